@@ -0,0 +1,566 @@
+/*******************************************************************************************************************************//**
+ *
+ * @file		falseshare.c
+ * @brief		Benchmark: líneas de caché compartidas entre procesos, con el formato anterior de la memoria
+ * 				compartida (o sus regiones sin alinear) y con ShmLayout_t. Mide tiempo, ciclos y fallos de caché
+ * 				con perf_event_open().
+ * @date		19 oct. 2026
+ * @author		Martinez Agustin
+ *
+ * Uso: make bench && ./bin/falseshare [vueltas]
+ * Hace falta más de una CPU para ver la diferencia: cada proceso se fija a una CPU distinta.
+ *
+ **********************************************************************************************************************************/
+
+ /***********************************************************************************************************************************
+ *** INCLUDES
+ **********************************************************************************************************************************/
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE     // sched_setaffinity(), CPU_SET()
+#endif
+#include <linux/perf_event.h>   // perf_event_attr
+#include <sys/syscall.h>        // SYS_perf_event_open
+#include <sys/ioctl.h>          // PERF_EVENT_IOC_ENABLE
+#include <sys/mman.h>           // mmap()
+#include <sys/wait.h>           // waitpid()
+#include <sched.h>              // sched_setaffinity()
+#include <stdio.h>              // printf()
+#include <stdlib.h>             // strtol(), exit()
+#include <string.h>             // memset()
+#include <unistd.h>             // fork(), sysconf()
+
+#include "../inc/shm.h"
+
+/***********************************************************************************************************************************
+ *** DEFINES PRIVADOS AL MODULO
+ **********************************************************************************************************************************/
+#define BENCH_DOORS     2               /**< Puertas (y procesos) de cada escenario */
+#define BENCH_LOOPS     20000000L       /**< Vueltas por proceso si no se indica otra cantidad */
+#define BENCH_SHM_SIZE  (sizeof(ShmLayout_t) + BENCH_DOORS * sizeof(DoorShm_t))     /**< Segmento con BENCH_DOORS puertas */
+#define BENCH_PAGE      4096            /**< Página: lo que separaba a las regiones cuando cada una tenía su mmap() */
+
+/***********************************************************************************************************************************
+ *** TIPO DE DATOS PRIVADOS AL MODULO
+ **********************************************************************************************************************************/
+/**
+ * \struct OldLogIndex_t
+ * \brief LogIndex_t antes de alinearlo: los contadores al final, pegados al índice de la puerta siguiente.
+ */
+typedef struct {
+    int16_t by_code[KEY_SPACE];
+    int16_t prev_code[MAX_LOG];
+    int16_t by_status[LOG_STATUSES];
+    int16_t prev_status[MAX_LOG];
+    uint32_t count[LOG_STATUSES];
+} OldLogIndex_t;
+
+/**
+ * \struct OldLogs_t
+ * \brief Segmento de logs anterior: [log puerta 0][log puerta 1][índice 0][índice 1], sin alinear.
+ */
+typedef struct {
+    ActivityEntry_t log[BENCH_DOORS][MAX_LOG];
+    OldLogIndex_t index[BENCH_DOORS];
+} OldLogs_t;
+
+/**
+ * \struct OldKeyShard_t
+ * \brief KeyShard_t antes de alinearlo: version y la cola de vencimientos pegadas al final de rules.
+ */
+typedef struct {
+    KeyEntry_t keys[MAX_VALID_KEYS];
+    KeyRule_t rules[MAX_VALID_KEYS];
+    uint32_t version;
+    uint32_t expire_count;
+    uint32_t expire_lost;
+    KeyExpire_t expire[KEY_EXPIRE_QUEUE];
+} OldKeyShard_t;
+
+/**
+ * \struct OldCounters_t
+ * \brief Contadores del pool, de los hijos y de TLS uno detrás de otro, sin alinear cada región.
+ * \details Así quedarían en el segmento sin padding: el final del pool (lo escriben los clientes) comparte línea
+ * con el comienzo de las estadísticas de los hijos (lo escribe el proceso principal).
+ */
+typedef struct {
+    BufPoolStats_t bufpool;
+    ChildStats_t children;
+    TlsStats_t tls;
+} OldCounters_t;
+
+/**
+ * \struct OldActuatorDoor_t
+ * \brief ActuatorDoorStats_t sin alinear: los contadores de dos puertas en la misma línea.
+ */
+typedef struct {
+    uint64_t queued;
+    uint64_t coalesced;
+    uint64_t batches;
+    uint64_t written;
+    uint32_t depth;
+    uint32_t max_depth;
+} OldActuatorDoor_t;
+
+/**
+ * \struct OldDoorLockouts_t
+ * \brief Lockout_t de cada puerta en un arreglo, en lugar de uno por DoorShm_t.
+ */
+typedef struct {
+    Lockout_t door[BENCH_DOORS];
+} OldDoorLockouts_t;
+
+/**
+ * \struct OldTables_t
+ * \brief StatsTable_t y LockoutTable_t como estaban antes: cada una en sus propias páginas (un mmap() por tabla).
+ */
+typedef struct {
+    _Alignas(BENCH_PAGE) StatsTable_t stats;
+    _Alignas(BENCH_PAGE) LockoutTable_t lockout;
+} OldTables_t;
+
+/**
+ * \struct Result_t
+ * \brief Lo que mide cada proceso.
+ */
+typedef struct {
+    double ms;                          /**< Tiempo */
+    uint64_t cycles;                    /**< Ciclos (solo espacio de usuario). 0 sin contadores */
+    uint64_t misses;                    /**< Fallos de caché. 0 sin contadores */
+} Result_t;
+
+/**
+ * \brief Trabajo de un proceso: _role 0 y 1 son las dos puertas, o el escritor y el lector.
+ */
+typedef void (*Work_t)(void* _mem, int _role, long _loops);
+
+/***********************************************************************************************************************************
+ *** PROTOTIPOS DE FUNCIONES PRIVADAS AL MODULO
+ **********************************************************************************************************************************/
+static void OldDoorWriter(void* _mem, int _role, long _loops);
+static void NewDoorWriter(void* _mem, int _role, long _loops);
+static void OldShardWork(void* _mem, int _role, long _loops);
+static void NewShardWork(void* _mem, int _role, long _loops);
+static void CountersWork(BufPoolStats_t* _bufpool, ChildStats_t* _children, TlsStats_t* _tls, int _role, long _loops);
+static void OldCountersWork(void* _mem, int _role, long _loops);
+static void NewCountersWork(void* _mem, int _role, long _loops);
+static void ActuatorWork(ActuatorDoorStats_t* _door, long _loops);
+static void OldActuatorWork(void* _mem, int _role, long _loops);
+static void NewActuatorWork(void* _mem, int _role, long _loops);
+static void LockoutWork(Lockout_t* _lockout, long _loops);
+static void OldLockoutWork(void* _mem, int _role, long _loops);
+static void NewLockoutWork(void* _mem, int _role, long _loops);
+static void TablesWork(StatsTable_t* _stats, LockoutTable_t* _lockout, int _role, long _loops);
+static void OldTablesWork(void* _mem, int _role, long _loops);
+static void NewTablesWork(void* _mem, int _role, long _loops);
+static int CounterOpen(uint64_t _config);
+static uint64_t CounterRead(int _fd);
+static void Run(const char* _name, Work_t _work, size_t _size, long _loops);
+
+/***********************************************************************************************************************************
+ *** FUNCIONES
+ **********************************************************************************************************************************/
+int main(int argc, char* argv[])
+{
+    long loops = (argc > 1) ? strtol(argv[1], NULL, 10) : BENCH_LOOPS;
+
+    if (loops <= 0){
+        printf("Uso: %s [vueltas]\n", argv[0]);
+        return 1;
+    }
+    if (sysconf(_SC_NPROCESSORS_ONLN) < 2){
+        printf("Hay una sola CPU: los procesos se turnan y no hay líneas compartidas entre núcleos que medir.\n");
+    }
+    printf("%-34s %10s %12s %12s\n", "escenario", "ms", "ciclos/op", "fallos/op");
+    Run("dos lectores, formato anterior", OldDoorWriter, sizeof(OldLogs_t), loops);
+    Run("dos lectores, ShmLayout_t", NewDoorWriter, BENCH_SHM_SIZE, loops);
+    Run("claves: web y lector, anterior", OldShardWork, sizeof(OldKeyShard_t), loops);
+    Run("claves: web y lector, KeyShard_t", NewShardWork, sizeof(KeyShard_t), loops);
+    Run("hijos y clientes, sin alinear", OldCountersWork, sizeof(OldCounters_t), loops);
+    Run("hijos y clientes, ShmLayout_t", NewCountersWork, BENCH_SHM_SIZE, loops);
+    Run("actuadores, sin alinear", OldActuatorWork, sizeof(OldActuatorDoor_t) * BENCH_DOORS, loops);
+    Run("actuadores, ShmLayout_t", NewActuatorWork, BENCH_SHM_SIZE, loops);
+    Run("bloqueo por puerta, arreglo", OldLockoutWork, sizeof(OldDoorLockouts_t), loops);
+    Run("bloqueo por puerta, DoorShm_t", NewLockoutWork, BENCH_SHM_SIZE, loops);
+    Run("tablas: /stats y web, separadas", OldTablesWork, sizeof(OldTables_t), loops);
+    Run("tablas: /stats y web, ShmLayout_t", NewTablesWork, BENCH_SHM_SIZE, loops);
+    return 0;
+}
+
+/***********************************************************************************************************************************
+ *** FUNCIONES PRIVADAS AL MODULO
+ **********************************************************************************************************************************/
+/**
+ * \fn static void OldDoorWriter(void* _mem, int _role, long _loops)
+ * \brief Lo que hace AddLog() en el lector de una puerta, con el formato anterior.
+ * \param [in] _mem: OldLogs_t.
+ * \param [in] _role: Puerta.
+ * \param [in] _loops: Entradas a escribir.
+*/
+static void OldDoorWriter(void* _mem, int _role, long _loops)
+{
+    OldLogs_t* logs = (OldLogs_t*)_mem;
+
+    for (long i = 0; i < _loops; i++){
+        ActivityEntry_t* entry = &logs->log[_role][i % MAX_LOG];
+        __atomic_store_n(&entry->time_ns, i, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&logs->index[_role].count[i & 1], 1, __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * \fn static void NewDoorWriter(void* _mem, int _role, long _loops)
+ * \brief Lo que hace AddLog() en el lector de una puerta, con ShmLayout_t.
+ * \param [in] _mem: ShmLayout_t.
+ * \param [in] _role: Puerta.
+ * \param [in] _loops: Entradas a escribir.
+*/
+static void NewDoorWriter(void* _mem, int _role, long _loops)
+{
+    DoorShm_t* door = &((ShmLayout_t*)_mem)->door[_role];
+
+    for (long i = 0; i < _loops; i++){
+        ActivityEntry_t* entry = &door->log[i % MAX_LOG];
+        __atomic_store_n(&entry->time_ns, i, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&door->index.count[i & 1], 1, __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * \fn static void OldShardWork(void* _mem, int _role, long _loops)
+ * \brief Rol 0: la web cambia claves (version y cola de vencimientos). Rol 1: el lector busca la última clave.
+ * \param [in] _mem: OldKeyShard_t.
+ * \param [in] _role: 0 escritor, 1 lector.
+ * \param [in] _loops: Vueltas.
+*/
+static void OldShardWork(void* _mem, int _role, long _loops)
+{
+    OldKeyShard_t* shard = (OldKeyShard_t*)_mem;
+    uint64_t sum = 0;
+
+    for (long i = 0; i < _loops; i++){
+        if (_role == 0){
+            __atomic_fetch_add(&shard->version, 1, __ATOMIC_RELAXED);
+            __atomic_store_n(&shard->expire_count, (uint32_t)i, __ATOMIC_RELAXED);
+        }
+        else{
+            sum += __atomic_load_n(&shard->rules[MAX_VALID_KEYS - 1].end_ns, __ATOMIC_RELAXED);
+        }
+    }
+    __asm__ volatile("" : : "r"(sum));
+}
+
+/**
+ * \fn static void NewShardWork(void* _mem, int _role, long _loops)
+ * \brief Igual que OldShardWork() sobre KeyShard_t.
+ * \param [in] _mem: KeyShard_t.
+ * \param [in] _role: 0 escritor, 1 lector.
+ * \param [in] _loops: Vueltas.
+*/
+static void NewShardWork(void* _mem, int _role, long _loops)
+{
+    KeyShard_t* shard = (KeyShard_t*)_mem;
+    uint64_t sum = 0;
+
+    for (long i = 0; i < _loops; i++){
+        if (_role == 0){
+            __atomic_fetch_add(&shard->version, 1, __ATOMIC_RELAXED);
+            __atomic_store_n(&shard->expire_count, (uint32_t)i, __ATOMIC_RELAXED);
+        }
+        else{
+            sum += __atomic_load_n(&shard->rules[MAX_VALID_KEYS - 1].end_ns, __ATOMIC_RELAXED);
+        }
+    }
+    __asm__ volatile("" : : "r"(sum));
+}
+
+/**
+ * \fn static void CountersWork(BufPoolStats_t* _bufpool, ChildStats_t* _children, TlsStats_t* _tls, int _role, long _loops)
+ * \brief Rol 0: el proceso principal lanza y junta hijos. Rol 1: un cliente pide buffers y hace handshakes.
+ * \param [in] _bufpool: Estadísticas del pool.
+ * \param [in] _children: Estadísticas de los hijos.
+ * \param [in] _tls: Estadísticas de TLS.
+ * \param [in] _role: 0 principal, 1 cliente.
+ * \param [in] _loops: Vueltas.
+*/
+static void CountersWork(BufPoolStats_t* _bufpool, ChildStats_t* _children, TlsStats_t* _tls, int _role, long _loops)
+{
+    for (long i = 0; i < _loops; i++){
+        if (_role == 0){
+            __atomic_fetch_add(&_children->started, 1, __ATOMIC_RELAXED);
+            __atomic_store_n(&_children->active, (uint32_t)i, __ATOMIC_RELAXED);
+        }
+        else{
+            __atomic_fetch_add(&_bufpool->cls[BUF_CLASSES - 1].gets, 1, __ATOMIC_RELAXED);
+            __atomic_fetch_add(&_bufpool->fallbacks, 1, __ATOMIC_RELAXED);
+            __atomic_fetch_add(&_tls->full, 1, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+/**
+ * \fn static void OldCountersWork(void* _mem, int _role, long _loops)
+ * \brief CountersWork() sobre OldCounters_t.
+ * \param [in] _mem: OldCounters_t.
+ * \param [in] _role: 0 principal, 1 cliente.
+ * \param [in] _loops: Vueltas.
+*/
+static void OldCountersWork(void* _mem, int _role, long _loops)
+{
+    OldCounters_t* counters = (OldCounters_t*)_mem;
+
+    CountersWork(&counters->bufpool, &counters->children, &counters->tls, _role, _loops);
+}
+
+/**
+ * \fn static void NewCountersWork(void* _mem, int _role, long _loops)
+ * \brief CountersWork() sobre las regiones de ShmLayout_t.
+ * \param [in] _mem: ShmLayout_t.
+ * \param [in] _role: 0 principal, 1 cliente.
+ * \param [in] _loops: Vueltas.
+*/
+static void NewCountersWork(void* _mem, int _role, long _loops)
+{
+    ShmLayout_t* shm = (ShmLayout_t*)_mem;
+
+    CountersWork(&shm->bufpool, &shm->children, &shm->tls, _role, _loops);
+}
+
+/**
+ * \fn static void ActuatorWork(ActuatorDoorStats_t* _door, long _loops)
+ * \brief Lo que cuenta ActuatorPush() en el lector de una puerta.
+ * \param [in] _door: Contadores de la puerta.
+ * \param [in] _loops: Comandos.
+*/
+static void ActuatorWork(ActuatorDoorStats_t* _door, long _loops)
+{
+    for (long i = 0; i < _loops; i++){
+        __atomic_fetch_add(&_door->queued, 1, __ATOMIC_RELAXED);
+        __atomic_store_n(&_door->depth, (uint32_t)(i & 7), __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * \fn static void OldActuatorWork(void* _mem, int _role, long _loops)
+ * \brief ActuatorWork() con los contadores de las puertas pegados.
+ * \param [in] _mem: OldActuatorDoor_t[BENCH_DOORS].
+ * \param [in] _role: Puerta.
+ * \param [in] _loops: Comandos.
+*/
+static void OldActuatorWork(void* _mem, int _role, long _loops)
+{
+    OldActuatorDoor_t* door = &((OldActuatorDoor_t*)_mem)[_role];
+
+    for (long i = 0; i < _loops; i++){
+        __atomic_fetch_add(&door->queued, 1, __ATOMIC_RELAXED);
+        __atomic_store_n(&door->depth, (uint32_t)(i & 7), __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * \fn static void NewActuatorWork(void* _mem, int _role, long _loops)
+ * \brief ActuatorWork() sobre ShmLayout_t.
+ * \param [in] _mem: ShmLayout_t.
+ * \param [in] _role: Puerta.
+ * \param [in] _loops: Comandos.
+*/
+static void NewActuatorWork(void* _mem, int _role, long _loops)
+{
+    ActuatorWork(&((ShmLayout_t*)_mem)->actuator.door[_role], _loops);
+}
+
+/**
+ * \fn static void LockoutWork(Lockout_t* _lockout, long _loops)
+ * \brief Lo que escribe LockoutFail() en el lector de una puerta.
+ * \param [in] _lockout: Bloqueo de la puerta.
+ * \param [in] _loops: Claves incorrectas.
+*/
+static void LockoutWork(Lockout_t* _lockout, long _loops)
+{
+    for (long i = 0; i < _loops; i++){
+        __atomic_fetch_add(&_lockout->window.current, 1, __ATOMIC_RELAXED);
+        __atomic_store_n(&_lockout->window.start_ns, i, __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * \fn static void OldLockoutWork(void* _mem, int _role, long _loops)
+ * \brief LockoutWork() sobre OldDoorLockouts_t.
+ * \param [in] _mem: OldDoorLockouts_t.
+ * \param [in] _role: Puerta.
+ * \param [in] _loops: Claves incorrectas.
+*/
+static void OldLockoutWork(void* _mem, int _role, long _loops)
+{
+    LockoutWork(&((OldDoorLockouts_t*)_mem)->door[_role], _loops);
+}
+
+/**
+ * \fn static void NewLockoutWork(void* _mem, int _role, long _loops)
+ * \brief LockoutWork() sobre el Lockout_t de cada DoorShm_t.
+ * \param [in] _mem: ShmLayout_t.
+ * \param [in] _role: Puerta.
+ * \param [in] _loops: Claves incorrectas.
+*/
+static void NewLockoutWork(void* _mem, int _role, long _loops)
+{
+    LockoutWork(&((ShmLayout_t*)_mem)->door[_role].lockout, _loops);
+}
+
+/**
+ * \fn static void TablesWork(StatsTable_t* _stats, LockoutTable_t* _lockout, int _role, long _loops)
+ * \brief Rol 0: un lector cuenta intentos en /stats (StatsAdd()). Rol 1: un cliente registra fallas de su origen.
+ * \details Cada tabla tiene su spinlock; lo que se mide es si las dos comparten líneas dentro del segmento.
+ * \param [in] _stats: Anillos de /stats.
+ * \param [in] _lockout: Orígenes web.
+ * \param [in] _role: 0 lector, 1 cliente.
+ * \param [in] _loops: Vueltas.
+*/
+static void TablesWork(StatsTable_t* _stats, LockoutTable_t* _lockout, int _role, long _loops)
+{
+    for (long i = 0; i < _loops; i++){
+        if (_role == 0){
+            while (__atomic_test_and_set(&_stats->lock, __ATOMIC_ACQUIRE)){
+                ;
+            }
+            _stats->hour[0][0].denied++;
+            __atomic_clear(&_stats->lock, __ATOMIC_RELEASE);
+        }
+        else{
+            while (__atomic_test_and_set(&_lockout->lock, __ATOMIC_ACQUIRE)){
+                ;
+            }
+            _lockout->sources[0].last_ns = i;
+            __atomic_clear(&_lockout->lock, __ATOMIC_RELEASE);
+        }
+    }
+}
+
+/**
+ * \fn static void OldTablesWork(void* _mem, int _role, long _loops)
+ * \brief TablesWork() con cada tabla en sus propias páginas.
+ * \param [in] _mem: OldTables_t.
+ * \param [in] _role: 0 lector, 1 cliente.
+ * \param [in] _loops: Vueltas.
+*/
+static void OldTablesWork(void* _mem, int _role, long _loops)
+{
+    OldTables_t* tables = (OldTables_t*)_mem;
+
+    TablesWork(&tables->stats, &tables->lockout, _role, _loops);
+}
+
+/**
+ * \fn static void NewTablesWork(void* _mem, int _role, long _loops)
+ * \brief TablesWork() sobre las regiones de ShmLayout_t.
+ * \param [in] _mem: ShmLayout_t.
+ * \param [in] _role: 0 lector, 1 cliente.
+ * \param [in] _loops: Vueltas.
+*/
+static void NewTablesWork(void* _mem, int _role, long _loops)
+{
+    ShmLayout_t* shm = (ShmLayout_t*)_mem;
+
+    TablesWork(&shm->stats, &shm->lockout, _role, _loops);
+}
+
+/**
+ * \fn static int CounterOpen(uint64_t _config)
+ * \brief Abre un contador de hardware del proceso actual, solo en espacio de usuario.
+ * \param [in] _config: PERF_COUNT_HW_*.
+ * \return fd del contador. -1 si el kernel no lo permite (perf_event_paranoid, máquina virtual).
+*/
+static int CounterOpen(uint64_t _config)
+{
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = _config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+/**
+ * \fn static uint64_t CounterRead(int _fd)
+ * \brief Lee y cierra un contador.
+ * \param [in] _fd: Contador de CounterOpen().
+ * \return Cuenta. 0 si no hay contador.
+*/
+static uint64_t CounterRead(int _fd)
+{
+    uint64_t value = 0;
+
+    if (_fd < 0){
+        return 0;
+    }
+    ioctl(_fd, PERF_EVENT_IOC_DISABLE, 0);
+    if (read(_fd, &value, sizeof(value)) != sizeof(value)){
+        value = 0;
+    }
+    close(_fd);
+    return value;
+}
+
+/**
+ * \fn static void Run(const char* _name, Work_t _work, size_t _size, long _loops)
+ * \brief Corre un escenario: dos procesos sobre una memoria compartida nueva, cada uno en su CPU.
+ * \param [in] _name: Nombre del escenario.
+ * \param [in] _work: Trabajo de cada proceso.
+ * \param [in] _size: Tamaño de la memoria compartida.
+ * \param [in] _loops: Vueltas por proceso.
+*/
+static void Run(const char* _name, Work_t _work, size_t _size, long _loops)
+{
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    void* mem = mmap(NULL, _size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    Result_t* results = mmap(NULL, sizeof(Result_t) * BENCH_DOORS, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    Result_t total = { 0, 0, 0 };
+
+    if (mem == MAP_FAILED || results == MAP_FAILED){
+        perror("mmap");
+        exit(1);
+    }
+    for (int role = 0; role < BENCH_DOORS; role++){
+        if (fork() == 0){
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(role % (cpus > 0 ? cpus : 1), &set);
+            sched_setaffinity(0, sizeof(set), &set);
+
+            int cycles = CounterOpen(PERF_COUNT_HW_CPU_CYCLES);
+            int misses = CounterOpen(PERF_COUNT_HW_CACHE_MISSES);
+            int64_t start = TimeNowNs();
+            if (cycles >= 0){
+                ioctl(cycles, PERF_EVENT_IOC_ENABLE, 0);
+            }
+            if (misses >= 0){
+                ioctl(misses, PERF_EVENT_IOC_ENABLE, 0);
+            }
+            _work(mem, role, _loops);
+            results[role].cycles = CounterRead(cycles);
+            results[role].misses = CounterRead(misses);
+            results[role].ms = (TimeNowNs() - start) / 1e6;
+            _exit(0);
+        }
+    }
+    while (wait(NULL) > 0){
+        ;
+    }
+    for (int role = 0; role < BENCH_DOORS; role++){
+        total.ms = (results[role].ms > total.ms) ? results[role].ms : total.ms;
+        total.cycles += results[role].cycles;
+        total.misses += results[role].misses;
+    }
+    double ops = (double)_loops * BENCH_DOORS;
+    if (total.cycles == 0){
+        printf("%-34s %10.1f %12s %12s\n", _name, total.ms, "-", "-");
+    }
+    else{
+        printf("%-34s %10.1f %12.2f %12.4f\n", _name, total.ms, total.cycles / ops, total.misses / ops);
+    }
+    munmap(mem, _size);
+    munmap(results, sizeof(Result_t) * BENCH_DOORS);
+}
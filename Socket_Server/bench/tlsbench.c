@@ -0,0 +1,220 @@
+/*******************************************************************************************************************************//**
+ *
+ * @file		tlsbench.c
+ * @brief		Benchmark: pedidos HTTPS al panel con un handshake completo por pedido y reanudando la sesión
+ * 				(tickets de TLS 1.3 o caché de sesiones).
+ * @date		19 oct. 2026
+ * @author		Martinez Agustin
+ *
+ * Uso: make bench && ./bin/tlsbench [host] [puerto] [pedidos] [ruta]
+ * El servidor tiene que escuchar con la opción tls (LISTEN=[::]:8443 tls). El certificado no se valida.
+ *
+ **********************************************************************************************************************************/
+
+ /***********************************************************************************************************************************
+ *** INCLUDES
+ **********************************************************************************************************************************/
+#include <openssl/ssl.h>        // SSL_connect(), SSL_set_session()
+#include <openssl/err.h>        // ERR_print_errors_fp()
+#include <sys/socket.h>         // socket(), connect()
+#include <netdb.h>              // getaddrinfo()
+#include <stdio.h>              // printf()
+#include <stdlib.h>             // strtol(), qsort()
+#include <string.h>             // strlen()
+#include <unistd.h>             // close()
+
+#include "../inc/timefmt.h"
+
+/***********************************************************************************************************************************
+ *** DEFINES PRIVADOS AL MODULO
+ **********************************************************************************************************************************/
+#define BENCH_HOST      "127.0.0.1"     /**< Servidor si no se indica otro */
+#define BENCH_PORT      "8443"          /**< Puerto si no se indica otro */
+#define BENCH_REQUESTS  200             /**< Pedidos por escenario si no se indica otra cantidad */
+#define BENCH_PATH      "/claves"       /**< Ruta pedida si no se indica otra */
+
+/***********************************************************************************************************************************
+ *** TIPO DE DATOS PRIVADOS AL MODULO
+ **********************************************************************************************************************************/
+/**
+ * \struct Sample_t
+ * \brief Tiempos de un pedido.
+ */
+typedef struct {
+    int64_t handshake_ns;               /**< connect() y handshake */
+    int64_t total_ns;                   /**< Pedido completo, hasta que el servidor cierra */
+    int resumed;                        /**< El servidor aceptó la sesión anterior */
+} Sample_t;
+
+/***********************************************************************************************************************************
+ *** PROTOTIPOS DE FUNCIONES PRIVADAS AL MODULO
+ **********************************************************************************************************************************/
+static int Request(SSL_CTX* _ctx, const struct addrinfo* _addr, const char* _path, SSL_SESSION** _session, Sample_t* _sample);
+static void Run(const char* _name, SSL_CTX* _ctx, const struct addrinfo* _addr, const char* _path, int _requests, int _resume);
+static int CompareNs(const void* _a, const void* _b);
+
+/***********************************************************************************************************************************
+ *** FUNCIONES
+ **********************************************************************************************************************************/
+int main(int argc, char* argv[])
+{
+    const char* host = (argc > 1) ? argv[1] : BENCH_HOST;
+    const char* port = (argc > 2) ? argv[2] : BENCH_PORT;
+    int requests = (argc > 3) ? (int)strtol(argv[3], NULL, 10) : BENCH_REQUESTS;
+    const char* path = (argc > 4) ? argv[4] : BENCH_PATH;
+    struct addrinfo hints;
+    struct addrinfo* addr;
+
+    if (requests <= 0){
+        printf("Uso: %s [host] [puerto] [pedidos] [ruta]\n", argv[0]);
+        return 1;
+    }
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(host, port, &hints, &addr) != 0){
+        printf("Dirección inválida: %s:%s\n", host, port);
+        return 1;
+    }
+
+    SSL_CTX* ctx = SSL_CTX_new(TLS_client_method());
+    if (ctx == NULL){
+        ERR_print_errors_fp(stdout);
+        return 1;
+    }
+    SSL_CTX_set_verify(ctx, SSL_VERIFY_NONE, NULL);     // Certificado autofirmado de prueba
+    SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_CLIENT);
+
+    printf("%-30s %8s %10s %12s %12s %12s %10s\n", "escenario", "pedidos", "reanudados", "handshake ms", "p99 ms",
+           "pedido ms", "pedidos/s");
+    Run("handshake completo por pedido", ctx, addr, path, requests, 0);
+    Run("sesión reanudada", ctx, addr, path, requests, 1);
+
+    SSL_CTX_free(ctx);
+    freeaddrinfo(addr);
+    return 0;
+}
+
+/***********************************************************************************************************************************
+ *** FUNCIONES PRIVADAS AL MODULO
+ **********************************************************************************************************************************/
+/**
+ * \fn static void Run(const char* _name, SSL_CTX* _ctx, const struct addrinfo* _addr, const char* _path, int _requests, int _resume)
+ * \brief Hace _requests pedidos seguidos, cada uno en su conexión, y muestra los tiempos.
+ * \param [in] _name: Escenario.
+ * \param [in] _ctx: Contexto cliente.
+ * \param [in] _addr: Servidor.
+ * \param [in] _path: Ruta pedida.
+ * \param [in] _requests: Cantidad de pedidos.
+ * \param [in] _resume: Distinto de 0 para ofrecer la sesión del pedido anterior.
+*/
+static void Run(const char* _name, SSL_CTX* _ctx, const struct addrinfo* _addr, const char* _path, int _requests, int _resume)
+{
+    Sample_t* samples = (Sample_t*)calloc(_requests, sizeof(Sample_t));
+    int64_t* handshakes = (int64_t*)calloc(_requests, sizeof(int64_t));
+    SSL_SESSION* session = NULL;
+    int64_t handshake_ns = 0;
+    int64_t total_ns = 0;
+    int resumed = 0;
+    int done = 0;
+
+    if (samples == NULL || handshakes == NULL){
+        free(samples);
+        free(handshakes);
+        return;
+    }
+    int64_t start = TimeNowNs();
+    for (int i = 0; i < _requests; i++){
+        if (Request(_ctx, _addr, _path, _resume ? &session : NULL, &samples[done]) < 0){
+            continue;
+        }
+        handshakes[done] = samples[done].handshake_ns;
+        handshake_ns += samples[done].handshake_ns;
+        total_ns += samples[done].total_ns;
+        resumed += samples[done].resumed;
+        done++;
+    }
+    double elapsed_s = (TimeNowNs() - start) / 1e9;
+    SSL_SESSION_free(session);
+
+    if (done == 0){
+        printf("%-30s %8d %10s %12s %12s %12s %10s\n", _name, 0, "-", "-", "-", "-", "-");
+    }
+    else{
+        qsort(handshakes, done, sizeof(int64_t), CompareNs);
+        printf("%-30s %8d %10d %12.3f %12.3f %12.3f %10.1f\n", _name, done, resumed, handshake_ns / 1e6 / done,
+               handshakes[(done * 99) / 100] / 1e6, total_ns / 1e6 / done, done / elapsed_s);
+    }
+    free(samples);
+    free(handshakes);
+}
+
+/**
+ * \fn static int Request(SSL_CTX* _ctx, const struct addrinfo* _addr, const char* _path, SSL_SESSION** _session, Sample_t* _sample)
+ * \brief Un pedido GET en una conexión nueva, leyendo la respuesta hasta que el servidor cierra.
+ * \param [in] _ctx: Contexto cliente.
+ * \param [in] _addr: Servidor.
+ * \param [in] _path: Ruta pedida.
+ * \param [in] _session: Sesión a ofrecer; queda la que dejó el servidor (tickets). NULL: handshake completo siempre.
+ * \param [out] _sample: Tiempos.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+static int Request(SSL_CTX* _ctx, const struct addrinfo* _addr, const char* _path, SSL_SESSION** _session, Sample_t* _sample)
+{
+    char buff[4096];
+    size_t len;
+    int ret = -1;
+
+    int64_t start = TimeNowNs();
+    int fd = socket(_addr->ai_family, _addr->ai_socktype, _addr->ai_protocol);
+    if (fd < 0){
+        return -1;
+    }
+    SSL* ssl = SSL_new(_ctx);
+    if (ssl == NULL || connect(fd, _addr->ai_addr, _addr->ai_addrlen) < 0){
+        perror("connect");
+        goto end;
+    }
+    SSL_set_fd(ssl, fd);
+    if (_session != NULL && *_session != NULL){
+        SSL_set_session(ssl, *_session);
+    }
+    if (SSL_connect(ssl) != 1){
+        ERR_print_errors_fp(stdout);
+        goto end;
+    }
+    _sample->handshake_ns = TimeNowNs() - start;
+    _sample->resumed = SSL_session_reused(ssl);
+
+    int n = snprintf(buff, sizeof(buff), "GET %s HTTP/1.1\r\nHost: bench\r\n\r\n", _path);
+    if (SSL_write_ex(ssl, buff, n, &len) != 1){
+        goto end;
+    }
+    while (SSL_read_ex(ssl, buff, sizeof(buff), &len) == 1){
+        ;
+    }
+    _sample->total_ns = TimeNowNs() - start;
+    SSL_shutdown(ssl);      // Sin close_notify SSL_free() descarta la sesión
+    if (_session != NULL){      // Con TLS 1.3 los tickets llegan después del handshake: se toman al final
+        SSL_SESSION_free(*_session);
+        *_session = SSL_get1_session(ssl);
+    }
+    ret = 0;
+end:
+    SSL_free(ssl);
+    close(fd);
+    return ret;
+}
+
+/**
+ * \fn static int CompareNs(const void* _a, const void* _b)
+ * \brief Orden de qsort() para tiempos.
+ * \param [in] _a: int64_t.
+ * \param [in] _b: int64_t.
+ * \return <0, 0 o >0.
+*/
+static int CompareNs(const void* _a, const void* _b)
+{
+    int64_t a = *(const int64_t*)_a;
+    int64_t b = *(const int64_t*)_b;
+    return (a > b) - (a < b);
+}
@@ -0,0 +1,128 @@
+/*******************************************************************************************************************************//**
+ *
+ * @file		actuator.h
+ * @brief		Cola de comandos a leds y buzzer: junta los de una ráfaga en una sola escritura al driver.
+ * @date		19 oct. 2026
+ * @author		Martinez Agustin
+ *
+ **********************************************************************************************************************************/
+
+ /***********************************************************************************************************************************
+ *** MODULO
+ **********************************************************************************************************************************/
+#ifndef ACTUATOR_H
+#define ACTUATOR_H
+
+/***********************************************************************************************************************************
+ *** INCLUDES GLOBALES
+ **********************************************************************************************************************************/
+#include <stdio.h>      // snprintf()
+#include <stdint.h>     // uint64_t
+#include <string.h>     // memmove()
+
+#include "../inc/driverHandler.h"
+#include "../inc/door.h"
+
+/***********************************************************************************************************************************
+ *** DEFINES GLOBALES
+ **********************************************************************************************************************************/
+#define ACTUATOR_QUEUE_LEN  8           /**< Comandos pendientes por puerta (con la fusión nunca se llega) */
+
+/***********************************************************************************************************************************
+ *** TIPO DE DATOS GLOBALES
+ **********************************************************************************************************************************/
+/**
+ * \struct ActuatorDoorStats_t
+ * \brief Contadores de la cola de una puerta.
+ * \details Los escribe solo el lector de la puerta: cada puerta en su propia línea de caché.
+ */
+typedef struct {
+    _Alignas(CACHE_LINE) uint64_t queued;   /**< Comandos recibidos */
+    uint64_t coalesced;             /**< Comandos descartados porque otro posterior los reemplazó */
+    uint64_t batches;               /**< Escrituras al driver (una por tanda) */
+    uint64_t written;               /**< Comandos escritos */
+    uint32_t depth;                 /**< Comandos pendientes ahora */
+    uint32_t max_depth;             /**< Máximo de pendientes */
+} ActuatorDoorStats_t;
+
+/**
+ * \struct ActuatorStats_t
+ * \brief Estadísticas de todas las puertas, en la memoria compartida por el servidor y los lectores.
+ */
+typedef struct {
+    ActuatorDoorStats_t door[MAX_DOORS];    /**< Por puerta */
+} ActuatorStats_t;
+
+/**
+ * \struct Actuator_t
+ * \brief Cola de comandos de una puerta. La usa solo el lector de esa puerta.
+ */
+typedef struct {
+    int id;                                     /**< Puerta */
+    int fd;                                     /**< Driver */
+    int sem;                                    /**< Semáforo de escritura */
+    driver_msg_t pending[ACTUATOR_QUEUE_LEN];   /**< Comandos pendientes, en orden */
+    int count;                                  /**< Cantidad de pendientes */
+    int64_t deadline_ns;                        /**< Instante en que se escriben los pendientes */
+} Actuator_t;
+
+/***********************************************************************************************************************************
+ *** IMPLANTACION DE LA CLASE
+ **********************************************************************************************************************************/
+/**
+ * \fn void ActuatorSetup(ActuatorStats_t* _stats, long _window_ms)
+ * \brief Fija la ventana de fusión y las estadísticas. Se llama una vez antes de lanzar los lectores.
+ * \param [in] _stats: Estadísticas en la memoria compartida (ShmLayout_t). NULL: sin estadísticas.
+ * \param [in] _window_ms: Espera desde el primer comando pendiente hasta escribir (ACTUATOR_WINDOW). 0: sin espera.
+*/
+void ActuatorSetup(ActuatorStats_t* _stats, long _window_ms);
+
+/**
+ * \fn void ActuatorInit(Actuator_t* _act, const Door_t* _door, int _id)
+ * \brief Prepara la cola de una puerta.
+ * \param [out] _act: Cola.
+ * \param [in] _door: Puerta.
+ * \param [in] _id: Id de la puerta.
+*/
+void ActuatorInit(Actuator_t* _act, const Door_t* _door, int _id);
+
+/**
+ * \fn int ActuatorPush(Actuator_t* _act, driver_msg_t _msg, int64_t _now_ns)
+ * \brief Encola un comando, fusionándolo con los pendientes.
+ * \details Un comando de led reemplaza a cualquier led pendiente (solo se vería el último) y un comando repetido
+ * reemplaza al anterior. Si la ventana es 0 se escribe enseguida.
+ * \param [in] _act: Cola.
+ * \param [in] _msg: Comando.
+ * \param [in] _now_ns: Instante actual.
+ * \return Devuelve -1 si falló una escritura. 0 sino.
+*/
+int ActuatorPush(Actuator_t* _act, driver_msg_t _msg, int64_t _now_ns);
+
+/**
+ * \fn int ActuatorTimeout(const Actuator_t* _act, int64_t _now_ns)
+ * \brief Milisegundos hasta que vence la ventana.
+ * \param [in] _act: Cola.
+ * \param [in] _now_ns: Instante actual.
+ * \return Timeout para poll(). -1 si no hay pendientes.
+*/
+int ActuatorTimeout(const Actuator_t* _act, int64_t _now_ns);
+
+/**
+ * \fn int ActuatorFlush(Actuator_t* _act)
+ * \brief Escribe todos los pendientes con un solo writeDriverBatch().
+ * \param [in] _act: Cola.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+int ActuatorFlush(Actuator_t* _act);
+
+/**
+ * \fn int ActuatorMetrics(char* _out, size_t _size, int _doors)
+ * \brief Escribe las estadísticas de las colas en formato de texto de Prometheus.
+ * \param [out] _out: Buffer.
+ * \param [in] _size: Tamaño de _out.
+ * \param [in] _doors: Cantidad de puertas.
+ * \return Bytes escritos. -1 si no entra.
+*/
+int ActuatorMetrics(char* _out, size_t _size, int _doors);
+
+#endif /* ACTUATOR_H */
@@ -0,0 +1,123 @@
+/*******************************************************************************************************************************//**
+ *
+ * @file		bufpool.h
+ * @brief		Pool de buffers de E/S de tamaño fijo (slabs por clase) para atender pedidos sin malloc().
+ * @date		19 oct. 2026
+ * @author		Martinez Agustin
+ *
+ **********************************************************************************************************************************/
+
+ /***********************************************************************************************************************************
+ *** MODULO
+ **********************************************************************************************************************************/
+#ifndef BUFPOOL_H
+#define BUFPOOL_H
+
+/***********************************************************************************************************************************
+ *** INCLUDES GLOBALES
+ **********************************************************************************************************************************/
+#include <sys/mman.h>   // mmap()
+#include <stdio.h>      // snprintf()
+#include <stdlib.h>     // malloc(), free()
+#include <string.h>     // memset()
+#include <stdint.h>     // uint64_t
+
+/***********************************************************************************************************************************
+ *** DEFINES GLOBALES
+ **********************************************************************************************************************************/
+#define BUF_CLASSES         4           /**< Cantidad de tamaños de buffer */
+#define BUF_CLASS_SIZES     { 4096, 32768, 262144, 2097152 }   /**< Tamaño de cada clase: respuesta corta, JSON de claves, pedido, reglas */
+#define BUF_CLASS_COUNTS    { 16, 8, 4, 2 } /**< Buffers de cada clase por pool (proceso o hilo) */
+#define BUF_MAX_PER_CLASS   16          /**< Máximo de BUF_CLASS_COUNTS */
+
+/***********************************************************************************************************************************
+ *** TIPO DE DATOS GLOBALES
+ **********************************************************************************************************************************/
+/**
+ * \struct BufClassStats_t
+ * \brief Contadores de una clase, sumados entre todos los procesos.
+ */
+typedef struct {
+    uint64_t gets;                  /**< Buffers entregados */
+    uint64_t puts;                  /**< Buffers devueltos */
+    uint64_t exhausted;             /**< Pedidos que encontraron la clase vacía y pasaron a la siguiente */
+} BufClassStats_t;
+
+/**
+ * \struct BufPoolStats_t
+ * \brief Estadísticas del pool, en la memoria compartida por el servidor y todos sus hijos.
+ */
+typedef struct {
+    BufClassStats_t cls[BUF_CLASSES];   /**< Por clase */
+    uint64_t pools;                     /**< Pools creados (uno por proceso y uno por hilo del pool de hilos) */
+    uint64_t fallbacks;                 /**< Pedidos más grandes que la clase mayor (o sin lugar): malloc() */
+    uint64_t fallback_bytes;            /**< Bytes pedidos a malloc() */
+} BufPoolStats_t;
+
+/**
+ * \struct BufPool_t
+ * \brief Pool de un proceso o de un hilo.
+ * \details Cada clase es un solo slab reservado con mmap() al arrancar. Las listas libres son pilas de índices, así
+ * armar el pool no toca las páginas de los buffers: cada hijo después de fork() tiene su propia copia de las listas y
+ * solo paga las páginas que escribe. Cada hilo del pool de hilos tiene su propio pool, así nunca se toma un lock.
+ */
+typedef struct {
+    char* slab[BUF_CLASSES];                        /**< Memoria de cada clase */
+    size_t size[BUF_CLASSES];                       /**< Tamaño de los buffers de cada clase */
+    int count[BUF_CLASSES];                         /**< Buffers de cada clase */
+    int free_count[BUF_CLASSES];                    /**< Buffers libres de cada clase */
+    uint16_t free_list[BUF_CLASSES][BUF_MAX_PER_CLASS]; /**< Índices libres (pila) */
+    BufPoolStats_t* stats;                          /**< En la memoria compartida */
+} BufPool_t;
+
+/***********************************************************************************************************************************
+ *** IMPLANTACION DE LA CLASE
+ **********************************************************************************************************************************/
+/**
+ * \fn int BufPoolInit(BufPoolStats_t* _stats)
+ * \brief Reserva los slabs del proceso principal. Se llama una vez, antes de los fork().
+ * \param [in] _stats: Estadísticas en la memoria compartida (ShmLayout_t).
+ * \return Devuelve -1 si error. 0 sino.
+*/
+int BufPoolInit(BufPoolStats_t* _stats);
+
+/**
+ * \fn int BufPoolThreadInit(void)
+ * \brief Crea el pool del hilo que llama. Las estadísticas siguen siendo las del proceso.
+ * \return Devuelve -1 si error (el hilo usa malloc()). 0 sino.
+*/
+int BufPoolThreadInit(void);
+
+/**
+ * \fn void BufPoolThreadFree(void)
+ * \brief Libera el pool del hilo que llama (al terminar el hilo).
+*/
+void BufPoolThreadFree(void);
+
+/**
+ * \fn void* BufGet(size_t _size)
+ * \brief Entrega un buffer de al menos _size bytes.
+ * \details Usa la clase más chica que alcanza; si está vacía, la siguiente. Si ninguna alcanza (o el pool no se
+ * inicializó) recurre a malloc() y lo cuenta en fallbacks.
+ * \param [in] _size: Bytes necesarios.
+ * \return El buffer. NULL si error.
+*/
+void* BufGet(size_t _size);
+
+/**
+ * \fn void BufPut(void* _buff)
+ * \brief Devuelve un buffer de BufGet(). Acepta NULL.
+ * \param [in] _buff: Buffer.
+*/
+void BufPut(void* _buff);
+
+/**
+ * \fn int BufPoolMetrics(char* _out, size_t _size)
+ * \brief Escribe las estadísticas del pool en formato de texto de Prometheus.
+ * \param [out] _out: Buffer.
+ * \param [in] _size: Tamaño de _out.
+ * \return Bytes escritos. -1 si no entra.
+*/
+int BufPoolMetrics(char* _out, size_t _size);
+
+#endif /* BUFPOOL_H */
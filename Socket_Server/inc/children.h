@@ -0,0 +1,153 @@
+/*******************************************************************************************************************************//**
+ *
+ * @file		children.h
+ * @brief		Procesos hijo que atienden clientes: cuenta, tiempos y recolección con signalfd() dentro del poll().
+ * @date		19 oct. 2026
+ * @author		Martinez Agustin
+ *
+ **********************************************************************************************************************************/
+
+ /***********************************************************************************************************************************
+ *** MODULO
+ **********************************************************************************************************************************/
+#ifndef CHILDREN_H
+#define CHILDREN_H
+
+/***********************************************************************************************************************************
+ *** INCLUDES GLOBALES
+ **********************************************************************************************************************************/
+#include <sys/signalfd.h>   // signalfd()
+#include <sys/wait.h>       // waitpid()
+#include <signal.h>         // sigprocmask()
+#include <stdio.h>          // snprintf()
+#include <stdint.h>         // uint64_t, int64_t
+#include <unistd.h>         // read(), close()
+#include <errno.h>          // errno
+
+#include "../inc/timefmt.h"
+
+/***********************************************************************************************************************************
+ *** DEFINES GLOBALES
+ **********************************************************************************************************************************/
+#define MAX_CHILDREN        1024        /**< Clientes en proceso hijo a la vez (máximo de MAX_CONNECTIONS) */
+#define CHILD_BUCKETS       6           /**< Rangos del histograma de duración (el último es +Inf) */
+
+/***********************************************************************************************************************************
+ *** TIPO DE DATOS GLOBALES
+ **********************************************************************************************************************************/
+/**
+ * \struct Child_t
+ * \brief Un cliente atendido en un proceso hijo.
+ */
+typedef struct {
+    pid_t pid;                      /**< Proceso */
+    int64_t start_ns;               /**< Instante del fork() */
+} Child_t;
+
+/**
+ * \struct ChildStats_t
+ * \brief Estadísticas de los hijos, en la memoria compartida para que las lea /metrics desde cualquier hijo.
+ * \details Solo las escribe el proceso principal.
+ */
+typedef struct {
+    uint64_t started;                   /**< Hijos lanzados */
+    uint64_t finished;                  /**< Hijos terminados */
+    uint64_t failed;                    /**< Terminados con exit() distinto de 0 o por una señal */
+    uint64_t runtime_ns;                /**< Suma de las duraciones */
+    uint64_t runtime_max_ns;            /**< Duración más larga */
+    uint64_t bucket[CHILD_BUCKETS];     /**< Terminados por rango de duración (no acumulado) */
+    uint32_t active;                    /**< Hijos vivos */
+} ChildStats_t;
+
+/**
+ * \struct ChildTable_t
+ * \brief Hijos vivos del proceso principal y el signalfd por el que llegan SIGCHLD y las demás señales.
+ */
+typedef struct {
+    int fd;                             /**< signalfd de SIGCHLD y de las señales del lazo principal (va en su poll()). -1 si no hay */
+    Child_t child[MAX_CHILDREN];        /**< Hijos vivos, compactos */
+    int count;                          /**< Cantidad de hijos vivos */
+} ChildTable_t;
+
+/**
+ * \brief Función que recibe los procesos terminados que no son clientes (lectores, réplicas).
+ * \param [in] _pid: Proceso.
+ * \param [in] _status: Estado de waitpid().
+ */
+typedef void (*ChildExit_t)(pid_t _pid, int _status);
+
+/***********************************************************************************************************************************
+ *** IMPLANTACION DE LA CLASE
+ **********************************************************************************************************************************/
+/**
+ * \fn int ChildrenInit(ChildTable_t* _table, const sigset_t* _signals, ChildStats_t* _stats)
+ * \brief Bloquea SIGCHLD y _signals y crea un signalfd para todas. Se llama una vez antes de lanzar hilos y de
+ * aceptar clientes.
+ * \details Con las señales bloqueadas quedan pendientes hasta que el lazo principal las lee del signalfd: no hay
+ * handler que modifique la cuenta de hijos mientras el lazo la consulta, ni una señal que llegue entre revisar un
+ * pedido y entrar al poll() y se pierda. Los hilos que se lancen después heredan la máscara.
+ * \param [out] _table: Tabla.
+ * \param [in] _signals: Señales que también se leen del signalfd (SIGCHLD se agrega siempre).
+ * \param [in] _stats: Estadísticas en la memoria compartida (ShmLayout_t). NULL: sin estadísticas.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+int ChildrenInit(ChildTable_t* _table, const sigset_t* _signals, ChildStats_t* _stats);
+
+/**
+ * \fn int ChildrenAdd(ChildTable_t* _table, pid_t _pid)
+ * \brief Registra un hijo recién lanzado.
+ * \param [in] _table: Tabla.
+ * \param [in] _pid: Proceso.
+ * \return Devuelve -1 si la tabla está llena. 0 sino.
+*/
+int ChildrenAdd(ChildTable_t* _table, pid_t _pid);
+
+/**
+ * \fn int ChildrenReap(ChildTable_t* _table, ChildExit_t _other)
+ * \brief Junta todos los hijos terminados sin bloquear. Se llama al leer SIGCHLD de ChildrenNextSignal().
+ * \details Los clientes salen de la tabla y se cuentan en las estadísticas. El resto se pasa a _other.
+ * \param [in] _table: Tabla.
+ * \param [in] _other: Función para los procesos que no son clientes. NULL para ignorarlos.
+ * \return Cantidad de clientes que terminaron.
+*/
+int ChildrenReap(ChildTable_t* _table, ChildExit_t _other);
+
+/**
+ * \fn int ChildrenNextSignal(ChildTable_t* _table)
+ * \brief Lee una señal pendiente del signalfd sin bloquear.
+ * \param [in] _table: Tabla.
+ * \return Número de la señal (ssi_signo). 0 si no hay más.
+*/
+int ChildrenNextSignal(ChildTable_t* _table);
+
+/**
+ * \fn int ChildrenActive(const ChildTable_t* _table)
+ * \brief Cantidad de clientes atendiéndose en procesos hijo.
+ * \param [in] _table: Tabla.
+ * \return Hijos vivos.
+*/
+int ChildrenActive(const ChildTable_t* _table);
+
+/**
+ * \fn void ChildrenClose(ChildTable_t* _table)
+ * \brief Cierra el signalfd. Lo llaman los hijos después del fork().
+ * \param [in] _table: Tabla.
+*/
+void ChildrenClose(ChildTable_t* _table);
+
+/**
+ * \fn void ChildrenUnblockSignals(void)
+ * \brief Desbloquea las señales que el proceso principal lee por signalfd. Lo llaman los hijos después del fork().
+*/
+void ChildrenUnblockSignals(void);
+
+/**
+ * \fn int ChildrenMetrics(char* _out, size_t _size)
+ * \brief Escribe las estadísticas de los hijos en formato de texto de Prometheus.
+ * \param [out] _out: Buffer.
+ * \param [in] _size: Tamaño de _out.
+ * \return Bytes escritos. -1 si no entra.
+*/
+int ChildrenMetrics(char* _out, size_t _size);
+
+#endif /* CHILDREN_H */
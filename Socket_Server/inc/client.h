@@ -26,25 +26,69 @@
 
 #include "../inc/data.h"
 #include "../inc/driverHandler.h"
+#include "../inc/conn.h"
+#include "../inc/door.h"
+#include "../inc/repl.h"
+#include "../inc/workers.h"
+#include "../inc/router.h"
+#include "../inc/lockout.h"
+#include "../inc/actuator.h"
+#include "../inc/children.h"
+#include "../inc/stats.h"
+#include "../inc/h2.h"
 
 /***********************************************************************************************************************************
  *** DEFINES GLOBALES
  **********************************************************************************************************************************/
 #define PAGINA_HTML "web/webserver.html"    /**< Archivo HTML principal del servidor */
 #define ICO_FILE "web/favicon.ico"          /**< Ícono del sitio web */
+#define DOOR_NOT_FOUND  -2                  /**< TakeDoorPrefix(): /doors/<id> con una puerta que no existe */
+#define STATS_BATCH     256                 /**< Claves copiadas por cada toma del spinlock en SendStats() */
+#define LOG_BATCH       64                  /**< Entradas del log copiadas por cada toma del semáforo en SendLog() */
+#define LOG_ENTRY_JSON  128                 /**< Máximo de una entrada del log en JSON */
+#define RULE_RELATIVE_MAX (10L * 366 * 86400)  /**< ParseRuleTime(): máximo de un tiempo relativo ("+3650d"), en segundos */
+#define METRICS_SECTION 4096                /**< Buffer de cada sección de SendMetrics(). La más grande (actuadores con MAX_DOORS) usa unos 3 KB */
+#define METRICS_SECTIONS 6                  /**< Secciones de /metrics: buffers, workers, actuadores, hijos, TLS y log */
+#define PAGE_PLACEHOLDER "/*DATOS_INICIALES*/null"  /**< Marcador de PAGINA_HTML que SendPage() reemplaza por los datos */
 
 /***********************************************************************************************************************************
  *** TIPO DE DATOS GLOBALES
  **********************************************************************************************************************************/
 /**
- * \fn int client(int _client_id, struct sockaddr_in* _client_data)
+ * \fn int ClientInit(void)
+ * \brief Arma la tabla de rutas y carga PAGINA_HTML en memoria. Se llama una vez en el proceso principal.
+ * \details Si la página no se puede cargar se lee del disco en cada pedido, sin datos iniciales.
+ * \return Devuelve -1 si error en la tabla de rutas. 0 sino.
+*/
+int ClientInit(void);
+
+/**
+ * \fn int client(int _client_id, Doors_t* _doors, const ConnLimits_t* _limits)
  * \brief Maneja el cliente _client_id del servidor HTML.
  * \details Lee y responde a la petición del cliente. Guarda/borra KEYS en memoria compartida.
+ * Las rutas sin prefijo trabajan sobre las claves globales (válidas en todas las puertas). Con el prefijo
+ * /doors/<id> trabajan sobre las claves y el log de esa puerta. El pedido se atiende con la ruta de la tabla routes
+ * (404 si no existe, 405 si no admite el método). No cierra el socket ni se desengancha de la memoria
+ * compartida: puede correr en un proceso hijo o en un hilo del pool. Si llegó por un listener tls primero hace el
+ * handshake; un handshake fallido descarta al cliente sin respuesta. Sin TLS también acepta HTTP/2 (h2c): varios
+ * pedidos multiplexados en la misma conexión, cada uno atendido con las mismas rutas.
  * \param [in] _client_id: ID del cliente.
- * \param [in] _client_data: informacion del cliente.
+ * \param [in] _doors: Puertas.
+ * \param [in] _limits: Timeouts y tamaño máximo del pedido.
  * \return Devuelve -1 si error. 0 sino.
 */
-int client(int _client_id, int driver, KeyEntry_t* valid_keys, ActivityEntry_t*log, int sem_list[3]);
+int client(int _client_id, Doors_t* _doors, const ConnLimits_t* _limits);
+
+/**
+ * \fn int TakeDoorPrefix(Connection_t* _conn, int _doors_count)
+ * \brief Quita el prefijo /doors/<id> de la línea de pedido.
+ * \details "GET /doors/2/claves HTTP/1.1" queda como "GET /claves HTTP/1.1", así el resto de las rutas
+ * no cambia. Se corre el resto del buffer y se ajustan los largos de la conexión.
+ * \param [in] _conn: Conexión con el pedido completo.
+ * \param [in] _doors_count: Cantidad de puertas.
+ * \return El id de la puerta. DOOR_GLOBAL si no hay prefijo. DOOR_NOT_FOUND si la puerta no existe.
+*/
+int TakeDoorPrefix(Connection_t* _conn, int _doors_count);
 
 /**
  * \fn int GetKeyFromHTML(char* _buff, KeyEntry_t* _key)
@@ -55,6 +99,76 @@ int client(int _client_id, int driver, KeyEntry_t* valid_keys, ActivityEntry_t*l
  * \return Devuelve -1 si error. 0 sino.
 */
 int GetKeyFromHTML(char* _buff, KeyEntry_t* _key);
+/**
+ * \fn int ParseKeyList(const char* _body, size_t _len, KeyEntry_t* _keys, int _max, int* _bad)
+ * \brief Obtiene una lista de KEYs de un cuerpo JSON (["1234","5678"]) o CSV (1234,5678 o una por línea).
+ * \details Se valida todo antes de devolver: cada clave debe tener exactamente KEY_SIZE dígitos.
+ * \param [in] _body: Cuerpo del pedido.
+ * \param [in] _len: Largo del cuerpo.
+ * \param [out] _keys: Claves leídas.
+ * \param [in] _max: Cantidad máxima de claves.
+ * \param [out] _bad: Posición (desde 1) de la clave inválida, si hubo error.
+ * \return Devuelve -1 si error. La cantidad de claves sino.
+*/
+int ParseKeyList(const char* _body, size_t _len, KeyEntry_t* _keys, int _max, int* _bad);
+/**
+ * \fn int GetParam(const char* _text, size_t _len, const char* _name, char* _value, size_t _size)
+ * \brief Busca un parámetro por nombre en un cuerpo JSON ("nombre":"valor") o en una query (?nombre=valor&...).
+ * \details En la query se decodifican los %XX.
+ * \param [in] _text: Texto donde buscar.
+ * \param [in] _len: Largo del texto.
+ * \param [in] _name: Nombre del parámetro.
+ * \param [out] _value: Valor, terminado en '\0'.
+ * \param [in] _size: Tamaño de _value.
+ * \return El largo del valor. -1 si no está o no entra en _value.
+*/
+int GetParam(const char* _text, size_t _len, const char* _name, char* _value, size_t _size);
+/**
+ * \fn int ParseRuleTime(const char* _value, int64_t* _ns)
+ * \brief Lee un instante de una regla.
+ * \details Acepta fecha y hora local ("2026-10-20T18:00" o "2026-10-20 18:00"), segundos desde epoch, o un
+ * tiempo relativo a ahora ("+30m", "+2h", "+1d", "+45s"). El relativo va hasta RULE_RELATIVE_MAX (unos 10 años),
+ * así el instante en ns no desborda int64_t.
+ * \param [in] _value: Texto.
+ * \param [out] _ns: Instante en ns desde epoch.
+ * \return Devuelve -1 si el formato no es válido. 0 sino.
+*/
+int ParseRuleTime(const char* _value, int64_t* _ns);
+/**
+ * \fn int GetRuleFromHTML(const char* _text, size_t _len, KeyRule_t* _rule)
+ * \brief Obtiene la validez de una clave del cuerpo JSON o de la query.
+ * \details Parámetros (todos opcionales): "desde" y "hasta" (ver ParseRuleTime()), "dias" ("lun,mar,mie,jue,vie,sab,dom"),
+ * "horario" ("08:00-18:00", puede cruzar la medianoche) y "unico" (1/true: se borra al usarla).
+ * Sin parámetros la regla queda en cero (clave permanente).
+ * \param [in] _text: Cuerpo o línea de pedido.
+ * \param [in] _len: Largo del texto.
+ * \param [out] _rule: Regla leída.
+ * \return Devuelve -1 si algún parámetro es inválido. 0 sino.
+*/
+int GetRuleFromHTML(const char* _text, size_t _len, KeyRule_t* _rule);
+
+/**
+ * \fn int ImportKeys(Connection_t* _conn, Doors_t* _doors, int _door)
+ * \brief Atiende POST /claves/bulk.
+ * \details Valida el lote completo, lo guarda con una sola toma del semáforo y prende el LED una sola vez.
+ * Con "?modo=reemplazar" el lote reemplaza a todas las claves.
+ * \param [in] _conn: Conexión con el pedido completo.
+ * \param [in] _doors: Puertas.
+ * \param [in] _door: Puerta cuyas claves se cargan, o DOOR_GLOBAL.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+int ImportKeys(Connection_t* _conn, Doors_t* _doors, int _door);
+/**
+ * \fn int SendResponse(int _client_id, const char* _status, const char* _type, const char* _body, size_t _len)
+ * \brief Envía una respuesta HTTP completa con un cuerpo corto.
+ * \param [in] _client_id: ID del cliente a enviar.
+ * \param [in] _status: Línea de estado ("200 OK").
+ * \param [in] _type: Content-Type del cuerpo.
+ * \param [in] _body: Cuerpo de la respuesta.
+ * \param [in] _len: Largo del cuerpo.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+int SendResponse(int _client_id, const char* _status, const char* _type, const char* _body, size_t _len);
 /**
  * \fn int SendHTML(int _client_id, char* _html_file)
  * \brief Envía el archivo HTML indicado.
@@ -64,6 +178,20 @@ int GetKeyFromHTML(char* _buff, KeyEntry_t* _key);
  * \return Devuelve -1 si error. 0 sino.
 */
 int SendHTML(int _client_id, char* _html_file);
+/**
+ * \fn int SendPage(Connection_t* _conn, const Doors_t* _doors, int _door, KeyShard_t* _keys, int _sem_k)
+ * \brief Envía la página cargada por ClientInit() con las claves y el log actuales en lugar de PAGE_PLACEHOLDER.
+ * \details Los datos ({"claves":[...],"log":[...]}) van entre las dos mitades de la página, que no se copian:
+ * encabezado, primera mitad, datos y segunda mitad salen con una sola ConnWriteVec(). Así la página se muestra
+ * completa con un solo pedido y /claves y /log quedan para las actualizaciones.
+ * \param [in] _conn: Conexión del cliente.
+ * \param [in] _doors: Puertas.
+ * \param [in] _door: Puerta del log, o DOOR_GLOBAL.
+ * \param [in] _keys: Claves a incluir.
+ * \param [in] _sem_k: Semáforo de _keys.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+int SendPage(Connection_t* _conn, const Doors_t* _doors, int _door, KeyShard_t* _keys, int _sem_k);
 /**
  * \fn int SendIco(int _client_id, char* _ico_file)
  * \brief Envía el icono indicado.
@@ -75,7 +203,7 @@ int SendHTML(int _client_id, char* _html_file);
 int SendIco(int _client_id, char* _ico_file);
 
 /**
- * \fn int SendValidKeys(int _client_id, KeyEntry_t* _valid_keys, int _semId)
+ * \fn int SendValidKeys(int _client_id, KeyShard_t* _valid_keys, int _semId)
  * \brief Envía las KEYs válidas al servidor HTML.
  * \details Envía las KEYs válidas al servidor HTML.
  * \param [in] _client_id: ID del cliente a enviar.
@@ -83,16 +211,75 @@ int SendIco(int _client_id, char* _ico_file);
  * \param [in] _semId: Id del semáforo de _valid_keys.
  * \return Devuelve -1 si error. 0 sino.
 */
-int SendValidKeys(int _client_id, KeyEntry_t* _valid_keys, int _semId);
+int SendValidKeys(int _client_id, KeyShard_t* _valid_keys, int _semId);
 /**
- * \fn int SendLog(int _client_id, ActivityEntry_t* _log, int _semId)
- * \brief Envía el log al servidor HTML.
- * \details Envía el log al servidor HTML.
+ * \fn int SendKeysExport(int _client_id, KeyShard_t* _valid_keys, int _semId)
+ * \brief Envía todas las KEYs válidas en CSV, una por línea.
+ * \details El formato es el mismo que acepta POST /claves/bulk.
+ * \param [in] _client_id: ID del cliente a enviar.
+ * \param [in] _valid_keys: Lista de valid KEYs.
+ * \param [in] _semId: Id del semáforo de _valid_keys.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+int SendKeysExport(int _client_id, KeyShard_t* _valid_keys, int _semId);
+/**
+ * \fn int SendKeyRules(int _client_id, KeyShard_t* _valid_keys, int _semId)
+ * \brief Envía las KEYs que tienen alguna restricción, con su validez.
+ * \details [{"clave":"1234","desde":"2026-10-19T08:00","hasta":"...","dias":"lun,mar","horario":"08:00-18:00","unico":true}].
+ * Los campos sin restricción no se envían. Las claves permanentes no aparecen.
  * \param [in] _client_id: ID del cliente a enviar.
- * \param [in] _log: Log/Lista de actividades a enviar.
- * \param [in] _semId: Id del semárofo de _log.
+ * \param [in] _valid_keys: Lista de valid KEYs.
+ * \param [in] _semId: Id del semáforo de _valid_keys.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+int SendKeyRules(int _client_id, KeyShard_t* _valid_keys, int _semId);
+/**
+ * \fn int SendLog(Connection_t* _conn, const Doors_t* _doors, int _door)
+ * \brief Envía el log al servidor HTML.
+ * \details Envía el log de una puerta, o el de todas una detrás de otra si _door es DOOR_GLOBAL.
+ * La respuesta es chunked: se copian LOG_BATCH entradas con el semáforo del log, se suelta y se envían mientras
+ * se copian las siguientes. La memoria usada no depende del largo del log y un cliente lento no frena al lector
+ * de la puerta. Las entradas solo se agregan al final, así que entre tandas no se saltean ni se repiten.
+ * \param [in] _conn: Conexión del cliente.
+ * \param [in] _doors: Puertas.
+ * \param [in] _door: Puerta o DOOR_GLOBAL.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+int SendLog(Connection_t* _conn, const Doors_t* _doors, int _door);
+/**
+ * \fn int SendLogQuery(Connection_t* _conn, const Doors_t* _doors, int _door, const LogQuery_t* _query)
+ * \brief Envía las entradas del log que cumplen una consulta, de la más nueva a la más vieja.
+ * \details Usa el índice de cada puerta (LogFind()): recorre solo las entradas de la clave o del estado pedido.
+ * Igual que SendLog() es chunked y toma el semáforo de a LOG_BATCH entradas.
+ * \param [in] _conn: Conexión del cliente.
+ * \param [in] _doors: Puertas.
+ * \param [in] _door: Puerta o DOOR_GLOBAL.
+ * \param [in] _query: Consulta con clave o estado.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+int SendLogQuery(Connection_t* _conn, const Doors_t* _doors, int _door, const LogQuery_t* _query);
+/**
+ * \fn int SendStats(Connection_t* _conn, int _door, int _hours, int _days)
+ * \brief Envía los intentos aceptados y rechazados por hora, por día y por clave.
+ * \details Los valores ya están contados (stats.c): no se recorre el log. La respuesta es chunked porque la lista de
+ * claves puede ser larga.
+ * \param [in] _conn: Conexión del cliente.
+ * \param [in] _door: Puerta o DOOR_GLOBAL. Las claves son siempre de todas las puertas.
+ * \param [in] _hours: Horas (validadas con StatsWindow()).
+ * \param [in] _days: Días (validados con StatsWindow()).
+ * \return Devuelve -1 si error. 0 sino.
+*/
+int SendStats(Connection_t* _conn, int _door, int _hours, int _days);
+
+/**
+ * \fn int SendMetrics(Connection_t* _conn, const Doors_t* _doors)
+ * \brief Envía las estadísticas del servidor en formato de texto de Prometheus.
+ * \details Chunked, una sección por bloque. Una sección que no entra en METRICS_SECTION no se corta: la respuesta
+ * queda en 500 o incompleta.
+ * \param [in] _conn: Conexión del cliente.
+ * \param [in] _doors: Puertas.
  * \return Devuelve -1 si error. 0 sino.
 */
-int SendLog(int _client_id, ActivityEntry_t* _log, int _semId);
+int SendMetrics(Connection_t* _conn, const Doors_t* _doors);
 
 #endif /* CLIENT_H */
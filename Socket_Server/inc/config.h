@@ -0,0 +1,144 @@
+/*******************************************************************************************************************************//**
+ *
+ * @file		config.h
+ * @brief		Lectura y validación del config.ini en una tabla tipada de claves/valores.
+ * @date		19 oct. 2026
+ * @author		Martinez Agustin
+ *
+ **********************************************************************************************************************************/
+
+ /***********************************************************************************************************************************
+ *** MODULO
+ **********************************************************************************************************************************/
+#ifndef CONFIG_H
+#define CONFIG_H
+
+/***********************************************************************************************************************************
+ *** INCLUDES GLOBALES
+ **********************************************************************************************************************************/
+#include <stdio.h>      // fopen(), fgets()
+#include <stdlib.h>     // strtol()
+#include <string.h>     // strcmp(), strncpy()
+#include <ctype.h>      // isspace()
+
+/***********************************************************************************************************************************
+ *** DEFINES GLOBALES
+ **********************************************************************************************************************************/
+#define CONFIG_FILE         "config.ini"    /**< Archivo de configuración por defecto */
+#define CONFIG_MAX_ENTRIES  64              /**< Cantidad máxima de líneas clave=valor */
+#define CONFIG_KEY_LEN      32              /**< Largo máximo de una clave */
+#define CONFIG_VALUE_LEN    256             /**< Largo máximo de un valor */
+
+/***********************************************************************************************************************************
+ *** TIPO DE DATOS GLOBALES
+ **********************************************************************************************************************************/
+/**
+ * \enum ConfigType_t
+ * \brief Tipos de valores aceptados en el config.ini.
+ */
+typedef enum {
+    CFG_INT = 0,    /**< Entero: "10" */
+    CFG_STRING,     /**< Texto libre: "unix:/tmp/alarm.sock mode=0660" */
+    CFG_SIZE,       /**< Tamaño en bytes: "8192", "8k", "4M" */
+    CFG_DURATION,   /**< Duración en ms: "500", "500ms", "5s", "2m", "1h" */
+    CFG_LIST        /**< Lista separada por comas: "a,b,c" */
+} ConfigType_t;
+
+/**
+ * \struct ConfigSchema_t
+ * \brief Descripción de una clave conocida.
+ */
+typedef struct {
+    const char* key;        /**< Nombre de la clave */
+    ConfigType_t type;      /**< Tipo del valor */
+    const char* def;        /**< Valor por defecto (NULL si no tiene) */
+    long min;               /**< Mínimo (tipos numéricos) */
+    long max;               /**< Máximo (tipos numéricos) */
+    int multi;              /**< La clave puede repetirse */
+    int reloadable;         /**< Se aplica en caliente con SIGHUP */
+} ConfigSchema_t;
+
+/**
+ * \struct ConfigEntry_t
+ * \brief Valor leído y convertido.
+ */
+typedef struct {
+    const ConfigSchema_t* schema;   /**< Descripción de la clave */
+    char text[CONFIG_VALUE_LEN];    /**< Valor tal y como figura en el archivo */
+    long num;                       /**< Valor numérico (bytes para CFG_SIZE, ms para CFG_DURATION) */
+} ConfigEntry_t;
+
+/**
+ * \struct Config_t
+ * \brief Tabla de configuración ya validada.
+ */
+typedef struct {
+    ConfigEntry_t entries[CONFIG_MAX_ENTRIES];  /**< Valores leídos */
+    int count;                                  /**< Cantidad de valores */
+} Config_t;
+
+/***********************************************************************************************************************************
+ *** IMPLANTACION DE LA CLASE
+ **********************************************************************************************************************************/
+/**
+ * \fn int ConfigLoad(const char* _file_name, Config_t* _config)
+ * \brief Lee y valida el archivo completo.
+ * \details Se lee una sola vez. Líneas vacías o que empiezan con '#' o ';' se ignoran.
+ * Las claves desconocidas se informan y se ignoran. Un valor inválido o fuera de rango hace fallar la carga
+ * sin modificar _config, de modo que una recarga con errores no pisa la configuración en uso.
+ * \param [in] _file_name: Nombre del archivo .ini.
+ * \param [out] _config: Tabla a completar.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+int ConfigLoad(const char* _file_name, Config_t* _config);
+
+/**
+ * \fn long ConfigGetInt(const Config_t* _config, const char* _key)
+ * \brief Valor numérico de una clave (CFG_INT, CFG_SIZE o CFG_DURATION).
+ * \param [in] _config: Tabla de configuración.
+ * \param [in] _key: Nombre de la clave.
+ * \return El valor, o el valor por defecto del esquema si no figura. -1 si la clave no existe.
+*/
+long ConfigGetInt(const Config_t* _config, const char* _key);
+
+/**
+ * \fn const char* ConfigGetString(const Config_t* _config, const char* _key)
+ * \brief Valor de texto de una clave.
+ * \param [in] _config: Tabla de configuración.
+ * \param [in] _key: Nombre de la clave.
+ * \return El valor, el valor por defecto del esquema, o NULL.
+*/
+const char* ConfigGetString(const Config_t* _config, const char* _key);
+
+/**
+ * \fn int ConfigGetList(const Config_t* _config, const char* _key, char _values[][CONFIG_VALUE_LEN], int _max)
+ * \brief Todos los valores de una clave.
+ * \details Para claves repetibles devuelve una entrada por línea. Para CFG_LIST separa por comas.
+ * Si la clave no figura devuelve el valor por defecto del esquema, si tiene.
+ * \param [in] _config: Tabla de configuración.
+ * \param [in] _key: Nombre de la clave.
+ * \param [out] _values: Valores encontrados.
+ * \param [in] _max: Cantidad máxima de valores.
+ * \return La cantidad de valores.
+*/
+int ConfigGetList(const Config_t* _config, const char* _key, char _values[][CONFIG_VALUE_LEN], int _max);
+
+/**
+ * \fn int ConfigChanged(const Config_t* _old, const Config_t* _new, const char* _key)
+ * \brief Indica si una clave cambió entre dos configuraciones.
+ * \param [in] _old: Configuración anterior.
+ * \param [in] _new: Configuración nueva.
+ * \param [in] _key: Nombre de la clave.
+ * \return 1 si cambió. 0 sino.
+*/
+int ConfigChanged(const Config_t* _old, const Config_t* _new, const char* _key);
+
+/**
+ * \fn void ConfigWarnNotReloadable(const Config_t* _old, const Config_t* _new)
+ * \brief Informa las claves que cambiaron pero requieren reiniciar.
+ * \param [in] _old: Configuración anterior.
+ * \param [in] _new: Configuración nueva.
+*/
+void ConfigWarnNotReloadable(const Config_t* _old, const Config_t* _new);
+
+#endif /* CONFIG_H */
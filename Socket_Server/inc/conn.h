@@ -0,0 +1,235 @@
+/*******************************************************************************************************************************//**
+ *
+ * @file		conn.h
+ * @brief		Conexión con buffer propio, deadlines de lectura/escritura y armado incremental de pedidos HTTP.
+ * @date		19 oct. 2026
+ * @author		Martinez Agustin
+ *
+ **********************************************************************************************************************************/
+
+ /***********************************************************************************************************************************
+ *** MODULO
+ **********************************************************************************************************************************/
+#ifndef CONN_H
+#define CONN_H
+
+/***********************************************************************************************************************************
+ *** INCLUDES GLOBALES
+ **********************************************************************************************************************************/
+#include <sys/socket.h> // recv(), send(), setsockopt()
+#include <sys/time.h>   // struct timeval
+#include <sys/uio.h>    // struct iovec
+#include <poll.h>       // poll()
+#include <time.h>       // clock_gettime()
+#include <errno.h>      // errno
+#include <stdio.h>      // snprintf()
+#include <stdlib.h>     // malloc(), free()
+#include <string.h>     // memcpy(), strstr()
+#include <strings.h>    // strncasecmp()
+#include <unistd.h>     // close()
+
+#include "../inc/bufpool.h"
+#include "../inc/tls.h"
+
+/***********************************************************************************************************************************
+ *** DEFINES GLOBALES
+ **********************************************************************************************************************************/
+#define CONN_OK          0   /**< Pedido completo */
+#define CONN_ERROR      -1   /**< Error de socket */
+#define CONN_TIMEOUT    -2   /**< Se venció algún deadline */
+#define CONN_TOO_LARGE  -3   /**< El pedido supera el tamaño máximo */
+#define CONN_CLOSED     -4   /**< El cliente cerró antes de completar el pedido */
+#define CONN_BAD        -5   /**< Pedido mal formado */
+
+#define CHUNK_SIZE      4096 /**< Datos por bloque de una respuesta Transfer-Encoding: chunked */
+#define CHUNK_PREFIX    6    /**< "XXXX\r\n": largo del bloque en hexa, con ceros a la izquierda */
+
+#define CAPTURE_MAX     (16 * 1024 * 1024)  /**< Respuesta más grande que se puede capturar */
+
+/***********************************************************************************************************************************
+ *** TIPO DE DATOS GLOBALES
+ **********************************************************************************************************************************/
+/**
+ * \struct ConnLimits_t
+ * \brief Límites aplicados a cada conexión. Se leen del config.ini (READ_TIMEOUT, REQUEST_TIMEOUT, WRITE_TIMEOUT, MAX_REQUEST_SIZE, HTTP2).
+ */
+typedef struct {
+    int read_timeout_ms;        /**< Timeout entre lecturas */
+    int request_timeout_ms;     /**< Timeout total del pedido */
+    int write_timeout_ms;       /**< Timeout de cada escritura */
+    size_t max_request_size;    /**< Tamaño máximo de pedido */
+    int tls;                    /**< HTTPS: la aceptó un listener con la opción tls */
+    int h2c;                    /**< Acepta HTTP/2 sin TLS (prefacio o Upgrade: h2c) */
+} ConnLimits_t;
+
+/**
+ * \struct Connection_t
+ * \brief Conexión con un cliente y el pedido que se va armando.
+ */
+typedef struct {
+    int fd;                     /**< Socket del cliente */
+    char* buff;                 /**< Buffer de recepción (terminado en '\0') */
+    size_t cap;                 /**< Capacidad útil de buff */
+    size_t len;                 /**< Bytes recibidos */
+    size_t header_len;          /**< Largo del encabezado incluyendo la línea vacía. 0 si incompleto */
+    size_t content_length;      /**< Valor de Content-Length del pedido */
+    ConnLimits_t limits;        /**< Límites de la conexión */
+    struct timespec deadline;   /**< Instante límite para completar el pedido */
+} Connection_t;
+
+/**
+ * \struct ChunkWriter_t
+ * \brief Respuesta con Transfer-Encoding: chunked. Usa siempre la misma memoria, sin importar el largo del cuerpo.
+ * \details Los datos se juntan en buff detrás del lugar reservado para el largo. Con CHUNK_SIZE bytes se completan
+ * largo y "\r\n" y el bloque sale con una sola escritura.
+ */
+typedef struct {
+    Connection_t* conn;                             /**< Conexión */
+    char buff[CHUNK_PREFIX + CHUNK_SIZE + 2];       /**< Largo, datos y "\r\n" del bloque en armado */
+    size_t len;                                     /**< Datos en el bloque */
+    int chunks;                                     /**< Bloques enviados */
+    int error;                                      /**< Falló una escritura: se descarta el resto */
+} ChunkWriter_t;
+
+/**
+ * \struct ConnCapture_t
+ * \brief Lo que se escribe en un socket mientras está capturado: la respuesta HTTP/1.1 de un manejador, que
+ * HTTP/2 reparte después en frames.
+ */
+typedef struct {
+    int fd;                     /**< Socket capturado */
+    char* data;                 /**< Datos escritos (malloc). El que capturó los libera */
+    size_t len;                 /**< Bytes escritos */
+    size_t cap;                 /**< Capacidad de data */
+} ConnCapture_t;
+
+/***********************************************************************************************************************************
+ *** IMPLANTACION DE LA CLASE
+ **********************************************************************************************************************************/
+/**
+ * \fn int ConnInit(Connection_t* _conn, int _fd, const ConnLimits_t* _limits)
+ * \brief Inicializa una conexión sobre un socket aceptado.
+ * \details Reserva el buffer y configura SO_SNDTIMEO en el socket.
+ * \param [out] _conn: Conexión a inicializar.
+ * \param [in] _fd: Socket del cliente.
+ * \param [in] _limits: Límites a aplicar.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+int ConnInit(Connection_t* _conn, int _fd, const ConnLimits_t* _limits);
+
+/**
+ * \fn int ConnSetRequest(Connection_t* _conn, const char* _head, size_t _head_len, const char* _body, size_t _body_len)
+ * \brief Carga un pedido ya armado (encabezado y cuerpo), como si ConnReadRequest() lo hubiera leído del socket.
+ * \param [in] _conn: Conexión inicializada.
+ * \param [in] _head: Encabezado HTTP/1.1 con la línea vacía final.
+ * \param [in] _head_len: Largo del encabezado.
+ * \param [in] _body: Cuerpo. Puede ser NULL si _body_len es 0.
+ * \param [in] _body_len: Largo del cuerpo.
+ * \return CONN_OK. CONN_TOO_LARGE o CONN_BAD si el pedido no se puede atender.
+*/
+int ConnSetRequest(Connection_t* _conn, const char* _head, size_t _head_len, const char* _body, size_t _body_len);
+
+/**
+ * \fn int ConnReadRequest(Connection_t* _conn)
+ * \brief Lee un pedido HTTP completo.
+ * \details Lee de a partes hasta tener el encabezado completo y Content-Length bytes de cuerpo.
+ * Corta si se vence el timeout entre lecturas o el deadline total del pedido, o si se supera el tamaño máximo.
+ * \param [in] _conn: Conexión a leer.
+ * \return CONN_OK si el pedido está completo. Un CONN_* negativo sino.
+*/
+int ConnReadRequest(Connection_t* _conn);
+
+/**
+ * \fn int ConnWriteAll(Connection_t* _conn, const void* _data, size_t _size)
+ * \brief Escribe todo el buffer en la conexión.
+ * \param [in] _conn: Conexión a escribir.
+ * \param [in] _data: Datos a enviar.
+ * \param [in] _size: Cantidad de bytes a enviar.
+ * \return Devuelve -1 si error (o timeout). 0 sino.
+*/
+int ConnWriteAll(Connection_t* _conn, const void* _data, size_t _size);
+
+/**
+ * \fn ssize_t ConnSend(int _fd, const void* _buff, size_t _len, int _flags)
+ * \brief send() de las respuestas: pasa por TlsSend(), o se guarda si el hilo está capturando _fd.
+ * \param [in] _fd: Socket.
+ * \param [in] _buff: Datos.
+ * \param [in] _len: Cantidad de bytes.
+ * \param [in] _flags: Flags de send().
+ * \return Bytes enviados (o guardados). -1 si error.
+*/
+ssize_t ConnSend(int _fd, const void* _buff, size_t _len, int _flags);
+
+/**
+ * \fn void ConnCaptureBegin(ConnCapture_t* _capture, int _fd)
+ * \brief Desde acá lo que el hilo escribe en _fd queda en _capture en lugar de salir por el socket.
+ * \param [out] _capture: Captura (vacía).
+ * \param [in] _fd: Socket.
+*/
+void ConnCaptureBegin(ConnCapture_t* _capture, int _fd);
+
+/**
+ * \fn void ConnCaptureEnd(void)
+ * \brief Termina la captura del hilo. Los datos quedan en la captura.
+*/
+void ConnCaptureEnd(void);
+
+/**
+ * \fn int ConnWriteVec(Connection_t* _conn, struct iovec* _iov, int _count)
+ * \brief Escribe varios buffers seguidos con una sola llamada (sendmsg(), como writev() pero sin SIGPIPE).
+ * \details Si la escritura queda por la mitad se sigue desde donde quedó. Modifica _iov. Con HTTPS sin kTLS, o con
+ * el socket capturado, sale de a un buffer por ConnSend().
+ * \param [in] _conn: Conexión a escribir.
+ * \param [in] _iov: Buffers. Pueden tener largo 0.
+ * \param [in] _count: Cantidad de buffers.
+ * \return Devuelve -1 si error (o timeout). 0 sino.
+*/
+int ConnWriteVec(Connection_t* _conn, struct iovec* _iov, int _count);
+
+/**
+ * \fn int ConnSendError(Connection_t* _conn, int _err)
+ * \brief Responde al cliente según el error de lectura.
+ * \details 408 para timeouts, 413 para pedidos grandes y 400 para pedidos mal formados.
+ * \param [in] _conn: Conexión a responder.
+ * \param [in] _err: Código CONN_* devuelto por ConnReadRequest().
+ * \return Devuelve -1 si error. 0 sino.
+*/
+int ConnSendError(Connection_t* _conn, int _err);
+
+/**
+ * \fn int ConnChunkBegin(ChunkWriter_t* _writer, Connection_t* _conn, const char* _status, const char* _type)
+ * \brief Envía el encabezado de una respuesta chunked.
+ * \param [out] _writer: Respuesta.
+ * \param [in] _conn: Conexión.
+ * \param [in] _status: Línea de estado ("200 OK").
+ * \param [in] _type: Content-Type del cuerpo.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+int ConnChunkBegin(ChunkWriter_t* _writer, Connection_t* _conn, const char* _status, const char* _type);
+
+/**
+ * \fn int ConnChunkWrite(ChunkWriter_t* _writer, const void* _data, size_t _size)
+ * \brief Agrega datos al cuerpo. Envía un bloque cada CHUNK_SIZE bytes.
+ * \param [in] _writer: Respuesta.
+ * \param [in] _data: Datos.
+ * \param [in] _size: Cantidad de bytes.
+ * \return Devuelve -1 si error (también si falló una escritura anterior). 0 sino.
+*/
+int ConnChunkWrite(ChunkWriter_t* _writer, const void* _data, size_t _size);
+
+/**
+ * \fn int ConnChunkEnd(ChunkWriter_t* _writer)
+ * \brief Envía el último bloque con datos y el bloque vacío que cierra el cuerpo.
+ * \param [in] _writer: Respuesta.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+int ConnChunkEnd(ChunkWriter_t* _writer);
+
+/**
+ * \fn void ConnFree(Connection_t* _conn)
+ * \brief Libera el buffer de la conexión. No cierra el socket.
+ * \param [in] _conn: Conexión a liberar.
+*/
+void ConnFree(Connection_t* _conn);
+
+#endif /* CONN_H */
@@ -22,20 +22,45 @@
 #include <string.h>     // Funciones de manejo de cadenas (strcmp, strcpy, etc.)
 #include <time.h>       // Formateo de fecha y hora
 #include <stdio.h>      // Funciones de salida estándar
+#include <stdint.h>     // uint16_t, int64_t
+#include <sched.h>      // sched_yield()
+#include <errno.h>      // errno, EEXIST, EBUSY
+
+#include "../inc/timefmt.h"
 
 /***********************************************************************************************************************************
  *** DEFINES GLOBALES
  **********************************************************************************************************************************/
-#define SM_ID_K     1111    /**< ID de memoria compartida para las claves válidas */
-#define SEM_ID_K    2222    /**< ID de semáforo para las claves válidas */
-#define SM_ID_L     3333    /**< ID de memoria compartida para los registros de log */
-#define SEM_ID_L    4444    /**< ID de semáforo para los registros de log */
-#define SEM_ID_WR   1234    /**< ID de escritura del driver */
+#define SM_ID       1111    /**< ID de memoria compartida de claves y logs (ShmLayout_t) */
+#define SEM_ID_K    2222    /**< ID de semáforo para las claves válidas en todas las puertas */
+#define SEM_HELD    (-2)    /**< En lugar de un semId: quien llama ya tiene tomado el semáforo */
 
-#define MAX_VALID_KEYS  5  /**< Cantidad máxima de claves válidas almacenadas */
+#define MAX_VALID_KEYS  10000  /**< Cantidad máxima de claves válidas almacenadas (todas las claves de 4 dígitos) */
 #define MAX_LOG         5  /**< Cantidad máxima de registros de actividad */
 
 #define KEY_SIZE        4   /**< Largo máximo de la clave */
+#define KEY_SPACE       10000   /**< Cantidad de claves distintas de KEY_SIZE dígitos */
+#define KEY_EMPTY       0xFFFF  /**< Código de una posición libre (fuera de 0..KEY_SPACE-1) */
+#define KEY_BLOCK       16      /**< Claves comparadas por vuelta en HasKey() */
+#define CACHE_LINE      64      /**< Separación entre campos que escriben procesos o hilos distintos */
+#define SEQ_RETRIES     1000    /**< Intentos de una lectura sin semáforo antes de darla por fallida */
+
+#define LOG_STATUS_OK   0x0001  /**< Bit de ActivityEntry_t.flags: la clave fue aceptada */
+#define LOG_LOCKOUT     0x0002  /**< Bit de ActivityEntry_t.flags: la clave empezó un bloqueo por intentos fallidos */
+#define LOG_STATUSES    3       /**< Estados de una entrada: 0 rechazada, 1 aceptada, 2 bloqueó la puerta */
+#define LOG_NONE        (-1)    /**< Fin de una cadena de LogIndex_t */
+#define LOG_ANY         (-1)    /**< LogQuery_t: sin filtro por clave o por estado */
+
+#define RULE_ONE_TIME   0x01    /**< Bit de KeyRule_t.flags: la clave se borra al usarla */
+#define RULE_ALL_DAY    1440    /**< Minutos de un día */
+#define KEY_EXPIRE_QUEUE 256    /**< Vencimientos nuevos que el lector todavía no programó */
+
+#if MAX_VALID_KEYS % KEY_BLOCK != 0
+#error "MAX_VALID_KEYS tiene que ser múltiplo de KEY_BLOCK"
+#endif
+#if MAX_LOG > INT16_MAX
+#error "LogIndex_t guarda posiciones del log en int16_t"
+#endif
 
 /***********************************************************************************************************************************
  *** TIPO DE DATOS GLOBALES
@@ -54,29 +79,108 @@ union semun {
 /**
  * \struct KeyEntry_t
  * \brief Estructura de una clave de la alarma.
+ * \details La clave se guarda como número (2 bytes en vez de 5): "0042" es 42. Solo se pasa a texto
+ * al armar el JSON/CSV, con KeyToString().
  */
 typedef struct {    
-    char value[KEY_SIZE+1]; /**< Valor de la clave en formato string */
+    uint16_t code;          /**< Valor de la clave (0..KEY_SPACE-1). KEY_EMPTY si la posición está libre */
 } KeyEntry_t;
 
+/**
+ * \struct KeyRule_t
+ * \brief Validez de una clave: cuándo se puede usar.
+ * \details Todo en 0 es una clave permanente. Los días y la franja horaria se evalúan en hora local.
+ */
+typedef struct {
+    int64_t start_ns;           /**< Válida desde (ns desde epoch). 0: desde siempre */
+    int64_t end_ns;             /**< Vence (ns desde epoch). 0: no vence */
+    uint16_t from_min;          /**< Franja diaria: desde (minuto del día) */
+    uint16_t to_min;            /**< Franja diaria: hasta. Igual a from_min: todo el día. Menor: cruza la medianoche */
+    uint8_t weekdays;           /**< Bit 0 domingo ... bit 6 sábado. 0: todos los días */
+    uint8_t flags;              /**< RULE_ONE_TIME */
+    uint16_t reserved;          /**< Relleno explícito */
+} KeyRule_t;
+
+/**
+ * \struct KeyExpire_t
+ * \brief Aviso al lector de una clave con vencimiento nueva.
+ */
+typedef struct {
+    int64_t end_ns;             /**< Vencimiento */
+    uint16_t code;              /**< Clave */
+    uint16_t reserved[3];       /**< Relleno explícito */
+} KeyExpire_t;
+
+/**
+ * \struct KeyShard_t
+ * \brief Un conjunto de claves válidas (globales o de una puerta) en la memoria compartida.
+ * \details Los códigos van en su propio arreglo compacto para que HasKey() los compare en bloque; la regla de
+ * cada clave está en la misma posición de rules. Quien agrega una clave que vence la anota en expire para que
+ * el lector la programe en su rueda de timers sin recorrer la tabla.
+ * Los cambios se hacen con el semáforo tomado y entre SeqWriteBegin() y SeqWriteEnd(), así se puede leer sin semáforo.
+ * keys y rules se leen en cada intento; version y la cola de vencimientos se escriben en cada cambio: cada grupo
+ * empieza en su propia línea de caché para que escribir uno no invalide al otro.
+ */
+typedef struct {
+    _Alignas(CACHE_LINE) KeyEntry_t keys[MAX_VALID_KEYS];   /**< Códigos. Los libres valen KEY_EMPTY y van al final */
+    _Alignas(CACHE_LINE) KeyRule_t rules[MAX_VALID_KEYS];   /**< Regla de keys[i] */
+    _Alignas(CACHE_LINE) uint32_t version;                  /**< Sube en cada cambio de keys/rules (para no copiar a disco si no cambió) */
+    uint32_t seq;                       /**< Impar mientras se modifican keys/rules (ver KeyShardRead()) */
+    uint32_t expire_count;              /**< Avisos pendientes en expire */
+    uint32_t expire_lost;               /**< Se llenó expire: el lector tiene que revisar toda la tabla */
+    KeyExpire_t expire[KEY_EXPIRE_QUEUE];
+} KeyShard_t;
+
 /**
  * \struct ActivityEntry_t
  * \brief Estructura que representa una entrada en el log de actividad del sistema.
+ * \details 16 bytes. La fecha y hora se formatean recién al enviar el log.
  */
 typedef struct {      
-    char date[9];               /**< Fecha en formato YYYYMMDD */
-    char time[7];               /**< Hora en formato HHMMSS */
-    char code[KEY_SIZE + 1];    /**< Clave utilizada */
-    int status;                 /**< Resultado: 1 si fue aceptada, 0 si fue denegada */
+    int64_t time_ns;            /**< Instante del intento en ns desde epoch (CLOCK_REALTIME) */
+    uint16_t code;              /**< Clave utilizada. KEY_EMPTY si la entrada está libre */
+    uint16_t flags;             /**< LOG_STATUS_OK si fue aceptada, LOG_LOCKOUT si bloqueó la puerta */
+    uint32_t reserved;          /**< Relleno explícito: la entrada completa queda inicializada */
 } ActivityEntry_t;
 
+/**
+ * \struct LogIndex_t
+ * \brief Índice secundario del log de una puerta: por clave y por estado.
+ * \details Cada cadena empieza en la entrada más nueva y sigue por prev_* hasta LOG_NONE, así una consulta recorre
+ * solo las entradas que coinciden. Se actualiza en AddLog() bajo el mismo semáforo que el log.
+ * Las cabezas por estado y los contadores cambian en cada entrada y /metrics los lee sin semáforo: van juntos en
+ * la primera línea de caché, separados de las cadenas.
+ */
+typedef struct {
+    _Alignas(CACHE_LINE) uint32_t count[LOG_STATUSES];      /**< Entradas por estado */
+    uint32_t seq;                       /**< Impar mientras se escribe el log o el índice (ver LogRead()) */
+    int16_t by_status[LOG_STATUSES];    /**< Última posición de cada estado */
+    _Alignas(CACHE_LINE) int16_t by_code[KEY_SPACE];        /**< Última posición de cada clave. LOG_NONE si no está */
+    int16_t prev_code[MAX_LOG];         /**< Posición anterior con la misma clave */
+    int16_t prev_status[MAX_LOG];       /**< Posición anterior con el mismo estado */
+} LogIndex_t;
+
+/**
+ * \struct LogQuery_t
+ * \brief Consulta al log por índice, que se continúa de a tandas con LogFind().
+ */
+typedef struct {
+    int code;                   /**< Clave (0..KEY_SPACE-1). LOG_ANY: todas */
+    int status;                 /**< Estado (0..LOG_STATUSES-1). LOG_ANY: todos */
+    int64_t since_ns;           /**< Solo entradas desde este instante. 0: todas */
+    int next;                   /**< Próxima posición a revisar. LOG_NONE: terminó */
+    int started;                /**< 0 hasta la primera llamada a LogFind() */
+} LogQuery_t;
+
 /***********************************************************************************************************************************
  *** IMPLANTACION DE LA CLASE
  **********************************************************************************************************************************/
 /**
  * \fn void* createShMem(int _id, size_t _size, int _create, int* _shmId)
- * \brief Crea/abre un Shared Memory.
- * \details Crea/abre el Shared Memory con la Key correspondiente. 
+ * \brief Crea un Shared Memory nuevo.
+ * \details Crea el Shared Memory con la Key correspondiente (IPC_EXCL). Si ya hay uno con esa Key (de una corrida que
+ * terminó mal, de otro binario o con otra cantidad de puertas) y nadie está enganchado, se borra y se crea de nuevo.
+ * Si alguien está enganchado (otro servidor corriendo) no se toca y se devuelve NULL con errno en EBUSY.
  * \param [in] _path: Path al archivo generador de clave.
  * \param [in] _proj_id: ID para el ftok.
  * \param [in] _size: TAmaño de la Shared Memory.
@@ -88,7 +192,7 @@ void* createShMem(char* _path, int _proj_id, size_t _size, int* _shmId);
  * \fn int createSem(int _id, int _create)
  * \brief Crea/abre un semáforo.
  * \details Crea/abre el semáforo con la Key correspondiente. 
- * \param [in] _path: Path al archivo generador de clave.
+ * \param [in] _path: Path al archivo generador de clave. NULL para un semáforo privado (IPC_PRIVATE).
  * \param [in] _proj_id: ID para el ftok.
  * \return Devuelve -1 si error. 0 sino.
 */
@@ -97,16 +201,17 @@ int createSem(char* _path, int _proj_id);
 /**
  * \fn int lockSem(int _semId)
  * \brief Bloquea un semáforo.
- * \details Bloquea el semáforo con la ID correspondiente.
- * \param [in] _semId: ID del semáforo.
+ * \details Bloquea el semáforo con la ID correspondiente. Con SEM_HELD no hace nada: así las funciones de este
+ * módulo se pueden llamar dentro de una sección crítica más larga (por ejemplo, cambio y journal juntos).
+ * \param [in] _semId: ID del semáforo, o SEM_HELD.
  * \return Devuelve -1 si error. 0 sino.
 */
 int lockSem(int _semId);
 /**
  * \fn int unlockSem(int _semId)
  * \brief Desbloquea un semáforo.
- * \details DEsbloquea el semáforo con la ID correspondiente.
- * \param [in] _semId: ID del semáforo.
+ * \details DEsbloquea el semáforo con la ID correspondiente. Con SEM_HELD no hace nada.
+ * \param [in] _semId: ID del semáforo, o SEM_HELD.
  * \return Devuelve -1 si error. 0 sino.
 */
 int unlockSem(int _semId);
@@ -119,37 +224,149 @@ int unlockSem(int _semId);
 */
 void closeSem(int _semId);
 
-//int CreateKey(KeyEntry_t* _key, char* _value);
 /**
- * \fn int AddKey(const KeyEntry_t _key, KeyEntry_t* _valid_keys, int _semId)
+ * \fn int KeyFromString(const char* _text, size_t _len, KeyEntry_t* _key)
+ * \brief Convierte el texto de una clave a KeyEntry_t.
+ * \param [in] _text: Texto de la clave.
+ * \param [in] _len: Largo del texto. Tiene que ser KEY_SIZE.
+ * \param [out] _key: Clave convertida.
+ * \return Devuelve -1 si no son exactamente KEY_SIZE dígitos. 0 sino.
+*/
+int KeyFromString(const char* _text, size_t _len, KeyEntry_t* _key);
+/**
+ * \fn char* KeyToString(const KeyEntry_t _key, char* _text)
+ * \brief Convierte una clave a texto con ceros a la izquierda ("0042").
+ * \param [in] _key: Clave a convertir.
+ * \param [out] _text: Buffer de al menos KEY_SIZE+1 bytes.
+ * \return _text.
+*/
+char* KeyToString(const KeyEntry_t _key, char* _text);
+
+/**
+ * \fn int AddKey(const KeyEntry_t _key, const KeyRule_t* _rule, KeyShard_t* _shard, int _semId)
  * \brief Añade una Key a la lista de Keys.
- * \details Añade una Key a la lista de Keys.
+ * \details Si la clave ya estaba se le actualiza la regla.
  * \param [in] _key: Clave a guardar.
- * \param [in] _valid_keys: Lista de valid Keys.
+ * \param [in] _rule: Validez de la clave. NULL para una clave permanente.
+ * \param [in] _shard: Lista de valid Keys.
  * \param [in] _semId: Id del semáforo para utilizar.
- * \return Devuelve -1 si error. 0 sino.
+ * \return Devuelve -1 si error. La posición+1 si la clave es nueva. 0 sino.
 */
-int AddKey(const KeyEntry_t _key, KeyEntry_t* _valid_keys, int _semId);
+int AddKey(const KeyEntry_t _key, const KeyRule_t* _rule, KeyShard_t* _shard, int _semId);
 /**
- * \fn int DeleteKey(const KeyEntry_t _key, KeyEntry_t* _valid_keys, int _semId)
+ * \fn int DeleteKey(const KeyEntry_t _key, KeyShard_t* _shard, int _semId)
  * \brief Elimina una Key a la lista de Keys.
  * \details Elimina una Key a la lista de Keys.
  * \param [in] _key: Clave a borrar.
- * \param [in] _valid_keys: Lista de valid Keys.
+ * \param [in] _shard: Lista de valid Keys.
  * \param [in] _semId: Id del semáforo a utilizar.
  * \return Devuelve -1 si error. 0 sino.
 */
-int DeleteKey(const KeyEntry_t _key, KeyEntry_t* _valid_keys, int _semId);
+int DeleteKey(const KeyEntry_t _key, KeyShard_t* _shard, int _semId);
+/**
+ * \fn int AddKeysBulk(const KeyEntry_t* _keys, int _count, int _replace, const KeyRule_t* _rule, KeyShard_t* _shard, int _semId)
+ * \brief Añade un lote de Keys en una sola sección crítica.
+ * \details Las claves deben venir validadas (menores a KEY_SPACE). Las repetidas (en el lote o ya guardadas) no se duplican,
+ * pero todas las del lote quedan con la regla indicada. Es todo o nada: si no entran todas no se modifica la lista.
+ * \param [in] _keys: Claves a guardar.
+ * \param [in] _count: Cantidad de claves del lote.
+ * \param [in] _replace: Si es distinto de 0 el lote reemplaza a la lista completa.
+ * \param [in] _rule: Validez de las claves del lote. NULL para claves permanentes.
+ * \param [in] _shard: Lista de valid Keys.
+ * \param [in] _semId: Id del semáforo a utilizar.
+ * \return Cantidad de claves nuevas. -1 si error. -2 si no hay lugar.
+*/
+int AddKeysBulk(const KeyEntry_t* _keys, int _count, int _replace, const KeyRule_t* _rule, KeyShard_t* _shard, int _semId);
+/**
+ * \fn int HasKey(const KeyEntry_t _key, const KeyShard_t* _shard, int _semId)
+ * \brief Detecta si una Key está en una lista y se puede usar ahora.
+ * \details Compara de a KEY_BLOCK enteros sin cortar en el medio, así el compilador puede vectorizar la vuelta.
+ * La regla se evalúa solo sobre la clave encontrada.
+ * \param [in] _key: Clave a buscar.
+ * \param [in] _shard: Lista de valid Keys.
+ * \param [in] _semId: Id del semáforo a utilizar.
+ * \return 1 si posee la KEY y es válida en este momento. 0 si no.
+*/
+int HasKey(const KeyEntry_t _key, const KeyShard_t* _shard, int _semId);
 /**
- * \fn int HasKey(const KeyEntry_t _key, const KeyEntry_t* _valid_keys, int _semId)
- * \brief Detecta si una Key está en una lista o no.
- * \details Detecta si una Key está en una lista o no.
+ * \fn int UseKey(const KeyEntry_t _key, KeyShard_t* _shard, int _semId)
+ * \brief Como HasKey() pero además consume las claves de un solo uso.
+ * \details La búsqueda y el borrado van en la misma sección crítica: una clave de un solo uso no se acepta dos veces.
  * \param [in] _key: Clave a buscar.
- * \param [in] _valid_keys: Lista de valid Keys.
+ * \param [in] _shard: Lista de valid Keys.
  * \param [in] _semId: Id del semáforo a utilizar.
- * \return 1 si posee la KEY. 0 si no.
+ * \return 1 si la clave se aceptó. 2 si se aceptó y se borró (un solo uso). 0 si no. -1 si error.
+*/
+int UseKey(const KeyEntry_t _key, KeyShard_t* _shard, int _semId);
+/**
+ * \fn int ExpireKeys(const uint16_t* _codes, int _count, int64_t _now_ns, KeyShard_t* _shard, int _semId)
+ * \brief Borra, de las claves indicadas, las que ya vencieron.
+ * \details Las que no vencieron (porque se les cambió la regla) se dejan. Compacta la lista una sola vez por llamada.
+ * \param [in] _codes: Claves a revisar.
+ * \param [in] _count: Cantidad de claves.
+ * \param [in] _now_ns: Instante actual.
+ * \param [in] _shard: Lista de valid Keys.
+ * \param [in] _semId: Id del semáforo a utilizar.
+ * \return Cantidad de claves borradas. -1 si error.
+*/
+int ExpireKeys(const uint16_t* _codes, int _count, int64_t _now_ns, KeyShard_t* _shard, int _semId);
+/**
+ * \fn int TakeExpirations(KeyShard_t* _shard, int _semId, KeyExpire_t* _out, int* _lost)
+ * \brief Saca los avisos de vencimientos nuevos.
+ * \param [in] _shard: Lista de valid Keys.
+ * \param [in] _semId: Id del semáforo a utilizar.
+ * \param [out] _out: Buffer de KEY_EXPIRE_QUEUE avisos.
+ * \param [out] _lost: 1 si se perdieron avisos y hay que revisar toda la tabla con ListExpirations().
+ * \return Cantidad de avisos. -1 si error.
+*/
+int TakeExpirations(KeyShard_t* _shard, int _semId, KeyExpire_t* _out, int* _lost);
+/**
+ * \fn int ListExpirations(const KeyShard_t* _shard, int _semId, KeyExpire_t* _out)
+ * \brief Lista todas las claves que vencen (al arrancar el lector o si se perdieron avisos).
+ * \param [in] _shard: Lista de valid Keys.
+ * \param [in] _semId: Id del semáforo a utilizar.
+ * \param [out] _out: Buffer de MAX_VALID_KEYS avisos.
+ * \return Cantidad de claves. -1 si error.
+*/
+int ListExpirations(const KeyShard_t* _shard, int _semId, KeyExpire_t* _out);
+/**
+ * \fn void SeqWriteBegin(uint32_t* _seq)
+ * \brief Marca el comienzo de un cambio (seq queda impar). Se llama con el semáforo tomado.
+ * \param [in] _seq: Contador de la lista o del log.
+*/
+void SeqWriteBegin(uint32_t* _seq);
+/**
+ * \fn void SeqWriteEnd(uint32_t* _seq)
+ * \brief Marca el fin de un cambio (seq vuelve a ser par) y lo publica.
+ * \param [in] _seq: Contador de la lista o del log.
+*/
+void SeqWriteEnd(uint32_t* _seq);
+/**
+ * \fn int KeyShardRead(const KeyShard_t* _shard, KeyEntry_t* _keys, KeyRule_t* _rules, uint32_t* _version)
+ * \brief Copia las claves sin tomar el semáforo.
+ * \details Copia entre dos lecturas de seq y reintenta si cambió o si había un cambio a medias: quien lee no
+ * frena a quien escribe ni lo hace entrar al kernel.
+ * \param [in] _shard: Lista de valid Keys.
+ * \param [out] _keys: MAX_VALID_KEYS claves.
+ * \param [out] _rules: MAX_VALID_KEYS reglas. NULL si no hacen falta.
+ * \param [out] _version: Versión de la copia. NULL si no hace falta.
+ * \return Cantidad de claves. -1 si no se consiguió una copia entera en SEQ_RETRIES intentos.
+*/
+int KeyShardRead(const KeyShard_t* _shard, KeyEntry_t* _keys, KeyRule_t* _rules, uint32_t* _version);
+/**
+ * \fn void KeyShardInit(KeyShard_t* _shard)
+ * \brief Deja una lista vacía.
+ * \param [out] _shard: Lista a inicializar.
+*/
+void KeyShardInit(KeyShard_t* _shard);
+/**
+ * \fn int KeyRuleAllows(const KeyRule_t* _rule, int64_t _now_ns)
+ * \brief Evalúa una regla en un instante.
+ * \param [in] _rule: Regla.
+ * \param [in] _now_ns: Instante (ns desde epoch).
+ * \return 1 si la clave se puede usar. 0 si no.
 */
-int HasKey(const KeyEntry_t _key, const KeyEntry_t* _valid_keys, int _semId);
+int KeyRuleAllows(const KeyRule_t* _rule, int64_t _now_ns);
 
 /**
  * \fn int CreateActivityEntry(ActivityEntry_t* _activity, KeyEntry_t _code, const int _status)
@@ -162,15 +379,69 @@ int HasKey(const KeyEntry_t _key, const KeyEntry_t* _valid_keys, int _semId);
 */
 int CreateActivityEntry(ActivityEntry_t* _activity, KeyEntry_t _code, const int _status);
 /**
- * \fn int AddLog(const ActivityEntry_t _activity, ActivityEntry_t* _log, int _semId)
+ * \fn int AddLog(const ActivityEntry_t _activity, ActivityEntry_t* _log, LogIndex_t* _index, int _semId)
  * \brief Añade una actividad a un log de actividades.
- * \details Añade una actividad a un log de actividades.
+ * \details Añade una actividad a un log de actividades y la suma al índice en la misma sección crítica.
  * \param [in] _activity: actividad a guardar.
  * \param [in] _log: log de actividades.
+ * \param [in] _index: Índice del log. NULL si no tiene.
  * \param [in] _semId: Id del semáforo a utilizar.
- * \return Devuelve -1 si error. 0 sino.
+ * \return Devuelve -1 si error, 0 si el log está lleno (no se guarda) y la posición + 1 sino.
+*/
+int AddLog(const ActivityEntry_t _activity, ActivityEntry_t* _log, LogIndex_t* _index, int _semId);
+/**
+ * \fn int LogEntryStatus(const ActivityEntry_t* _entry)
+ * \brief Estado de una entrada del log.
+ * \param [in] _entry: Entrada.
+ * \return 0 rechazada, 1 aceptada, 2 bloqueó la puerta.
+*/
+int LogEntryStatus(const ActivityEntry_t* _entry);
+/**
+ * \fn void LogIndexBuild(LogIndex_t* _index, const ActivityEntry_t* _log)
+ * \brief Rehace el índice a partir del log completo. Se llama con el semáforo tomado (o sin otros procesos).
+ * \details seq no se toca: lo maneja quien escribe el log.
+ * \param [out] _index: Índice.
+ * \param [in] _log: Log de MAX_LOG entradas.
+*/
+void LogIndexBuild(LogIndex_t* _index, const ActivityEntry_t* _log);
+/**
+ * \fn void LogIndexAdd(LogIndex_t* _index, const ActivityEntry_t* _log, int _pos)
+ * \brief Suma al índice la entrada recién escrita en _pos. Se llama con el semáforo tomado.
+ * \param [in] _index: Índice.
+ * \param [in] _log: Log.
+ * \param [in] _pos: Posición de la entrada nueva (siempre más nueva que las anteriores).
+*/
+void LogIndexAdd(LogIndex_t* _index, const ActivityEntry_t* _log, int _pos);
+/**
+ * \fn void LogQueryInit(LogQuery_t* _query)
+ * \brief Deja una consulta sin filtros.
+ * \param [out] _query: Consulta.
+*/
+void LogQueryInit(LogQuery_t* _query);
+/**
+ * \fn int LogFind(const ActivityEntry_t* _log, const LogIndex_t* _index, int _semId, LogQuery_t* _query, ActivityEntry_t* _out, int _max)
+ * \brief Copia hasta _max entradas que cumplen la consulta, de la más nueva a la más vieja.
+ * \details Sigue la cadena de la clave (o la del estado si no hay clave): el costo es proporcional al resultado,
+ * no al largo del log. Cada llamada es una sección crítica corta; la siguiente sigue desde _query->next.
+ * \param [in] _log: Log.
+ * \param [in] _index: Índice del log.
+ * \param [in] _semId: Id del semáforo a utilizar.
+ * \param [in] _query: Consulta con clave o estado. Se actualiza para la próxima tanda.
+ * \param [out] _out: Entradas encontradas.
+ * \param [in] _max: Tamaño de _out.
+ * \return Cantidad de entradas copiadas (0: terminó). -1 si error.
+*/
+int LogFind(const ActivityEntry_t* _log, const LogIndex_t* _index, int _semId, LogQuery_t* _query, ActivityEntry_t* _out, int _max);
+/**
+ * \fn int LogRead(const ActivityEntry_t* _log, const LogIndex_t* _index, ActivityEntry_t* _out, uint32_t* _count)
+ * \brief Copia el log y los contadores del índice sin tomar el semáforo, igual que KeyShardRead().
+ * \param [in] _log: Log.
+ * \param [in] _index: Índice del log.
+ * \param [out] _out: MAX_LOG entradas, de la más vieja a la más nueva.
+ * \param [out] _count: LOG_STATUSES contadores. NULL si no hacen falta.
+ * \return Cantidad de entradas. -1 si no se consiguió una copia entera en SEQ_RETRIES intentos.
 */
-int AddLog(const ActivityEntry_t _activity, ActivityEntry_t* _log, int _semId);
+int LogRead(const ActivityEntry_t* _log, const LogIndex_t* _index, ActivityEntry_t* _out, uint32_t* _count);
 //int DeleteLog(const ActivityEntry_t _activity, ActivityEntry_t* _log, int _semId);
 //int HasLog(const ActivityEntry_t _activity, ActivityEntry_t* _log, int _semId);
 
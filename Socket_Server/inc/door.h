@@ -0,0 +1,175 @@
+/*******************************************************************************************************************************//**
+ *
+ * @file		door.h
+ * @brief		Puertas del sitio: un dispositivo de alarma, su lector y su parte de las claves y del log.
+ * @date		19 oct. 2026
+ * @author		Martinez Agustin
+ *
+ **********************************************************************************************************************************/
+
+ /***********************************************************************************************************************************
+ *** MODULO
+ **********************************************************************************************************************************/
+#ifndef DOOR_H
+#define DOOR_H
+
+/***********************************************************************************************************************************
+ *** INCLUDES GLOBALES
+ **********************************************************************************************************************************/
+#include <sys/types.h>  // pid_t
+#include <sys/wait.h>   // waitpid()
+#include <signal.h>     // kill()
+#include <fcntl.h>      // open()
+#include <stdio.h>      // printf(), perror()
+#include <stddef.h>     // offsetof()
+#include <string.h>     // strncpy()
+#include <unistd.h>     // fork(), close()
+
+#include "../inc/data.h"
+#include "../inc/driverHandler.h"
+#include "../inc/config.h"
+#include "../inc/lockout.h"
+
+/***********************************************************************************************************************************
+ *** DEFINES GLOBALES
+ **********************************************************************************************************************************/
+#define MAX_DOORS           8       /**< Cantidad máxima de dispositivos (líneas DEVICE) */
+#define DOOR_DEVICE_LEN     64      /**< Largo máximo del path de un dispositivo */
+#define DOOR_GLOBAL         -1      /**< Id de las claves válidas en todas las puertas */
+
+/***********************************************************************************************************************************
+ *** TIPO DE DATOS GLOBALES
+ **********************************************************************************************************************************/
+typedef struct ShmLayout ShmLayout_t;  /**< Formato de la memoria compartida (ver shm.h) */
+
+/**
+ * \struct Door_t
+ * \brief Una puerta: su dispositivo, su proceso lector y su parte de la memoria compartida.
+ * \details Cada puerta tiene sus propios semáforos, así dos puertas nunca esperan una por la otra.
+ */
+typedef struct {
+    int id;                             /**< Posición en el config.ini (0..MAX_DOORS-1). Se usa en /doors/<id>/ */
+    char device[DOOR_DEVICE_LEN];       /**< Path del dispositivo */
+    int driver;                         /**< fd del dispositivo */
+    int sem_k;                          /**< Semáforo de las claves de la puerta */
+    int sem_l;                          /**< Semáforo del log de la puerta */
+    int sem_write;                      /**< Semáforo de escritura del dispositivo */
+    pid_t pid;                          /**< Proceso lector (periph). -1 si no está corriendo */
+    KeyShard_t* keys;                   /**< Claves válidas solo en esta puerta */
+    ActivityEntry_t* log;               /**< Log de esta puerta (MAX_LOG) */
+    LogIndex_t* log_index;              /**< Índice del log por clave y por estado (bajo sem_l) */
+    Lockout_t* lockout;                 /**< Bloqueo por intentos fallidos (solo lo usa el lector) */
+} Door_t;
+
+/**
+ * \struct Doors_t
+ * \brief Todas las puertas y el conjunto de claves válidas en todas.
+ * \details Las claves, los logs, las estadísticas y los bloqueos van en un solo segmento de memoria compartida (ShmLayout_t).
+ * Los punteros se recalculan en cada proceso con DoorsAttach(): lo que se traspasa entre binarios son solo los IDs.
+ */
+typedef struct {
+    int count;                          /**< Cantidad de puertas */
+    int smId;                           /**< Memoria compartida (ShmLayout_t) */
+    int sem_global;                     /**< Semáforo de las claves globales */
+    int read_only;                      /**< Réplica: no se aceptan cambios por HTTP ni se lanzan lectores */
+    ShmLayout_t* shm;                   /**< Segmento enganchado. NULL si no */
+    KeyShard_t* global_keys;            /**< Claves válidas en todas las puertas */
+    Door_t door[MAX_DOORS];             /**< Puertas */
+} Doors_t;
+
+/***********************************************************************************************************************************
+ *** IMPLANTACION DE LA CLASE
+ **********************************************************************************************************************************/
+/**
+ * \fn int DoorsLoad(const Config_t* _config, Doors_t* _doors)
+ * \brief Lee los dispositivos del config.ini (una línea DEVICE por puerta).
+ * \param [in] _config: Configuración leída.
+ * \param [out] _doors: Puertas a completar. Todavía sin memoria compartida ni dispositivos abiertos.
+ * \return Devuelve -1 si error. La cantidad de puertas sino.
+*/
+int DoorsLoad(const Config_t* _config, Doors_t* _doors);
+
+/**
+ * \fn int DoorsCreate(char* _path, Doors_t* _doors)
+ * \brief Crea la memoria compartida y los semáforos, los inicializa y abre los dispositivos.
+ * \details Si algo falla deshace lo creado.
+ * \param [in] _path: Path al archivo generador de claves IPC (argv[0]).
+ * \param [in] _doors: Puertas leídas con DoorsLoad().
+ * \return Devuelve -1 si error. 0 sino.
+*/
+int DoorsCreate(char* _path, Doors_t* _doors);
+
+/**
+ * \fn int DoorsAttach(Doors_t* _doors)
+ * \brief Se engancha a la memoria compartida ya creada (por IDs) y recalcula los punteros.
+ * \param [in] _doors: Puertas con los IDs cargados.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+int DoorsAttach(Doors_t* _doors);
+
+/**
+ * \fn void DoorsDetach(Doors_t* _doors)
+ * \brief Se desengancha de la memoria compartida sin borrarla.
+ * \param [in] _doors: Puertas.
+*/
+void DoorsDetach(Doors_t* _doors);
+
+/**
+ * \fn void DoorsDestroy(Doors_t* _doors)
+ * \brief Cierra los dispositivos y borra la memoria compartida y los semáforos.
+ * \param [in] _doors: Puertas.
+*/
+void DoorsDestroy(Doors_t* _doors);
+
+/**
+ * \fn int DoorsStart(Doors_t* _doors)
+ * \brief Lanza un proceso lector (periph) por puerta.
+ * \param [in] _doors: Puertas.
+ * \return Devuelve -1 si error (los que llegaron a arrancar se detienen). 0 sino.
+*/
+int DoorsStart(Doors_t* _doors);
+
+/**
+ * \fn void DoorsStop(Doors_t* _doors)
+ * \brief Termina los procesos lectores.
+ * \param [in] _doors: Puertas.
+*/
+void DoorsStop(Doors_t* _doors);
+
+/**
+ * \fn int DoorsIsWorker(const Doors_t* _doors, pid_t _pid)
+ * \brief Indica si _pid es el lector de alguna puerta.
+ * \param [in] _doors: Puertas.
+ * \param [in] _pid: Proceso a buscar.
+ * \return 1 si es un lector. 0 sino.
+*/
+int DoorsIsWorker(const Doors_t* _doors, pid_t _pid);
+
+/**
+ * \fn void DoorsCloseDrivers(const Doors_t* _doors)
+ * \brief Cierra los fds de los dispositivos en este proceso.
+ * \param [in] _doors: Puertas.
+*/
+void DoorsCloseDrivers(const Doors_t* _doors);
+
+/**
+ * \fn KeyShard_t* DoorKeys(const Doors_t* _doors, int _door, int* _semId)
+ * \brief Claves de una puerta o las globales.
+ * \param [in] _doors: Puertas.
+ * \param [in] _door: Id de la puerta o DOOR_GLOBAL.
+ * \param [out] _semId: Semáforo que protege esas claves.
+ * \return Puntero a las claves. NULL si la puerta no existe.
+*/
+KeyShard_t* DoorKeys(const Doors_t* _doors, int _door, int* _semId);
+
+/**
+ * \fn int DoorsNotify(const Doors_t* _doors, int _door, const driver_msg_t _msg)
+ * \brief Envía un mensaje al dispositivo de una puerta, o a todos si _door es DOOR_GLOBAL.
+ * \param [in] _doors: Puertas.
+ * \param [in] _door: Id de la puerta o DOOR_GLOBAL.
+ * \param [in] _msg: Mensaje a escribir.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+int DoorsNotify(const Doors_t* _doors, int _door, const driver_msg_t _msg);
+
+#endif /* DOOR_H */
@@ -20,6 +20,7 @@
 #include <stdlib.h>     // sleep
 #include <unistd.h>     // sleep
 #include <fcntl.h>
+#include <sys/uio.h>    // writev()
 
 /***********************************************************************************************************************************
  *** DEFINES GLOBALES
@@ -53,5 +54,6 @@
  **********************************************************************************************************************************/
 int readDriver( int driver_fd, KeyEntry_t* _driver_buff );
 int writeDriver(int driver_fd, const driver_msg_t _msg, int _sem);
+int writeDriverBatch(int driver_fd, const driver_msg_t* _msgs, int _count, int _sem);
 
 #endif /* DRIVERHANDLER_H */
\ No newline at end of file
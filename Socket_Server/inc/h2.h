@@ -0,0 +1,143 @@
+/*******************************************************************************************************************************//**
+ *
+ * @file		h2.h
+ * @brief		HTTP/2 sin TLS (h2c): frames, streams multiplexados sobre una conexión y control de flujo.
+ * @date		19 oct. 2026
+ * @author		Martinez Agustin
+ *
+ **********************************************************************************************************************************/
+
+ /***********************************************************************************************************************************
+ *** MODULO
+ **********************************************************************************************************************************/
+#ifndef H2_H
+#define H2_H
+
+/***********************************************************************************************************************************
+ *** INCLUDES GLOBALES
+ **********************************************************************************************************************************/
+#include <stdint.h>     // uint8_t, uint32_t, int64_t
+#include <stdio.h>      // printf(), snprintf()
+#include <stdlib.h>     // malloc(), realloc(), free()
+#include <string.h>     // memcpy(), memmove(), strncmp()
+#include <strings.h>    // strncasecmp()
+#include <ctype.h>      // tolower(), isupper()
+#include <poll.h>       // poll()
+#include <errno.h>      // errno
+
+#include "../inc/conn.h"
+#include "../inc/hpack.h"
+
+/***********************************************************************************************************************************
+ *** DEFINES GLOBALES
+ **********************************************************************************************************************************/
+#define H2_PREFACE          "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n"  /**< Lo primero que manda el cliente */
+#define H2_PREFACE_LEN      24          /**< Largo de H2_PREFACE */
+#define H2_PREFACE_HEAD     18          /**< Parte de H2_PREFACE que ConnReadRequest() toma como encabezado */
+#define H2_FRAME_HEADER     9           /**< Largo, tipo, flags y stream de cada frame */
+#define H2_MAX_FRAME        16384       /**< SETTINGS_MAX_FRAME_SIZE: el mínimo del protocolo, no se anuncia otro */
+#define H2_MAX_STREAMS      32          /**< SETTINGS_MAX_CONCURRENT_STREAMS */
+#define H2_MAX_REQUESTS     1000        /**< Pedidos por conexión: después se manda GOAWAY y se libera el hijo o el hilo */
+#define H2_WINDOW           65535       /**< Ventana inicial de control de flujo */
+#define H2_MAX_WINDOW       0x7FFFFFFF  /**< Ventana máxima */
+#define H2_HEADER_BLOCK     16384       /**< Bloque de encabezados de un pedido (HEADERS y sus CONTINUATION) */
+#define H2_HEAD_SIZE        4096        /**< Encabezado HTTP/1.1 armado para los manejadores */
+#define H2_PENDING          1024        /**< Frames chicos que se juntan antes de escribir */
+
+#define H2_BLOCK_REQUEST    0           /**< Bloque de encabezados de un pedido nuevo */
+#define H2_BLOCK_TRAILERS   1           /**< Trailers de un pedido: se descartan */
+#define H2_BLOCK_REFUSED    2           /**< Stream rechazado: se decodifica solo para mantener la tabla HPACK */
+
+#define H2_PRIOR            1           /**< H2Detect(): el cliente empezó con el prefacio */
+#define H2_UPGRADE          2           /**< H2Detect(): pedido HTTP/1.1 con Upgrade: h2c */
+
+/***********************************************************************************************************************************
+ *** TIPO DE DATOS GLOBALES
+ **********************************************************************************************************************************/
+/**
+ * \brief Atiende un pedido HTTP/1.1 cargado en _conn. Lo que escribe en el socket se captura y sale como respuesta
+ * del stream.
+ * \param [in] _conn: Conexión con el pedido completo.
+ * \param [in] _arg: Argumento de H2Serve().
+ * \return Devuelve -1 si error. 0 sino.
+ */
+typedef int (*H2Handler_t)(Connection_t* _conn, void* _arg);
+
+/**
+ * \struct H2Stream_t
+ * \brief Un pedido en curso: se arma mientras llegan HEADERS y DATA, y después se envía la respuesta.
+ */
+typedef struct {
+    uint32_t id;                    /**< Id del stream. 0: libre */
+    int remote_closed;              /**< El cliente mandó END_STREAM: el pedido está completo */
+    int too_large;                  /**< El pedido no entra: se responde 413 */
+    char head[H2_HEAD_SIZE];        /**< Encabezado HTTP/1.1 sin Content-Length ni la línea vacía */
+    size_t head_len;                /**< Largo de head */
+    char* body;                     /**< Cuerpo recibido (malloc) */
+    size_t body_len;                /**< Largo del cuerpo */
+    size_t body_cap;                /**< Capacidad de body */
+    char* out;                      /**< Respuesta capturada (malloc). NULL si todavía no hay */
+    size_t out_pos;                 /**< Próximo byte del cuerpo por enviar */
+    size_t out_end;                 /**< Fin del cuerpo */
+    int64_t window;                 /**< Ventana de envío del stream (puede quedar negativa) */
+} H2Stream_t;
+
+/**
+ * \struct H2Session_t
+ * \brief Estado de una conexión HTTP/2.
+ */
+typedef struct {
+    Connection_t* conn;             /**< Conexión (socket, límites y el pedido que la abrió) */
+    H2Handler_t handler;            /**< Atiende cada pedido */
+    void* arg;                      /**< Argumento de handler */
+    uint8_t* in;                    /**< Datos recibidos todavía sin procesar */
+    size_t in_len;                  /**< Bytes en in */
+    size_t in_cap;                  /**< Capacidad de in */
+    int preface;                    /**< Ya llegó el prefacio */
+    int settings;                   /**< Ya llegó el primer SETTINGS del cliente */
+    uint32_t last_id;               /**< Stream más alto abierto por el cliente */
+    uint32_t continuation;          /**< Stream que espera CONTINUATION. 0 si ninguno */
+    uint8_t block[H2_HEADER_BLOCK]; /**< Bloque de encabezados en armado */
+    size_t block_len;               /**< Largo de block */
+    int block_end;                  /**< El bloque en armado trae END_STREAM */
+    int block_kind;                 /**< Pedido nuevo, trailers o stream rechazado (H2_BLOCK_*) */
+    HpackTable_t decoder;           /**< Tabla dinámica de los pedidos */
+    HpackTable_t encoder;           /**< Tabla dinámica de las respuestas */
+    int64_t window;                 /**< Ventana de envío de la conexión */
+    int64_t initial_window;         /**< SETTINGS_INITIAL_WINDOW_SIZE del cliente */
+    int requests;                   /**< Pedidos atendidos */
+    int closing;                    /**< Se mandó o recibió GOAWAY: se termina lo pendiente y se cierra */
+    int next;                       /**< Stream que sigue en el reparto de DATA */
+    H2Stream_t streams[H2_MAX_STREAMS]; /**< Streams abiertos */
+    uint8_t pending[H2_PENDING];    /**< Frames chicos por escribir */
+    size_t pending_len;             /**< Bytes en pending */
+} H2Session_t;
+
+/***********************************************************************************************************************************
+ *** IMPLANTACION DE LA CLASE
+ **********************************************************************************************************************************/
+/**
+ * \fn int H2Detect(const Connection_t* _conn)
+ * \brief Indica si el pedido leído por ConnReadRequest() abre una conexión HTTP/2.
+ * \param [in] _conn: Conexión con el pedido completo.
+ * \return H2_PRIOR si empieza con el prefacio, H2_UPGRADE si pide Upgrade: h2c con HTTP2-Settings. 0 sino.
+*/
+int H2Detect(const Connection_t* _conn);
+
+/**
+ * \fn int H2Serve(Connection_t* _conn, int _mode, H2Handler_t _handler, void* _arg)
+ * \brief Atiende la conexión con HTTP/2 hasta que el cliente la cierra, se vence READ_TIMEOUT sin tráfico o se
+ * llega a H2_MAX_REQUESTS pedidos.
+ * \details Cada stream completo se arma como pedido HTTP/1.1 en una conexión aparte y lo atiende _handler con el
+ * socket capturado; la respuesta sale en un HEADERS (con HPACK) y frames DATA. Los DATA de los distintos streams se
+ * envían alternados, de a un frame por stream, respetando las ventanas del cliente. Con H2_UPGRADE primero se
+ * responde 101 y el pedido original pasa a ser el stream 1.
+ * \param [in] _conn: Conexión con el pedido que devolvió H2Detect().
+ * \param [in] _mode: H2_PRIOR o H2_UPGRADE.
+ * \param [in] _handler: Atiende cada pedido.
+ * \param [in] _arg: Argumento de _handler.
+ * \return Devuelve -1 si error de socket. 0 sino.
+*/
+int H2Serve(Connection_t* _conn, int _mode, H2Handler_t _handler, void* _arg);
+
+#endif /* H2_H */
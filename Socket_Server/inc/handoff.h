@@ -0,0 +1,112 @@
+/*******************************************************************************************************************************//**
+ *
+ * @file		handoff.h
+ * @brief		Traspaso de sockets de escucha y memoria compartida a un binario nuevo (actualización sin cortes).
+ * @date		19 oct. 2026
+ * @author		Martinez Agustin
+ *
+ **********************************************************************************************************************************/
+
+ /***********************************************************************************************************************************
+ *** MODULO
+ **********************************************************************************************************************************/
+#ifndef HANDOFF_H
+#define HANDOFF_H
+
+/***********************************************************************************************************************************
+ *** INCLUDES GLOBALES
+ **********************************************************************************************************************************/
+#include <sys/socket.h> // socketpair(), sendmsg(), recvmsg(), SCM_RIGHTS
+#include <sys/types.h>  // pid_t
+#include <sys/wait.h>   // waitpid()
+#include <signal.h>     // sigprocmask()
+#include <poll.h>       // poll()
+#include <errno.h>      // errno
+#include <stdio.h>      // printf(), perror()
+#include <stdlib.h>     // getenv(), setenv()
+#include <string.h>     // memcpy()
+#include <unistd.h>     // fork(), execv()
+
+#include "../inc/listener.h"
+#include "../inc/door.h"
+
+/***********************************************************************************************************************************
+ *** DEFINES GLOBALES
+ **********************************************************************************************************************************/
+#define HANDOFF_ENV         "ALARM_HANDOFF_FD"  /**< Variable de entorno con el socket de traspaso */
+#define HANDOFF_MAGIC       0x414C524DU         /**< "ALRM" */
+#define HANDOFF_VERSION     8                   /**< Versión del mensaje de traspaso. Cambia si cambia el formato de la memoria compartida */
+#define HANDOFF_TIMEOUT_MS  10000               /**< Espera máxima a que el binario nuevo quede listo */
+#define HANDOFF_MAX_FDS     (MAX_LISTENERS + MAX_DOORS + 1) /**< Listeners + un dispositivo por puerta + replicación */
+
+/***********************************************************************************************************************************
+ *** TIPO DE DATOS GLOBALES
+ **********************************************************************************************************************************/
+/**
+ * \struct HandoffState_t
+ * \brief Estado que el proceso viejo le pasa al nuevo.
+ * \details Los file descriptors viajan aparte (SCM_RIGHTS); en el mensaje solo van los metadatos.
+ * La memoria compartida y los semáforos SysV se identifican por ID: el proceso nuevo se engancha a ellos
+ * sin volver a inicializarlos, así no se pierden las claves ni el log.
+ */
+typedef struct {
+    unsigned int magic;                         /**< HANDOFF_MAGIC */
+    int version;                                /**< HANDOFF_VERSION */
+    Doors_t doors;                              /**< Puertas: IDs de memoria compartida, semáforos y dispositivos */
+    int listeners_count;                        /**< Cantidad de sockets de escucha */
+    Listener_t listeners[MAX_LISTENERS];        /**< Sockets de escucha */
+    Listener_t repl_listener;                   /**< Escucha de réplicas (REPLICATION_LISTEN). fd -1 si no hay */
+} HandoffState_t;
+
+/***********************************************************************************************************************************
+ *** IMPLANTACION DE LA CLASE
+ **********************************************************************************************************************************/
+/**
+ * \fn int HandoffSpawn(char* _argv[], int* _sock)
+ * \brief Ejecuta el binario nuevo con un socket de traspaso.
+ * \details Crea un socketpair y ejecuta _argv[0] con HANDOFF_ENV apuntando a su extremo. Se hace doble fork()
+ * para que el proceso nuevo no sea hijo del viejo: así no entra en la cuenta de hijos del proceso viejo y
+ * sigue vivo cuando el viejo termina. El proceso nuevo cierra el resto de los fds heredados:
+ * los que necesita le llegan por el socket.
+ * \param [in] _argv: Argumentos con los que se ejecutó el servidor.
+ * \param [out] _sock: Extremo del socket del proceso viejo.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+int HandoffSpawn(char* _argv[], int* _sock);
+
+/**
+ * \fn int HandoffSend(int _sock, const HandoffState_t* _state)
+ * \brief Envía el estado y los fds al proceso nuevo.
+ * \param [in] _sock: Socket de traspaso.
+ * \param [in] _state: Estado a enviar.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+int HandoffSend(int _sock, const HandoffState_t* _state);
+
+/**
+ * \fn int HandoffWaitReady(int _sock, int _timeout_ms)
+ * \brief Espera la confirmación del proceso nuevo.
+ * \param [in] _sock: Socket de traspaso.
+ * \param [in] _timeout_ms: Espera máxima.
+ * \return 0 si el proceso nuevo ya atiende clientes. -1 si falló (el viejo debe seguir atendiendo).
+*/
+int HandoffWaitReady(int _sock, int _timeout_ms);
+
+/**
+ * \fn int HandoffReceive(HandoffState_t* _state, int* _sock)
+ * \brief En el proceso nuevo: recibe el estado si se lo ejecutó por traspaso.
+ * \param [out] _state: Estado recibido, con los fds ya válidos en este proceso.
+ * \param [out] _sock: Socket de traspaso para confirmar con HandoffReady().
+ * \return 1 si hubo traspaso, 0 si es un arranque normal, -1 si error.
+*/
+int HandoffReceive(HandoffState_t* _state, int* _sock);
+
+/**
+ * \fn int HandoffReady(int _sock)
+ * \brief En el proceso nuevo: avisa al viejo que ya atiende clientes y cierra el socket.
+ * \param [in] _sock: Socket de traspaso.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+int HandoffReady(int _sock);
+
+#endif /* HANDOFF_H */
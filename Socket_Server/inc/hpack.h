@@ -0,0 +1,125 @@
+/*******************************************************************************************************************************//**
+ *
+ * @file		hpack.h
+ * @brief		HPACK (RFC 7541): compresión de encabezados de HTTP/2 con tabla estática, tabla dinámica y Huffman.
+ * @date		19 oct. 2026
+ * @author		Martinez Agustin
+ *
+ **********************************************************************************************************************************/
+
+ /***********************************************************************************************************************************
+ *** MODULO
+ **********************************************************************************************************************************/
+#ifndef HPACK_H
+#define HPACK_H
+
+/***********************************************************************************************************************************
+ *** INCLUDES GLOBALES
+ **********************************************************************************************************************************/
+#include <stdint.h>     // uint8_t, uint16_t, uint32_t
+#include <stddef.h>     // size_t
+#include <string.h>     // memcpy(), memmove(), strlen()
+
+/***********************************************************************************************************************************
+ *** DEFINES GLOBALES
+ **********************************************************************************************************************************/
+#define HPACK_TABLE_SIZE    4096        /**< Tamaño de la tabla dinámica (SETTINGS_HEADER_TABLE_SIZE por defecto) */
+#define HPACK_ENTRY_EXTRA   32          /**< Lo que suma cada entrada además de nombre y valor (RFC 7541 4.1) */
+#define HPACK_MAX_ENTRIES   (HPACK_TABLE_SIZE / HPACK_ENTRY_EXTRA)  /**< Entradas que entran como máximo */
+#define HPACK_STATIC        61          /**< Entradas de la tabla estática */
+#define HPACK_STRING_MAX    4096        /**< Largo máximo de un nombre o valor decodificado */
+
+#define HPACK_INDEX         1           /**< HpackEncode(): agregar el campo a la tabla dinámica */
+#define HPACK_NO_INDEX      0           /**< HpackEncode(): no agregarlo (valores que cambian en cada respuesta) */
+
+/***********************************************************************************************************************************
+ *** TIPO DE DATOS GLOBALES
+ **********************************************************************************************************************************/
+/**
+ * \struct HpackEntry_t
+ * \brief Una entrada de la tabla dinámica: nombre y valor seguidos en text.
+ */
+typedef struct {
+    uint16_t offset;                            /**< Comienzo en text */
+    uint16_t name_len;                          /**< Largo del nombre */
+    uint16_t value_len;                         /**< Largo del valor */
+} HpackEntry_t;
+
+/**
+ * \struct HpackTable_t
+ * \brief Tabla dinámica de un sentido de la conexión (una para decodificar y otra para codificar).
+ * \details La entrada más nueva es entry[0] y su texto está al principio de text: agregar corre todo hacia atrás y
+ * desalojar saca del final. Con HPACK_TABLE_SIZE bytes como máximo correr el texto es barato.
+ */
+typedef struct {
+    HpackEntry_t entry[HPACK_MAX_ENTRIES];      /**< Entradas, de la más nueva a la más vieja */
+    int count;                                  /**< Cantidad de entradas */
+    size_t size;                                /**< Tamaño según RFC 7541 (nombre + valor + 32 por entrada) */
+    size_t max_size;                            /**< Tamaño máximo en uso */
+    size_t limit;                               /**< Máximo que puede fijar una actualización de tamaño */
+    int resized;                                /**< Codificador: hay que avisar el tamaño nuevo en el próximo bloque */
+    size_t text_len;                            /**< Bytes usados de text */
+    char text[HPACK_TABLE_SIZE];                /**< Nombres y valores */
+} HpackTable_t;
+
+/**
+ * \brief Función que recibe cada campo decodificado. Los punteros valen solo durante la llamada.
+ * \param [in] _arg: Argumento de HpackDecode().
+ * \param [in] _name: Nombre (no termina en '\0').
+ * \param [in] _name_len: Largo del nombre.
+ * \param [in] _value: Valor (no termina en '\0').
+ * \param [in] _value_len: Largo del valor.
+ * \return Devuelve -1 para cortar la decodificación. 0 sino.
+ */
+typedef int (*HpackField_t)(void* _arg, const char* _name, size_t _name_len, const char* _value, size_t _value_len);
+
+/***********************************************************************************************************************************
+ *** IMPLANTACION DE LA CLASE
+ **********************************************************************************************************************************/
+/**
+ * \fn void HpackInit(HpackTable_t* _table, size_t _limit)
+ * \brief Deja la tabla vacía con tamaño máximo _limit.
+ * \param [out] _table: Tabla.
+ * \param [in] _limit: Tamaño máximo (a lo sumo HPACK_TABLE_SIZE).
+*/
+void HpackInit(HpackTable_t* _table, size_t _limit);
+
+/**
+ * \fn int HpackDecode(HpackTable_t* _table, const uint8_t* _block, size_t _len, HpackField_t _field, void* _arg)
+ * \brief Decodifica un bloque de encabezados completo y llama a _field por cada campo, en orden.
+ * \details Cualquier error deja la tabla inconsistente con la del otro lado: es un error de compresión y la
+ * conexión no se puede seguir usando.
+ * \param [in] _table: Tabla dinámica del decodificador.
+ * \param [in] _block: Bloque (HEADERS más sus CONTINUATION).
+ * \param [in] _len: Largo del bloque.
+ * \param [in] _field: Función para cada campo.
+ * \param [in] _arg: Argumento de _field.
+ * \return Devuelve -1 si el bloque es inválido o _field cortó. 0 sino.
+*/
+int HpackDecode(HpackTable_t* _table, const uint8_t* _block, size_t _len, HpackField_t _field, void* _arg);
+
+/**
+ * \fn void HpackResize(HpackTable_t* _table, size_t _limit)
+ * \brief Codificador: el otro lado cambió SETTINGS_HEADER_TABLE_SIZE. Se avisa en el próximo bloque.
+ * \param [in] _table: Tabla dinámica del codificador.
+ * \param [in] _limit: Tamaño máximo nuevo (se usa a lo sumo HPACK_TABLE_SIZE).
+*/
+void HpackResize(HpackTable_t* _table, size_t _limit);
+
+/**
+ * \fn int HpackEncode(HpackTable_t* _table, uint8_t* _out, size_t _size, const char* _name, const char* _value, int _mode)
+ * \brief Agrega un campo a un bloque de encabezados.
+ * \details Usa un índice si el campo ya está en la tabla estática o en la dinámica. Sino va como literal, con el
+ * nombre indexado si se puede, y con HPACK_INDEX queda en la tabla dinámica para las respuestas siguientes. Los
+ * literales no usan Huffman. El primer campo de un bloque lleva el aviso de HpackResize() si hay uno pendiente.
+ * \param [in] _table: Tabla dinámica del codificador.
+ * \param [out] _out: Destino.
+ * \param [in] _size: Espacio en _out.
+ * \param [in] _name: Nombre en minúsculas.
+ * \param [in] _value: Valor.
+ * \param [in] _mode: HPACK_INDEX o HPACK_NO_INDEX.
+ * \return Bytes escritos. -1 si no entra.
+*/
+int HpackEncode(HpackTable_t* _table, uint8_t* _out, size_t _size, const char* _name, const char* _value, int _mode);
+
+#endif /* HPACK_H */
@@ -0,0 +1,108 @@
+/*******************************************************************************************************************************//**
+ *
+ * @file		listener.h
+ * @brief		Sockets de escucha del servidor (IPv4, IPv6 dual-stack y unix domain socket).
+ * @date		19 oct. 2026
+ * @author		Martinez Agustin
+ *
+ **********************************************************************************************************************************/
+
+ /***********************************************************************************************************************************
+ *** MODULO
+ **********************************************************************************************************************************/
+#ifndef LISTENER_H
+#define LISTENER_H
+
+/***********************************************************************************************************************************
+ *** INCLUDES GLOBALES
+ **********************************************************************************************************************************/
+#include <sys/socket.h> // socket(), bind(), listen()
+#include <sys/un.h>     // struct sockaddr_un
+#include <sys/stat.h>   // chmod()
+#include <netinet/in.h> // struct sockaddr_in, struct sockaddr_in6
+#include <netinet/tcp.h>// TCP_NODELAY, TCP_DEFER_ACCEPT, TCP_FASTOPEN
+#include <arpa/inet.h>  // inet_pton()
+#include <stdio.h>      // printf()
+#include <stdlib.h>     // strtol()
+#include <string.h>     // strncpy(), strchr()
+#include <unistd.h>     // close(), unlink()
+
+/***********************************************************************************************************************************
+ *** DEFINES GLOBALES
+ **********************************************************************************************************************************/
+#define MAX_LISTENERS   8       /**< Cantidad máxima de direcciones de escucha */
+#define LISTEN_ADDR_LEN 108     /**< Largo máximo de la dirección (sun_path) */
+
+/***********************************************************************************************************************************
+ *** TIPO DE DATOS GLOBALES
+ **********************************************************************************************************************************/
+/**
+ * \struct Listener_t
+ * \brief Dirección de escucha con sus opciones.
+ * \details Se arma desde una línea LISTEN del config.ini, por ejemplo:
+ * "0.0.0.0:8080 backlog=10 nodelay", "[::]:8443 defer_accept=5 tls" o "unix:/tmp/alarm.sock mode=0660".
+ */
+typedef struct {
+    int fd;                         /**< Socket de escucha. -1 si no está abierto */
+    int family;                     /**< AF_INET, AF_INET6 o AF_UNIX */
+    char addr[LISTEN_ADDR_LEN];     /**< IP o path del socket unix */
+    int port;                       /**< Puerto (no aplica a AF_UNIX) */
+    int backlog;                    /**< Backlog de listen() */
+    int nodelay;                    /**< TCP_NODELAY en las conexiones aceptadas */
+    int defer_accept;               /**< TCP_DEFER_ACCEPT en segundos. 0 deshabilitado */
+    int fastopen;                   /**< Largo de cola TCP_FASTOPEN. 0 deshabilitado */
+    int v6only;                     /**< IPV6_V6ONLY. 0 para dual-stack */
+    int mode;                       /**< Permisos del socket unix. 0 para dejar los por defecto */
+    int tls;                        /**< HTTPS (TLS_CERT, TLS_KEY) en las conexiones aceptadas */
+} Listener_t;
+
+/***********************************************************************************************************************************
+ *** IMPLANTACION DE LA CLASE
+ **********************************************************************************************************************************/
+/**
+ * \fn int ParseListener(const char* _spec, int _backlog, Listener_t* _listener)
+ * \brief Interpreta una dirección de escucha.
+ * \details Formatos: "IPv4:puerto", "[IPv6]:puerto", "unix:/path", seguidos de opciones separadas por espacios:
+ * backlog=N, nodelay, defer_accept=SEG, fastopen=N, v6only, mode=OCTAL, tls.
+ * \param [in] _spec: Texto a interpretar.
+ * \param [in] _backlog: Backlog a usar si no se indica.
+ * \param [out] _listener: Listener a completar.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+int ParseListener(const char* _spec, int _backlog, Listener_t* _listener);
+
+/**
+ * \fn int OpenListener(Listener_t* _listener)
+ * \brief Crea el socket, aplica las opciones, hace bind() y listen().
+ * \param [in] _listener: Listener a abrir. Se completa su fd.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+int OpenListener(Listener_t* _listener);
+
+/**
+ * \fn void CloseListener(Listener_t* _listener, int _unlink)
+ * \brief Cierra el socket de escucha.
+ * \param [in] _listener: Listener a cerrar.
+ * \param [in] _unlink: Si es distinto de 0 borra el path de los sockets unix.
+*/
+void CloseListener(Listener_t* _listener, int _unlink);
+
+/**
+ * \fn void SetupAccepted(const Listener_t* _listener, int _client_id)
+ * \brief Aplica al socket aceptado las opciones del listener que lo recibió.
+ * \param [in] _listener: Listener que aceptó la conexión.
+ * \param [in] _client_id: Socket aceptado.
+*/
+void SetupAccepted(const Listener_t* _listener, int _client_id);
+
+/**
+ * \fn const char* ListenerName(const Listener_t* _listener, char* _buff, size_t _size)
+ * \brief Texto de la dirección para mostrar por consola.
+ * \param [in] _listener: Listener a describir.
+ * \param [out] _buff: Buffer destino.
+ * \param [in] _size: Tamaño del buffer.
+ * \return _buff.
+*/
+const char* ListenerName(const Listener_t* _listener, char* _buff, size_t _size);
+
+#endif /* LISTENER_H */
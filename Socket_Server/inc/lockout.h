@@ -0,0 +1,168 @@
+/*******************************************************************************************************************************//**
+ *
+ * @file		lockout.h
+ * @brief		Bloqueo por intentos fallidos (fuerza bruta) con ventanas deslizantes por puerta y por origen.
+ * @date		19 oct. 2026
+ * @author		Martinez Agustin
+ *
+ **********************************************************************************************************************************/
+
+ /***********************************************************************************************************************************
+ *** MODULO
+ **********************************************************************************************************************************/
+#ifndef LOCKOUT_H
+#define LOCKOUT_H
+
+/***********************************************************************************************************************************
+ *** INCLUDES GLOBALES
+ **********************************************************************************************************************************/
+#include <sys/socket.h> // getpeername()
+#include <netinet/in.h> // struct sockaddr_in6
+#include <sched.h>      // sched_yield()
+#include <pthread.h>    // pthread_mutex_t (compartido entre procesos y robusto)
+#include <string.h>     // memcpy(), memset()
+#include <stdint.h>     // int64_t, uint32_t
+
+#include "../inc/data.h"
+
+/***********************************************************************************************************************************
+ *** DEFINES GLOBALES
+ **********************************************************************************************************************************/
+#define LOCKOUT_SOURCES     256         /**< Orígenes (IP) recordados a la vez */
+#define LOCKOUT_PROBE       8           /**< Celdas revisadas por origen antes de reemplazar la más vieja */
+
+/***********************************************************************************************************************************
+ *** TIPO DE DATOS GLOBALES
+ **********************************************************************************************************************************/
+/**
+ * \struct SlidingWindow_t
+ * \brief Contador de fallas en los últimos T segundos, con dos ventanas fijas.
+ * \details La cuenta estimada es la de la ventana actual más la parte de la anterior que todavía cae dentro de los
+ * últimos T segundos. Sumar y consultar es O(1) y no guarda un instante por intento.
+ */
+typedef struct {
+    int64_t start_ns;               /**< Comienzo de la ventana actual */
+    uint32_t current;               /**< Fallas en la ventana actual */
+    uint32_t previous;              /**< Fallas en la ventana anterior */
+} SlidingWindow_t;
+
+/**
+ * \struct Lockout_t
+ * \brief Estado de bloqueo de una puerta o de un origen.
+ */
+typedef struct {
+    SlidingWindow_t window;         /**< Fallas recientes */
+    int64_t locked_until_ns;        /**< Fin del bloqueo. 0 si no está bloqueado */
+    uint32_t suppressed;            /**< Intentos descartados durante el bloqueo */
+} Lockout_t;
+
+/**
+ * \struct LockoutSource_t
+ * \brief Un origen (dirección IPv6, o IPv4 mapeada) con su estado de bloqueo.
+ */
+typedef struct {
+    uint8_t addr[16];               /**< Dirección */
+    int64_t last_ns;                /**< Última falla. 0 si la celda está libre */
+    Lockout_t state;                /**< Bloqueo */
+} LockoutSource_t;
+
+/**
+ * \struct LockoutTable_t
+ * \brief Orígenes de los pedidos web, en la memoria compartida por el servidor, sus hijos y sus hilos.
+ * \details Se cambia con el lock tomado y entre SeqWriteBegin() y SeqWriteEnd(): LockoutSourcesRead() copia sin él.
+ * El lock es un mutex robusto: si un cliente muere con él tomado, el siguiente lo recupera y deja seq par.
+ */
+typedef struct {
+    pthread_mutex_t lock;                       /**< Mutex compartido entre procesos y robusto */
+    uint32_t ready;                             /**< 1 si lock ya está inicializado (el segmento nuevo viene en cero) */
+    uint32_t seq;                               /**< Impar mientras se cambia alguna celda */
+    LockoutSource_t sources[LOCKOUT_SOURCES];   /**< Tabla con hash y sondeo lineal */
+} LockoutTable_t;
+
+/***********************************************************************************************************************************
+ *** IMPLANTACION DE LA CLASE
+ **********************************************************************************************************************************/
+/**
+ * \fn void LockoutInit(LockoutTable_t* _table, int _failures, long _window_ms, long _time_ms)
+ * \brief Fija los límites y la tabla de orígenes. Se llama una vez en el proceso principal, antes de los fork().
+ * \details Inicializa el lock de la tabla solo si el segmento es nuevo: con SIGUSR2 lo pueden tener tomado los
+ * clientes del proceso anterior.
+ * \param [in] _table: Tabla en la memoria compartida (ShmLayout_t). NULL: solo se bloquean las puertas.
+ * \param [in] _failures: Fallas dentro de la ventana que bloquean (LOCKOUT_FAILURES). 0 desactiva el bloqueo.
+ * \param [in] _window_ms: Ventana (LOCKOUT_WINDOW).
+ * \param [in] _time_ms: Duración del bloqueo (LOCKOUT_TIME).
+*/
+void LockoutInit(LockoutTable_t* _table, int _failures, long _window_ms, long _time_ms);
+
+/**
+ * \fn int LockoutActive(Lockout_t* _lockout, int64_t _now_ns)
+ * \brief Indica si está bloqueado. Si lo está cuenta el intento como descartado.
+ * \param [in] _lockout: Estado.
+ * \param [in] _now_ns: Instante actual.
+ * \return 1 si está bloqueado. 0 sino.
+*/
+int LockoutActive(Lockout_t* _lockout, int64_t _now_ns);
+
+/**
+ * \fn int LockoutFail(Lockout_t* _lockout, int64_t _now_ns)
+ * \brief Registra una falla.
+ * \param [in] _lockout: Estado.
+ * \param [in] _now_ns: Instante actual.
+ * \return 1 si esta falla empieza un bloqueo. 0 sino.
+*/
+int LockoutFail(Lockout_t* _lockout, int64_t _now_ns);
+
+/**
+ * \fn void LockoutReset(Lockout_t* _lockout)
+ * \brief Olvida las fallas (clave correcta).
+ * \param [in] _lockout: Estado.
+*/
+void LockoutReset(Lockout_t* _lockout);
+
+/**
+ * \fn int LockoutExpired(Lockout_t* _lockout, int64_t _now_ns)
+ * \brief Termina el bloqueo si ya pasó LOCKOUT_TIME.
+ * \param [in] _lockout: Estado.
+ * \param [in] _now_ns: Instante actual.
+ * \return Intentos descartados si el bloqueo terminó ahora. -1 sino.
+*/
+int LockoutExpired(Lockout_t* _lockout, int64_t _now_ns);
+
+/**
+ * \fn int LockoutSourceActive(int _fd, int64_t _now_ns)
+ * \brief Indica si el origen de la conexión está bloqueado. Las conexiones por socket unix no se bloquean.
+ * \param [in] _fd: Socket del cliente.
+ * \param [in] _now_ns: Instante actual.
+ * \return Segundos que faltan si está bloqueado. 0 sino.
+*/
+int LockoutSourceActive(int _fd, int64_t _now_ns);
+
+/**
+ * \fn int LockoutSourceFail(int _fd, int64_t _now_ns)
+ * \brief Registra una falla del origen de la conexión.
+ * \param [in] _fd: Socket del cliente.
+ * \param [in] _now_ns: Instante actual.
+ * \return 1 si esta falla bloquea al origen. 0 sino.
+*/
+int LockoutSourceFail(int _fd, int64_t _now_ns);
+
+/**
+ * \fn void LockoutRead(const Lockout_t* _lockout, Lockout_t* _out)
+ * \brief Copia el bloqueo de una puerta, que escribe solo su lector, desde otro proceso.
+ * \details Cada campo se lee entero; la copia puede mezclar dos intentos seguidos, alcanza para mostrarla.
+ * \param [in] _lockout: Estado (puede estar enganchado en solo lectura).
+ * \param [out] _out: Copia.
+*/
+void LockoutRead(const Lockout_t* _lockout, Lockout_t* _out);
+
+/**
+ * \fn int LockoutSourcesRead(const LockoutTable_t* _table, LockoutSource_t* _out)
+ * \brief Copia los orígenes ocupados sin tomar el lock, para leer la tabla de otro proceso.
+ * \details Copia entre dos lecturas de seq y reintenta si cambió o si había un cambio a medias.
+ * \param [in] _table: Tabla (puede estar enganchada en solo lectura).
+ * \param [out] _out: LOCKOUT_SOURCES posiciones.
+ * \return Cantidad de orígenes. -1 si no se consiguió una copia entera en SEQ_RETRIES intentos.
+*/
+int LockoutSourcesRead(const LockoutTable_t* _table, LockoutSource_t* _out);
+
+#endif /* LOCKOUT_H */
@@ -25,22 +25,40 @@
 #include <sys/wait.h>   // waitpid()
 #include <signal.h>     // signal()
 #include <errno.h>      // errno variable
+#include <poll.h>       // poll()
+#include <sys/time.h>   // setitimer()
 
 #include "../inc/data.h"
 #include "../inc/client.h"
 #include "../inc/periph.h"
+#include "../inc/conn.h"
+#include "../inc/listener.h"
+#include "../inc/config.h"
+#include "../inc/handoff.h"
+#include "../inc/snapshot.h"
+#include "../inc/repl.h"
+#include "../inc/workers.h"
+#include "../inc/children.h"
+#include "../inc/shm.h"
 
 /***********************************************************************************************************************************
  *** TIPO DE DATOS GLOBALES
  **********************************************************************************************************************************/
-#define DEFAULT_BACKLOG         1
-#define DEFAULT_MAXCONNECTIONS  1
+void ApplyConfig(const Config_t* _config, int* _backlog, int* _max_connections, ConnLimits_t* _limits);
+int ReloadConfig(Config_t* _config, Listener_t* _listeners, int _count, int* _max_connections, ConnLimits_t* _limits);
+int LoadListeners(const Config_t* _config, int _port, int _backlog, Listener_t* _listeners);
+void CloseListeners(Listener_t* _listeners, int _count);
+int Upgrade(char* _argv[], const HandoffState_t* _state);
+int OpenReplication(const Config_t* _config, int _backlog, Listener_t* _listener);
+int StartWorkers(const Config_t* _config, WorkerPool_t* _workers, Doors_t* _doors);
+int StartTls(const Config_t* _config, const Listener_t* _listeners, int _count);
+pid_t StartFollower(const char* _primary, Listener_t* _listeners, int _count, const Listener_t* _repl);
+void ServeReplica(const Listener_t* _repl, Listener_t* _listeners, int _count);
+void StopReplication(int _follower_only);
+void SnapshotTimer(long _interval_ms);
+void setSignals(sigset_t* _mask);
+int DispatchSignals(ChildTable_t* _children);
 
-int GetInitValue(const char* _file_name, const char* _key);
-int MakeServer(int _port, int _backlog );
-void setHandlers( void );
-
-void ChildHandler(int signal);
-void KillHandler(int signal);
+void WorkerExited(pid_t _pid, int _status);
 
 #endif
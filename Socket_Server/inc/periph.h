@@ -17,21 +17,35 @@
  **********************************************************************************************************************************/
 #include "../inc/data.h"
 #include "../inc/driverHandler.h"
+#include "../inc/door.h"
+#include "../inc/timerwheel.h"
+#include "../inc/repl.h"
+#include "../inc/lockout.h"
+#include "../inc/actuator.h"
+#include "../inc/stats.h"
 
 #include <stdio.h>      // files, scanf
 #include <stdlib.h>     // sleep
 #include <unistd.h>     // sleep
+#include <poll.h>       // poll()
+#include <errno.h>      // errno
+#include <string.h>     // memset()
 
 /***********************************************************************************************************************************
  *** IMPLANTACION DE LA CLASE
  **********************************************************************************************************************************/
 /**
- * \fn int periph( int driver )
- * \brief Función de manejo del periférico
- * \details Abre la memoria compartida, lee el teclado y analiza la respuesta. 
- * \param [in] driver: File descriptor del driver a utilizar. 
- * Las respuestas activan los leds y se guardan en el log.
+ * \fn int periph(const Doors_t* _doors, int _id)
+ * \brief Función de manejo del periférico de una puerta.
+ * \details Espera con poll() a que el dispositivo tenga una clave, la valida contra las claves de la puerta y las
+ * globales, activa los leds y la guarda en el log de la puerta. Solo toma semáforos de su puerta (y el global para leer).
+ * Además vence las claves temporales de su puerta (la puerta 0 también las globales) con una rueda de timers que
+ * avanza una vez por segundo. Tras LOCKOUT_FAILURES claves incorrectas en LOCKOUT_WINDOW la puerta se bloquea
+ * LOCKOUT_TIME: se registra una sola entrada (LOG_LOCKOUT) y los intentos siguientes se descartan sin validar.
+ * Los comandos a leds y buzzer pasan por una cola que los junta durante ACTUATOR_WINDOW y los escribe de una vez.
+ * \param [in] _doors: Puertas.
+ * \param [in] _id: Puerta a atender.
 */
-int periph( int driver, KeyEntry_t* valid_keys, ActivityEntry_t*log, int sem_list[3]);
+int periph(const Doors_t* _doors, int _id);
 
 #endif
\ No newline at end of file
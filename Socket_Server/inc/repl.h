@@ -0,0 +1,219 @@
+/*******************************************************************************************************************************//**
+ *
+ * @file		repl.h
+ * @brief		Replicación de claves y log hacia otra instancia (primaria / réplica).
+ * @date		19 oct. 2026
+ * @author		Martinez Agustin
+ *
+ **********************************************************************************************************************************/
+
+ /***********************************************************************************************************************************
+ *** MODULO
+ **********************************************************************************************************************************/
+#ifndef REPL_H
+#define REPL_H
+
+/***********************************************************************************************************************************
+ *** INCLUDES GLOBALES
+ **********************************************************************************************************************************/
+#include <sys/types.h>  // off_t
+#include <sys/file.h>   // flock()
+#include <sys/stat.h>   // fstat()
+#include <sys/socket.h> // socket(), connect()
+#include <sys/un.h>     // struct sockaddr_un
+#include <netinet/in.h> // struct sockaddr_in
+#include <netinet/tcp.h>// TCP_NODELAY
+#include <arpa/inet.h>  // inet_pton()
+#include <fcntl.h>      // open()
+#include <poll.h>       // poll()
+#include <unistd.h>     // pread(), write()
+#include <stdio.h>      // printf()
+#include <stdlib.h>     // malloc()
+#include <string.h>     // memcpy()
+#include <stdint.h>     // uint64_t
+#include <time.h>       // clock_gettime()
+#include <errno.h>      // errno
+
+#include "../inc/data.h"
+#include "../inc/door.h"
+#include "../inc/listener.h"
+#include "../inc/config.h"
+#include "../inc/snapshot.h"
+#include "../inc/stats.h"
+
+/***********************************************************************************************************************************
+ *** DEFINES GLOBALES
+ **********************************************************************************************************************************/
+#define REPL_MAGIC              0x4C504552U     /**< "REPL" */
+#define REPL_VERSION            1               /**< Cambia si cambia el protocolo o el formato del journal */
+#define REPL_BATCH_MAX          256             /**< Registros por mensaje */
+#define REPL_BATCH_MS           50              /**< Espera para juntar registros en un mismo mensaje */
+#define REPL_HEARTBEAT_MS       1000            /**< Mensaje vacío si no hubo cambios */
+#define REPL_TIMEOUT_MS         5000            /**< Sin noticias de la primaria: la réplica reconecta */
+#define REPL_RETRY_MS           1000            /**< Espera entre intentos de conexión */
+#define MAX_REPLICAS            4               /**< Réplicas conectadas a la vez */
+#define JOURNAL_MAX_RECORDS     100000          /**< Registros del journal antes de rotarlo (~4 MB) */
+
+/***********************************************************************************************************************************
+ *** TIPO DE DATOS GLOBALES
+ **********************************************************************************************************************************/
+/**
+ * \enum ReplType_t
+ * \brief Tipo de cambio registrado en el journal.
+ */
+typedef enum {
+    REPL_KEY_ADD = 1,   /**< AddKey(): clave y regla */
+    REPL_KEY_DEL,       /**< DeleteKey() o clave de un solo uso consumida */
+    REPL_KEY_CLEAR,     /**< Se vació la lista (lote con modo=reemplazar) */
+    REPL_KEY_EXPIRE,    /**< ExpireKeys() en el instante time_ns */
+    REPL_LOG            /**< Entrada nueva del log */
+} ReplType_t;
+
+/**
+ * \struct ReplRecord_t
+ * \brief Un cambio, tal como se guarda en el journal y viaja a la réplica.
+ * \details El número de secuencia no se guarda: es la posición en el journal más la base del encabezado.
+ * Aplicar dos veces el mismo registro no cambia el resultado.
+ */
+typedef struct {
+    int64_t time_ns;                /**< Instante del cambio (para REPL_LOG y REPL_KEY_EXPIRE) */
+    uint8_t type;                   /**< ReplType_t */
+    int8_t door;                    /**< Puerta, o DOOR_GLOBAL */
+    uint16_t code;                  /**< Clave */
+    uint16_t flags;                 /**< REPL_LOG: ActivityEntry_t.flags */
+    uint16_t reserved;              /**< Relleno explícito */
+    KeyRule_t rule;                 /**< REPL_KEY_ADD: regla de la clave */
+} ReplRecord_t;
+
+/**
+ * \struct JournalHeader_t
+ * \brief Primer registro del journal.
+ * \details epoch identifica al journal: si se borra y se crea otro, las réplicas no confunden sus secuencias.
+ * Al rotar se vacía el archivo y base pasa a ser la última secuencia escrita.
+ */
+typedef struct {
+    uint32_t magic;                 /**< REPL_MAGIC */
+    uint32_t version;               /**< REPL_VERSION */
+    uint64_t epoch;                 /**< Identificador del journal */
+    uint64_t base;                  /**< Secuencia anterior al primer registro del archivo */
+    uint8_t reserved[16];           /**< Mismo tamaño que un ReplRecord_t */
+} JournalHeader_t;
+
+_Static_assert(sizeof(JournalHeader_t) == sizeof(ReplRecord_t), "El encabezado del journal ocupa un registro");
+
+/**
+ * \struct ReplHello_t
+ * \brief Lo primero que envía la réplica: hasta dónde tiene aplicado.
+ */
+typedef struct {
+    uint32_t magic;                 /**< REPL_MAGIC */
+    uint32_t version;               /**< REPL_VERSION */
+    uint64_t epoch;                 /**< Journal del que viene last_seq. 0 si no tiene nada */
+    uint64_t last_seq;              /**< Último registro aplicado */
+} ReplHello_t;
+
+/**
+ * \enum ReplMsgType_t
+ * \brief Mensajes de la primaria a la réplica.
+ */
+typedef enum {
+    REPL_MSG_FULL_BEGIN = 1,        /**< Copia completa: la réplica vacía todo. seq: secuencia de la copia */
+    REPL_MSG_SHARD,                 /**< Claves de una lista (seq: 0 globales, i+1 puerta i). count SnapshotKey_t */
+    REPL_MSG_LOG,                   /**< Log de una puerta (seq: puerta). count ActivityEntry_t */
+    REPL_MSG_FULL_END,              /**< Fin de la copia completa */
+    REPL_MSG_BATCH                  /**< count ReplRecord_t desde seq. Vacío: solo latido */
+} ReplMsgType_t;
+
+/**
+ * \struct ReplMsg_t
+ * \brief Encabezado de cada mensaje de la primaria.
+ */
+typedef struct {
+    uint32_t type;                  /**< ReplMsgType_t */
+    uint32_t count;                 /**< Elementos que siguen */
+    uint64_t seq;                   /**< Según el tipo */
+    uint64_t epoch;                 /**< Journal de la primaria */
+} ReplMsg_t;
+
+/***********************************************************************************************************************************
+ *** IMPLANTACION DE LA CLASE
+ **********************************************************************************************************************************/
+/**
+ * \fn int JournalOpen(const char* _path)
+ * \brief Indica el journal de este proceso (lo heredan los hijos) y lo crea si no existe.
+ * \param [in] _path: Archivo (REPLICATION_JOURNAL). NULL o vacío para no registrar cambios.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+int JournalOpen(const char* _path);
+
+/**
+ * \fn int JournalAppend(const ReplRecord_t* _records, int _count)
+ * \brief Agrega cambios al journal.
+ * \details Cada proceso abre el archivo y toma flock() exclusivo mientras escribe, así clientes y lectores pueden
+ * registrar a la vez. Si el journal supera JOURNAL_MAX_RECORDS se rota antes de escribir.
+ * \param [in] _records: Cambios.
+ * \param [in] _count: Cantidad.
+ * \return Devuelve -1 si error. 0 sino (también si no hay journal).
+*/
+int JournalAppend(const ReplRecord_t* _records, int _count);
+
+/**
+ * \fn int JournalKey(ReplType_t _type, int _door, KeyEntry_t _key, const KeyRule_t* _rule, int64_t _time_ns)
+ * \brief Registra un cambio de una clave.
+ * \details Se llama con el semáforo de la lista tomado, en la misma sección crítica que el cambio: así el journal
+ * queda en el mismo orden que los cambios aunque escriban varios procesos.
+ * \param [in] _type: REPL_KEY_ADD, REPL_KEY_DEL, REPL_KEY_CLEAR o REPL_KEY_EXPIRE.
+ * \param [in] _door: Puerta o DOOR_GLOBAL.
+ * \param [in] _key: Clave.
+ * \param [in] _rule: Regla (REPL_KEY_ADD). NULL si no aplica.
+ * \param [in] _time_ns: Instante del cambio.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+int JournalKey(ReplType_t _type, int _door, KeyEntry_t _key, const KeyRule_t* _rule, int64_t _time_ns);
+
+/**
+ * \fn int JournalBulk(const KeyEntry_t* _keys, int _count, int _replace, const KeyRule_t* _rule, int _door)
+ * \brief Registra un lote de claves (POST /claves/bulk) con una sola escritura.
+ * \details Como JournalKey(), con el semáforo de la lista tomado.
+ * \param [in] _keys: Claves del lote.
+ * \param [in] _count: Cantidad.
+ * \param [in] _replace: El lote reemplazó a todas las claves.
+ * \param [in] _rule: Regla de todas las claves del lote.
+ * \param [in] _door: Puerta o DOOR_GLOBAL.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+int JournalBulk(const KeyEntry_t* _keys, int _count, int _replace, const KeyRule_t* _rule, int _door);
+
+/**
+ * \fn int JournalLog(int _door, const ActivityEntry_t* _activity)
+ * \brief Registra una entrada nueva del log.
+ * \param [in] _door: Puerta.
+ * \param [in] _activity: Entrada.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+int JournalLog(int _door, const ActivityEntry_t* _activity);
+
+/**
+ * \fn int ReplServe(int _sock, const Doors_t* _doors)
+ * \brief Atiende una réplica (proceso hijo) hasta que se desconecta.
+ * \details Si la réplica viene del mismo journal y sus registros siguen en disco, se le envía solo lo que le falta.
+ * Si no, una copia completa de claves y logs. Después se le envían los registros nuevos en lotes de hasta
+ * REPL_BATCH_MAX, revisando el journal cada REPL_BATCH_MS.
+ * \param [in] _sock: Conexión aceptada.
+ * \param [in] _doors: Puertas.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+int ReplServe(int _sock, const Doors_t* _doors);
+
+/**
+ * \fn int ReplFollow(const char* _primary, Doors_t* _doors)
+ * \brief Sigue a la primaria (proceso hijo de la réplica). No vuelve.
+ * \details Se conecta, aplica la copia completa o los registros que faltan y después cada lote. Si la conexión se cae
+ * o no llega nada en REPL_TIMEOUT_MS reconecta indicando el último registro aplicado.
+ * \param [in] _primary: Dirección de la primaria (REPLICA_OF): "IP:puerto", "[IPv6]:puerto" o "unix:/path".
+ * \param [in] _doors: Puertas.
+ * \return Devuelve -1 si la dirección es inválida.
+*/
+int ReplFollow(const char* _primary, Doors_t* _doors);
+
+#endif /* REPL_H */
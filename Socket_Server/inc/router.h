@@ -0,0 +1,147 @@
+/*******************************************************************************************************************************//**
+ *
+ * @file		router.h
+ * @brief		Tabla de rutas HTTP (método + path -> función) con hash perfecto.
+ * @date		19 oct. 2026
+ * @author		Martinez Agustin
+ *
+ **********************************************************************************************************************************/
+
+ /***********************************************************************************************************************************
+ *** MODULO
+ **********************************************************************************************************************************/
+#ifndef ROUTER_H
+#define ROUTER_H
+
+/***********************************************************************************************************************************
+ *** INCLUDES GLOBALES
+ **********************************************************************************************************************************/
+#include <stdio.h>      // snprintf()
+#include <string.h>     // memcmp(), strlen()
+#include <stdint.h>     // uint32_t, int8_t
+
+#include "../inc/conn.h"
+#include "../inc/door.h"
+
+/***********************************************************************************************************************************
+ *** DEFINES GLOBALES
+ **********************************************************************************************************************************/
+#define ROUTER_SLOTS        64          /**< Celdas del hash (potencia de 2, al menos el doble de rutas) */
+#define ROUTER_MAX_SEEDS    4096        /**< Semillas probadas hasta encontrar una sin colisiones */
+#define ROUTE_PARAM_LEN     64          /**< Largo máximo del valor de un parámetro de la query */
+
+/***********************************************************************************************************************************
+ *** TIPO DE DATOS GLOBALES
+ **********************************************************************************************************************************/
+/**
+ * \enum HttpMethod_t
+ * \brief Métodos atendidos.
+ */
+typedef enum {
+    HTTP_GET = 0,       /**< GET */
+    HTTP_POST,          /**< POST */
+    HTTP_METHODS        /**< Cantidad de métodos. También: método desconocido */
+} HttpMethod_t;
+
+/**
+ * \struct Request_t
+ * \brief Pedido ya ruteado, con todo lo que necesita la función de la ruta.
+ */
+typedef struct {
+    int client_id;              /**< Socket del cliente */
+    Connection_t* conn;         /**< Pedido completo */
+    Doors_t* doors;             /**< Puertas */
+    int door;                   /**< Puerta del prefijo /doors/<id>. DOOR_GLOBAL si no hay */
+    KeyShard_t* keys;           /**< Claves de door */
+    int sem_k;                  /**< Semáforo de keys */
+    HttpMethod_t method;        /**< Método */
+    const char* path;           /**< Path (sin query), dentro de conn->buff */
+    size_t path_len;            /**< Largo del path */
+    const char* query;          /**< Query sin '?'. NULL si no hay */
+    size_t query_len;           /**< Largo de la query */
+} Request_t;
+
+/**
+ * \brief Función de una ruta.
+ * \return Devuelve -1 si error. 0 sino.
+ */
+typedef int (*RouteHandler_t)(Request_t* _req);
+
+/**
+ * \struct Route_t
+ * \brief Una ruta: path exacto y la función de cada método (NULL si no se admite: 405).
+ */
+typedef struct {
+    const char* path;                       /**< Path exacto */
+    RouteHandler_t handler[HTTP_METHODS];   /**< Por método */
+} Route_t;
+
+/**
+ * \struct Router_t
+ * \brief Tabla de rutas con su hash perfecto.
+ * \details slot[hash(path) % ROUTER_SLOTS] es el índice de la única ruta que cae en esa celda (-1 si ninguna), así
+ * rutear es calcular un hash y comparar un solo path.
+ */
+typedef struct {
+    const Route_t* routes;          /**< Rutas */
+    int count;                      /**< Cantidad de rutas */
+    uint32_t seed;                  /**< Semilla sin colisiones */
+    int8_t slot[ROUTER_SLOTS];      /**< Ruta de cada celda */
+} Router_t;
+
+/***********************************************************************************************************************************
+ *** IMPLANTACION DE LA CLASE
+ **********************************************************************************************************************************/
+/**
+ * \fn int RouterBuild(Router_t* _router, const Route_t* _routes, int _count)
+ * \brief Busca una semilla con la que ningún par de rutas cae en la misma celda y arma la tabla.
+ * \details Se llama una vez en el proceso principal: hijos e hilos usan la tabla ya armada.
+ * \param [out] _router: Tabla.
+ * \param [in] _routes: Rutas (deben seguir existiendo).
+ * \param [in] _count: Cantidad de rutas (hasta ROUTER_SLOTS / 2).
+ * \return Devuelve -1 si hay paths repetidos o no se encontró semilla. 0 sino.
+*/
+int RouterBuild(Router_t* _router, const Route_t* _routes, int _count);
+
+/**
+ * \fn int RouterDispatch(const Router_t* _router, Request_t* _req)
+ * \brief Separa método, path y query de la línea de pedido y llama a la función de la ruta.
+ * \details Responde 400 si la línea de pedido es inválida, 404 si el path no existe y 405 (con Allow) si existe
+ * pero no para ese método.
+ * \param [in] _router: Tabla.
+ * \param [in] _req: Pedido con client_id, conn, doors, door, keys y sem_k cargados. Completa el resto.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+int RouterDispatch(const Router_t* _router, Request_t* _req);
+
+/**
+ * \fn int RouterParseMethod(const char* _line, HttpMethod_t* _method)
+ * \brief Método de una línea de pedido, sin rutearla.
+ * \param [in] _line: Línea de pedido.
+ * \param [out] _method: Método. HTTP_METHODS si es desconocido.
+ * \return Devuelve -1 si la línea no tiene método. 0 sino.
+*/
+int RouterParseMethod(const char* _line, HttpMethod_t* _method);
+
+/**
+ * \fn int RouteParam(const Request_t* _req, const char* _name, char* _value, size_t _size)
+ * \brief Valor de un parámetro de la query ("?clave=1234&estado=0"). No decodifica %XX.
+ * \param [in] _req: Pedido ruteado.
+ * \param [in] _name: Nombre del parámetro.
+ * \param [out] _value: Valor, terminado en '\0'.
+ * \param [in] _size: Tamaño de _value.
+ * \return Largo del valor. -1 si no está o no entra en _value.
+*/
+int RouteParam(const Request_t* _req, const char* _name, char* _value, size_t _size);
+
+/**
+ * \fn int RouteError(const Request_t* _req, const char* _status, const char* _body)
+ * \brief Responde un error desde una ruta, igual que los 404/405 del router.
+ * \param [in] _req: Pedido ruteado.
+ * \param [in] _status: Estado ("400 Bad Request").
+ * \param [in] _body: Cuerpo JSON.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+int RouteError(const Request_t* _req, const char* _status, const char* _body);
+
+#endif /* ROUTER_H */
@@ -0,0 +1,112 @@
+/*******************************************************************************************************************************//**
+ *
+ * @file		shm.h
+ * @brief		Formato de la memoria compartida: claves, logs, estadísticas y bloqueos en un solo segmento versionado.
+ * @date		19 oct. 2026
+ * @author		Martinez Agustin
+ *
+ **********************************************************************************************************************************/
+
+ /***********************************************************************************************************************************
+ *** MODULO
+ **********************************************************************************************************************************/
+#ifndef SHM_H
+#define SHM_H
+
+/***********************************************************************************************************************************
+ *** INCLUDES GLOBALES
+ **********************************************************************************************************************************/
+#include <stddef.h>     // offsetof()
+#include <stdint.h>     // uint32_t, uint64_t
+
+#include "../inc/data.h"
+#include "../inc/door.h"
+#include "../inc/stats.h"
+#include "../inc/lockout.h"
+#include "../inc/actuator.h"
+#include "../inc/bufpool.h"
+#include "../inc/children.h"
+#include "../inc/tls.h"
+
+/***********************************************************************************************************************************
+ *** DEFINES GLOBALES
+ **********************************************************************************************************************************/
+#define SHM_MAGIC           0x4D48534CU /**< "LSHM": comienzo de ShmLayout_t */
+#define SHM_VERSION         5           /**< Versión de ShmLayout_t. Cambia si cambia cualquier estructura de la memoria compartida */
+
+/***********************************************************************************************************************************
+ *** TIPO DE DATOS GLOBALES
+ **********************************************************************************************************************************/
+/**
+ * \brief Regiones del segmento descriptas en el encabezado, además de las claves y las puertas.
+ */
+typedef enum {
+    SHM_STATS = 0,                      /**< StatsTable_t: anillos de /stats */
+    SHM_LOCKOUT,                        /**< LockoutTable_t: orígenes web bloqueados */
+    SHM_ACTUATOR,                       /**< ActuatorStats_t: colas de leds y buzzer */
+    SHM_BUFPOOL,                        /**< BufPoolStats_t: pool de buffers */
+    SHM_CHILDREN,                       /**< ChildStats_t: procesos hijo */
+    SHM_TLS,                            /**< TlsStats_t: handshakes */
+    SHM_REGIONS                         /**< Cantidad de regiones */
+} ShmRegionId_t;
+
+/**
+ * \struct ShmRegion_t
+ * \brief Dónde empieza y cuánto ocupa una región del segmento.
+ */
+typedef struct {
+    uint32_t offset;                    /**< Desde el comienzo del segmento. Múltiplo de CACHE_LINE */
+    uint32_t size;                      /**< sizeof() de la región */
+} ShmRegion_t;
+
+/**
+ * \struct ShmHeader_t
+ * \brief Encabezado de la memoria compartida: quién la lee (otro binario, una herramienta) puede validar el formato.
+ * \details Se escribe una sola vez al crearla. Los offsets y tamaños son los del binario que la creó.
+ */
+typedef struct {
+    _Alignas(CACHE_LINE) uint32_t magic;    /**< SHM_MAGIC */
+    uint32_t version;                       /**< SHM_VERSION */
+    uint32_t doors;                         /**< Cantidad de puertas */
+    uint32_t max_log;                       /**< Entradas del log por puerta (MAX_LOG) */
+    uint64_t size;                          /**< Tamaño total del segmento */
+    uint32_t cache_line;                    /**< CACHE_LINE con que se alineó */
+    uint32_t shard_size;                    /**< sizeof(KeyShard_t) */
+    uint32_t door_size;                     /**< sizeof(DoorShm_t) */
+    uint32_t global_offset;                 /**< Offset de las claves globales */
+    uint32_t doors_offset;                  /**< Offset de la primera DoorShm_t */
+    ShmRegion_t region[SHM_REGIONS];        /**< Estadísticas y bloqueos (ShmRegionId_t) */
+} ShmHeader_t;
+
+/**
+ * \struct DoorShm_t
+ * \brief La parte de una puerta en la memoria compartida.
+ * \details Empieza en su propia línea de caché, igual que su log, su índice y su bloqueo: el lector de una puerta
+ * nunca escribe una línea que lea o escriba el lector de otra.
+ */
+typedef struct {
+    KeyShard_t keys;                                        /**< Claves válidas solo en esta puerta */
+    _Alignas(CACHE_LINE) ActivityEntry_t log[MAX_LOG];      /**< Log */
+    LogIndex_t index;                                       /**< Índice del log */
+    _Alignas(CACHE_LINE) Lockout_t lockout;                 /**< Bloqueo por intentos fallidos (solo lo escribe el lector) */
+} DoorShm_t;
+
+/**
+ * \struct ShmLayout
+ * \brief Toda la memoria compartida en un solo segmento (ShmLayout_t, declarado en door.h).
+ * \details Cada región empieza en su propia línea de caché: los contadores que escriben los clientes (pool de
+ * buffers, TLS) no comparten línea con los que escribe el proceso principal (hijos) ni con los de los lectores.
+ */
+struct ShmLayout {
+    ShmHeader_t header;                                 /**< Formato */
+    KeyShard_t global_keys;                             /**< Claves válidas en todas las puertas */
+    _Alignas(CACHE_LINE) StatsTable_t stats;            /**< /stats (las escriben los lectores) */
+    _Alignas(CACHE_LINE) LockoutTable_t lockout;        /**< Orígenes web (los escriben los clientes) */
+    _Alignas(CACHE_LINE) ActuatorStats_t actuator;      /**< Colas de actuadores (una línea por puerta) */
+    _Alignas(CACHE_LINE) BufPoolStats_t bufpool;        /**< Pool de buffers (los escriben los clientes) */
+    _Alignas(CACHE_LINE) ChildStats_t children;         /**< Hijos (los escribe el proceso principal) */
+    _Alignas(CACHE_LINE) TlsStats_t tls;                /**< Handshakes (los escriben los clientes) */
+    DoorShm_t door[];                                   /**< Puertas (header.doors) */
+};
+
+#endif /* SHM_H */
@@ -0,0 +1,131 @@
+/*******************************************************************************************************************************//**
+ *
+ * @file		snapshot.h
+ * @brief		Copia de las claves a disco y recuperación al arrancar.
+ * @date		19 oct. 2026
+ * @author		Martinez Agustin
+ *
+ **********************************************************************************************************************************/
+
+ /***********************************************************************************************************************************
+ *** MODULO
+ **********************************************************************************************************************************/
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+/***********************************************************************************************************************************
+ *** INCLUDES GLOBALES
+ **********************************************************************************************************************************/
+#include <sys/mman.h>   // mmap()
+#include <sys/stat.h>   // fstat()
+#include <sys/uio.h>    // writev()
+#include <fcntl.h>      // open()
+#include <unistd.h>     // close(), fsync()
+#include <stdio.h>      // printf(), rename()
+#include <stdlib.h>     // malloc(), free()
+#include <string.h>     // memcpy()
+#include <stdint.h>     // uint32_t
+#include <errno.h>      // errno
+
+#include "../inc/data.h"
+#include "../inc/door.h"
+#include "../inc/config.h"
+
+/***********************************************************************************************************************************
+ *** DEFINES GLOBALES
+ **********************************************************************************************************************************/
+#define SNAPSHOT_MAGIC      0x50414E53          /**< "SNAP" */
+#define SNAPSHOT_VERSION    1                   /**< Cambia si cambia el formato del archivo */
+#define SNAPSHOT_SHARDS     (MAX_DOORS + 1)     /**< Claves globales más una parte por puerta */
+
+/***********************************************************************************************************************************
+ *** TIPO DE DATOS GLOBALES
+ **********************************************************************************************************************************/
+/**
+ * \struct SnapshotHeader_t
+ * \brief Encabezado del archivo. Le siguen shards SnapshotShard_t y después las claves de cada uno, en orden.
+ */
+typedef struct {
+    uint32_t magic;                     /**< SNAPSHOT_MAGIC */
+    uint32_t version;                   /**< SNAPSHOT_VERSION */
+    int64_t created_ns;                 /**< Instante de la copia */
+    uint32_t shards;                    /**< Cantidad de SnapshotShard_t */
+    uint32_t checksum;                  /**< FNV-1a de todo lo que sigue al encabezado */
+} SnapshotHeader_t;
+
+/**
+ * \struct SnapshotShard_t
+ * \brief Un conjunto de claves en el archivo.
+ * \details Se identifica por el dispositivo y no por la posición, así reordenar las líneas DEVICE no mezcla claves.
+ */
+typedef struct {
+    char device[DOOR_DEVICE_LEN];       /**< Dispositivo de la puerta. Vacío para las claves globales */
+    uint32_t count;                     /**< Claves de este conjunto */
+    uint32_t reserved;                  /**< Relleno explícito */
+} SnapshotShard_t;
+
+/**
+ * \struct SnapshotKey_t
+ * \brief Una clave en el archivo, con su regla.
+ */
+typedef struct {
+    KeyRule_t rule;                     /**< Validez */
+    uint16_t code;                      /**< Clave */
+    uint16_t reserved[3];               /**< Relleno explícito */
+} SnapshotKey_t;
+
+/**
+ * \struct Snapshot_t
+ * \brief Estado de las copias del servidor.
+ * \details keys es el segundo buffer: cada conjunto se copia ahí con su semáforo tomado (una copia en memoria) y
+ * el archivo se escribe después, sin bloquear a quien agrega o valida claves.
+ */
+typedef struct {
+    char path[CONFIG_VALUE_LEN];        /**< Archivo. Vacío si está deshabilitado */
+    uint32_t version[SNAPSHOT_SHARDS];  /**< KeyShard_t.version de la última copia escrita */
+    int written;                        /**< Ya hay una copia escrita o cargada con esas versiones */
+    SnapshotShard_t table[SNAPSHOT_SHARDS]; /**< Tabla de la copia en curso */
+    SnapshotKey_t* keys;                /**< Claves de la copia en curso */
+} Snapshot_t;
+
+/***********************************************************************************************************************************
+ *** IMPLANTACION DE LA CLASE
+ **********************************************************************************************************************************/
+/**
+ * \fn int SnapshotInit(Snapshot_t* _snap, const char* _path)
+ * \brief Prepara las copias.
+ * \param [out] _snap: Estado a inicializar.
+ * \param [in] _path: Archivo (SNAPSHOT_FILE). NULL o vacío para deshabilitar.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+int SnapshotInit(Snapshot_t* _snap, const char* _path);
+
+/**
+ * \fn void SnapshotFree(Snapshot_t* _snap)
+ * \brief Libera el buffer de copia.
+ * \param [in] _snap: Estado.
+*/
+void SnapshotFree(Snapshot_t* _snap);
+
+/**
+ * \fn int SnapshotLoad(Snapshot_t* _snap, Doors_t* _doors)
+ * \brief Carga la última copia en la memoria compartida recién creada.
+ * \details Se llama antes de lanzar los lectores, así que no toma semáforos. El archivo se lee con mmap() y se valida
+ * completo (tamaños y checksum) antes de copiar nada. Las claves ya vencidas y las de dispositivos que ya no están se descartan.
+ * \param [in] _snap: Estado.
+ * \param [in] _doors: Puertas con la memoria compartida vacía.
+ * \return Cantidad de claves recuperadas. 0 si no hay copia. -1 si el archivo es inválido.
+*/
+int SnapshotLoad(Snapshot_t* _snap, Doors_t* _doors);
+
+/**
+ * \fn int SnapshotSave(Snapshot_t* _snap, const Doors_t* _doors)
+ * \brief Escribe una copia de todas las claves si alguna cambió desde la anterior.
+ * \details Se escribe a un archivo temporal y se renombra: una copia a medio escribir nunca reemplaza a la anterior.
+ * \param [in] _snap: Estado.
+ * \param [in] _doors: Puertas.
+ * \return 1 si se escribió. 0 si no hubo cambios o está deshabilitado. -1 si error.
+*/
+int SnapshotSave(Snapshot_t* _snap, const Doors_t* _doors);
+
+#endif /* SNAPSHOT_H */
@@ -0,0 +1,166 @@
+/*******************************************************************************************************************************//**
+ *
+ * @file		stats.h
+ * @brief		Estadísticas de accesos por hora, por día y por clave, llevadas al agregar cada entrada del log.
+ * @date		19 oct. 2026
+ * @author		Martinez Agustin
+ *
+ **********************************************************************************************************************************/
+
+ /***********************************************************************************************************************************
+ *** MODULO
+ **********************************************************************************************************************************/
+#ifndef STATS_H
+#define STATS_H
+
+/***********************************************************************************************************************************
+ *** INCLUDES GLOBALES
+ **********************************************************************************************************************************/
+#include <sched.h>      // sched_yield()
+#include <string.h>     // memset()
+#include <stdint.h>     // uint16_t, uint32_t, int64_t
+#include <time.h>       // localtime_r()
+
+#include "../inc/data.h"
+#include "../inc/door.h"
+
+/***********************************************************************************************************************************
+ *** DEFINES GLOBALES
+ **********************************************************************************************************************************/
+#define STATS_HOURS_MAX     168         /**< Horas recordadas (una semana). Máximo de STATS_HOURS */
+#define STATS_DAYS_MAX      31          /**< Días recordados. Máximo de STATS_DAYS */
+#define STATS_KEY_WORDS     ((KEY_SPACE + 63) / 64)     /**< Palabras del mapa de claves usadas en un día */
+
+/***********************************************************************************************************************************
+ *** TIPO DE DATOS GLOBALES
+ **********************************************************************************************************************************/
+/**
+ * \struct StatsCount_t
+ * \brief Intentos aceptados y rechazados (incluye los que bloquearon la puerta).
+ */
+typedef struct {
+    uint32_t accepted;                  /**< Aceptados */
+    uint32_t denied;                    /**< Rechazados */
+} StatsCount_t;
+
+/**
+ * \struct StatsBucket_t
+ * \brief Una hora o un día de la respuesta.
+ */
+typedef struct {
+    int64_t start_ns;                   /**< Comienzo (hora local) */
+    StatsCount_t count;                 /**< Intentos */
+} StatsBucket_t;
+
+/**
+ * \struct StatsKey_t
+ * \brief Intentos de una clave dentro de la ventana de días.
+ */
+typedef struct {
+    uint16_t code;                      /**< Clave */
+    StatsCount_t count;                 /**< Intentos */
+} StatsKey_t;
+
+/**
+ * \struct StatsTable_t
+ * \brief Anillos de horas y de días, en la memoria compartida por el servidor, sus hijos y los lectores.
+ * \details Cada posición guarda qué hora o qué día cuenta (stamp, en hora local desde epoch): al llegar una entrada
+ * de una hora nueva se limpia la posición más vieja y se reusa. Las claves se cuentan por día y en conjunto para
+ * todas las puertas, con un mapa de las usadas para no recorrer KEY_SPACE al responder. Quien no puede tomar el
+ * lock (alarmctl, enganchado en solo lectura) copia con StatsRead(), que reintenta si seq cambió.
+ */
+typedef struct {
+    uint8_t lock;                                               /**< Spinlock (las secciones críticas son cortas) */
+    uint32_t seq;                                               /**< Impar mientras StatsAdd() cambia algo: se lee sin el lock */
+    int64_t hour_stamp[STATS_HOURS_MAX];                        /**< Hora de cada posición. 0: libre */
+    StatsCount_t hour[STATS_HOURS_MAX][MAX_DOORS];              /**< Intentos por hora y puerta */
+    int64_t day_stamp[STATS_DAYS_MAX];                          /**< Día de cada posición. 0: libre */
+    StatsCount_t day[STATS_DAYS_MAX][MAX_DOORS];                /**< Intentos por día y puerta */
+    uint64_t key_used[STATS_DAYS_MAX][STATS_KEY_WORDS];         /**< Claves con intentos en el día */
+    uint16_t key[STATS_DAYS_MAX][KEY_SPACE][2];                 /**< Aceptados y rechazados por día y clave (saturan) */
+} StatsTable_t;
+
+/**
+ * \struct StatsCursor_t
+ * \brief Recorrido de las claves con StatsKeys(), de a tandas.
+ */
+typedef struct {
+    int days;                           /**< Ventana en días */
+    int word;                           /**< Próxima palabra del mapa de claves */
+} StatsCursor_t;
+
+/***********************************************************************************************************************************
+ *** IMPLANTACION DE LA CLASE
+ **********************************************************************************************************************************/
+/**
+ * \fn void StatsSetup(StatsTable_t* _table, int _hours, int _days)
+ * \brief Fija las ventanas por defecto y la tabla. Se llama una vez antes de lanzar los lectores.
+ * \param [in] _table: Tabla en la memoria compartida (ShmLayout_t). NULL: sin estadísticas (/stats responde 503).
+ * \param [in] _hours: Horas que devuelve /stats si no se piden otras (STATS_HOURS).
+ * \param [in] _days: Días que devuelve /stats si no se piden otros (STATS_DAYS).
+*/
+void StatsSetup(StatsTable_t* _table, int _hours, int _days);
+
+/**
+ * \fn void StatsAdd(int _door, const ActivityEntry_t* _entry)
+ * \brief Cuenta una entrada del log en su hora, su día y su clave.
+ * \details Una entrada más vieja que lo que recuerdan los anillos no se cuenta.
+ * \param [in] _door: Puerta.
+ * \param [in] _entry: Entrada.
+*/
+void StatsAdd(int _door, const ActivityEntry_t* _entry);
+
+/**
+ * \fn int StatsWindow(int* _hours, int* _days)
+ * \brief Completa las ventanas no indicadas con las de config.ini y valida las indicadas.
+ * \param [in] _hours: Horas (0: STATS_HOURS). Queda el valor a usar.
+ * \param [in] _days: Días (0: STATS_DAYS). Queda el valor a usar.
+ * \return Devuelve -1 si alguna está fuera de rango. -2 si no hay estadísticas. 0 sino.
+*/
+int StatsWindow(int* _hours, int* _days);
+
+/**
+ * \fn int StatsHours(int _door, int _hours, StatsBucket_t* _out)
+ * \brief Intentos de las últimas _hours horas, de la más vieja a la actual (las horas sin intentos van en 0).
+ * \param [in] _door: Puerta o DOOR_GLOBAL (suma de todas).
+ * \param [in] _hours: Ventana (validada con StatsWindow()).
+ * \param [out] _out: _hours posiciones.
+ * \return Cantidad de horas.
+*/
+int StatsHours(int _door, int _hours, StatsBucket_t* _out);
+
+/**
+ * \fn int StatsDays(int _door, int _days, StatsBucket_t* _out)
+ * \brief Intentos de los últimos _days días, del más viejo a hoy.
+ * \param [in] _door: Puerta o DOOR_GLOBAL (suma de todas).
+ * \param [in] _days: Ventana (validada con StatsWindow()).
+ * \param [out] _out: _days posiciones.
+ * \return Cantidad de días.
+*/
+int StatsDays(int _door, int _days, StatsBucket_t* _out);
+
+/**
+ * \fn int StatsRead(const StatsTable_t* _table, int _door, int _hours, int _days, StatsBucket_t* _hours_out, StatsBucket_t* _days_out)
+ * \brief Lo mismo que StatsHours() y StatsDays() pero sin tomar el lock, para leer la tabla de otro proceso.
+ * \details Copia entre dos lecturas de seq y reintenta si cambió o si había un cambio a medias.
+ * \param [in] _table: Tabla (puede estar enganchada en solo lectura).
+ * \param [in] _door: Puerta o DOOR_GLOBAL (suma de todas).
+ * \param [in] _hours: Horas (1..STATS_HOURS_MAX).
+ * \param [in] _days: Días (1..STATS_DAYS_MAX).
+ * \param [out] _hours_out: _hours posiciones, de la más vieja a la actual.
+ * \param [out] _days_out: _days posiciones, del más viejo a hoy.
+ * \return Devuelve -1 si no se consiguió una copia entera en SEQ_RETRIES intentos. 0 sino.
+*/
+int StatsRead(const StatsTable_t* _table, int _door, int _hours, int _days, StatsBucket_t* _hours_out, StatsBucket_t* _days_out);
+
+/**
+ * \fn int StatsKeys(StatsCursor_t* _cursor, StatsKey_t* _out, int _max)
+ * \brief Intentos por clave en los últimos _cursor->days días, de a tandas y solo las claves usadas.
+ * \param [in] _cursor: Recorrido (word en 0 para empezar). Se actualiza para la próxima tanda.
+ * \param [out] _out: Claves.
+ * \param [in] _max: Tamaño de _out (al menos 64).
+ * \return Cantidad de claves copiadas. 0 si terminó.
+*/
+int StatsKeys(StatsCursor_t* _cursor, StatsKey_t* _out, int _max);
+
+#endif /* STATS_H */
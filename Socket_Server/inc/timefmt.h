@@ -0,0 +1,65 @@
+/*******************************************************************************************************************************//**
+ *
+ * @file		timefmt.h
+ * @brief		Reloj y formateo de fecha/hora con caché, compartido por el log y las respuestas JSON.
+ * @date		19 oct. 2026
+ * @author		Martinez Agustin
+ *
+ **********************************************************************************************************************************/
+
+ /***********************************************************************************************************************************
+ *** MODULO
+ **********************************************************************************************************************************/
+#ifndef TIMEFMT_H
+#define TIMEFMT_H
+
+/***********************************************************************************************************************************
+ *** INCLUDES GLOBALES
+ **********************************************************************************************************************************/
+#include <stdint.h>     // int64_t
+#include <time.h>       // clock_gettime(), localtime_r(), strftime()
+
+/***********************************************************************************************************************************
+ *** DEFINES GLOBALES
+ **********************************************************************************************************************************/
+#define TIME_DATE_LEN   11  /**< "YYYY/MM/DD\0" */
+#define TIME_HOUR_LEN   9   /**< "HH:MM:SS\0" */
+
+/***********************************************************************************************************************************
+ *** TIPO DE DATOS GLOBALES
+ **********************************************************************************************************************************/
+/**
+ * \struct TimeCache_t
+ * \brief Último instante formateado.
+ * \details Hay una sola por hilo (TimeFormat() la usa para todos los llamados): el log de la puerta, /log, /stats y
+ * la página inicial comparten la misma. Dentro del mismo segundo no se hace nada; al cambiar de segundo solo se
+ * reescriben los dos dígitos de los segundos, y localtime_r() (zona horaria) y strftime() se llaman solo al cambiar
+ * de minuto.
+ */
+typedef struct {
+    time_t second;                  /**< Segundo epoch formateado. -1 si vacío */
+    time_t minute_start;            /**< Segundo epoch en que empieza el minuto cacheado */
+    char date[TIME_DATE_LEN];       /**< Fecha del minuto cacheado */
+    char hour[TIME_HOUR_LEN];       /**< Hora del último instante formateado */
+} TimeCache_t;
+
+/***********************************************************************************************************************************
+ *** IMPLANTACION DE LA CLASE
+ **********************************************************************************************************************************/
+/**
+ * \fn int64_t TimeNowNs(void)
+ * \brief Instante actual en ns desde epoch.
+ * \details clock_gettime(CLOCK_REALTIME) se resuelve en el vDSO, sin syscall.
+ * \return Nanosegundos desde epoch.
+*/
+int64_t TimeNowNs(void);
+
+/**
+ * \fn const TimeCache_t* TimeFormat(int64_t _time_ns)
+ * \brief Formatea un instante en hora local con la caché del hilo.
+ * \param [in] _time_ns: Instante en ns desde epoch.
+ * \return Caché con date y hour correspondientes a _time_ns. Vale hasta el próximo TimeFormat() del mismo hilo.
+*/
+const TimeCache_t* TimeFormat(int64_t _time_ns);
+
+#endif /* TIMEFMT_H */
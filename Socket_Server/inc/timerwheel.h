@@ -0,0 +1,108 @@
+/*******************************************************************************************************************************//**
+ *
+ * @file		timerwheel.h
+ * @brief		Rueda de timers jerárquica para vencimientos de claves (resolución de 1 segundo).
+ * @date		19 oct. 2026
+ * @author		Martinez Agustin
+ *
+ **********************************************************************************************************************************/
+
+ /***********************************************************************************************************************************
+ *** MODULO
+ **********************************************************************************************************************************/
+#ifndef TIMERWHEEL_H
+#define TIMERWHEEL_H
+
+/***********************************************************************************************************************************
+ *** INCLUDES GLOBALES
+ **********************************************************************************************************************************/
+#include <stdint.h>     // int64_t, uint16_t
+#include <stdlib.h>     // malloc(), free()
+
+/***********************************************************************************************************************************
+ *** DEFINES GLOBALES
+ **********************************************************************************************************************************/
+#define WHEEL_BITS      6                       /**< 64 posiciones por nivel */
+#define WHEEL_SLOTS     (1 << WHEEL_BITS)
+#define WHEEL_MASK      (WHEEL_SLOTS - 1)
+#define WHEEL_LEVELS    4                       /**< 64^4 s ~ 194 días. Más lejos se reubica al llegar */
+
+/***********************************************************************************************************************************
+ *** TIPO DE DATOS GLOBALES
+ **********************************************************************************************************************************/
+/**
+ * \struct WheelTimer_t
+ * \brief Un vencimiento programado.
+ */
+typedef struct {
+    int64_t expire;     /**< Segundo epoch en que vence */
+    uint16_t code;      /**< Clave */
+    uint16_t tag;       /**< Dato libre del usuario (a qué lista pertenece la clave) */
+    int next;           /**< Siguiente en la misma posición, o en la lista libre. -1 si no hay */
+} WheelTimer_t;
+
+/**
+ * \struct TimerWheel_t
+ * \brief Rueda jerárquica: el nivel L tiene posiciones de 64^L segundos.
+ * \details Agregar es O(1). Al avanzar, cada timer se reubica como mucho una vez por nivel (cuando el nivel
+ * inferior da la vuelta), así que el costo amortizado por timer es O(1) y no se recorre la tabla de claves.
+ */
+typedef struct {
+    int64_t now;                                /**< Último segundo procesado */
+    int slots[WHEEL_LEVELS][WHEEL_SLOTS];       /**< Primer timer de cada posición. -1 si vacía */
+    WheelTimer_t* pool;                         /**< Timers */
+    int capacity;                               /**< Tamaño de pool */
+    int free_head;                              /**< Primer timer libre */
+    int count;                                  /**< Timers programados */
+} TimerWheel_t;
+
+/**
+ * \typedef WheelFire_t
+ * \brief Función que se llama por cada timer vencido.
+ */
+typedef void (*WheelFire_t)(void* _ctx, uint16_t _code, uint16_t _tag);
+
+/***********************************************************************************************************************************
+ *** IMPLANTACION DE LA CLASE
+ **********************************************************************************************************************************/
+/**
+ * \fn int WheelInit(TimerWheel_t* _wheel, int _capacity, int64_t _now)
+ * \brief Inicializa una rueda vacía.
+ * \param [out] _wheel: Rueda.
+ * \param [in] _capacity: Cantidad máxima de timers simultáneos.
+ * \param [in] _now: Segundo epoch actual.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+int WheelInit(TimerWheel_t* _wheel, int _capacity, int64_t _now);
+
+/**
+ * \fn void WheelFree(TimerWheel_t* _wheel)
+ * \brief Libera la rueda.
+ * \param [in] _wheel: Rueda.
+*/
+void WheelFree(TimerWheel_t* _wheel);
+
+/**
+ * \fn int WheelAdd(TimerWheel_t* _wheel, int64_t _expire, uint16_t _code, uint16_t _tag)
+ * \brief Programa un vencimiento.
+ * \details Un vencimiento ya pasado se dispara en el próximo WheelAdvance().
+ * \param [in] _wheel: Rueda.
+ * \param [in] _expire: Segundo epoch en que vence.
+ * \param [in] _code: Clave.
+ * \param [in] _tag: Dato libre.
+ * \return Devuelve -1 si no hay lugar. 0 sino.
+*/
+int WheelAdd(TimerWheel_t* _wheel, int64_t _expire, uint16_t _code, uint16_t _tag);
+
+/**
+ * \fn int WheelAdvance(TimerWheel_t* _wheel, int64_t _now, WheelFire_t _fire, void* _ctx)
+ * \brief Avanza hasta _now disparando los timers vencidos.
+ * \param [in] _wheel: Rueda.
+ * \param [in] _now: Segundo epoch actual.
+ * \param [in] _fire: Función a llamar por cada timer vencido.
+ * \param [in] _ctx: Dato para _fire.
+ * \return Cantidad de timers disparados.
+*/
+int WheelAdvance(TimerWheel_t* _wheel, int64_t _now, WheelFire_t _fire, void* _ctx);
+
+#endif /* TIMERWHEEL_H */
@@ -0,0 +1,138 @@
+/*******************************************************************************************************************************//**
+ *
+ * @file		tls.h
+ * @brief		HTTPS: handshake con OpenSSL en espacio de usuario y cifrado de los registros en el kernel (kTLS).
+ * @date		19 oct. 2026
+ * @author		Martinez Agustin
+ *
+ **********************************************************************************************************************************/
+
+ /***********************************************************************************************************************************
+ *** MODULO
+ **********************************************************************************************************************************/
+#ifndef TLS_H
+#define TLS_H
+
+/***********************************************************************************************************************************
+ *** INCLUDES GLOBALES
+ **********************************************************************************************************************************/
+#include <openssl/ssl.h>    // SSL_CTX_new(), SSL_accept(), BIO_get_ktls_send()
+#include <openssl/err.h>    // ERR_get_error()
+#include <sys/socket.h>     // send(), recv(), setsockopt()
+#include <sys/time.h>       // struct timeval
+#include <fcntl.h>          // fcntl(), O_NONBLOCK
+#include <poll.h>           // poll()
+#include <time.h>           // clock_gettime(), struct timespec
+#include <signal.h>         // signal()
+#include <stdio.h>          // printf(), snprintf()
+#include <stdint.h>         // uint64_t
+#include <string.h>         // strstr()
+#include <errno.h>          // errno
+
+/***********************************************************************************************************************************
+ *** DEFINES GLOBALES
+ **********************************************************************************************************************************/
+#define TLS_ULP_FILE    "/proc/sys/net/ipv4/tcp_available_ulp"  /**< ULPs de TCP cargados. kTLS necesita "tls" */
+#define TLS_SID_CTX     "alarm"                                  /**< Contexto de las sesiones (solo se reanudan acá) */
+
+/***********************************************************************************************************************************
+ *** TIPO DE DATOS GLOBALES
+ **********************************************************************************************************************************/
+/**
+ * \struct TlsStats_t
+ * \brief Handshakes y conexiones con kTLS, en la memoria compartida para que las lea /metrics desde cualquier hijo.
+ */
+typedef struct {
+    uint64_t full;                  /**< Handshakes completos */
+    uint64_t resumed;               /**< Handshakes reanudados (ticket o caché de sesiones) */
+    uint64_t failed;                /**< Handshakes fallidos */
+    uint64_t ktls_tx;               /**< Conexiones con el envío cifrado por el kernel */
+    uint64_t ktls_rx;               /**< Conexiones con la recepción descifrada por el kernel */
+} TlsStats_t;
+
+/***********************************************************************************************************************************
+ *** IMPLANTACION DE LA CLASE
+ **********************************************************************************************************************************/
+/**
+ * \fn int TlsSetup(TlsStats_t* _stats, const char* _cert, const char* _key, int _tickets, int _session_ms)
+ * \brief Crea el contexto TLS con el certificado. Se llama una vez antes de aceptar clientes.
+ * \details Las claves de los tickets se generan acá: los hijos y los hilos las heredan y reanudan las sesiones de
+ * los demás. La caché de sesiones del servidor solo sirve entre hilos (WORKERS), porque cada hijo tiene la suya.
+ * \param [in] _stats: Estadísticas en la memoria compartida (ShmLayout_t). NULL: sin estadísticas.
+ * \param [in] _cert: Certificado PEM (TLS_CERT). Puede incluir la cadena.
+ * \param [in] _key: Clave privada PEM (TLS_KEY).
+ * \param [in] _tickets: Tickets por handshake (TLS_TICKETS). 0: tickets con estado, que solo reanudan entre hilos.
+ * \param [in] _session_ms: Duración de una sesión reanudable (TLS_SESSION_TIME).
+ * \return Devuelve -1 si error. 0 sino.
+*/
+int TlsSetup(TlsStats_t* _stats, const char* _cert, const char* _key, int _tickets, int _session_ms);
+
+/**
+ * \fn SSL* TlsAccept(int _fd, int _timeout_ms, const struct timespec* _deadline)
+ * \brief Hace el handshake con el cliente y pasa el cifrado de los registros al kernel si se puede.
+ * \details Con kTLS en el envío el resto del servidor sigue escribiendo en el socket con send()/sendmsg(): el
+ * kernel arma los registros. Sin kTLS TlsSend() y TlsRecv() pasan por OpenSSL. La conexión queda como la del hilo
+ * (o del hijo) hasta TlsClose().
+ * El handshake se hace con el socket no bloqueante y poll(): termina antes de _deadline (el del pedido, REQUEST_TIMEOUT)
+ * aunque el cliente mande de a un byte, y corta si pasan _timeout_ms sin que avance.
+ * \param [in] _fd: Socket aceptado.
+ * \param [in] _timeout_ms: Timeout de cada lectura (READ_TIMEOUT).
+ * \param [in] _deadline: Instante límite del pedido (CLOCK_MONOTONIC), que incluye el handshake.
+ * \return La conexión TLS. NULL si no hay contexto o falló el handshake.
+*/
+SSL* TlsAccept(int _fd, int _timeout_ms, const struct timespec* _deadline);
+
+/**
+ * \fn ssize_t TlsSend(int _fd, const void* _buff, size_t _len, int _flags)
+ * \brief send() que cifra con OpenSSL si _fd es la conexión TLS del hilo y el kernel no cifra.
+ * \param [in] _fd: Socket.
+ * \param [in] _buff: Datos.
+ * \param [in] _len: Cantidad de bytes.
+ * \param [in] _flags: Flags de send() (se ignoran al cifrar con OpenSSL).
+ * \return Bytes enviados. -1 si error (EAGAIN si se venció SO_SNDTIMEO).
+*/
+ssize_t TlsSend(int _fd, const void* _buff, size_t _len, int _flags);
+
+/**
+ * \fn ssize_t TlsRecv(int _fd, void* _buff, size_t _len)
+ * \brief recv() que descifra con OpenSSL si _fd es la conexión TLS del hilo y el kernel no descifra.
+ * \param [in] _fd: Socket.
+ * \param [out] _buff: Destino.
+ * \param [in] _len: Tamaño de _buff.
+ * \return Bytes recibidos. 0 si el cliente cerró. -1 si error (EAGAIN si todavía no hay un registro completo).
+*/
+ssize_t TlsRecv(int _fd, void* _buff, size_t _len);
+
+/**
+ * \fn int TlsPending(int _fd)
+ * \brief Indica si OpenSSL ya tiene datos descifrados de _fd (poll() no los ve).
+ * \param [in] _fd: Socket.
+ * \return Distinto de 0 si hay datos para TlsRecv().
+*/
+int TlsPending(int _fd);
+
+/**
+ * \fn int TlsUserspace(int _fd)
+ * \brief Indica si lo que se escribe en _fd tiene que pasar por TlsSend() (TLS sin kTLS en el envío).
+ * \param [in] _fd: Socket.
+ * \return Distinto de 0 si no se puede escribir directo en el socket.
+*/
+int TlsUserspace(int _fd);
+
+/**
+ * \fn void TlsClose(SSL* _tls)
+ * \brief Envía close_notify y libera la conexión. No cierra el socket.
+ * \param [in] _tls: Conexión de TlsAccept(). NULL no hace nada.
+*/
+void TlsClose(SSL* _tls);
+
+/**
+ * \fn int TlsMetrics(char* _out, size_t _size)
+ * \brief Escribe las estadísticas de TLS en formato de texto de Prometheus.
+ * \param [out] _out: Buffer.
+ * \param [in] _size: Tamaño de _out.
+ * \return Bytes escritos. 0 si no hay HTTPS, -1 si no entra.
+*/
+int TlsMetrics(char* _out, size_t _size);
+
+#endif /* TLS_H */
@@ -0,0 +1,133 @@
+/*******************************************************************************************************************************//**
+ *
+ * @file		workers.h
+ * @brief		Pool de hilos que atiende clientes (alternativa al fork() por cliente).
+ * @date		19 oct. 2026
+ * @author		Martinez Agustin
+ *
+ **********************************************************************************************************************************/
+
+ /***********************************************************************************************************************************
+ *** MODULO
+ **********************************************************************************************************************************/
+#ifndef WORKERS_H
+#define WORKERS_H
+
+/***********************************************************************************************************************************
+ *** INCLUDES GLOBALES
+ **********************************************************************************************************************************/
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE     // pthread_setaffinity_np(), CPU_SET()
+#endif
+#include <pthread.h>    // pthread_create(), pthread_join()
+#include <sched.h>      // cpu_set_t, sched_yield()
+#include <semaphore.h>  // sem_t
+#include <signal.h>     // pthread_sigmask()
+#include <stdio.h>      // printf()
+#include <string.h>     // memset(), strerror()
+#include <stdint.h>     // uint64_t, intptr_t
+#include <errno.h>      // errno
+#include <unistd.h>     // close()
+
+#include "../inc/conn.h"
+#include "../inc/door.h"
+
+/***********************************************************************************************************************************
+ *** DEFINES GLOBALES
+ **********************************************************************************************************************************/
+#define MAX_WORKERS         64          /**< Máximo de WORKERS */
+#define WORKER_QUEUE_LEN    256         /**< Conexiones aceptadas esperando un hilo libre (potencia de 2) */
+#define MAX_WORKER_CPU      1023        /**< Mayor CPU aceptada en WORKER_CPUS (CPU_SETSIZE - 1) */
+
+/***********************************************************************************************************************************
+ *** TIPO DE DATOS GLOBALES
+ **********************************************************************************************************************************/
+/**
+ * \struct WorkItem_t
+ * \brief Una conexión aceptada, con los límites vigentes cuando se aceptó.
+ */
+typedef struct {
+    int fd;                     /**< Socket del cliente. -1: el hilo termina */
+    ConnLimits_t limits;        /**< Límites de la conexión */
+} WorkItem_t;
+
+/**
+ * \struct WorkCell_t
+ * \brief Celda de la cola. seq indica de quién es el turno (del que encola o del que desencola).
+ */
+typedef struct {
+    size_t seq;                 /**< Turno de la celda */
+    WorkItem_t item;            /**< Conexión */
+} WorkCell_t;
+
+/**
+ * \struct WorkQueue_t
+ * \brief Cola acotada de varios productores y varios consumidores sin locks (Vyukov).
+ * \details Cada lado avanza su índice con compare-and-swap y espera su turno en la celda. head y tail van en
+ * líneas de caché distintas para que el hilo que acepta y los que atienden no se invaliden entre sí. El semáforo
+ * cuenta las conexiones encoladas: un hilo sin trabajo duerme en sem_wait() en lugar de girar.
+ */
+typedef struct {
+    WorkCell_t cells[WORKER_QUEUE_LEN];                         /**< Celdas */
+    _Alignas(CACHE_LINE) size_t tail;                           /**< Próxima celda a encolar */
+    _Alignas(CACHE_LINE) size_t head;                           /**< Próxima celda a desencolar */
+    _Alignas(CACHE_LINE) sem_t items;                           /**< Conexiones en la cola */
+} WorkQueue_t;
+
+/**
+ * \struct WorkerPool_t
+ * \brief Pool de hilos.
+ */
+typedef struct {
+    pthread_t threads[MAX_WORKERS];     /**< Hilos */
+    int count;                          /**< Hilos en marcha. 0: se atiende con fork() */
+    Doors_t* doors;                     /**< Puertas (la memoria compartida ya está enganchada en este proceso) */
+    WorkQueue_t queue;                  /**< Conexiones pendientes */
+    _Alignas(CACHE_LINE) uint64_t served;   /**< Conexiones atendidas */
+    uint64_t rejected;                  /**< Conexiones cerradas por cola llena */
+} WorkerPool_t;
+
+/***********************************************************************************************************************************
+ *** IMPLANTACION DE LA CLASE
+ **********************************************************************************************************************************/
+/**
+ * \fn int WorkersStart(WorkerPool_t* _pool, int _count, const int* _cpus, int _cpus_count, Doors_t* _doors)
+ * \brief Lanza los hilos.
+ * \details Los hilos bloquean todas las señales: las sigue atendiendo el hilo principal. Si se indican CPUs, el
+ * hilo i queda fijo en _cpus[i % _cpus_count].
+ * \param [out] _pool: Pool.
+ * \param [in] _count: Cantidad de hilos (1 a MAX_WORKERS).
+ * \param [in] _cpus: CPUs (WORKER_CPUS). NULL para no fijar.
+ * \param [in] _cpus_count: Cantidad de CPUs.
+ * \param [in] _doors: Puertas.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+int WorkersStart(WorkerPool_t* _pool, int _count, const int* _cpus, int _cpus_count, Doors_t* _doors);
+
+/**
+ * \fn int WorkersSubmit(WorkerPool_t* _pool, int _fd, const ConnLimits_t* _limits)
+ * \brief Encola una conexión aceptada. El hilo que la atiende la cierra.
+ * \param [in] _pool: Pool.
+ * \param [in] _fd: Socket del cliente.
+ * \param [in] _limits: Límites de la conexión.
+ * \return Devuelve -1 si la cola está llena (el socket sigue siendo del que llama). 0 sino.
+*/
+int WorkersSubmit(WorkerPool_t* _pool, int _fd, const ConnLimits_t* _limits);
+
+/**
+ * \fn void WorkersStop(WorkerPool_t* _pool)
+ * \brief Espera a que se atiendan las conexiones encoladas y termina los hilos.
+ * \param [in] _pool: Pool.
+*/
+void WorkersStop(WorkerPool_t* _pool);
+
+/**
+ * \fn int WorkersMetrics(char* _out, size_t _size)
+ * \brief Escribe las estadísticas del pool de este proceso en formato de texto de Prometheus.
+ * \param [out] _out: Buffer.
+ * \param [in] _size: Tamaño de _out.
+ * \return Bytes escritos. 0 si se atiende con fork(), -1 si no entra.
+*/
+int WorkersMetrics(char* _out, size_t _size);
+
+#endif /* WORKERS_H */
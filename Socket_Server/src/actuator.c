@@ -0,0 +1,223 @@
+/*******************************************************************************************************************************//**
+ *
+ * @file		actuator.c
+ * @brief		Cola de comandos a leds y buzzer: junta los de una ráfaga en una sola escritura al driver.
+ * @date		19 oct. 2026
+ * @author		Martinez Agustin
+ *
+ **********************************************************************************************************************************/
+
+ /***********************************************************************************************************************************
+ *** INCLUDES
+ **********************************************************************************************************************************/
+#include "../inc/actuator.h"
+
+/***********************************************************************************************************************************
+ *** VARIABLES GLOBALES PRIVADAS AL MODULO
+ **********************************************************************************************************************************/
+static int64_t window_ns = 0;           /**< Ventana de fusión */
+static ActuatorStats_t* stats = NULL;   /**< En la memoria compartida. NULL: sin estadísticas */
+
+/***********************************************************************************************************************************
+ *** PROTOTIPOS DE FUNCIONES PRIVADAS AL MODULO
+ **********************************************************************************************************************************/
+static int IsLed(char _command);
+static void Count(uint64_t* _counter, uint64_t _value);
+static void SetDepth(const Actuator_t* _act);
+
+/***********************************************************************************************************************************
+ *** IMPLEMENTACION DE LOS METODODS DE LA CLASE
+ **********************************************************************************************************************************/
+/**
+ * \fn void ActuatorSetup(ActuatorStats_t* _stats, long _window_ms)
+ * \brief Fija la ventana de fusión y las estadísticas. Se llama una vez antes de lanzar los lectores.
+ * \param [in] _stats: Estadísticas en la memoria compartida (ShmLayout_t). NULL: sin estadísticas.
+ * \param [in] _window_ms: Espera desde el primer comando pendiente hasta escribir (ACTUATOR_WINDOW). 0: sin espera.
+*/
+void ActuatorSetup(ActuatorStats_t* _stats, long _window_ms)
+{
+    window_ns = (int64_t)_window_ms * 1000000LL;
+    stats = _stats;
+}
+
+/**
+ * \fn void ActuatorInit(Actuator_t* _act, const Door_t* _door, int _id)
+ * \brief Prepara la cola de una puerta.
+ * \param [out] _act: Cola.
+ * \param [in] _door: Puerta.
+ * \param [in] _id: Id de la puerta.
+*/
+void ActuatorInit(Actuator_t* _act, const Door_t* _door, int _id)
+{
+    _act->id = _id;
+    _act->fd = _door->driver;
+    _act->sem = _door->sem_write;
+    _act->count = 0;
+    _act->deadline_ns = 0;
+}
+
+/**
+ * \fn int ActuatorPush(Actuator_t* _act, driver_msg_t _msg, int64_t _now_ns)
+ * \brief Encola un comando, fusionándolo con los pendientes.
+ * \details Un comando de led reemplaza a cualquier led pendiente (solo se vería el último) y un comando repetido
+ * reemplaza al anterior. Si la ventana es 0 se escribe enseguida.
+ * \param [in] _act: Cola.
+ * \param [in] _msg: Comando.
+ * \param [in] _now_ns: Instante actual.
+ * \return Devuelve -1 si falló una escritura. 0 sino.
+*/
+int ActuatorPush(Actuator_t* _act, driver_msg_t _msg, int64_t _now_ns)
+{
+    ActuatorDoorStats_t* st = (stats != NULL) ? &stats->door[_act->id] : NULL;
+    int ret = 0;
+
+    if (st != NULL){
+        Count(&st->queued, 1);
+    }
+    // El reemplazado sale de la cola y el nuevo va al final: se respeta el orden de llegada.
+    for (int i = 0; i < _act->count; i++){
+        if (_act->pending[i].command == _msg.command || (IsLed(_msg.command) && IsLed(_act->pending[i].command))){
+            memmove(&_act->pending[i], &_act->pending[i + 1], (_act->count - i - 1) * sizeof(driver_msg_t));
+            _act->count--;
+            if (st != NULL){
+                Count(&st->coalesced, 1);
+            }
+            break;  // Nunca hay dos pendientes que se reemplacen entre sí
+        }
+    }
+    if (_act->count == ACTUATOR_QUEUE_LEN){
+        ret = ActuatorFlush(_act);
+    }
+    if (_act->count == 0){
+        _act->deadline_ns = _now_ns + window_ns;
+    }
+    _act->pending[_act->count++] = _msg;
+    SetDepth(_act);
+    if (window_ns == 0 && ActuatorFlush(_act) < 0){
+        ret = -1;
+    }
+    return ret;
+}
+
+/**
+ * \fn int ActuatorTimeout(const Actuator_t* _act, int64_t _now_ns)
+ * \brief Milisegundos hasta que vence la ventana.
+ * \param [in] _act: Cola.
+ * \param [in] _now_ns: Instante actual.
+ * \return Timeout para poll(). -1 si no hay pendientes.
+*/
+int ActuatorTimeout(const Actuator_t* _act, int64_t _now_ns)
+{
+    if (_act->count == 0){
+        return -1;
+    }
+    if (_act->deadline_ns <= _now_ns){
+        return 0;
+    }
+    return (int)((_act->deadline_ns - _now_ns + 999999LL) / 1000000LL);
+}
+
+/**
+ * \fn int ActuatorFlush(Actuator_t* _act)
+ * \brief Escribe todos los pendientes con un solo writeDriverBatch().
+ * \param [in] _act: Cola.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+int ActuatorFlush(Actuator_t* _act)
+{
+    int count = _act->count;
+
+    if (count == 0){
+        return 0;
+    }
+    _act->count = 0;    // Si falla no se reintenta: un led viejo no sirve de nada
+    SetDepth(_act);
+    if (stats != NULL){
+        Count(&stats->door[_act->id].batches, 1);
+        Count(&stats->door[_act->id].written, count);
+    }
+    return writeDriverBatch(_act->fd, _act->pending, count, _act->sem);
+}
+
+/**
+ * \fn int ActuatorMetrics(char* _out, size_t _size, int _doors)
+ * \brief Escribe las estadísticas de las colas en formato de texto de Prometheus.
+ * \param [out] _out: Buffer.
+ * \param [in] _size: Tamaño de _out.
+ * \param [in] _doors: Cantidad de puertas.
+ * \return Bytes escritos. -1 si no entra.
+*/
+int ActuatorMetrics(char* _out, size_t _size, int _doors)
+{
+    static const char* const names[4] = { "queued_total", "coalesced_total", "batches_total", "written_total" };
+    size_t pos = 0;
+
+    if (stats == NULL || _size == 0){
+        return 0;
+    }
+    for (int m = 0; m < 4 && pos < _size; m++){
+        pos += snprintf(_out + pos, _size - pos, "# TYPE alarm_actuator_%s counter\n", names[m]);
+        for (int d = 0; d < _doors && pos < _size; d++){
+            const uint64_t* values = &stats->door[d].queued;
+            pos += snprintf(_out + pos, _size - pos, "alarm_actuator_%s{puerta=\"%d\"} %llu\n", names[m], d,
+                            (unsigned long long)__atomic_load_n(&values[m], __ATOMIC_RELAXED));
+        }
+    }
+    if (pos < _size){
+        pos += snprintf(_out + pos, _size - pos, "# TYPE alarm_actuator_queue_depth gauge\n");
+    }
+    for (int d = 0; d < _doors && pos < _size; d++){
+        pos += snprintf(_out + pos, _size - pos, "alarm_actuator_queue_depth{puerta=\"%d\"} %u\n", d,
+                        __atomic_load_n(&stats->door[d].depth, __ATOMIC_RELAXED));
+    }
+    if (pos < _size){
+        pos += snprintf(_out + pos, _size - pos, "# TYPE alarm_actuator_queue_depth_max gauge\n");
+    }
+    for (int d = 0; d < _doors && pos < _size; d++){
+        pos += snprintf(_out + pos, _size - pos, "alarm_actuator_queue_depth_max{puerta=\"%d\"} %u\n", d,
+                        __atomic_load_n(&stats->door[d].max_depth, __ATOMIC_RELAXED));
+    }
+    return (pos < _size) ? (int)pos : -1;
+}
+
+/***********************************************************************************************************************************
+ *** FUNCIONES PRIVADAS AL MODULO
+ **********************************************************************************************************************************/
+/**
+ * \fn static int IsLed(char _command)
+ * \brief Indica si el comando es de un led.
+ * \param [in] _command: Comando.
+ * \return 1 si es GREEN_LED, RED_LED u ORANGE_LED. 0 sino.
+*/
+static int IsLed(char _command)
+{
+    return _command == GREEN_LED || _command == RED_LED || _command == ORANGE_LED;
+}
+
+/**
+ * \fn static void Count(uint64_t* _counter, uint64_t _value)
+ * \brief Suma a un contador compartido entre procesos.
+ * \param [in] _counter: Contador.
+ * \param [in] _value: Valor a sumar.
+*/
+static void Count(uint64_t* _counter, uint64_t _value)
+{
+    __atomic_fetch_add(_counter, _value, __ATOMIC_RELAXED);
+}
+
+/**
+ * \fn static void SetDepth(const Actuator_t* _act)
+ * \brief Publica la cantidad de pendientes de la puerta.
+ * \param [in] _act: Cola.
+*/
+static void SetDepth(const Actuator_t* _act)
+{
+    if (stats == NULL){
+        return;
+    }
+    ActuatorDoorStats_t* st = &stats->door[_act->id];
+    __atomic_store_n(&st->depth, (uint32_t)_act->count, __ATOMIC_RELAXED);
+    if ((uint32_t)_act->count > __atomic_load_n(&st->max_depth, __ATOMIC_RELAXED)){
+        __atomic_store_n(&st->max_depth, (uint32_t)_act->count, __ATOMIC_RELAXED);   // Solo lo escribe el lector
+    }
+}
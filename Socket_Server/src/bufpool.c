@@ -0,0 +1,246 @@
+/*******************************************************************************************************************************//**
+ *
+ * @file		bufpool.c
+ * @brief		Pool de buffers de E/S de tamaño fijo (slabs por clase) para atender pedidos sin malloc().
+ * @date		19 oct. 2026
+ * @author		Martinez Agustin
+ *
+ **********************************************************************************************************************************/
+
+ /***********************************************************************************************************************************
+ *** INCLUDES
+ **********************************************************************************************************************************/
+#include "../inc/bufpool.h"
+
+/***********************************************************************************************************************************
+ *** VARIABLES GLOBALES PRIVADAS AL MODULO
+ **********************************************************************************************************************************/
+static BufPool_t main_pool;             /**< Pool del proceso (cada hijo hereda su copia) */
+static BufPoolStats_t* stats = NULL;    /**< Estadísticas en la memoria compartida, comunes a procesos e hilos */
+static __thread BufPool_t* pool = NULL; /**< Pool del hilo que llama. NULL: malloc() */
+
+/***********************************************************************************************************************************
+ *** PROTOTIPOS DE FUNCIONES PRIVADAS AL MODULO
+ **********************************************************************************************************************************/
+static void Count(uint64_t* _counter, uint64_t _value);
+static int PoolCreate(BufPool_t* _pool);
+static void PoolDestroy(BufPool_t* _pool);
+
+/***********************************************************************************************************************************
+ *** IMPLEMENTACION DE LOS METODODS DE LA CLASE
+ **********************************************************************************************************************************/
+/**
+ * \fn int BufPoolInit(BufPoolStats_t* _stats)
+ * \brief Reserva los slabs del proceso principal. Se llama una vez, antes de los fork().
+ * \param [in] _stats: Estadísticas en la memoria compartida (ShmLayout_t).
+ * \return Devuelve -1 si error. 0 sino.
+*/
+int BufPoolInit(BufPoolStats_t* _stats)
+{
+    stats = _stats;
+    pool = &main_pool;
+    return PoolCreate(&main_pool);
+}
+
+/**
+ * \fn int BufPoolThreadInit(void)
+ * \brief Crea el pool del hilo que llama. Las estadísticas siguen siendo las del proceso.
+ * \return Devuelve -1 si error (el hilo usa malloc()). 0 sino.
+*/
+int BufPoolThreadInit(void)
+{
+    BufPool_t* aux;
+
+    if (stats == NULL){
+        return -1;
+    }
+    aux = (BufPool_t*)malloc(sizeof(BufPool_t));
+    if (aux == NULL){
+        return -1;
+    }
+    if (PoolCreate(aux) < 0){
+        PoolDestroy(aux);
+        free(aux);
+        return -1;
+    }
+    pool = aux;
+    return 0;
+}
+
+/**
+ * \fn void BufPoolThreadFree(void)
+ * \brief Libera el pool del hilo que llama (al terminar el hilo).
+*/
+void BufPoolThreadFree(void)
+{
+    if (pool == NULL || pool == &main_pool){
+        return;
+    }
+    PoolDestroy(pool);
+    free(pool);
+    pool = NULL;
+}
+
+/**
+ * \fn void* BufGet(size_t _size)
+ * \brief Entrega un buffer de al menos _size bytes.
+ * \details Usa la clase más chica que alcanza; si está vacía, la siguiente. Si ninguna alcanza (o el pool no se
+ * inicializó) recurre a malloc() y lo cuenta en fallbacks.
+ * \param [in] _size: Bytes necesarios.
+ * \return El buffer. NULL si error.
+*/
+void* BufGet(size_t _size)
+{
+    for (int c = 0; pool != NULL && c < BUF_CLASSES; c++){
+        if (pool->size[c] < _size){
+            continue;
+        }
+        if (pool->free_count[c] == 0){
+            Count(&stats->cls[c].exhausted, 1);
+            continue;
+        }
+        int index = pool->free_list[c][--pool->free_count[c]];
+        Count(&stats->cls[c].gets, 1);
+        return pool->slab[c] + pool->size[c] * index;
+    }
+    if (stats != NULL){
+        Count(&stats->fallbacks, 1);
+        Count(&stats->fallback_bytes, _size);
+    }
+    return malloc(_size);
+}
+
+/**
+ * \fn void BufPut(void* _buff)
+ * \brief Devuelve un buffer de BufGet(). Acepta NULL.
+ * \param [in] _buff: Buffer.
+*/
+void BufPut(void* _buff)
+{
+    char* aux = (char*)_buff;
+
+    if (aux == NULL){
+        return;
+    }
+    // Un buffer siempre vuelve al pool del hilo que lo pidió.
+    for (int c = 0; pool != NULL && c < BUF_CLASSES; c++){
+        if (pool->slab[c] != NULL && aux >= pool->slab[c] && aux < pool->slab[c] + pool->size[c] * pool->count[c]){
+            pool->free_list[c][pool->free_count[c]++] = (uint16_t)((aux - pool->slab[c]) / pool->size[c]);
+            Count(&stats->cls[c].puts, 1);
+            return;
+        }
+    }
+    free(_buff);
+}
+
+/**
+ * \fn int BufPoolMetrics(char* _out, size_t _size)
+ * \brief Escribe las estadísticas del pool en formato de texto de Prometheus.
+ * \param [out] _out: Buffer.
+ * \param [in] _size: Tamaño de _out.
+ * \return Bytes escritos. -1 si no entra.
+*/
+int BufPoolMetrics(char* _out, size_t _size)
+{
+    static const char* const names[3] = { "gets_total", "puts_total", "exhausted_total" };
+    size_t pos = 0;
+
+    if (stats == NULL){
+        return 0;
+    }
+    for (int m = 0; m < 3 && pos < _size; m++){
+        pos += snprintf(_out + pos, _size - pos, "# TYPE alarm_bufpool_%s counter\n", names[m]);
+        for (int c = 0; c < BUF_CLASSES && pos < _size; c++){
+            const uint64_t* values = &stats->cls[c].gets;
+            pos += snprintf(_out + pos, _size - pos, "alarm_bufpool_%s{size=\"%zu\"} %llu\n", names[m], main_pool.size[c],
+                            (unsigned long long)__atomic_load_n(&values[m], __ATOMIC_RELAXED));
+        }
+    }
+    // En uso: entregados menos devueltos, entre todos los procesos.
+    if (pos < _size){
+        pos += snprintf(_out + pos, _size - pos, "# TYPE alarm_bufpool_in_use gauge\n");
+    }
+    for (int c = 0; c < BUF_CLASSES && pos < _size; c++){
+        pos += snprintf(_out + pos, _size - pos, "alarm_bufpool_in_use{size=\"%zu\"} %llu\n", main_pool.size[c],
+                        (unsigned long long)(__atomic_load_n(&stats->cls[c].gets, __ATOMIC_RELAXED)
+                                             - __atomic_load_n(&stats->cls[c].puts, __ATOMIC_RELAXED)));
+    }
+    if (pos < _size){
+        pos += snprintf(_out + pos, _size - pos, "# TYPE alarm_bufpool_capacity gauge\n");
+    }
+    for (int c = 0; c < BUF_CLASSES && pos < _size; c++){
+        pos += snprintf(_out + pos, _size - pos, "alarm_bufpool_capacity{size=\"%zu\"} %d\n", main_pool.size[c], main_pool.count[c]);
+    }
+    if (pos < _size){
+        pos += snprintf(_out + pos, _size - pos, "# TYPE alarm_bufpool_pools gauge\nalarm_bufpool_pools %llu\n",
+                        (unsigned long long)__atomic_load_n(&stats->pools, __ATOMIC_RELAXED));
+    }
+    if (pos < _size){
+        pos += snprintf(_out + pos, _size - pos,
+                        "# TYPE alarm_bufpool_fallbacks_total counter\nalarm_bufpool_fallbacks_total %llu\n"
+                        "# TYPE alarm_bufpool_fallback_bytes_total counter\nalarm_bufpool_fallback_bytes_total %llu\n",
+                        (unsigned long long)__atomic_load_n(&stats->fallbacks, __ATOMIC_RELAXED),
+                        (unsigned long long)__atomic_load_n(&stats->fallback_bytes, __ATOMIC_RELAXED));
+    }
+    return (pos < _size) ? (int)pos : -1;
+}
+
+/***********************************************************************************************************************************
+ *** FUNCIONES PRIVADAS AL MODULO
+ **********************************************************************************************************************************/
+/**
+ * \fn static void Count(uint64_t* _counter, uint64_t _value)
+ * \brief Suma a un contador compartido entre procesos.
+ * \param [in] _counter: Contador.
+ * \param [in] _value: Valor a sumar.
+*/
+static void Count(uint64_t* _counter, uint64_t _value)
+{
+    __atomic_fetch_add(_counter, _value, __ATOMIC_RELAXED);
+}
+
+/**
+ * \fn static int PoolCreate(BufPool_t* _pool)
+ * \brief Reserva los slabs de un pool.
+ * \param [out] _pool: Pool.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+static int PoolCreate(BufPool_t* _pool)
+{
+    const size_t sizes[BUF_CLASSES] = BUF_CLASS_SIZES;
+    const int counts[BUF_CLASSES] = BUF_CLASS_COUNTS;
+
+    memset(_pool, 0, sizeof(BufPool_t));
+    _pool->stats = stats;
+    for (int c = 0; c < BUF_CLASSES; c++){
+        // MAP_NORESERVE: las páginas que nadie usa no cuentan como memoria comprometida.
+        void* slab = mmap(NULL, sizes[c] * counts[c], PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (slab == MAP_FAILED){
+            return -1;  // Las clases que faltan quedan vacías: BufGet() pasa a malloc()
+        }
+        _pool->slab[c] = (char*)slab;
+        _pool->size[c] = sizes[c];
+        _pool->count[c] = counts[c];
+        _pool->free_count[c] = counts[c];
+        for (int i = 0; i < counts[c]; i++){
+            _pool->free_list[c][i] = (uint16_t)(counts[c] - 1 - i);   // El 0 sale primero
+        }
+    }
+    Count(&stats->pools, 1);
+    return 0;
+}
+
+/**
+ * \fn static void PoolDestroy(BufPool_t* _pool)
+ * \brief Libera los slabs de un pool.
+ * \param [in] _pool: Pool.
+*/
+static void PoolDestroy(BufPool_t* _pool)
+{
+    for (int c = 0; c < BUF_CLASSES; c++){
+        if (_pool->slab[c] != NULL){
+            munmap(_pool->slab[c], _pool->size[c] * _pool->count[c]);
+            _pool->slab[c] = NULL;
+        }
+    }
+}
@@ -0,0 +1,254 @@
+/*******************************************************************************************************************************//**
+ *
+ * @file		children.c
+ * @brief		Procesos hijo que atienden clientes: cuenta, tiempos y recolección con signalfd() dentro del poll().
+ * @date		19 oct. 2026
+ * @author		Martinez Agustin
+ *
+ **********************************************************************************************************************************/
+
+ /***********************************************************************************************************************************
+ *** INCLUDES
+ **********************************************************************************************************************************/
+#include "../inc/children.h"
+
+/***********************************************************************************************************************************
+ *** VARIABLES GLOBALES PRIVADAS AL MODULO
+ **********************************************************************************************************************************/
+static ChildStats_t* stats = NULL;      /**< En la memoria compartida. NULL: sin estadísticas */
+
+/** Límites superiores de los rangos del histograma, en segundos (el último es +Inf) */
+static const double bucket_le[CHILD_BUCKETS - 1] = { 0.01, 0.1, 1, 10, 60 };
+
+/***********************************************************************************************************************************
+ *** PROTOTIPOS DE FUNCIONES PRIVADAS AL MODULO
+ **********************************************************************************************************************************/
+static void ChildFinished(pid_t _pid, int _status, int64_t _runtime_ns);
+
+/***********************************************************************************************************************************
+ *** IMPLEMENTACION DE LOS METODODS DE LA CLASE
+ **********************************************************************************************************************************/
+/**
+ * \fn int ChildrenInit(ChildTable_t* _table, const sigset_t* _signals, ChildStats_t* _stats)
+ * \brief Bloquea SIGCHLD y _signals y crea un signalfd para todas. Se llama una vez antes de lanzar hilos y de
+ * aceptar clientes.
+ * \details Con las señales bloqueadas quedan pendientes hasta que el lazo principal las lee del signalfd: no hay
+ * handler que modifique la cuenta de hijos mientras el lazo la consulta, ni una señal que llegue entre revisar un
+ * pedido y entrar al poll() y se pierda. Los hilos que se lancen después heredan la máscara.
+ * \param [out] _table: Tabla.
+ * \param [in] _signals: Señales que también se leen del signalfd (SIGCHLD se agrega siempre).
+ * \param [in] _stats: Estadísticas en la memoria compartida (ShmLayout_t). NULL: sin estadísticas.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+int ChildrenInit(ChildTable_t* _table, const sigset_t* _signals, ChildStats_t* _stats)
+{
+    sigset_t mask = *_signals;
+
+    _table->count = 0;
+    sigaddset(&mask, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &mask, NULL);
+    _table->fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (_table->fd < 0){
+        return -1;
+    }
+    stats = _stats;
+    return 0;
+}
+
+/**
+ * \fn int ChildrenAdd(ChildTable_t* _table, pid_t _pid)
+ * \brief Registra un hijo recién lanzado.
+ * \param [in] _table: Tabla.
+ * \param [in] _pid: Proceso.
+ * \return Devuelve -1 si la tabla está llena. 0 sino.
+*/
+int ChildrenAdd(ChildTable_t* _table, pid_t _pid)
+{
+    if (_table->count == MAX_CHILDREN){
+        return -1;
+    }
+    _table->child[_table->count].pid = _pid;
+    _table->child[_table->count].start_ns = TimeNowNs();
+    _table->count++;
+    if (stats != NULL){
+        __atomic_fetch_add(&stats->started, 1, __ATOMIC_RELAXED);
+        __atomic_store_n(&stats->active, (uint32_t)_table->count, __ATOMIC_RELAXED);
+    }
+    return 0;
+}
+
+/**
+ * \fn int ChildrenReap(ChildTable_t* _table, ChildExit_t _other)
+ * \brief Junta todos los hijos terminados sin bloquear. Se llama al leer SIGCHLD de ChildrenNextSignal().
+ * \details Los clientes salen de la tabla y se cuentan en las estadísticas. El resto se pasa a _other.
+ * \param [in] _table: Tabla.
+ * \param [in] _other: Función para los procesos que no son clientes. NULL para ignorarlos.
+ * \return Cantidad de clientes que terminaron.
+*/
+int ChildrenReap(ChildTable_t* _table, ChildExit_t _other)
+{
+    int status;
+    int reaped = 0;
+    pid_t pid;
+
+    // Varios SIGCHLD seguidos se juntan en uno: el signalfd solo avisa, waitpid() dice quiénes terminaron.
+    while ((pid = waitpid(-1, &status, WNOHANG)) > 0){
+        int i = 0;
+        while (i < _table->count && _table->child[i].pid != pid){
+            i++;
+        }
+        if (i == _table->count){
+            if (_other != NULL){
+                _other(pid, status);
+            }
+            continue;
+        }
+        ChildFinished(pid, status, TimeNowNs() - _table->child[i].start_ns);
+        _table->child[i] = _table->child[--_table->count];
+        reaped++;
+    }
+    if (stats != NULL){
+        __atomic_store_n(&stats->active, (uint32_t)_table->count, __ATOMIC_RELAXED);
+    }
+    return reaped;
+}
+
+/**
+ * \fn int ChildrenNextSignal(ChildTable_t* _table)
+ * \brief Lee una señal pendiente del signalfd sin bloquear.
+ * \param [in] _table: Tabla.
+ * \return Número de la señal (ssi_signo). 0 si no hay más.
+*/
+int ChildrenNextSignal(ChildTable_t* _table)
+{
+    struct signalfd_siginfo info;
+
+    if (_table->fd < 0 || read(_table->fd, &info, sizeof(info)) != sizeof(info)){
+        return 0;
+    }
+    return (int)info.ssi_signo;
+}
+
+/**
+ * \fn int ChildrenActive(const ChildTable_t* _table)
+ * \brief Cantidad de clientes atendiéndose en procesos hijo.
+ * \param [in] _table: Tabla.
+ * \return Hijos vivos.
+*/
+int ChildrenActive(const ChildTable_t* _table)
+{
+    return _table->count;
+}
+
+/**
+ * \fn void ChildrenClose(ChildTable_t* _table)
+ * \brief Cierra el signalfd. Lo llaman los hijos después del fork().
+ * \param [in] _table: Tabla.
+*/
+void ChildrenClose(ChildTable_t* _table)
+{
+    if (_table->fd >= 0){
+        close(_table->fd);
+        _table->fd = -1;
+    }
+}
+
+/**
+ * \fn void ChildrenUnblockSignals(void)
+ * \brief Desbloquea las señales que el proceso principal lee por signalfd. Lo llaman los hijos después del fork().
+ * \details La máscara se hereda: sin esto un hijo no terminaría con SIGINT.
+*/
+void ChildrenUnblockSignals(void)
+{
+    sigset_t mask;
+
+    sigemptyset(&mask);
+    sigprocmask(SIG_SETMASK, &mask, NULL);
+}
+
+/**
+ * \fn int ChildrenMetrics(char* _out, size_t _size)
+ * \brief Escribe las estadísticas de los hijos en formato de texto de Prometheus.
+ * \param [out] _out: Buffer.
+ * \param [in] _size: Tamaño de _out.
+ * \return Bytes escritos. -1 si no entra.
+*/
+int ChildrenMetrics(char* _out, size_t _size)
+{
+    uint64_t cumulative = 0;
+    size_t pos = 0;
+
+    if (stats == NULL || _size == 0){
+        return 0;
+    }
+    pos += snprintf(_out + pos, _size - pos,
+            "# TYPE alarm_children_active gauge\n"
+            "alarm_children_active %u\n"
+            "# TYPE alarm_children_started_total counter\n"
+            "alarm_children_started_total %llu\n"
+            "# TYPE alarm_children_failed_total counter\n"
+            "alarm_children_failed_total %llu\n"
+            "# TYPE alarm_children_runtime_max_seconds gauge\n"
+            "alarm_children_runtime_max_seconds %.6f\n"
+            "# TYPE alarm_children_runtime_seconds histogram\n",
+            __atomic_load_n(&stats->active, __ATOMIC_RELAXED),
+            (unsigned long long)__atomic_load_n(&stats->started, __ATOMIC_RELAXED),
+            (unsigned long long)__atomic_load_n(&stats->failed, __ATOMIC_RELAXED),
+            __atomic_load_n(&stats->runtime_max_ns, __ATOMIC_RELAXED) / 1e9);
+    for (int b = 0; b < CHILD_BUCKETS && pos < _size; b++){
+        char le[16];
+        cumulative += __atomic_load_n(&stats->bucket[b], __ATOMIC_RELAXED);
+        if (b < CHILD_BUCKETS - 1){
+            snprintf(le, sizeof(le), "%g", bucket_le[b]);
+        }
+        else{
+            snprintf(le, sizeof(le), "+Inf");
+        }
+        pos += snprintf(_out + pos, _size - pos, "alarm_children_runtime_seconds_bucket{le=\"%s\"} %llu\n", le,
+                        (unsigned long long)cumulative);
+    }
+    if (pos < _size){
+        pos += snprintf(_out + pos, _size - pos,
+                "alarm_children_runtime_seconds_sum %.6f\n"
+                "alarm_children_runtime_seconds_count %llu\n",
+                __atomic_load_n(&stats->runtime_ns, __ATOMIC_RELAXED) / 1e9,
+                (unsigned long long)__atomic_load_n(&stats->finished, __ATOMIC_RELAXED));
+    }
+    return (pos < _size) ? (int)pos : -1;
+}
+
+/***********************************************************************************************************************************
+ *** FUNCIONES PRIVADAS AL MODULO
+ **********************************************************************************************************************************/
+/**
+ * \fn static void ChildFinished(pid_t _pid, int _status, int64_t _runtime_ns)
+ * \brief Cuenta un cliente terminado e informa si no terminó bien.
+ * \param [in] _pid: Proceso.
+ * \param [in] _status: Estado de waitpid().
+ * \param [in] _runtime_ns: Tiempo desde el fork().
+*/
+static void ChildFinished(pid_t _pid, int _status, int64_t _runtime_ns)
+{
+    int failed = !WIFEXITED(_status) || WEXITSTATUS(_status) != 0;
+    int b = 0;
+
+    if (WIFSIGNALED(_status)){
+        printf("Cliente %d terminó por la señal %d tras %.1f ms\n", _pid, WTERMSIG(_status), _runtime_ns / 1e6);
+    }
+    else if (failed){
+        printf("Cliente %d terminó con error %d tras %.1f ms\n", _pid, WEXITSTATUS(_status), _runtime_ns / 1e6);
+    }
+    if (stats == NULL){
+        return;
+    }
+    while (b < CHILD_BUCKETS - 1 && _runtime_ns > (int64_t)(bucket_le[b] * 1e9)){
+        b++;
+    }
+    __atomic_fetch_add(&stats->finished, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&stats->failed, (uint64_t)failed, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&stats->runtime_ns, (uint64_t)_runtime_ns, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&stats->bucket[b], 1, __ATOMIC_RELAXED);
+    if ((uint64_t)_runtime_ns > __atomic_load_n(&stats->runtime_max_ns, __ATOMIC_RELAXED)){
+        __atomic_store_n(&stats->runtime_max_ns, (uint64_t)_runtime_ns, __ATOMIC_RELAXED);   // Solo lo escribe el principal
+    }
+}
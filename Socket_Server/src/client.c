@@ -12,157 +12,482 @@
  **********************************************************************************************************************************/
 #include "../inc/client.h"
 
+/***********************************************************************************************************************************
+ *** PROTOTIPOS DE FUNCIONES PRIVADAS AL MODULO
+ **********************************************************************************************************************************/
+static int ServeClient(int _client_id, Doors_t* _doors, const ConnLimits_t* _limits);
+static int DispatchRequest(Connection_t* _conn, void* _doors);
+static int RouteAddKey(Request_t* _req);
+static int RouteDeleteKey(Request_t* _req);
+static int RouteBulk(Request_t* _req);
+static int RouteExport(Request_t* _req);
+static int RouteRules(Request_t* _req);
+static int RouteKeys(Request_t* _req);
+static int RouteLog(Request_t* _req);
+static int RouteMetrics(Request_t* _req);
+static int RouteStats(Request_t* _req);
+static int RouteIco(Request_t* _req);
+static int RouteHTML(Request_t* _req);
+static void SourceFailed(const Request_t* _req);
+static int LoadPage(const char* _file);
+static int KeysJson(char* _out, KeyShard_t* _valid_keys, int _semId);
+static int LogJson(char* _out, size_t _size, const Doors_t* _doors, int _door);
+static int LogBatch(const Door_t* _door, int _start, ActivityEntry_t* _batch);
+static int ParseLogQuery(const Request_t* _req, LogQuery_t* _query);
+static int LogMetrics(char* _out, size_t _size, const Doors_t* _doors);
+static int LogEntryJson(char* _out, size_t _size, const ActivityEntry_t* _entry, int _door, int _comma);
+
+/***********************************************************************************************************************************
+ *** VARIABLES GLOBALES PRIVADAS AL MODULO
+ **********************************************************************************************************************************/
+/**
+ * \var routes
+ * \brief Rutas del servidor. Una ruta nueva es una línea más: RouterBuild() recalcula el hash al arrancar.
+ */
+static const Route_t routes[] = {
+    /* path                 GET             POST */
+    { "/",                  { RouteHTML,    NULL } },
+    { "/favicon.ico",       { RouteIco,     NULL } },
+    { "/claves",            { RouteKeys,    NULL } },
+    { "/claves/export",     { RouteExport,  NULL } },
+    { "/claves/reglas",     { RouteRules,   NULL } },
+    { "/claves/bulk",       { NULL,         RouteBulk } },
+    { "/agregar",           { NULL,         RouteAddKey } },
+    { "/eliminar",          { NULL,         RouteDeleteKey } },
+    { "/log",               { RouteLog,     NULL } },
+    { "/metrics",           { RouteMetrics, NULL } },
+    { "/stats",             { RouteStats,   NULL } },
+};
+
+#define ROUTES_COUNT (int)(sizeof(routes) / sizeof(routes[0]))
+
+_Static_assert(sizeof(routes) / sizeof(routes[0]) <= ROUTER_SLOTS / 2, "Demasiadas rutas para ROUTER_SLOTS");
+
+static Router_t router;     /**< Armado por ClientInit() antes de los fork() y de los hilos */
+static char* page = NULL;   /**< PAGINA_HTML cargada por ClientInit(). NULL: se lee del disco en cada pedido */
+static size_t page_len;     /**< Largo de page */
+static size_t page_split;   /**< Posición de PAGE_PLACEHOLDER en page. page_len si no está */
+
 /***********************************************************************************************************************************
  *** IMPLEMENTACION DE LOS METODODS DE LA CLASE
  **********************************************************************************************************************************/
 /**
- * \fn int client(int _client_id, struct sockaddr_in* _client_data)
+ * \fn int ClientInit(void)
+ * \brief Arma la tabla de rutas y carga PAGINA_HTML en memoria. Se llama una vez en el proceso principal.
+ * \details Si la página no se puede cargar se lee del disco en cada pedido, sin datos iniciales.
+ * \return Devuelve -1 si error en la tabla de rutas. 0 sino.
+*/
+int ClientInit(void)
+{
+    if (LoadPage(PAGINA_HTML) < 0){
+        perror(PAGINA_HTML);
+    }
+    return RouterBuild(&router, routes, ROUTES_COUNT);
+}
+
+/**
+ * \fn int client(int _client_id, Doors_t* _doors, const ConnLimits_t* _limits)
  * \brief Maneja el cliente _client_id del servidor HTML.
  * \details Lee y responde a la petición del cliente. Guarda/borra KEYS en memoria compartida.
+ * Las rutas sin prefijo trabajan sobre las claves globales (válidas en todas las puertas). Con el prefijo
+ * /doors/<id> trabajan sobre las claves y el log de esa puerta. El pedido se atiende con la ruta de la tabla routes
+ * (404 si no existe, 405 si no admite el método). No cierra el socket ni se desengancha de la memoria
+ * compartida: puede correr en un proceso hijo o en un hilo del pool. Si llegó por un listener tls primero hace el
+ * handshake; un handshake fallido descarta al cliente sin respuesta. Sin TLS también acepta HTTP/2 (h2c): varios
+ * pedidos multiplexados en la misma conexión, cada uno atendido con las mismas rutas.
  * \param [in] _client_id: ID del cliente.
- * \param [in] _client_data: informacion del cliente.
+ * \param [in] _doors: Puertas.
+ * \param [in] _limits: Timeouts y tamaño máximo del pedido.
  * \return Devuelve -1 si error. 0 sino.
 */
-int client(int _client_id, int driver, KeyEntry_t* valid_keys, ActivityEntry_t*log, int sem_list[3])
+int client(int _client_id, Doors_t* _doors, const ConnLimits_t* _limits)
 {
-    char buff_com[4096];
+    return ServeClient(_client_id, _doors, _limits);
+}
 
-    KeyEntry_t key;
+/**
+ * \fn int TakeDoorPrefix(Connection_t* _conn, int _doors_count)
+ * \brief Quita el prefijo /doors/<id> de la línea de pedido.
+ * \details "GET /doors/2/claves HTTP/1.1" queda como "GET /claves HTTP/1.1", así el resto de las rutas
+ * no cambia. Se corre el resto del buffer y se ajustan los largos de la conexión.
+ * \param [in] _conn: Conexión con el pedido completo.
+ * \param [in] _doors_count: Cantidad de puertas.
+ * \return El id de la puerta. DOOR_GLOBAL si no hay prefijo. DOOR_NOT_FOUND si la puerta no existe.
+*/
+int TakeDoorPrefix(Connection_t* _conn, int _doors_count)
+{
+    char* path = strchr(_conn->buff, ' ');
+    const char* line_end = strchr(_conn->buff, '\n');
+    if (path == NULL || line_end == NULL || path > line_end || strncmp(path, " /doors/", 8) != 0){
+        return DOOR_GLOBAL;
+    }
+    path++;     // "/doors/..."
 
-    int sem_k = sem_list[0];
-    int sem_l = sem_list[1];
-    int sem_write = sem_list[2];
+    char* num_end;
+    long id = strtol(path + 7, &num_end, 10);
+    if (num_end == path + 7 || (*num_end != '/' && *num_end != ' ') || id < 0 || id >= _doors_count){
+        return DOOR_NOT_FOUND;
+    }
+    if (*num_end == ' '){       // "/doors/<id>" solo: la página
+        *--num_end = '/';
+    }
 
-    driver_msg_t driver_msg;
-    driver_msg.command = ORANGE_LED;
-    driver_msg.dec_ms = 200;
+    size_t removed = num_end - path;
+    memmove(path, num_end, _conn->len - (num_end - _conn->buff) + 1);
+    _conn->len -= removed;
+    _conn->header_len -= removed;
+    return (int)id;
+}
 
-    // Lectura de mensaje recibido:
-    int len = recv(_client_id, buff_com, sizeof(buff_com), 0);
-    if (len == -1){
-        shmdt(valid_keys);
-        shmdt(log);
+/**
+ * \fn int GetKeyFromHTML(char* _buff, KeyEntry_t* _key)
+ * \brief Obtiene la KEY del mensaje HTML recibido.
+ * \details Obtiene la KEY del mensaje HTML recibido. Tiene que tener exactamente KEY_SIZE dígitos.
+ * \param [in] _buff: Mensaje HTML recibido.
+ * \param [in] _key: Puntero a KEY leída.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+int GetKeyFromHTML(char* _buff, KeyEntry_t* _key)
+{
+    const char* aux = strstr(_buff, "{\"clave\":\"");
+    if(aux == NULL){
         return -1;
     }
-    buff_com[len] = '\0';
-    printf("*-------------------------------------------\n"
-        "Recibido del cliente:\n\n%.30s\n"
-        "*-------------------------------------------\n", buff_com);
-    
-    // Análisis del mensaje recibido:
-    if (strstr(buff_com, "POST /agregar HTTP/1.1") != NULL) // Añado nueva clave valida
-    { 
-        if (GetKeyFromHTML(buff_com, &key) < 0){
-            printf("Error clave no recibida");
-            shmdt(valid_keys);
-            shmdt(log);
-            return -1;
-        }
-        int new_key = AddKey(key, valid_keys, sem_k);
-        if (new_key < 0)
-            printf("No pude añadir la KEY");
-        
-        if (new_key > 0)
-        {
-            if (writeDriver(driver, driver_msg, sem_write) == -1)
+    aux += 10;
+    return KeyFromString(aux, strcspn(aux, "\""), _key);
+}
+
+/**
+ * \fn int ParseKeyList(const char* _body, size_t _len, KeyEntry_t* _keys, int _max, int* _bad)
+ * \brief Obtiene una lista de KEYs de un cuerpo JSON (["1234","5678"]) o CSV (1234,5678 o una por línea).
+ * \details Se valida todo antes de devolver: cada clave debe tener exactamente KEY_SIZE dígitos.
+ * \param [in] _body: Cuerpo del pedido.
+ * \param [in] _len: Largo del cuerpo.
+ * \param [out] _keys: Claves leídas.
+ * \param [in] _max: Cantidad máxima de claves.
+ * \param [out] _bad: Posición (desde 1) de la clave inválida, si hubo error.
+ * \return Devuelve -1 si error. La cantidad de claves sino.
+*/
+int ParseKeyList(const char* _body, size_t _len, KeyEntry_t* _keys, int _max, int* _bad)
+{
+    int count = 0;
+    size_t i = 0;
+
+    while (i < _len){
+        char c = _body[i];
+        if (c >= '0' && c <= '9'){
+            size_t start = i;
+            while (i < _len && _body[i] >= '0' && _body[i] <= '9'){
+                i++;
+            }
+            if (count >= _max || KeyFromString(_body + start, i - start, &_keys[count]) < 0){
+                *_bad = count + 1;
                 return -1;
+            }
+            count++;
+            continue;
         }
-        printf("Añadi la KEY: %s.\n", key.value);
-
-        if (SendValidKeys(_client_id, valid_keys, sem_k) < 0){
-            shmdt(valid_keys);
-            shmdt(log);
+        if (strchr(" \t\r\n,;\"[]", c) == NULL){    // Separadores válidos de JSON y CSV
+            *_bad = count + 1;
             return -1;
         }
-        printf("Envié keys.JSON\n\n");
+        i++;
     }
-    if (strstr(buff_com, "POST /eliminar HTTP/1.1") != NULL)    // Borro nueva clave valida
-    { 
-        if (GetKeyFromHTML(buff_com, &key) < 0){
-            printf("Error clave no recibida");
-            shmdt(valid_keys);
-            shmdt(log);
+    return count;
+}
+
+/**
+ * \fn int GetParam(const char* _text, size_t _len, const char* _name, char* _value, size_t _size)
+ * \brief Busca un parámetro por nombre en un cuerpo JSON ("nombre":"valor") o en una query (?nombre=valor&...).
+ * \details En la query se decodifican los %XX.
+ * \param [in] _text: Texto donde buscar.
+ * \param [in] _len: Largo del texto.
+ * \param [in] _name: Nombre del parámetro.
+ * \param [out] _value: Valor, terminado en '\0'.
+ * \param [in] _size: Tamaño de _value.
+ * \return El largo del valor. -1 si no está o no entra en _value.
+*/
+int GetParam(const char* _text, size_t _len, const char* _name, char* _value, size_t _size)
+{
+    size_t name_len = strlen(_name);
+
+    for (size_t i = 1; i + name_len < _len; i++){
+        if (memcmp(_text + i, _name, name_len) != 0){
+            continue;
+        }
+        char before = _text[i - 1];
+        size_t pos = i + name_len;
+        const char* stop;
+        int query = 0;
+        if (before == '"' && _text[pos] == '"'){        // JSON
+            pos++;
+            while (pos < _len && (_text[pos] == ' ' || _text[pos] == ':')){
+                pos++;
+            }
+            if (pos < _len && _text[pos] == '"'){
+                pos++;
+                stop = "\"";
+            }
+            else{
+                stop = ",} \r\n";
+            }
+        }
+        else if ((before == '?' || before == '&') && _text[pos] == '='){    // Query
+            pos++;
+            stop = "& \r\n";
+            query = 1;
+        }
+        else{
+            continue;
+        }
+        size_t end = pos;
+        while (end < _len && strchr(stop, _text[end]) == NULL){
+            end++;
+        }
+        if (end - pos >= _size){
             return -1;
         }
-        printf("Borré una KEY: %s.\n", key.value);
-        
-        int new_key = DeleteKey(key, valid_keys, sem_k);        
-        if (new_key > 0)
-        {
-            if (writeDriver(driver, driver_msg, sem_write) == -1)
-                return -1;
+        size_t out = 0;
+        for (size_t j = pos; j < end; j++){
+            unsigned int hex;
+            if (query && _text[j] == '%' && j + 2 < end && sscanf(_text + j + 1, "%2x", &hex) == 1){   // "%2B" -> '+'
+                _value[out++] = (char)hex;
+                j += 2;
+                continue;
+            }
+            _value[out++] = _text[j];
         }
+        _value[out] = '\0';
+        return (int)out;
+    }
+    return -1;
+}
+
+/**
+ * \fn int ParseRuleTime(const char* _value, int64_t* _ns)
+ * \brief Lee un instante de una regla.
+ * \details Acepta fecha y hora local ("2026-10-20T18:00" o "2026-10-20 18:00"), segundos desde epoch, o un
+ * tiempo relativo a ahora ("+30m", "+2h", "+1d", "+45s"). El relativo va hasta RULE_RELATIVE_MAX (unos 10 años),
+ * así el instante en ns no desborda int64_t.
+ * \param [in] _value: Texto.
+ * \param [out] _ns: Instante en ns desde epoch.
+ * \return Devuelve -1 si el formato no es válido. 0 sino.
+*/
+int ParseRuleTime(const char* _value, int64_t* _ns)
+{
+    char* end;
+    struct tm local;
+    char sep;
 
-        if (SendValidKeys(_client_id, valid_keys, sem_k) < 0){
-            shmdt(valid_keys);
-            shmdt(log);
+    if (_value[0] == '+'){
+        long amount = strtol(_value + 1, &end, 10);
+        long unit = 0;
+        if (end == _value + 1 || amount < 0 || end[0] == '\0' || end[1] != '\0'){
             return -1;
         }
-        printf("Envié keys.JSON\n\n");
-    }
-    if (strstr(buff_com, "GET /claves HTTP/1.1") != NULL)   //Envío la tabla de claves
-    {
-        if (SendValidKeys(_client_id, valid_keys, sem_k) < 0){
-            shmdt(valid_keys);
-            shmdt(log);
+        switch (end[0]){
+            case 's': unit = 1; break;
+            case 'm': unit = 60; break;
+            case 'h': unit = 3600; break;
+            case 'd': unit = 86400; break;
+            default: return -1;
+        }
+        if (amount > RULE_RELATIVE_MAX / unit){
             return -1;
         }
-        printf("Envié keys.JSON\n\n");
+        *_ns = TimeNowNs() + (int64_t)amount * unit * 1000000000LL;
+        return 0;
     }
-    if (strstr(buff_com, "GET /log HTTP/1.1") != NULL)  //Envío la tabla de historial
-    {
-        if (SendLog(_client_id, log, sem_l) < 0){
-            shmdt(valid_keys);
-            shmdt(log);
+
+    memset(&local, 0, sizeof(local));
+    if (sscanf(_value, "%4d-%2d-%2d%c%2d:%2d", &local.tm_year, &local.tm_mon, &local.tm_mday, &sep,
+               &local.tm_hour, &local.tm_min) == 6 && (sep == 'T' || sep == ' ')){
+        local.tm_year -= 1900;
+        local.tm_mon -= 1;
+        local.tm_isdst = -1;
+        time_t when = mktime(&local);
+        if (when == (time_t)-1){
             return -1;
         }
-        printf("Envié log.JSON\n\n");
+        *_ns = (int64_t)when * 1000000000LL;
+        return 0;
     }
-    if (strstr(buff_com, "GET /favicon.ico HTTP/1.1") != NULL)  //Innecesario. YA coloqué un .ico vació en HTML
-    {
-        if (SendIco(_client_id, ICO_FILE) < 0)
-        {
-            printf("Error mandando el Icono\n");
-            shmdt(valid_keys);
-            shmdt(log);
+
+    long long seconds = strtoll(_value, &end, 10);
+    if (end == _value || *end != '\0' || seconds <= 0 || seconds > INT64_MAX / 1000000000LL){
+        return -1;
+    }
+    *_ns = (int64_t)seconds * 1000000000LL;
+    return 0;
+}
+
+/**
+ * \fn int GetRuleFromHTML(const char* _text, size_t _len, KeyRule_t* _rule)
+ * \brief Obtiene la validez de una clave del cuerpo JSON o de la query.
+ * \details Parámetros (todos opcionales): "desde" y "hasta" (ver ParseRuleTime()), "dias" ("lun,mar,mie,jue,vie,sab,dom"),
+ * "horario" ("08:00-18:00", puede cruzar la medianoche) y "unico" (1/true: se borra al usarla).
+ * Sin parámetros la regla queda en cero (clave permanente).
+ * \param [in] _text: Cuerpo o línea de pedido.
+ * \param [in] _len: Largo del texto.
+ * \param [out] _rule: Regla leída.
+ * \return Devuelve -1 si algún parámetro es inválido. 0 sino.
+*/
+int GetRuleFromHTML(const char* _text, size_t _len, KeyRule_t* _rule)
+{
+    static const char* const days[7] = { "dom", "lun", "mar", "mie", "jue", "vie", "sab" };
+    char value[64];
+
+    memset(_rule, 0, sizeof(KeyRule_t));
+    if (GetParam(_text, _len, "desde", value, sizeof(value)) >= 0 && ParseRuleTime(value, &_rule->start_ns) < 0){
+        return -1;
+    }
+    if (GetParam(_text, _len, "hasta", value, sizeof(value)) >= 0 && ParseRuleTime(value, &_rule->end_ns) < 0){
+        return -1;
+    }
+    if (_rule->end_ns != 0 && _rule->end_ns <= _rule->start_ns){
+        return -1;
+    }
+    if (GetParam(_text, _len, "dias", value, sizeof(value)) >= 0){
+        char* save;
+        for (char* day = strtok_r(value, ",", &save); day != NULL; day = strtok_r(NULL, ",", &save)){
+            int found = -1;
+            for (int d = 0; d < 7; d++){
+                if (strcmp(day, days[d]) == 0){
+                    found = d;
+                }
+            }
+            if (found < 0){
+                return -1;
+            }
+            _rule->weekdays |= (uint8_t)(1 << found);
+        }
+    }
+    if (GetParam(_text, _len, "horario", value, sizeof(value)) >= 0){
+        int h1, m1, h2, m2;
+        char extra;
+        if (sscanf(value, "%2d:%2d-%2d:%2d%c", &h1, &m1, &h2, &m2, &extra) != 4
+            || h1 < 0 || h1 > 23 || m1 < 0 || m1 > 59 || h2 < 0 || h2 > 24 || m2 < 0 || m2 > 59
+            || h2 * 60 + m2 > RULE_ALL_DAY){
             return -1;
         }
-        printf("Se envió el icono\n");
+        _rule->from_min = (uint16_t)(h1 * 60 + m1);
+        _rule->to_min = (uint16_t)((h2 * 60 + m2) % RULE_ALL_DAY);
     }
-    if (strstr(buff_com, "GET / HTTP/1.1") != 0)
-    {
-        printf("Envio HTML\n");
-        if (SendHTML(_client_id, PAGINA_HTML) < 0){
-            printf("Error mandando el HTML\n");
-            shmdt(valid_keys);
-            shmdt(log);
+    if (GetParam(_text, _len, "unico", value, sizeof(value)) >= 0){
+        if (strcmp(value, "1") == 0 || strcmp(value, "true") == 0){
+            _rule->flags |= RULE_ONE_TIME;
+        }
+        else if (strcmp(value, "0") != 0 && strcmp(value, "false") != 0){
             return -1;
         }
-        printf("Se envió el HTML\n");
     }
-    shmdt(valid_keys);
-    shmdt(log);
     return 0;
-    // Si get -> Envío la pantalla html (log actualizado)
-    // Si post -> recibo claves/borro clave y envío la pantalla html
 }
 
 /**
- * \fn int GetKeyFromHTML(char* _buff, KeyEntry_t* _key)
- * \brief Obtiene la KEY del mensaje HTML recibido.
- * \details Obtiene la KEY del mensaje HTML recibido.
- * \param [in] _buff: Mensaje HTML recibido.
- * \param [in] _key: Puntero a KEY leída.
+ * \fn int ImportKeys(Connection_t* _conn, Doors_t* _doors, int _door)
+ * \brief Atiende POST /claves/bulk.
+ * \details Valida el lote completo, lo guarda con una sola toma del semáforo y prende el LED una sola vez.
+ * Con "?modo=reemplazar" el lote reemplaza a todas las claves.
+ * \param [in] _conn: Conexión con el pedido completo.
+ * \param [in] _doors: Puertas.
+ * \param [in] _door: Puerta cuyas claves se cargan, o DOOR_GLOBAL.
  * \return Devuelve -1 si error. 0 sino.
 */
-int GetKeyFromHTML(char* _buff, KeyEntry_t* _key)
+int ImportKeys(Connection_t* _conn, Doors_t* _doors, int _door)
 {
-    const char* aux = strstr(_buff, "{\"clave\":\"");
-    if(aux == NULL){
+    char answer[128];
+    int bad = 0;
+    int sem_k;
+    KeyRule_t rule;
+    KeyShard_t* valid_keys = DoorKeys(_doors, _door, &sem_k);
+    const char* line_end = strchr(_conn->buff, '\n');
+    int replace = (line_end != NULL && strstr(_conn->buff, "modo=reemplazar") != NULL
+                   && strstr(_conn->buff, "modo=reemplazar") < line_end);
+
+    // La validez del lote va en la línea de pedido: ?hasta=+2h&unico=1
+    size_t line_len = line_end ? (size_t)(line_end - _conn->buff) : strlen(_conn->buff);
+    if (GetRuleFromHTML(_conn->buff, line_len, &rule) < 0){
+        return SendResponse(_conn->fd, "400 Bad Request", "application/json", "{\"error\":\"regla invalida\"}", strlen("{\"error\":\"regla invalida\"}"));
+    }
+
+    KeyEntry_t* keys = (KeyEntry_t*)BufGet(sizeof(KeyEntry_t) * MAX_VALID_KEYS);
+    if (!keys){
+        return -1;
+    }
+    int count = ParseKeyList(_conn->buff + _conn->header_len, _conn->content_length, keys, MAX_VALID_KEYS, &bad);
+    if (count < 0){
+        BufPut(keys);
+        int len = snprintf(answer, sizeof(answer), "{\"error\":\"clave invalida\",\"posicion\":%d}", bad);
+        return SendResponse(_conn->fd, "400 Bad Request", "application/json", answer, len);
+    }
+
+    // Cambio y journal con el mismo semáforo tomado: el journal queda en el orden de los cambios.
+    if (lockSem(sem_k) == -1){
+        BufPut(keys);
+        return -1;
+    }
+    int added = AddKeysBulk(keys, count, replace, &rule, valid_keys, SEM_HELD);
+    if (added >= 0 && JournalBulk(keys, count, replace, &rule, _door) < 0){
+        perror("Error al escribir el journal");
+    }
+    if (unlockSem(sem_k) == -1){
+        added = -1;
+    }
+    BufPut(keys);
+    if (added == -2){
+        int len = snprintf(answer, sizeof(answer), "{\"error\":\"sin lugar\",\"maximo\":%d}", MAX_VALID_KEYS);
+        return SendResponse(_conn->fd, "507 Insufficient Storage", "application/json", answer, len);
+    }
+    if (added < 0){
+        return -1;
+    }
+
+    if (added > 0 || replace){      // Un solo aviso por lote
+        driver_msg_t driver_msg;
+        driver_msg.command = ORANGE_LED;
+        driver_msg.dec_ms = 200;
+        if (DoorsNotify(_doors, _door, driver_msg) == -1){
+            return -1;
+        }
+    }
+
+    int len = snprintf(answer, sizeof(answer), "{\"recibidas\":%d,\"agregadas\":%d,\"reemplazo\":%s}",
+                       count, added, replace ? "true" : "false");
+    return SendResponse(_conn->fd, "200 OK", "application/json", answer, len);
+}
+
+/**
+ * \fn int SendResponse(int _client_id, const char* _status, const char* _type, const char* _body, size_t _len)
+ * \brief Envía una respuesta HTTP completa con un cuerpo corto.
+ * \param [in] _client_id: ID del cliente a enviar.
+ * \param [in] _status: Línea de estado ("200 OK").
+ * \param [in] _type: Content-Type del cuerpo.
+ * \param [in] _body: Cuerpo de la respuesta.
+ * \param [in] _len: Largo del cuerpo.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+int SendResponse(int _client_id, const char* _status, const char* _type, const char* _body, size_t _len)
+{
+    char header[200];
+    int header_len = snprintf(header, sizeof(header),
+            "HTTP/1.1 %s\n"
+            "Content-Length: %zu\n"
+            "Content-Type: %s; charset=utf-8\n"
+            "Connection: Closed\n\n",
+            _status, _len, _type);
+
+    if (ConnSend(_client_id, header, header_len, MSG_NOSIGNAL) != header_len){
         return -1;
     }
-    strncpy(_key->value, (aux + 10), KEY_SIZE);
-    _key->value[KEY_SIZE] = '\0';
+    size_t sent = 0;
+    while (sent < _len){
+        int aux = ConnSend(_client_id, _body + sent, _len - sent, MSG_NOSIGNAL);
+        if (aux <= 0){
+            return -1;
+        }
+        sent += aux;
+    }
     return 0;
 }
 
@@ -185,14 +510,14 @@ int SendHTML(int _client_id, char* _html_file)
     long file_size = ftell(file);
     rewind(file);
 
-    char* buff_file = (char*)malloc(sizeof(char)*file_size + 1);
+    char* buff_file = (char*)BufGet(sizeof(char)*file_size + 1);
     if(!buff_file){
         fclose(file);
         return -1;
     }
-    char* buff_com = (char*)malloc(sizeof(char)*(file_size+110));
+    char* buff_com = (char*)BufGet(sizeof(char)*(file_size+110));
     if(!buff_com){
-        free(buff_file);
+        BufPut(buff_file);
         fclose(file);
         return -1;
     }
@@ -214,20 +539,85 @@ int SendHTML(int _client_id, char* _html_file)
     int sent = 0;
     while (sent < lenght)
     {
-        int aux = send(_client_id, buff_com + sent, lenght - sent, 0);
+        int aux = ConnSend(_client_id, buff_com + sent, lenght - sent, 0);
         if (aux <= 0){
-            free(buff_file);
-            free(buff_com);
+            BufPut(buff_file);
+            BufPut(buff_com);
             return -1;
         }
         sent += aux;
     }
 
-    free(buff_com);
-    free(buff_file);
+    BufPut(buff_com);
+    BufPut(buff_file);
     return 0;
 }
 
+/**
+ * \fn int SendPage(Connection_t* _conn, const Doors_t* _doors, int _door, KeyShard_t* _keys, int _sem_k)
+ * \brief Envía la página cargada por ClientInit() con las claves y el log actuales en lugar de PAGE_PLACEHOLDER.
+ * \details Los datos ({"claves":[...],"log":[...]}) van entre las dos mitades de la página, que no se copian:
+ * encabezado, primera mitad, datos y segunda mitad salen con una sola ConnWriteVec(). Así la página se muestra
+ * completa con un solo pedido y /claves y /log quedan para las actualizaciones.
+ * \param [in] _conn: Conexión del cliente.
+ * \param [in] _doors: Puertas.
+ * \param [in] _door: Puerta del log, o DOOR_GLOBAL.
+ * \param [in] _keys: Claves a incluir.
+ * \param [in] _sem_k: Semáforo de _keys.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+int SendPage(Connection_t* _conn, const Doors_t* _doors, int _door, KeyShard_t* _keys, int _sem_k)
+{
+    char header[200];
+    int pos = 0;
+
+    if (page == NULL){
+        return SendHTML(_conn->fd, PAGINA_HTML);
+    }
+    int doors_count = (_door == DOOR_GLOBAL) ? _doors->count : 1;
+    size_t size = 32 + MAX_VALID_KEYS * 7 + 3 + (size_t)doors_count * MAX_LOG * LOG_ENTRY_JSON + 3;
+    char* data = (char*)BufGet(size);
+    if (!data){
+        return -1;
+    }
+    size_t tail = page_len;
+    if (page_split < page_len){
+        tail = page_split + strlen(PAGE_PLACEHOLDER);
+        pos += sprintf(data, "{\"claves\":");
+        int len = KeysJson(data + pos, _keys, _sem_k);
+        if (len < 0){
+            BufPut(data);
+            return -1;
+        }
+        pos += len;
+        pos += sprintf(data + pos, ",\"log\":");
+        len = LogJson(data + pos, size - pos, _doors, _door);
+        if (len < 0){
+            BufPut(data);
+            return -1;
+        }
+        pos += len;
+        data[pos++] = '}';
+    }
+
+    int header_len = snprintf(header, sizeof(header),
+            "HTTP/1.1 200 OK\r\n"
+            "Content-Length: %zu\r\n"
+            "Content-Type: text/html; charset=utf-8\r\n"
+            "Cache-Control: no-store\r\n"
+            "Connection: close\r\n\r\n",
+            page_split + pos + (page_len - tail));
+    struct iovec iov[4] = {
+        { header, header_len },
+        { page, page_split },
+        { data, pos },
+        { page + tail, page_len - tail },
+    };
+    int ret = ConnWriteVec(_conn, iov, 4);
+    BufPut(data);
+    return ret;
+}
+
 /**
  * \fn int SendIco(int _client_id, char* _ico_file)
  * \brief Envía el icono indicado.
@@ -247,14 +637,14 @@ int SendIco(int _client_id, char* _ico_file)
     long file_size = ftell(file);
     rewind(file);
 
-    char* buff_file = (char*)malloc(sizeof(char)*file_size + 1);
+    char* buff_file = (char*)BufGet(sizeof(char)*file_size + 1);
     if(!buff_file){
         fclose(file);
         return -1;
     }
-    char* buff_com = (char*)malloc(sizeof(char)*(file_size+110));
+    char* buff_com = (char*)BufGet(sizeof(char)*(file_size+110));
     if(!buff_com){
-        free(buff_file);
+        BufPut(buff_file);
         fclose(file);
         return -1;
     }
@@ -275,22 +665,22 @@ int SendIco(int _client_id, char* _ico_file)
     int lenght = strlen(buff_com);
     int sent = 0;
     while (sent < lenght){
-        int aux = send(_client_id, buff_com + sent, lenght - sent, 0);
+        int aux = ConnSend(_client_id, buff_com + sent, lenght - sent, 0);
         if (aux <= 0){
-            free(buff_file);
-            free(buff_com);
+            BufPut(buff_file);
+            BufPut(buff_com);
             return -1;
         }
         sent += aux;
     }
 
-    free(buff_com);
-    free(buff_file);
+    BufPut(buff_com);
+    BufPut(buff_file);
     return 0;
 }
 
 /**
- * \fn int SendValidKeys(int _client_id, KeyEntry_t* _valid_keys, int _semId)
+ * \fn int SendValidKeys(int _client_id, KeyShard_t* _valid_keys, int _semId)
  * \brief Envía las KEYs válidas al servidor HTML.
  * \details Envía las KEYs válidas al servidor HTML.
  * \param [in] _client_id: ID del cliente a enviar.
@@ -298,46 +688,24 @@ int SendIco(int _client_id, char* _ico_file)
  * \param [in] _semId: Id del semáforo de _valid_keys.
  * \return Devuelve -1 si error. 0 sino.
 */
-int SendValidKeys(int _client_id, KeyEntry_t* _valid_keys, int _semId)
+int SendValidKeys(int _client_id, KeyShard_t* _valid_keys, int _semId)
 {
-    int pos = 1;
     int file_size;
 
-    if (lockSem(_semId) == -1){
-        return -1;
-    }
-
-    char* buff_file = (char*)malloc((sizeof(char)*MAX_VALID_KEYS*7+2));
+    char* buff_file = (char*)BufGet((sizeof(char)*MAX_VALID_KEYS*7+3));
     if(!buff_file){
-        unlockSem(_semId);
         return -1;
     }
-
-    buff_file[0] = '[';
-    buff_file[1] = '\0';
-    for (int i = 0; i < MAX_VALID_KEYS; i++){
-        if (_valid_keys[i].value[0] == '\0'){  
-            break;
-        }
-        pos += sprintf(buff_file + pos, "\"%s\"", _valid_keys[i].value);
-        if (i < (MAX_VALID_KEYS-1)){ //Si no estoy en el último posible
-            if (_valid_keys[i+1].value[0] != '\0'){  //Si el que sigue existe
-                pos += sprintf(buff_file + pos, ",");
-            }
-        }
-    }
-    sprintf(buff_file + pos, "]");
-    file_size = strlen(buff_file);
-    printf("Envio: %s", buff_file);
-
-    if(unlockSem(_semId) < 0){
-        free(buff_file);
+    file_size = KeysJson(buff_file, _valid_keys, _semId);
+    if (file_size < 0){
+        BufPut(buff_file);
         return -1;
     }
+    printf("Envio: claves, %d bytes\n", file_size);
 
-    char* buff_com = (char*)malloc(sizeof(char)*(file_size+115));
+    char* buff_com = (char*)BufGet(sizeof(char)*(file_size+115));
     if(!buff_com){
-        free(buff_file);
+        BufPut(buff_file);
         return -1;
     }
 
@@ -353,101 +721,936 @@ int SendValidKeys(int _client_id, KeyEntry_t* _valid_keys, int _semId)
     int lenght = strlen(buff_com);
     int sent = 0;
     while (sent < lenght){
-        int aux = send(_client_id, buff_com + sent, lenght - sent, 0);
+        int aux = ConnSend(_client_id, buff_com + sent, lenght - sent, 0);
         if (aux <= 0){
-            free(buff_file);
-            free(buff_com);
+            BufPut(buff_file);
+            BufPut(buff_com);
             return -1;
         }
         sent += aux;
     }
 
-    free(buff_com);
-    free(buff_file);
+    BufPut(buff_com);
+    BufPut(buff_file);
     return 0;
 }
 
 /**
- * \fn int SendLog(int _client_id, ActivityEntry_t* _log, int _semId)
- * \brief Envía el log al servidor HTML.
- * \details Envía el log al servidor HTML.
+ * \fn int SendKeysExport(int _client_id, KeyShard_t* _valid_keys, int _semId)
+ * \brief Envía todas las KEYs válidas en CSV, una por línea.
+ * \details El formato es el mismo que acepta POST /claves/bulk.
  * \param [in] _client_id: ID del cliente a enviar.
- * \param [in] _log: Log/Lista de actividades a enviar.
- * \param [in] _semId: Id del semárofo de _log.
+ * \param [in] _valid_keys: Lista de valid KEYs.
+ * \param [in] _semId: Id del semáforo de _valid_keys.
  * \return Devuelve -1 si error. 0 sino.
 */
-int SendLog(int _client_id, ActivityEntry_t* _log, int _semId)
+int SendKeysExport(int _client_id, KeyShard_t* _valid_keys, int _semId)
 {
-    int pos = 1;
-    int file_size;
+    int pos = 0;
 
+    char* buff_file = (char*)BufGet(sizeof(char) * MAX_VALID_KEYS * (KEY_SIZE + 1) + 1);
+    if (!buff_file){
+        return -1;
+    }
     if (lockSem(_semId) == -1){
+        BufPut(buff_file);
         return -1;
     }
-    char* buff_file = (char*)malloc((sizeof(char)*MAX_LOG*75+3));    //CAMBIAR
-    if(!buff_file){
-        unlockSem(_semId);
+    for (int i = 0; i < MAX_VALID_KEYS && _valid_keys->keys[i].code != KEY_EMPTY; i++){
+        KeyToString(_valid_keys->keys[i], buff_file + pos);
+        pos += KEY_SIZE;
+        buff_file[pos++] = '\n';
+    }
+    if (unlockSem(_semId) == -1){
+        BufPut(buff_file);
         return -1;
     }
-    buff_file[0] = '[';
-    buff_file[1] = '\0';
-    for (int i = 0; i < MAX_LOG; i++){
-        if (_log[i].code[0] == '\0'){  //Terminé la lista
-            break;
+
+    int ret = SendResponse(_client_id, "200 OK", "text/csv", buff_file, pos);
+    BufPut(buff_file);
+    return ret;
+}
+
+/**
+ * \fn int SendKeyRules(int _client_id, KeyShard_t* _valid_keys, int _semId)
+ * \brief Envía las KEYs que tienen alguna restricción, con su validez.
+ * \details [{"clave":"1234","desde":"2026-10-19T08:00","hasta":"...","dias":"lun,mar","horario":"08:00-18:00","unico":true}].
+ * Los campos sin restricción no se envían. Las claves permanentes no aparecen.
+ * \param [in] _client_id: ID del cliente a enviar.
+ * \param [in] _valid_keys: Lista de valid KEYs.
+ * \param [in] _semId: Id del semáforo de _valid_keys.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+int SendKeyRules(int _client_id, KeyShard_t* _valid_keys, int _semId)
+{
+    static const char* const days[7] = { "dom", "lun", "mar", "mie", "jue", "vie", "sab" };
+    const size_t entry_max = 160;
+    size_t pos = 0;
+    char code[KEY_SIZE + 1];
+
+    char* buff_file = (char*)BufGet(entry_max * MAX_VALID_KEYS + 3);
+    if (!buff_file){
+        return -1;
+    }
+    if (lockSem(_semId) == -1){
+        BufPut(buff_file);
+        return -1;
+    }
+    buff_file[pos++] = '[';
+    for (int i = 0; i < MAX_VALID_KEYS && _valid_keys->keys[i].code != KEY_EMPTY; i++){
+        const KeyRule_t* rule = &_valid_keys->rules[i];
+        if (rule->start_ns == 0 && rule->end_ns == 0 && rule->weekdays == 0
+            && rule->from_min == rule->to_min && rule->flags == 0){
+            continue;
+        }
+        if (pos > 1){
+            buff_file[pos++] = ',';
         }
-        char date[11]; // "YYYY/MM/DD\0"
-        snprintf(date, sizeof(date), "%.4s/%.2s/%.2s",
-                 _log[i].date, _log[i].date + 4, _log[i].date + 6);
-        char time[9]; // "HH:MM:SS\0"
-        snprintf(time, sizeof(time), "%.2s:%.2s:%.2s",
-                 _log[i].time, _log[i].time + 2, _log[i].time + 4);
-
-        pos += sprintf(buff_file + pos,
-            "{\"fecha\":\"%s\",\"hora\":\"%s\",\"clave\":\"%s\",\"estado\":\"%d\"}",
-            date, time, _log[i].code, _log[i].status);
-        if ((i+1) < MAX_LOG ){  //Si no es el último posible
-            if (_log[i+1].code[0] != '\0'){  //Si el que le sigue existe
-                pos += sprintf(buff_file + pos, ",");
+        pos += sprintf(buff_file + pos, "{\"clave\":\"%s\"", KeyToString(_valid_keys->keys[i], code));
+        int64_t limits[2] = { rule->start_ns, rule->end_ns };
+        const char* names[2] = { "desde", "hasta" };
+        for (int l = 0; l < 2; l++){
+            if (limits[l] == 0){
+                continue;
             }
+            time_t when = (time_t)(limits[l] / 1000000000LL);
+            struct tm local;
+            localtime_r(&when, &local);
+            pos += sprintf(buff_file + pos, ",\"%s\":\"", names[l]);
+            pos += strftime(buff_file + pos, 20, "%Y-%m-%dT%H:%M", &local);
+            buff_file[pos++] = '"';
+        }
+        if (rule->weekdays != 0){
+            pos += sprintf(buff_file + pos, ",\"dias\":\"");
+            int first = 1;
+            for (int d = 0; d < 7; d++){
+                if (rule->weekdays & (1 << d)){
+                    pos += sprintf(buff_file + pos, "%s%s", first ? "" : ",", days[d]);
+                    first = 0;
+                }
+            }
+            buff_file[pos++] = '"';
+        }
+        if (rule->from_min != rule->to_min){
+            pos += sprintf(buff_file + pos, ",\"horario\":\"%02d:%02d-%02d:%02d\"", rule->from_min / 60, rule->from_min % 60,
+                           rule->to_min / 60, rule->to_min % 60);
+        }
+        if (rule->flags & RULE_ONE_TIME){
+            pos += sprintf(buff_file + pos, ",\"unico\":true");
         }
+        buff_file[pos++] = '}';
     }
-    sprintf(buff_file + pos, "]");
-    printf("Envio: %s", buff_file);
-    file_size = strlen(buff_file);
+    buff_file[pos++] = ']';
+    if (unlockSem(_semId) == -1){
+        BufPut(buff_file);
+        return -1;
+    }
+
+    int ret = SendResponse(_client_id, "200 OK", "application/json", buff_file, pos);
+    BufPut(buff_file);
+    return ret;
+}
+
+/**
+ * \fn int SendLog(Connection_t* _conn, const Doors_t* _doors, int _door)
+ * \brief Envía el log al servidor HTML.
+ * \details Envía el log de una puerta, o el de todas una detrás de otra si _door es DOOR_GLOBAL.
+ * La respuesta es chunked: se copian LOG_BATCH entradas con el semáforo del log, se suelta y se envían mientras
+ * se copian las siguientes. La memoria usada no depende del largo del log y un cliente lento no frena al lector
+ * de la puerta. Las entradas solo se agregan al final, así que entre tandas no se saltean ni se repiten.
+ * \param [in] _conn: Conexión del cliente.
+ * \param [in] _doors: Puertas.
+ * \param [in] _door: Puerta o DOOR_GLOBAL.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+int SendLog(Connection_t* _conn, const Doors_t* _doors, int _door)
+{
+    ChunkWriter_t writer;
+    ActivityEntry_t batch[LOG_BATCH];
+    int entries = 0;
 
-    if(unlockSem(_semId) == -1){
-        free(buff_file);
+    int first = (_door == DOOR_GLOBAL) ? 0 : _door;
+    int last = (_door == DOOR_GLOBAL) ? _doors->count : _door + 1;
+
+    if (ConnChunkBegin(&writer, _conn, "200 OK", "application/json") < 0){
         return -1;
     }
+    ConnChunkWrite(&writer, "[", 1);
+    for (int d = first; d < last; d++){
+        int count = LOG_BATCH;
 
-    char* buff_com = (char*)malloc(sizeof(char)*(file_size+120));
-    if(!buff_com){
-        free(buff_file);
+        for (int start = 0; start < MAX_LOG && count == LOG_BATCH; start += LOG_BATCH){
+            count = LogBatch(&_doors->door[d], start, batch);
+            if (count < 0){
+                return -1;
+            }
+            for (int i = 0; i < count; i++){
+                char entry[LOG_ENTRY_JSON];
+                int len = LogEntryJson(entry, sizeof(entry), &batch[i], d, entries > 0);
+                if (ConnChunkWrite(&writer, entry, len) < 0){
+                    return -1;
+                }
+                entries++;
+            }
+        }
+    }
+    ConnChunkWrite(&writer, "]", 1);
+    if (ConnChunkEnd(&writer) < 0){
         return -1;
     }
+    printf("Envio: %d entradas en %d bloques\n", entries, writer.chunks);
+    return 0;
+}
 
-    sprintf(buff_com,
-            "HTTP/1.1 200 OK\n"
-            "Content-Length: %d\n"
-            "Content-Type: application/json; charset=utf-8\n"
-            "Connection: Closed\n\n"
-            "%s",
-            file_size, buff_file);
+/**
+ * \fn int SendLogQuery(Connection_t* _conn, const Doors_t* _doors, int _door, const LogQuery_t* _query)
+ * \brief Envía las entradas del log que cumplen una consulta, de la más nueva a la más vieja.
+ * \details Usa el índice de cada puerta (LogFind()): recorre solo las entradas de la clave o del estado pedido.
+ * Igual que SendLog() es chunked y toma el semáforo de a LOG_BATCH entradas.
+ * \param [in] _conn: Conexión del cliente.
+ * \param [in] _doors: Puertas.
+ * \param [in] _door: Puerta o DOOR_GLOBAL.
+ * \param [in] _query: Consulta con clave o estado.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+int SendLogQuery(Connection_t* _conn, const Doors_t* _doors, int _door, const LogQuery_t* _query)
+{
+    ChunkWriter_t writer;
+    ActivityEntry_t batch[LOG_BATCH];
+    int entries = 0;
 
-    // Envia el mensaje al cliente
-    int lenght = strlen(buff_com);
-    int sent = 0;
-    while (sent < lenght){
-        int aux = send(_client_id, buff_com + sent, lenght - sent, 0);
-        if (aux <= 0){
-            free(buff_file);
-            free(buff_com);
+    int first = (_door == DOOR_GLOBAL) ? 0 : _door;
+    int last = (_door == DOOR_GLOBAL) ? _doors->count : _door + 1;
+
+    if (ConnChunkBegin(&writer, _conn, "200 OK", "application/json") < 0){
+        return -1;
+    }
+    ConnChunkWrite(&writer, "[", 1);
+    for (int d = first; d < last; d++){
+        const Door_t* door = &_doors->door[d];
+        LogQuery_t query = *_query;     // Cada puerta recorre su propia cadena
+        int count;
+
+        while ((count = LogFind(door->log, door->log_index, door->sem_l, &query, batch, LOG_BATCH)) > 0){
+            for (int i = 0; i < count; i++){
+                char entry[LOG_ENTRY_JSON];
+                int len = LogEntryJson(entry, sizeof(entry), &batch[i], d, entries > 0);
+                if (ConnChunkWrite(&writer, entry, len) < 0){
+                    return -1;
+                }
+                entries++;
+            }
+        }
+        if (count < 0){
             return -1;
         }
-        sent += aux;
     }
-
-    free(buff_com);
-    free(buff_file);
+    ConnChunkWrite(&writer, "]", 1);
+    if (ConnChunkEnd(&writer) < 0){
+        return -1;
+    }
+    printf("Envio: %d entradas filtradas en %d bloques\n", entries, writer.chunks);
     return 0;
 }
+
+/**
+ * \fn int SendStats(Connection_t* _conn, int _door, int _hours, int _days)
+ * \brief Envía los intentos aceptados y rechazados por hora, por día y por clave.
+ * \details Los valores ya están contados (stats.c): no se recorre el log. La respuesta es chunked porque la lista de
+ * claves puede ser larga.
+ * \param [in] _conn: Conexión del cliente.
+ * \param [in] _door: Puerta o DOOR_GLOBAL. Las claves son siempre de todas las puertas.
+ * \param [in] _hours: Horas (validadas con StatsWindow()).
+ * \param [in] _days: Días (validados con StatsWindow()).
+ * \return Devuelve -1 si error. 0 sino.
+*/
+int SendStats(Connection_t* _conn, int _door, int _hours, int _days)
+{
+    ChunkWriter_t writer;
+    StatsBucket_t buckets[STATS_HOURS_MAX];
+    StatsKey_t keys[STATS_BATCH];
+    StatsCursor_t cursor = { .days = _days, .word = 0 };
+    char item[LOG_ENTRY_JSON];
+    int count;
+    int len;
+
+    if (ConnChunkBegin(&writer, _conn, "200 OK", "application/json") < 0){
+        return -1;
+    }
+    ConnChunkWrite(&writer, "{\"horas\":[", strlen("{\"horas\":["));
+    count = StatsHours(_door, _hours, buckets);
+    for (int i = 0; i < count; i++){
+        const TimeCache_t* when = TimeFormat(buckets[i].start_ns);
+        len = snprintf(item, sizeof(item), "%s{\"fecha\":\"%s\",\"hora\":\"%.5s\",\"aceptadas\":%u,\"rechazadas\":%u}",
+                       i > 0 ? "," : "", when->date, when->hour, buckets[i].count.accepted, buckets[i].count.denied);
+        ConnChunkWrite(&writer, item, len);
+    }
+    ConnChunkWrite(&writer, "],\"dias\":[", strlen("],\"dias\":["));
+    count = StatsDays(_door, _days, buckets);
+    for (int i = 0; i < count; i++){
+        const TimeCache_t* when = TimeFormat(buckets[i].start_ns);
+        len = snprintf(item, sizeof(item), "%s{\"fecha\":\"%s\",\"aceptadas\":%u,\"rechazadas\":%u}",
+                       i > 0 ? "," : "", when->date, buckets[i].count.accepted, buckets[i].count.denied);
+        ConnChunkWrite(&writer, item, len);
+    }
+    ConnChunkWrite(&writer, "],\"claves\":[", strlen("],\"claves\":["));
+    int sent = 0;
+    while ((count = StatsKeys(&cursor, keys, STATS_BATCH)) > 0){
+        for (int i = 0; i < count; i++){
+            KeyEntry_t key = { .code = keys[i].code };
+            char code[KEY_SIZE + 1];
+            len = snprintf(item, sizeof(item), "%s{\"clave\":\"%s\",\"aceptadas\":%u,\"rechazadas\":%u}",
+                           sent++ > 0 ? "," : "", KeyToString(key, code), keys[i].count.accepted, keys[i].count.denied);
+            if (ConnChunkWrite(&writer, item, len) < 0){
+                return -1;
+            }
+        }
+    }
+    ConnChunkWrite(&writer, "]}", 2);
+    if (ConnChunkEnd(&writer) < 0){
+        return -1;
+    }
+    printf("Envio: estadísticas de %d horas, %d días y %d claves\n", _hours, _days, sent);
+    return 0;
+}
+
+/**
+ * \fn int SendMetrics(Connection_t* _conn, const Doors_t* _doors)
+ * \brief Envía las estadísticas del servidor en formato de texto de Prometheus.
+ * \details La respuesta es chunked: cada sección (buffers, workers, actuadores, hijos, TLS y log) se escribe en un
+ * buffer de METRICS_SECTION y se envía como un bloque, así el largo total no depende de MAX_DOORS.
+ * Si una sección no entra no se la corta: si es la primera se responde 500, si no se corta la respuesta sin el
+ * bloque final y el cliente ve el cuerpo incompleto.
+ * \param [in] _conn: Conexión del cliente.
+ * \param [in] _doors: Puertas.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+int SendMetrics(Connection_t* _conn, const Doors_t* _doors)
+{
+    ChunkWriter_t writer;
+    int ret = 0;
+
+    char* section = (char*)BufGet(METRICS_SECTION);
+    if (!section){
+        return -1;
+    }
+    for (int s = 0; s < METRICS_SECTIONS && ret == 0; s++){
+        int len = -1;
+        switch (s){
+            case 0: len = BufPoolMetrics(section, METRICS_SECTION); break;
+            case 1: len = WorkersMetrics(section, METRICS_SECTION); break;
+            case 2: len = ActuatorMetrics(section, METRICS_SECTION, _doors->count); break;
+            case 3: len = ChildrenMetrics(section, METRICS_SECTION); break;
+            case 4: len = TlsMetrics(section, METRICS_SECTION); break;
+            case 5: len = LogMetrics(section, METRICS_SECTION, _doors); break;
+        }
+        if (len < 0){
+            printf("Métricas: la sección %d no entra en %d bytes\n", s, METRICS_SECTION);
+            if (s == 0){
+                SendResponse(_conn->fd, "500 Internal Server Error", "text/plain", "", 0);
+            }
+            ret = -1;
+        }
+        else if (s == 0 && ConnChunkBegin(&writer, _conn, "200 OK", "text/plain; version=0.0.4") < 0){
+            ret = -1;
+        }
+        else if (len > 0 && ConnChunkWrite(&writer, section, len) < 0){
+            ret = -1;
+        }
+    }
+    BufPut(section);
+    if (ret < 0 || ConnChunkEnd(&writer) < 0){
+        return -1;
+    }
+    return 0;
+}
+
+/***********************************************************************************************************************************
+ *** FUNCIONES PRIVADAS AL MODULO
+ **********************************************************************************************************************************/
+/**
+ * \fn static int ServeClient(int _client_id, Doors_t* _doors, const ConnLimits_t* _limits)
+ * \brief Lee el pedido del cliente y lo atiende con la ruta que corresponda.
+ * \details Sin TLS, un cliente que empieza con el prefacio de HTTP/2 o pide Upgrade: h2c sigue con HTTP/2 (si
+ * HTTP2 lo permite): cada stream se atiende con DispatchRequest(), igual que un pedido HTTP/1.1.
+ * Si llegó por un listener tls primero hace el handshake, dentro del deadline del pedido (REQUEST_TIMEOUT).
+ * \param [in] _client_id: ID del cliente.
+ * \param [in] _doors: Puertas.
+ * \param [in] _limits: Timeouts y tamaño máximo del pedido.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+static int ServeClient(int _client_id, Doors_t* _doors, const ConnLimits_t* _limits)
+{
+    Connection_t conn;
+    SSL* tls = NULL;
+
+    // Lectura de mensaje recibido (puede llegar en varias partes):
+    if (ConnInit(&conn, _client_id, _limits) < 0){
+        return -1;
+    }
+    // El handshake cuenta dentro del deadline del pedido:
+    if (_limits->tls){
+        tls = TlsAccept(_client_id, _limits->read_timeout_ms, &conn.deadline);
+        if (tls == NULL){
+            ConnFree(&conn);
+            return 0;
+        }
+    }
+    int status = ConnReadRequest(&conn);
+    if (status != CONN_OK){
+        printf("Pedido descartado (%d)\n", status);
+        ConnSendError(&conn, status);
+        ConnFree(&conn);
+        TlsClose(tls);
+        return (status == CONN_ERROR) ? -1 : 0;
+    }
+    printf("*-------------------------------------------\n"
+        "Recibido del cliente:\n\n%.30s\n"
+        "*-------------------------------------------\n", conn.buff);
+
+    int h2 = (_limits->h2c && !_limits->tls) ? H2Detect(&conn) : 0;
+    int ret = h2 ? H2Serve(&conn, h2, DispatchRequest, _doors) : DispatchRequest(&conn, _doors);
+    ConnFree(&conn);
+    TlsClose(tls);
+    return ret;
+}
+
+/**
+ * \fn static int DispatchRequest(Connection_t* _conn, void* _doors)
+ * \brief Atiende un pedido completo: prefijo de puerta, réplica de solo lectura, bloqueo del origen y ruta.
+ * \param [in] _conn: Conexión con el pedido (de HTTP/1.1 o armado desde un stream de HTTP/2).
+ * \param [in] _doors: Puertas (Doors_t).
+ * \return Devuelve -1 si error. 0 sino.
+*/
+static int DispatchRequest(Connection_t* _conn, void* _doors)
+{
+    Doors_t* doors = (Doors_t*)_doors;
+    int client_id = _conn->fd;
+    Request_t req;
+    HttpMethod_t method;
+
+    // ¿Pedido para una puerta? (/doors/<id>/...)
+    int door = TakeDoorPrefix(_conn, doors->count);
+    if (door == DOOR_NOT_FOUND){
+        return SendResponse(client_id, "404 Not Found", "application/json", "{\"error\":\"puerta inexistente\"}", strlen("{\"error\":\"puerta inexistente\"}"));
+    }
+
+    // Una réplica solo muestra lo que recibe de la primaria.
+    if (RouterParseMethod(_conn->buff, &method) < 0){
+        method = HTTP_METHODS;
+    }
+    if (doors->read_only && method == HTTP_POST){
+        return SendResponse(client_id, "403 Forbidden", "application/json", "{\"error\":\"replica de solo lectura\"}", strlen("{\"error\":\"replica de solo lectura\"}"));
+    }
+
+    // Un origen con demasiadas claves inválidas no puede modificar nada hasta que termine su bloqueo.
+    int wait_s = (method == HTTP_POST) ? LockoutSourceActive(client_id, TimeNowNs()) : 0;
+    if (wait_s > 0){
+        char body[80];
+        int len = snprintf(body, sizeof(body), "{\"error\":\"demasiados intentos\",\"reintentar\":%d}", wait_s);
+        return SendResponse(client_id, "429 Too Many Requests", "application/json", body, len);
+    }
+
+    // Análisis del mensaje recibido: una sola ruta por pedido.
+    req.client_id = client_id;
+    req.conn = _conn;
+    req.doors = doors;
+    req.door = door;
+    req.keys = DoorKeys(doors, door, &req.sem_k);
+    return RouterDispatch(&router, &req);
+}
+
+/**
+ * \fn static int RouteAddKey(Request_t* _req)
+ * \brief POST /agregar: añade una clave válida (con su regla) y responde la lista.
+ * \param [in] _req: Pedido.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+static int RouteAddKey(Request_t* _req)
+{
+    KeyEntry_t key;
+    KeyRule_t rule;
+    driver_msg_t driver_msg;
+    driver_msg.command = ORANGE_LED;
+    driver_msg.dec_ms = 200;
+
+    if (GetKeyFromHTML(_req->conn->buff, &key) < 0){
+        return RouteError(_req, "400 Bad Request", "{\"error\":\"clave invalida\"}");
+    }
+    if (GetRuleFromHTML(_req->conn->buff + _req->conn->header_len, _req->conn->content_length, &rule) < 0){
+        return RouteError(_req, "400 Bad Request", "{\"error\":\"regla invalida\"}");
+    }
+    // Cambio y journal con el mismo semáforo tomado: el journal queda en el orden de los cambios.
+    if (lockSem(_req->sem_k) == -1){
+        return -1;
+    }
+    int new_key = AddKey(key, &rule, _req->keys, SEM_HELD);
+    if (new_key < 0)
+        printf("No pude añadir la KEY");
+    else if (JournalKey(REPL_KEY_ADD, _req->door, key, &rule, TimeNowNs()) < 0)
+        perror("Error al escribir el journal");
+    if (unlockSem(_req->sem_k) == -1){
+        return -1;
+    }
+
+    if (new_key > 0)
+    {
+        if (DoorsNotify(_req->doors, _req->door, driver_msg) == -1){
+            return -1;
+        }
+    }
+    printf("Añadi la KEY: %04u.\n", key.code);
+
+    if (SendValidKeys(_req->client_id, _req->keys, _req->sem_k) < 0){
+        return -1;
+    }
+    printf("Envié keys.JSON\n\n");
+    return 0;
+}
+
+/**
+ * \fn static int RouteDeleteKey(Request_t* _req)
+ * \brief POST /eliminar: borra una clave válida y responde la lista.
+ * \param [in] _req: Pedido.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+static int RouteDeleteKey(Request_t* _req)
+{
+    KeyEntry_t key;
+    driver_msg_t driver_msg;
+    driver_msg.command = ORANGE_LED;
+    driver_msg.dec_ms = 200;
+
+    if (GetKeyFromHTML(_req->conn->buff, &key) < 0){
+        return RouteError(_req, "400 Bad Request", "{\"error\":\"clave invalida\"}");
+    }
+    printf("Borré una KEY: %04u.\n", key.code);
+
+    if (lockSem(_req->sem_k) == -1){
+        return -1;
+    }
+    int new_key = DeleteKey(key, _req->keys, SEM_HELD);
+    if (new_key > 0 && JournalKey(REPL_KEY_DEL, _req->door, key, NULL, TimeNowNs()) < 0){
+        perror("Error al escribir el journal");
+    }
+    if (unlockSem(_req->sem_k) == -1){
+        return -1;
+    }
+    if (new_key == 0){      // Borrar claves que no existen es una forma de probarlas
+        SourceFailed(_req);
+    }
+    if (new_key > 0)
+    {
+        if (DoorsNotify(_req->doors, _req->door, driver_msg) == -1){
+            return -1;
+        }
+    }
+
+    if (SendValidKeys(_req->client_id, _req->keys, _req->sem_k) < 0){
+        return -1;
+    }
+    printf("Envié keys.JSON\n\n");
+    return 0;
+}
+
+/**
+ * \fn static int RouteBulk(Request_t* _req)
+ * \brief POST /claves/bulk: lote de claves (JSON o CSV).
+ * \param [in] _req: Pedido.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+static int RouteBulk(Request_t* _req)
+{
+    if (ImportKeys(_req->conn, _req->doors, _req->door) < 0){
+        return -1;
+    }
+    printf("Importé un lote de claves\n\n");
+    return 0;
+}
+
+/**
+ * \fn static int RouteExport(Request_t* _req)
+ * \brief GET /claves/export: todas las claves en CSV.
+ * \param [in] _req: Pedido.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+static int RouteExport(Request_t* _req)
+{
+    if (SendKeysExport(_req->client_id, _req->keys, _req->sem_k) < 0){
+        return -1;
+    }
+    printf("Envié keys.CSV\n\n");
+    return 0;
+}
+
+/**
+ * \fn static int RouteRules(Request_t* _req)
+ * \brief GET /claves/reglas: claves temporales con su validez.
+ * \param [in] _req: Pedido.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+static int RouteRules(Request_t* _req)
+{
+    if (SendKeyRules(_req->client_id, _req->keys, _req->sem_k) < 0){
+        return -1;
+    }
+    printf("Envié reglas.JSON\n\n");
+    return 0;
+}
+
+/**
+ * \fn static int RouteKeys(Request_t* _req)
+ * \brief GET /claves: tabla de claves.
+ * \param [in] _req: Pedido.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+static int RouteKeys(Request_t* _req)
+{
+    if (SendValidKeys(_req->client_id, _req->keys, _req->sem_k) < 0){
+        return -1;
+    }
+    printf("Envié keys.JSON\n\n");
+    return 0;
+}
+
+/**
+ * \fn static int RouteLog(Request_t* _req)
+ * \brief GET /log: tabla de historial.
+ * \details Con "?clave=1234" o "?estado=0" (y opcionalmente "desde", ver ParseRuleTime()) responde solo las
+ * entradas que cumplen, usando el índice del log.
+ * \param [in] _req: Pedido.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+static int RouteLog(Request_t* _req)
+{
+    LogQuery_t query;
+    int filtered = ParseLogQuery(_req, &query);
+
+    if (filtered < 0){
+        return RouteError(_req, "400 Bad Request", "{\"error\":\"filtro invalido\"}");
+    }
+    if (filtered > 0){
+        if (SendLogQuery(_req->conn, _req->doors, _req->door, &query) < 0){
+            return -1;
+        }
+        printf("Envié log.JSON filtrado\n\n");
+        return 0;
+    }
+    if (SendLog(_req->conn, _req->doors, _req->door) < 0){
+        return -1;
+    }
+    printf("Envié log.JSON\n\n");
+    return 0;
+}
+
+/**
+ * \fn static int RouteStats(Request_t* _req)
+ * \brief GET /stats: intentos aceptados y rechazados por hora, día y clave.
+ * \details "?horas=48&dias=30" cambia las ventanas (por defecto STATS_HOURS y STATS_DAYS).
+ * \param [in] _req: Pedido.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+static int RouteStats(Request_t* _req)
+{
+    char value[8];
+    char* end;
+    int hours = 0;
+    int days = 0;
+
+    if (RouteParam(_req, "horas", value, sizeof(value)) >= 0){
+        hours = (int)strtol(value, &end, 10);
+        if (end == value || *end != '\0' || hours <= 0){
+            hours = -1;
+        }
+    }
+    if (RouteParam(_req, "dias", value, sizeof(value)) >= 0){
+        days = (int)strtol(value, &end, 10);
+        if (end == value || *end != '\0' || days <= 0){
+            days = -1;
+        }
+    }
+    int ret = StatsWindow(&hours, &days);
+    if (ret == -2){
+        return RouteError(_req, "503 Service Unavailable", "{\"error\":\"sin estadisticas\"}");
+    }
+    if (ret < 0){
+        return RouteError(_req, "400 Bad Request", "{\"error\":\"ventana invalida\"}");
+    }
+    if (SendStats(_req->conn, _req->door, hours, days) < 0){
+        return -1;
+    }
+    printf("Envié stats.JSON\n\n");
+    return 0;
+}
+
+/**
+ * \fn static int RouteMetrics(Request_t* _req)
+ * \brief GET /metrics: estadísticas del servidor (texto de Prometheus).
+ * \param [in] _req: Pedido.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+static int RouteMetrics(Request_t* _req)
+{
+    if (SendMetrics(_req->conn, _req->doors) < 0){
+        return -1;
+    }
+    printf("Envié métricas\n\n");
+    return 0;
+}
+
+/**
+ * \fn static int RouteIco(Request_t* _req)
+ * \brief GET /favicon.ico: ícono del sitio.
+ * \param [in] _req: Pedido.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+static int RouteIco(Request_t* _req)
+{
+    if (SendIco(_req->client_id, ICO_FILE) < 0)
+    {
+        printf("Error mandando el Icono\n");
+        return -1;
+    }
+    printf("Se envió el icono\n");
+    return 0;
+}
+
+/**
+ * \fn static int RouteHTML(Request_t* _req)
+ * \brief GET /: la página.
+ * \param [in] _req: Pedido.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+static int RouteHTML(Request_t* _req)
+{
+    printf("Envio HTML\n");
+    if (SendPage(_req->conn, _req->doors, _req->door, _req->keys, _req->sem_k) < 0){
+        printf("Error mandando el HTML\n");
+        return -1;
+    }
+    printf("Se envió el HTML\n");
+    return 0;
+}
+
+/**
+ * \fn static void SourceFailed(const Request_t* _req)
+ * \brief Cuenta un pedido con una clave inválida o inexistente contra el origen de la conexión.
+ * \param [in] _req: Pedido.
+*/
+static void SourceFailed(const Request_t* _req)
+{
+    if (LockoutSourceFail(_req->client_id, TimeNowNs())){
+        printf("Origen bloqueado por intentos fallidos\n");
+    }
+}
+
+/**
+ * \fn static int LoadPage(const char* _file)
+ * \brief Carga la página en memoria y busca PAGE_PLACEHOLDER.
+ * \param [in] _file: Path de la página.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+static int LoadPage(const char* _file)
+{
+    FILE* file = fopen(_file, "rb");
+    if (!file){
+        return -1;
+    }
+    fseek(file, 0L, SEEK_END);
+    long size = ftell(file);
+    rewind(file);
+    char* html = (size >= 0) ? (char*)malloc(size + 1) : NULL;     // Vive lo mismo que el proceso
+    if (!html || fread(html, 1, size, file) != (size_t)size){
+        free(html);
+        fclose(file);
+        return -1;
+    }
+    fclose(file);
+    html[size] = '\0';
+
+    const char* mark = strstr(html, PAGE_PLACEHOLDER);
+    page = html;
+    page_len = size;
+    page_split = (mark != NULL) ? (size_t)(mark - html) : page_len;
+    if (mark == NULL){
+        printf("%s sin %s: se envía sin datos iniciales\n", _file, PAGE_PLACEHOLDER);
+    }
+    return 0;
+}
+
+/**
+ * \fn static int KeysJson(char* _out, KeyShard_t* _valid_keys, int _semId)
+ * \brief Escribe las KEYs válidas como un array JSON (["1234","5678"]).
+ * \param [out] _out: Buffer de al menos MAX_VALID_KEYS * 7 + 3 bytes. Queda terminado en '\0'.
+ * \param [in] _valid_keys: Lista de valid KEYs.
+ * \param [in] _semId: Id del semáforo de _valid_keys.
+ * \return Largo escrito. -1 si error.
+*/
+static int KeysJson(char* _out, KeyShard_t* _valid_keys, int _semId)
+{
+    int pos = 0;
+
+    if (lockSem(_semId) == -1){
+        return -1;
+    }
+    _out[pos++] = '[';
+    for (int i = 0; i < MAX_VALID_KEYS && _valid_keys->keys[i].code != KEY_EMPTY; i++){
+        if (i > 0){
+            _out[pos++] = ',';
+        }
+        _out[pos++] = '"';
+        KeyToString(_valid_keys->keys[i], _out + pos);
+        pos += KEY_SIZE;
+        _out[pos++] = '"';
+    }
+    _out[pos++] = ']';
+    _out[pos] = '\0';
+    if (unlockSem(_semId) == -1){
+        return -1;
+    }
+    return pos;
+}
+
+/**
+ * \fn static int LogJson(char* _out, size_t _size, const Doors_t* _doors, int _door)
+ * \brief Escribe el log de una puerta (o de todas) como un array JSON, igual que SendLog().
+ * \param [out] _out: Buffer.
+ * \param [in] _size: Tamaño de _out (alcanza con puertas * MAX_LOG * LOG_ENTRY_JSON + 3).
+ * \param [in] _doors: Puertas.
+ * \param [in] _door: Puerta o DOOR_GLOBAL.
+ * \return Largo escrito. -1 si error.
+*/
+static int LogJson(char* _out, size_t _size, const Doors_t* _doors, int _door)
+{
+    ActivityEntry_t batch[LOG_BATCH];
+    size_t pos = 0;
+    int entries = 0;
+
+    int first = (_door == DOOR_GLOBAL) ? 0 : _door;
+    int last = (_door == DOOR_GLOBAL) ? _doors->count : _door + 1;
+
+    _out[pos++] = '[';
+    for (int d = first; d < last; d++){
+        int count = LOG_BATCH;
+        for (int start = 0; start < MAX_LOG && count == LOG_BATCH; start += LOG_BATCH){
+            count = LogBatch(&_doors->door[d], start, batch);
+            if (count < 0){
+                return -1;
+            }
+            for (int i = 0; i < count && pos + LOG_ENTRY_JSON < _size; i++){
+                pos += LogEntryJson(_out + pos, _size - pos, &batch[i], d, entries++ > 0);
+            }
+        }
+    }
+    _out[pos++] = ']';
+    return (int)pos;
+}
+
+/**
+ * \fn static int LogBatch(const Door_t* _door, int _start, ActivityEntry_t* _batch)
+ * \brief Copia hasta LOG_BATCH entradas del log de una puerta, con su semáforo tomado solo durante la copia.
+ * \param [in] _door: Puerta.
+ * \param [in] _start: Primera entrada a copiar.
+ * \param [out] _batch: LOG_BATCH entradas.
+ * \return Entradas copiadas (menos de LOG_BATCH si se terminó el log). -1 si error.
+*/
+static int LogBatch(const Door_t* _door, int _start, ActivityEntry_t* _batch)
+{
+    int count;
+
+    if (lockSem(_door->sem_l) == -1){
+        return -1;
+    }
+    for (count = 0; count < LOG_BATCH && _start + count < MAX_LOG; count++){
+        if (_door->log[_start + count].code == KEY_EMPTY){  //Terminé la lista
+            break;
+        }
+        _batch[count] = _door->log[_start + count];
+    }
+    if (unlockSem(_door->sem_l) == -1){
+        return -1;
+    }
+    return count;
+}
+
+/**
+ * \fn static int ParseLogQuery(const Request_t* _req, LogQuery_t* _query)
+ * \brief Lee los filtros de GET /log: "clave", "estado" y "desde".
+ * \param [in] _req: Pedido.
+ * \param [out] _query: Consulta.
+ * \return 1 si hay clave o estado. 0 si no hay filtros (se envía todo el log). -1 si algún filtro no es válido.
+*/
+static int ParseLogQuery(const Request_t* _req, LogQuery_t* _query)
+{
+    char value[32];
+    int len;
+
+    LogQueryInit(_query);
+    if ((len = RouteParam(_req, "clave", value, sizeof(value))) >= 0){
+        KeyEntry_t key;
+        if (KeyFromString(value, len, &key) < 0){
+            return -1;
+        }
+        _query->code = key.code;
+    }
+    if (RouteParam(_req, "estado", value, sizeof(value)) >= 0){
+        if (value[0] < '0' || value[0] >= '0' + LOG_STATUSES || value[1] != '\0'){
+            return -1;
+        }
+        _query->status = value[0] - '0';
+    }
+    if (RouteParam(_req, "desde", value, sizeof(value)) >= 0 && ParseRuleTime(value, &_query->since_ns) < 0){
+        return -1;
+    }
+    if (_query->code == LOG_ANY && _query->status == LOG_ANY){
+        return (_query->since_ns != 0) ? -1 : 0;    // "desde" solo acota una consulta por clave o estado
+    }
+    return 1;
+}
+
+/**
+ * \fn static int LogMetrics(char* _out, size_t _size, const Doors_t* _doors)
+ * \brief Escribe las entradas del log por puerta y estado (contadores del índice) en formato de texto de Prometheus.
+ * \param [out] _out: Buffer.
+ * \param [in] _size: Tamaño de _out.
+ * \param [in] _doors: Puertas.
+ * \return Bytes escritos. -1 si no entra.
+*/
+static int LogMetrics(char* _out, size_t _size, const Doors_t* _doors)
+{
+    size_t pos = 0;
+
+    if (_size == 0){
+        return 0;
+    }
+    pos += snprintf(_out + pos, _size - pos, "# TYPE alarm_log_entries gauge\n");
+    for (int d = 0; d < _doors->count && pos < _size; d++){
+        for (int s = 0; s < LOG_STATUSES && pos < _size; s++){
+            pos += snprintf(_out + pos, _size - pos, "alarm_log_entries{puerta=\"%d\",estado=\"%d\"} %u\n", d, s,
+                            __atomic_load_n(&_doors->door[d].log_index->count[s], __ATOMIC_RELAXED));
+        }
+    }
+    return (pos < _size) ? (int)pos : -1;
+}
+
+/**
+ * \fn static int LogEntryJson(char* _out, size_t _size, const ActivityEntry_t* _entry, int _door, int _comma)
+ * \brief Escribe una entrada del log en JSON. Recién acá se pasa de binario a texto.
+ * \param [out] _out: Buffer.
+ * \param [in] _size: Tamaño de _out (LOG_ENTRY_JSON alcanza).
+ * \param [in] _entry: Entrada.
+ * \param [in] _door: Puerta de la entrada.
+ * \param [in] _comma: 1 si va una coma antes (ya hay una entrada).
+ * \return Largo escrito.
+*/
+static int LogEntryJson(char* _out, size_t _size, const ActivityEntry_t* _entry, int _door, int _comma)
+{
+    const TimeCache_t* when = TimeFormat(_entry->time_ns);
+    KeyEntry_t key = { .code = _entry->code };
+    char code[KEY_SIZE + 1];
+
+    int len = snprintf(_out, _size,
+        "%s{\"puerta\":%d,\"fecha\":\"%s\",\"hora\":\"%s\",\"clave\":\"%s\",\"estado\":\"%d\"}",
+        _comma ? "," : "", _door, when->date, when->hour, KeyToString(key, code), LogEntryStatus(_entry));
+    return (len < (int)_size) ? len : -1;
+}
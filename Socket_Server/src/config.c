@@ -0,0 +1,362 @@
+/*******************************************************************************************************************************//**
+ *
+ * @file		config.c
+ * @brief		Lectura y validación del config.ini en una tabla tipada de claves/valores.
+ * @date		19 oct. 2026
+ * @author		Martinez Agustin
+ *
+ **********************************************************************************************************************************/
+
+ /***********************************************************************************************************************************
+ *** INCLUDES
+ **********************************************************************************************************************************/
+#include "../inc/config.h"
+
+/***********************************************************************************************************************************
+ *** VARIABLES GLOBALES PRIVADAS AL MODULO
+ **********************************************************************************************************************************/
+/**
+ * \var schema
+ * \brief Claves conocidas, su tipo, valor por defecto, rango válido y si admiten recarga en caliente.
+ */
+static const ConfigSchema_t schema[] = {
+    /* key                  type           def       min   max          multi reload */
+    { "BACKLOG",            CFG_INT,       "1",      1,    4096,        0,    1 },
+    { "MAX_CONNECTIONS",    CFG_INT,       "1",      1,    1024,        0,    1 },
+    { "READ_TIMEOUT",       CFG_DURATION,  "5s",     1,    3600000,     0,    1 },
+    { "REQUEST_TIMEOUT",    CFG_DURATION,  "10s",    1,    3600000,     0,    1 },
+    { "WRITE_TIMEOUT",      CFG_DURATION,  "5s",     1,    3600000,     0,    1 },
+    { "MAX_REQUEST_SIZE",   CFG_SIZE,      "8k",     512,  16777216,    0,    1 },
+    { "HTTP2",              CFG_INT,       "1",      0,    1,           0,    1 },
+    { "LISTEN",             CFG_STRING,    NULL,     0,    0,           1,    0 },
+    { "DEVICE",             CFG_STRING,    "/dev/my_alarm", 0, 0,        1,    0 },
+    { "SNAPSHOT_FILE",      CFG_STRING,    NULL,     0,    0,           0,    0 },
+    { "SNAPSHOT_INTERVAL",  CFG_DURATION,  "30s",    0,    86400000,    0,    1 },
+    { "REPLICATION_LISTEN", CFG_STRING,    NULL,     0,    0,           0,    0 },
+    { "REPLICATION_JOURNAL",CFG_STRING,    NULL,     0,    0,           0,    0 },
+    { "REPLICA_OF",         CFG_STRING,    NULL,     0,    0,           0,    0 },
+    { "WORKERS",            CFG_INT,       "0",      0,    64,          0,    0 },
+    { "WORKER_CPUS",        CFG_LIST,      NULL,     0,    0,           0,    0 },
+    { "LOCKOUT_FAILURES",   CFG_INT,       "5",      0,    1000,        0,    0 },
+    { "LOCKOUT_WINDOW",     CFG_DURATION,  "60s",    1000, 86400000,    0,    0 },
+    { "LOCKOUT_TIME",       CFG_DURATION,  "5m",     1000, 86400000,    0,    0 },
+    { "ACTUATOR_WINDOW",    CFG_DURATION,  "20ms",   0,    1000,        0,    0 },
+    { "STATS_HOURS",        CFG_INT,       "24",     1,    168,         0,    0 },
+    { "STATS_DAYS",         CFG_INT,       "7",      1,    31,          0,    0 },
+    { "TLS_CERT",           CFG_STRING,    NULL,     0,    0,           0,    0 },
+    { "TLS_KEY",            CFG_STRING,    NULL,     0,    0,           0,    0 },
+    { "TLS_TICKETS",        CFG_INT,       "2",      0,    16,          0,    0 },
+    { "TLS_SESSION_TIME",   CFG_DURATION,  "2h",     1000, 604800000,   0,    0 },
+};
+
+#define SCHEMA_SIZE (int)(sizeof(schema) / sizeof(schema[0]))
+
+/***********************************************************************************************************************************
+ *** PROTOTIPOS DE FUNCIONES PRIVADAS AL MODULO
+ **********************************************************************************************************************************/
+static const ConfigSchema_t* FindSchema(const char* _key);
+static const ConfigEntry_t* FindEntry(const Config_t* _config, const char* _key);
+static int ParseValue(const ConfigSchema_t* _schema, const char* _text, long* _num);
+static char* Trim(char* _str);
+
+/***********************************************************************************************************************************
+ *** IMPLEMENTACION DE LOS METODODS DE LA CLASE
+ **********************************************************************************************************************************/
+/**
+ * \fn int ConfigLoad(const char* _file_name, Config_t* _config)
+ * \brief Lee y valida el archivo completo.
+ * \details Se lee una sola vez. Líneas vacías o que empiezan con '#' o ';' se ignoran.
+ * Las claves desconocidas se informan y se ignoran. Un valor inválido o fuera de rango hace fallar la carga
+ * sin modificar _config, de modo que una recarga con errores no pisa la configuración en uso.
+ * \param [in] _file_name: Nombre del archivo .ini.
+ * \param [out] _config: Tabla a completar.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+int ConfigLoad(const char* _file_name, Config_t* _config)
+{
+    static Config_t aux;    // Se arma aparte y se copia entera solo si es válida
+    char line[CONFIG_KEY_LEN + CONFIG_VALUE_LEN + 8];
+    int line_number = 0;
+    int ret = 0;
+
+    FILE* config_file = fopen(_file_name, "rb");
+    if (!config_file){
+        return -1;
+    }
+
+    aux.count = 0;
+    while (fgets(line, sizeof(line), config_file)){
+        line_number++;
+        char* key = Trim(line);
+        if (key[0] == '\0' || key[0] == '#' || key[0] == ';'){
+            continue;
+        }
+        char* value = strchr(key, '=');
+        if (value == NULL){
+            printf("%s:%d: falta '='\n", _file_name, line_number);
+            ret = -1;
+            continue;
+        }
+        *value++ = '\0';
+        key = Trim(key);
+        value = Trim(value);
+
+        const ConfigSchema_t* sch = FindSchema(key);
+        if (sch == NULL){
+            printf("%s:%d: clave desconocida %s (ignorada)\n", _file_name, line_number, key);
+            continue;
+        }
+        if (!sch->multi && FindEntry(&aux, key) != NULL){
+            printf("%s:%d: %s repetida\n", _file_name, line_number, key);
+            ret = -1;
+            continue;
+        }
+        if (aux.count >= CONFIG_MAX_ENTRIES || strlen(value) >= CONFIG_VALUE_LEN){
+            printf("%s:%d: configuración demasiado grande\n", _file_name, line_number);
+            ret = -1;
+            break;
+        }
+
+        ConfigEntry_t* entry = &aux.entries[aux.count];
+        entry->schema = sch;
+        strcpy(entry->text, value);
+        if (ParseValue(sch, value, &entry->num) < 0){
+            printf("%s:%d: valor inválido para %s: %s\n", _file_name, line_number, key, value);
+            ret = -1;
+            continue;
+        }
+        aux.count++;
+    }
+    fclose(config_file);
+
+    if (ret == 0){
+        memcpy(_config, &aux, sizeof(Config_t));
+    }
+    return ret;
+}
+
+/**
+ * \fn long ConfigGetInt(const Config_t* _config, const char* _key)
+ * \brief Valor numérico de una clave (CFG_INT, CFG_SIZE o CFG_DURATION).
+ * \param [in] _config: Tabla de configuración.
+ * \param [in] _key: Nombre de la clave.
+ * \return El valor, o el valor por defecto del esquema si no figura. -1 si la clave no existe.
+*/
+long ConfigGetInt(const Config_t* _config, const char* _key)
+{
+    long num = -1;
+    const ConfigEntry_t* entry = FindEntry(_config, _key);
+    if (entry != NULL){
+        return entry->num;
+    }
+    const ConfigSchema_t* sch = FindSchema(_key);
+    if (sch == NULL || sch->def == NULL || ParseValue(sch, sch->def, &num) < 0){
+        return -1;
+    }
+    return num;
+}
+
+/**
+ * \fn const char* ConfigGetString(const Config_t* _config, const char* _key)
+ * \brief Valor de texto de una clave.
+ * \param [in] _config: Tabla de configuración.
+ * \param [in] _key: Nombre de la clave.
+ * \return El valor, el valor por defecto del esquema, o NULL.
+*/
+const char* ConfigGetString(const Config_t* _config, const char* _key)
+{
+    const ConfigEntry_t* entry = FindEntry(_config, _key);
+    if (entry != NULL){
+        return entry->text;
+    }
+    const ConfigSchema_t* sch = FindSchema(_key);
+    return (sch != NULL) ? sch->def : NULL;
+}
+
+/**
+ * \fn int ConfigGetList(const Config_t* _config, const char* _key, char _values[][CONFIG_VALUE_LEN], int _max)
+ * \brief Todos los valores de una clave.
+ * \details Para claves repetibles devuelve una entrada por línea. Para CFG_LIST separa por comas.
+ * \param [in] _config: Tabla de configuración.
+ * \param [in] _key: Nombre de la clave.
+ * \param [out] _values: Valores encontrados.
+ * \param [in] _max: Cantidad máxima de valores.
+ * \return La cantidad de valores.
+*/
+int ConfigGetList(const Config_t* _config, const char* _key, char _values[][CONFIG_VALUE_LEN], int _max)
+{
+    int count = 0;
+    const ConfigSchema_t* sch = FindSchema(_key);
+    if (sch == NULL){
+        return 0;
+    }
+
+    for (int i = 0; i < _config->count && count < _max; i++){
+        if (_config->entries[i].schema != sch){
+            continue;
+        }
+        if (sch->type != CFG_LIST){
+            strcpy(_values[count++], _config->entries[i].text);
+            continue;
+        }
+        char text[CONFIG_VALUE_LEN];
+        char* save = NULL;
+        strcpy(text, _config->entries[i].text);
+        for (char* item = strtok_r(text, ",", &save); item != NULL && count < _max; item = strtok_r(NULL, ",", &save)){
+            item = Trim(item);
+            if (item[0] != '\0'){
+                strcpy(_values[count++], item);
+            }
+        }
+    }
+    if (count == 0 && sch->def != NULL && _max > 0){   // No figura: valor por defecto
+        strcpy(_values[count++], sch->def);
+    }
+    return count;
+}
+
+/**
+ * \fn int ConfigChanged(const Config_t* _old, const Config_t* _new, const char* _key)
+ * \brief Indica si una clave cambió entre dos configuraciones.
+ * \param [in] _old: Configuración anterior.
+ * \param [in] _new: Configuración nueva.
+ * \param [in] _key: Nombre de la clave.
+ * \return 1 si cambió. 0 sino.
+*/
+int ConfigChanged(const Config_t* _old, const Config_t* _new, const char* _key)
+{
+    static char old_values[CONFIG_MAX_ENTRIES][CONFIG_VALUE_LEN];
+    static char new_values[CONFIG_MAX_ENTRIES][CONFIG_VALUE_LEN];
+
+    int old_count = ConfigGetList(_old, _key, old_values, CONFIG_MAX_ENTRIES);
+    int new_count = ConfigGetList(_new, _key, new_values, CONFIG_MAX_ENTRIES);
+    if (old_count != new_count){
+        return 1;
+    }
+    for (int i = 0; i < old_count; i++){
+        if (strcmp(old_values[i], new_values[i]) != 0){
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * \fn void ConfigWarnNotReloadable(const Config_t* _old, const Config_t* _new)
+ * \brief Informa las claves que cambiaron pero requieren reiniciar.
+ * \param [in] _old: Configuración anterior.
+ * \param [in] _new: Configuración nueva.
+*/
+void ConfigWarnNotReloadable(const Config_t* _old, const Config_t* _new)
+{
+    for (int i = 0; i < SCHEMA_SIZE; i++){
+        if (!schema[i].reloadable && ConfigChanged(_old, _new, schema[i].key)){
+            printf("%s cambió: se aplica al reiniciar el servidor\n", schema[i].key);
+        }
+    }
+}
+
+/***********************************************************************************************************************************
+ *** FUNCIONES PRIVADAS AL MODULO
+ **********************************************************************************************************************************/
+/**
+ * \fn static const ConfigSchema_t* FindSchema(const char* _key)
+ * \brief Busca la descripción de una clave.
+ * \param [in] _key: Nombre de la clave.
+ * \return Puntero al esquema o NULL si no es una clave conocida.
+*/
+static const ConfigSchema_t* FindSchema(const char* _key)
+{
+    for (int i = 0; i < SCHEMA_SIZE; i++){
+        if (strcmp(schema[i].key, _key) == 0){
+            return &schema[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * \fn static const ConfigEntry_t* FindEntry(const Config_t* _config, const char* _key)
+ * \brief Busca el primer valor leído de una clave.
+ * \param [in] _config: Tabla de configuración.
+ * \param [in] _key: Nombre de la clave.
+ * \return Puntero al valor o NULL si no figura en el archivo.
+*/
+static const ConfigEntry_t* FindEntry(const Config_t* _config, const char* _key)
+{
+    for (int i = 0; i < _config->count; i++){
+        if (strcmp(_config->entries[i].schema->key, _key) == 0){
+            return &_config->entries[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * \fn static int ParseValue(const ConfigSchema_t* _schema, const char* _text, long* _num)
+ * \brief Convierte y valida un valor según su tipo.
+ * \param [in] _schema: Descripción de la clave.
+ * \param [in] _text: Valor como texto.
+ * \param [out] _num: Valor numérico (sin uso para CFG_STRING y CFG_LIST).
+ * \return Devuelve -1 si error. 0 sino.
+*/
+static int ParseValue(const ConfigSchema_t* _schema, const char* _text, long* _num)
+{
+    char* end;
+    long mult = 1;
+
+    *_num = 0;
+    if (_schema->type == CFG_STRING || _schema->type == CFG_LIST){
+        return (_text[0] != '\0') ? 0 : -1;
+    }
+
+    long value = strtol(_text, &end, 10);
+    if (end == _text){
+        return -1;
+    }
+    if (_schema->type == CFG_SIZE){
+        switch (*end){
+        case 'k': case 'K': mult = 1024L; end++; break;
+        case 'm': case 'M': mult = 1024L * 1024L; end++; break;
+        case 'g': case 'G': mult = 1024L * 1024L * 1024L; end++; break;
+        }
+        if (*end == 'b' || *end == 'B'){
+            end++;
+        }
+    }
+    else if (_schema->type == CFG_DURATION){
+        if (strcmp(end, "ms") == 0)     { end += 2; }
+        else if (strcmp(end, "s") == 0) { mult = 1000L; end++; }
+        else if (strcmp(end, "m") == 0) { mult = 60L * 1000L; end++; }
+        else if (strcmp(end, "h") == 0) { mult = 3600L * 1000L; end++; }
+    }
+    if (*end != '\0'){
+        return -1;
+    }
+
+    value *= mult;
+    if (value < _schema->min || value > _schema->max){
+        return -1;
+    }
+    *_num = value;
+    return 0;
+}
+
+/**
+ * \fn static char* Trim(char* _str)
+ * \brief Quita espacios y fin de línea al principio y al final.
+ * \param [in] _str: Texto a recortar (se modifica).
+ * \return Puntero al primer caracter útil.
+*/
+static char* Trim(char* _str)
+{
+    while (isspace((unsigned char)*_str)){
+        _str++;
+    }
+    char* end = _str + strlen(_str);
+    while (end > _str && isspace((unsigned char)end[-1])){
+        end--;
+    }
+    *end = '\0';
+    return _str;
+}
@@ -0,0 +1,520 @@
+/*******************************************************************************************************************************//**
+ *
+ * @file		conn.c
+ * @brief		Conexión con buffer propio, deadlines de lectura/escritura y armado incremental de pedidos HTTP.
+ * @date		19 oct. 2026
+ * @author		Martinez Agustin
+ *
+ **********************************************************************************************************************************/
+
+ /***********************************************************************************************************************************
+ *** INCLUDES
+ **********************************************************************************************************************************/
+#include "../inc/conn.h"
+
+/***********************************************************************************************************************************
+ *** VARIABLES GLOBALES PRIVADAS AL MODULO
+ **********************************************************************************************************************************/
+static __thread ConnCapture_t* capture = NULL;  /**< Captura del hilo (o del hijo). NULL si no hay */
+
+/***********************************************************************************************************************************
+ *** PROTOTIPOS DE FUNCIONES PRIVADAS AL MODULO
+ **********************************************************************************************************************************/
+static long RemainingMs(const struct timespec* _deadline);
+static int ParseHeader(Connection_t* _conn);
+static void ChunkFlush(ChunkWriter_t* _writer);
+
+/***********************************************************************************************************************************
+ *** IMPLEMENTACION DE LOS METODODS DE LA CLASE
+ **********************************************************************************************************************************/
+/**
+ * \fn int ConnInit(Connection_t* _conn, int _fd, const ConnLimits_t* _limits)
+ * \brief Inicializa una conexión sobre un socket aceptado.
+ * \details Reserva el buffer y configura SO_SNDTIMEO en el socket.
+ * \param [out] _conn: Conexión a inicializar.
+ * \param [in] _fd: Socket del cliente.
+ * \param [in] _limits: Límites a aplicar.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+int ConnInit(Connection_t* _conn, int _fd, const ConnLimits_t* _limits)
+{
+    _conn->fd = _fd;
+    _conn->limits = *_limits;
+    _conn->cap = _limits->max_request_size;
+    _conn->len = 0;
+    _conn->header_len = 0;
+    _conn->content_length = 0;
+
+    _conn->buff = (char*)BufGet(_conn->cap + 1);
+    if (!_conn->buff){
+        return -1;
+    }
+    _conn->buff[0] = '\0';
+
+    // Deadline total del pedido: un cliente que manda de a un byte no puede estirarlo.
+    clock_gettime(CLOCK_MONOTONIC, &_conn->deadline);
+    _conn->deadline.tv_sec += _limits->request_timeout_ms / 1000;
+    _conn->deadline.tv_nsec += (long)(_limits->request_timeout_ms % 1000) * 1000000L;
+    if (_conn->deadline.tv_nsec >= 1000000000L){
+        _conn->deadline.tv_sec++;
+        _conn->deadline.tv_nsec -= 1000000000L;
+    }
+
+    struct timeval tv;
+    tv.tv_sec = _limits->write_timeout_ms / 1000;
+    tv.tv_usec = (_limits->write_timeout_ms % 1000) * 1000;
+    if (setsockopt(_fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv)) == -1){
+        BufPut(_conn->buff);
+        _conn->buff = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * \fn int ConnSetRequest(Connection_t* _conn, const char* _head, size_t _head_len, const char* _body, size_t _body_len)
+ * \brief Carga un pedido ya armado (encabezado y cuerpo), como si ConnReadRequest() lo hubiera leído del socket.
+ * \param [in] _conn: Conexión inicializada.
+ * \param [in] _head: Encabezado HTTP/1.1 con la línea vacía final.
+ * \param [in] _head_len: Largo del encabezado.
+ * \param [in] _body: Cuerpo. Puede ser NULL si _body_len es 0.
+ * \param [in] _body_len: Largo del cuerpo.
+ * \return CONN_OK. CONN_TOO_LARGE o CONN_BAD si el pedido no se puede atender.
+*/
+int ConnSetRequest(Connection_t* _conn, const char* _head, size_t _head_len, const char* _body, size_t _body_len)
+{
+    if (_head_len + _body_len > _conn->cap){
+        return CONN_TOO_LARGE;
+    }
+    memcpy(_conn->buff, _head, _head_len);
+    if (_body_len > 0){
+        memcpy(_conn->buff + _head_len, _body, _body_len);
+    }
+    _conn->len = _head_len + _body_len;
+    _conn->buff[_conn->len] = '\0';
+    _conn->header_len = 0;
+    _conn->content_length = 0;
+
+    int ret = ParseHeader(_conn);
+    if (ret < 0){
+        return ret;
+    }
+    if (_conn->header_len == 0 || _conn->header_len + _conn->content_length != _conn->len){
+        return CONN_BAD;
+    }
+    return CONN_OK;
+}
+
+/**
+ * \fn int ConnReadRequest(Connection_t* _conn)
+ * \brief Lee un pedido HTTP completo.
+ * \details Lee de a partes hasta tener el encabezado completo y Content-Length bytes de cuerpo.
+ * Corta si se vence el timeout entre lecturas o el deadline total del pedido, o si se supera el tamaño máximo.
+ * \param [in] _conn: Conexión a leer.
+ * \return CONN_OK si el pedido está completo. Un CONN_* negativo sino.
+*/
+int ConnReadRequest(Connection_t* _conn)
+{
+    while (1){
+        if (_conn->header_len == 0){
+            int ret = ParseHeader(_conn);
+            if (ret < 0){
+                return ret;
+            }
+        }
+        if (_conn->header_len > 0 && _conn->len >= _conn->header_len + _conn->content_length){
+            return CONN_OK;
+        }
+        if (_conn->len >= _conn->cap){
+            return CONN_TOO_LARGE;
+        }
+
+        long remaining = RemainingMs(&_conn->deadline);
+        if (remaining <= 0){
+            return CONN_TIMEOUT;
+        }
+        int timeout = _conn->limits.read_timeout_ms;
+        if (remaining < timeout){
+            timeout = (int)remaining;
+        }
+
+        // Lo que OpenSSL ya descifró no se ve en el socket:
+        struct pollfd pfd = { .fd = _conn->fd, .events = POLLIN };
+        int n = TlsPending(_conn->fd) ? 1 : poll(&pfd, 1, timeout);
+        if (n < 0){
+            if (errno == EINTR){
+                continue;
+            }
+            return CONN_ERROR;
+        }
+        if (n == 0){
+            return CONN_TIMEOUT;
+        }
+
+        ssize_t len = TlsRecv(_conn->fd, _conn->buff + _conn->len, _conn->cap - _conn->len);
+        if (len < 0){
+            if (errno == EINTR || errno == EAGAIN){
+                continue;
+            }
+            return CONN_ERROR;
+        }
+        if (len == 0){
+            return CONN_CLOSED;
+        }
+        _conn->len += len;
+        _conn->buff[_conn->len] = '\0';
+    }
+}
+
+/**
+ * \fn int ConnWriteAll(Connection_t* _conn, const void* _data, size_t _size)
+ * \brief Escribe todo el buffer en la conexión.
+ * \param [in] _conn: Conexión a escribir.
+ * \param [in] _data: Datos a enviar.
+ * \param [in] _size: Cantidad de bytes a enviar.
+ * \return Devuelve -1 si error (o timeout). 0 sino.
+*/
+int ConnWriteAll(Connection_t* _conn, const void* _data, size_t _size)
+{
+    const char* data = (const char*)_data;
+    size_t sent = 0;
+    while (sent < _size){
+        ssize_t aux = ConnSend(_conn->fd, data + sent, _size - sent, MSG_NOSIGNAL);
+        if (aux < 0 && errno == EINTR){
+            continue;
+        }
+        if (aux <= 0){  // EAGAIN acá significa que se venció SO_SNDTIMEO
+            return -1;
+        }
+        sent += aux;
+    }
+    return 0;
+}
+
+/**
+ * \fn ssize_t ConnSend(int _fd, const void* _buff, size_t _len, int _flags)
+ * \brief send() de las respuestas: pasa por TlsSend(), o se guarda si el hilo está capturando _fd.
+ * \param [in] _fd: Socket.
+ * \param [in] _buff: Datos.
+ * \param [in] _len: Cantidad de bytes.
+ * \param [in] _flags: Flags de send().
+ * \return Bytes enviados (o guardados). -1 si error.
+*/
+ssize_t ConnSend(int _fd, const void* _buff, size_t _len, int _flags)
+{
+    if (capture == NULL || capture->fd != _fd){
+        return TlsSend(_fd, _buff, _len, _flags);
+    }
+    if (capture->len + _len > capture->cap){
+        size_t cap = capture->cap ? capture->cap : CHUNK_SIZE;
+        while (cap < capture->len + _len){
+            cap *= 2;
+        }
+        char* data = (cap <= CAPTURE_MAX) ? (char*)realloc(capture->data, cap) : NULL;
+        if (data == NULL){
+            errno = ENOMEM;
+            return -1;
+        }
+        capture->data = data;
+        capture->cap = cap;
+    }
+    memcpy(capture->data + capture->len, _buff, _len);
+    capture->len += _len;
+    return _len;
+}
+
+/**
+ * \fn void ConnCaptureBegin(ConnCapture_t* _capture, int _fd)
+ * \brief Desde acá lo que el hilo escribe en _fd queda en _capture en lugar de salir por el socket.
+ * \param [out] _capture: Captura (vacía).
+ * \param [in] _fd: Socket.
+*/
+void ConnCaptureBegin(ConnCapture_t* _capture, int _fd)
+{
+    _capture->fd = _fd;
+    _capture->data = NULL;
+    _capture->len = 0;
+    _capture->cap = 0;
+    capture = _capture;
+}
+
+/**
+ * \fn void ConnCaptureEnd(void)
+ * \brief Termina la captura del hilo. Los datos quedan en la captura.
+*/
+void ConnCaptureEnd(void)
+{
+    capture = NULL;
+}
+
+/**
+ * \fn int ConnWriteVec(Connection_t* _conn, struct iovec* _iov, int _count)
+ * \brief Escribe varios buffers seguidos con una sola llamada (sendmsg(), como writev() pero sin SIGPIPE).
+ * \details Si la escritura queda por la mitad se sigue desde donde quedó. Modifica _iov. Con HTTPS sin kTLS, o con
+ * el socket capturado, sale de a un buffer por ConnSend().
+ * \param [in] _conn: Conexión a escribir.
+ * \param [in] _iov: Buffers. Pueden tener largo 0.
+ * \param [in] _count: Cantidad de buffers.
+ * \return Devuelve -1 si error (o timeout). 0 sino.
+*/
+int ConnWriteVec(Connection_t* _conn, struct iovec* _iov, int _count)
+{
+    struct msghdr msg;
+
+    if (TlsUserspace(_conn->fd) || (capture != NULL && capture->fd == _conn->fd)){  // OpenSSL o la captura: de a un buffer
+        for (int i = 0; i < _count; i++){
+            if (ConnWriteAll(_conn, _iov[i].iov_base, _iov[i].iov_len) < 0){
+                return -1;
+            }
+        }
+        return 0;
+    }
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = _iov;
+    msg.msg_iovlen = _count;
+    while (msg.msg_iovlen > 0){
+        if (msg.msg_iov->iov_len == 0){
+            msg.msg_iov++;
+            msg.msg_iovlen--;
+            continue;
+        }
+        ssize_t aux = sendmsg(_conn->fd, &msg, MSG_NOSIGNAL);
+        if (aux < 0 && errno == EINTR){
+            continue;
+        }
+        if (aux <= 0){  // EAGAIN acá significa que se venció SO_SNDTIMEO
+            return -1;
+        }
+        // Salteo lo que ya salió: buffers completos y el principio del primero pendiente.
+        while (msg.msg_iovlen > 0 && (size_t)aux >= msg.msg_iov->iov_len){
+            aux -= msg.msg_iov->iov_len;
+            msg.msg_iov++;
+            msg.msg_iovlen--;
+        }
+        if (msg.msg_iovlen > 0){
+            msg.msg_iov->iov_base = (char*)msg.msg_iov->iov_base + aux;
+            msg.msg_iov->iov_len -= aux;
+        }
+    }
+    return 0;
+}
+
+/**
+ * \fn int ConnSendError(Connection_t* _conn, int _err)
+ * \brief Responde al cliente según el error de lectura.
+ * \details 408 para timeouts, 413 para pedidos grandes y 400 para pedidos mal formados.
+ * \param [in] _conn: Conexión a responder.
+ * \param [in] _err: Código CONN_* devuelto por ConnReadRequest().
+ * \return Devuelve -1 si error. 0 sino.
+*/
+int ConnSendError(Connection_t* _conn, int _err)
+{
+    const char* status;
+    char buff_com[160];
+
+    switch (_err){
+    case CONN_TIMEOUT:
+        status = "408 Request Timeout";
+        break;
+    case CONN_TOO_LARGE:
+        status = "413 Payload Too Large";
+        break;
+    case CONN_BAD:
+        status = "400 Bad Request";
+        break;
+    default:    // Socket roto o cerrado: no hay a quién responder
+        return -1;
+    }
+
+    int len = snprintf(buff_com, sizeof(buff_com),
+            "HTTP/1.1 %s\r\n"
+            "Content-Length: 0\r\n"
+            "Connection: close\r\n\r\n",
+            status);
+    return ConnWriteAll(_conn, buff_com, len);
+}
+
+/**
+ * \fn int ConnChunkBegin(ChunkWriter_t* _writer, Connection_t* _conn, const char* _status, const char* _type)
+ * \brief Envía el encabezado de una respuesta chunked.
+ * \param [out] _writer: Respuesta.
+ * \param [in] _conn: Conexión.
+ * \param [in] _status: Línea de estado ("200 OK").
+ * \param [in] _type: Content-Type del cuerpo.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+int ConnChunkBegin(ChunkWriter_t* _writer, Connection_t* _conn, const char* _status, const char* _type)
+{
+    char header[200];
+    int len = snprintf(header, sizeof(header),
+            "HTTP/1.1 %s\r\n"
+            "Transfer-Encoding: chunked\r\n"
+            "Content-Type: %s; charset=utf-8\r\n"
+            "Connection: close\r\n\r\n",
+            _status, _type);
+
+    _writer->conn = _conn;
+    _writer->len = 0;
+    _writer->chunks = 0;
+    _writer->error = (ConnWriteAll(_conn, header, len) < 0);
+    return _writer->error ? -1 : 0;
+}
+
+/**
+ * \fn int ConnChunkWrite(ChunkWriter_t* _writer, const void* _data, size_t _size)
+ * \brief Agrega datos al cuerpo. Envía un bloque cada CHUNK_SIZE bytes.
+ * \param [in] _writer: Respuesta.
+ * \param [in] _data: Datos.
+ * \param [in] _size: Cantidad de bytes.
+ * \return Devuelve -1 si error (también si falló una escritura anterior). 0 sino.
+*/
+int ConnChunkWrite(ChunkWriter_t* _writer, const void* _data, size_t _size)
+{
+    const char* data = (const char*)_data;
+
+    while (_size > 0 && !_writer->error){
+        size_t part = CHUNK_SIZE - _writer->len;
+        if (part > _size){
+            part = _size;
+        }
+        memcpy(_writer->buff + CHUNK_PREFIX + _writer->len, data, part);
+        _writer->len += part;
+        data += part;
+        _size -= part;
+        if (_writer->len == CHUNK_SIZE){
+            ChunkFlush(_writer);
+        }
+    }
+    return _writer->error ? -1 : 0;
+}
+
+/**
+ * \fn int ConnChunkEnd(ChunkWriter_t* _writer)
+ * \brief Envía el último bloque con datos y el bloque vacío que cierra el cuerpo.
+ * \param [in] _writer: Respuesta.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+int ConnChunkEnd(ChunkWriter_t* _writer)
+{
+    if (_writer->len > 0){
+        ChunkFlush(_writer);
+    }
+    if (_writer->error || ConnWriteAll(_writer->conn, "0\r\n\r\n", 5) < 0){
+        _writer->error = 1;
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * \fn void ConnFree(Connection_t* _conn)
+ * \brief Libera el buffer de la conexión. No cierra el socket.
+ * \param [in] _conn: Conexión a liberar.
+*/
+void ConnFree(Connection_t* _conn)
+{
+    BufPut(_conn->buff);
+    _conn->buff = NULL;
+    _conn->cap = 0;
+    _conn->len = 0;
+}
+
+/***********************************************************************************************************************************
+ *** FUNCIONES PRIVADAS AL MODULO
+ **********************************************************************************************************************************/
+/**
+ * \fn static void ChunkFlush(ChunkWriter_t* _writer)
+ * \brief Completa el largo y el "\r\n" del bloque en armado y lo envía con una sola escritura.
+ * \param [in] _writer: Respuesta con len > 0.
+*/
+static void ChunkFlush(ChunkWriter_t* _writer)
+{
+    char prefix[CHUNK_PREFIX + 1];
+
+    snprintf(prefix, sizeof(prefix), "%04zx\r\n", _writer->len);
+    memcpy(_writer->buff, prefix, CHUNK_PREFIX);
+    memcpy(_writer->buff + CHUNK_PREFIX + _writer->len, "\r\n", 2);
+    if (ConnWriteAll(_writer->conn, _writer->buff, CHUNK_PREFIX + _writer->len + 2) < 0){
+        _writer->error = 1;
+    }
+    _writer->len = 0;
+    _writer->chunks++;
+}
+
+/**
+ * \fn static long RemainingMs(const struct timespec* _deadline)
+ * \brief Milisegundos que faltan para el deadline.
+ * \param [in] _deadline: Instante límite (CLOCK_MONOTONIC).
+ * \return Milisegundos restantes. <= 0 si ya se venció.
+*/
+static long RemainingMs(const struct timespec* _deadline)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (_deadline->tv_sec - now.tv_sec) * 1000L + (_deadline->tv_nsec - now.tv_nsec) / 1000000L;
+}
+
+/**
+ * \fn static int ParseHeader(Connection_t* _conn)
+ * \brief Busca el fin del encabezado y el Content-Length.
+ * \details Acepta "\r\n\r\n" y "\n\n" como fin de encabezado. Si el encabezado todavía no está completo no hace nada.
+ * Content-Length tiene que ser solo dígitos (con espacios alrededor). Repetido vale si todos dicen lo mismo: con
+ * valores distintos no se sabe dónde termina el cuerpo y el pedido es CONN_BAD.
+ * \param [in] _conn: Conexión con los datos recibidos.
+ * \return CONN_OK si no hubo error (completo o no). CONN_TOO_LARGE o CONN_BAD sino.
+*/
+static int ParseHeader(Connection_t* _conn)
+{
+    char* end = NULL;
+    for (size_t i = 0; i + 1 < _conn->len; i++){
+        if (_conn->buff[i] == '\n'){
+            if (_conn->buff[i+1] == '\n'){
+                end = _conn->buff + i + 2;
+                break;
+            }
+            if (_conn->buff[i+1] == '\r' && i + 2 < _conn->len && _conn->buff[i+2] == '\n'){
+                end = _conn->buff + i + 3;
+                break;
+            }
+        }
+    }
+    if (end == NULL){
+        return CONN_OK;
+    }
+    _conn->header_len = end - _conn->buff;
+
+    // Content-Length (sin distinguir mayúsculas):
+    const char* line = _conn->buff;
+    int found = 0;
+    while (line < end){
+        if (strncasecmp(line, "Content-Length:", 15) == 0){
+            const char* num = line + 15;
+            char* num_end;
+            while (*num == ' ' || *num == '\t'){
+                num++;
+            }
+            if (*num < '0' || *num > '9'){      // strtol() aceptaría signo
+                return CONN_BAD;
+            }
+            long value = strtol(num, &num_end, 10);
+            while (*num_end == ' ' || *num_end == '\t' || *num_end == '\r'){
+                num_end++;
+            }
+            if (*num_end != '\n' || (found && (size_t)value != _conn->content_length)){
+                return CONN_BAD;
+            }
+            _conn->content_length = value;
+            found = 1;
+        }
+        const char* next = strchr(line, '\n');
+        if (next == NULL || next >= end){
+            break;
+        }
+        line = next + 1;
+    }
+
+    if (_conn->header_len + _conn->content_length > _conn->cap){
+        return CONN_TOO_LARGE;
+    }
+    return CONN_OK;
+}
@@ -11,13 +11,22 @@
  **********************************************************************************************************************************/
 #include "../inc/data.h"
 
+/***********************************************************************************************************************************
+ *** PROTOTIPOS DE FUNCIONES PRIVADAS AL MODULO
+ **********************************************************************************************************************************/
+static int FindKey(const KeyShard_t* _shard, uint16_t _code);
+static void RemoveAt(KeyShard_t* _shard, int _pos);
+static void NoteExpire(KeyShard_t* _shard, uint16_t _code, const KeyRule_t* _rule);
+
 /***********************************************************************************************************************************
  *** IMPLEMENTACION DE LOS METODODS DE LA CLASE
  **********************************************************************************************************************************/
 /**
  * \fn void* createShMem(int _id, size_t _size, int* _shmId)
- * \brief Crea/abre un Shared Memory.
- * \details Crea/abre el Shared Memory con la Key correspondiente. 
+ * \brief Crea un Shared Memory nuevo.
+ * \details Crea el Shared Memory con la Key correspondiente (IPC_EXCL). Si ya hay uno con esa Key (de una corrida que
+ * terminó mal, de otro binario o con otra cantidad de puertas) y nadie está enganchado, se borra y se crea de nuevo.
+ * Si alguien está enganchado (otro servidor corriendo) no se toca y se devuelve NULL con errno en EBUSY.
  * \param [in] _path: Path al archivo generador de clave.
  * \param [in] _proj_id: ID para el ftok.
  * \param [in] _size: TAmaño de la Shared Memory.
@@ -32,7 +41,24 @@ void* createShMem(char* _path, int _proj_id, size_t _size, int* _shmId)
     if (key == -1){
         return NULL;
     }
-    (*_shmId) = shmget(key, _size, shmflags);
+    (*_shmId) = shmget(key, _size, shmflags | IPC_EXCL);
+    if ((*_shmId) == -1 && errno == EEXIST){
+        struct shmid_ds info;
+        int old = shmget(key, 0, 0);
+        if (old == -1 || shmctl(old, IPC_STAT, &info) == -1){
+            return NULL;
+        }
+        if (info.shm_nattch > 0){   // Es de un servidor (o de sus lectores) que sigue corriendo
+            printf("La memoria compartida de %s está en uso (último pid %d)\n", _path, (int)info.shm_lpid);
+            errno = EBUSY;
+            return NULL;
+        }
+        printf("Memoria compartida de una corrida anterior (%zu bytes): se borra\n", (size_t)info.shm_segsz);
+        if (shmctl(old, IPC_RMID, NULL) == -1){
+            return NULL;
+        }
+        (*_shmId) = shmget(key, _size, shmflags | IPC_EXCL);
+    }
     if ((*_shmId) == -1){
         return NULL;
     }
@@ -48,7 +74,7 @@ void* createShMem(char* _path, int _proj_id, size_t _size, int* _shmId)
  * \fn int createSem(int _id, int _create)
  * \brief Crea/abre un semáforo.
  * \details Crea/abre el semáforo con la Key correspondiente. 
- * \param [in] _path: Path al archivo generador de clave.
+ * \param [in] _path: Path al archivo generador de clave. NULL para un semáforo privado (IPC_PRIVATE).
  * \param [in] _proj_id: ID para el ftok.
  * \return Devuelve -1 si error. 0 sino.
 */
@@ -57,7 +83,10 @@ int createSem(char* _path, int _proj_id)
     int semId = -1;
     int semflags = 0660 | IPC_CREAT;
 
-    key_t key = ftok(_path, _proj_id);
+    key_t key = IPC_PRIVATE;    // Sin path: semáforo privado, se comparte por fork()
+    if (_path != NULL){
+        key = ftok(_path, _proj_id);
+    }
     if( key == -1){
         printf("Estoy fallando aca\n");
         return -1;
@@ -97,13 +126,17 @@ void closeSem(int _semId)
 /**
  * \fn int lockSem(int _semId)
  * \brief Bloquea un semáforo.
- * \details Bloquea el semáforo con la ID correspondiente.
- * \param [in] _semId: ID del semáforo.
+ * \details Bloquea el semáforo con la ID correspondiente. Con SEM_HELD no hace nada: así las funciones de este
+ * módulo se pueden llamar dentro de una sección crítica más larga (por ejemplo, cambio y journal juntos).
+ * \param [in] _semId: ID del semáforo, o SEM_HELD.
  * \return Devuelve -1 si error. 0 sino.
 */
 int lockSem(int _semId)
 {
     struct sembuf sb = {0, -1, 0};
+    if (_semId == SEM_HELD){
+        return 0;
+    }
     //printf("Semaforo LOCK");
     if (semop(_semId, &sb, 1) == -1) {
         return -1;
@@ -114,13 +147,16 @@ int lockSem(int _semId)
 /**
  * \fn int unlockSem(int _semId)
  * \brief Desbloquea un semáforo.
- * \details DEsbloquea el semáforo con la ID correspondiente.
- * \param [in] _semId: ID del semáforo.
+ * \details DEsbloquea el semáforo con la ID correspondiente. Con SEM_HELD no hace nada.
+ * \param [in] _semId: ID del semáforo, o SEM_HELD.
  * \return Devuelve -1 si error. 0 sino.
 */
 int unlockSem(int _semId)
 {
     struct sembuf sb = {0, 1, 0};
+    if (_semId == SEM_HELD){
+        return 0;
+    }
     //printf("Semaforo UNLOCK");
     if (semop(_semId, &sb, 1) == -1) {
         return -1;
@@ -129,32 +165,91 @@ int unlockSem(int _semId)
 }
 
 /**
- * \fn int AddKey(const KeyEntry_t _key, KeyEntry_t* _valid_keys, int _semId)
+ * \fn int KeyFromString(const char* _text, size_t _len, KeyEntry_t* _key)
+ * \brief Convierte el texto de una clave a KeyEntry_t.
+ * \param [in] _text: Texto de la clave.
+ * \param [in] _len: Largo del texto. Tiene que ser KEY_SIZE.
+ * \param [out] _key: Clave convertida.
+ * \return Devuelve -1 si no son exactamente KEY_SIZE dígitos. 0 sino.
+*/
+int KeyFromString(const char* _text, size_t _len, KeyEntry_t* _key)
+{
+    int code = 0;
+    if (_len != KEY_SIZE){
+        return -1;
+    }
+    for (int i = 0; i < KEY_SIZE; i++){
+        if (_text[i] < '0' || _text[i] > '9'){
+            return -1;
+        }
+        code = code * 10 + (_text[i] - '0');
+    }
+    _key->code = (uint16_t)code;
+    return 0;
+}
+
+/**
+ * \fn char* KeyToString(const KeyEntry_t _key, char* _text)
+ * \brief Convierte una clave a texto con ceros a la izquierda ("0042").
+ * \param [in] _key: Clave a convertir.
+ * \param [out] _text: Buffer de al menos KEY_SIZE+1 bytes.
+ * \return _text.
+*/
+char* KeyToString(const KeyEntry_t _key, char* _text)
+{
+    unsigned int code = _key.code;
+    for (int i = KEY_SIZE - 1; i >= 0; i--){
+        _text[i] = '0' + code % 10;
+        code /= 10;
+    }
+    _text[KEY_SIZE] = '\0';
+    return _text;
+}
+
+/**
+ * \fn int AddKey(const KeyEntry_t _key, const KeyRule_t* _rule, KeyShard_t* _shard, int _semId)
  * \brief Añade una Key a la lista de Keys.
- * \details Añade una Key a la lista de Keys.
+ * \details Si la clave ya estaba se le actualiza la regla.
  * \param [in] _key: Clave a guardar.
- * \param [in] _valid_keys: Lista de valid Keys.
+ * \param [in] _rule: Validez de la clave. NULL para una clave permanente.
+ * \param [in] _shard: Lista de valid Keys.
  * \param [in] _semId: Id del semáforo para utilizar.
- * \return Devuelve -1 si error. 0 sino.
+ * \return Devuelve -1 si error. La posición+1 si la clave es nueva. 0 sino.
 */
-int AddKey(const KeyEntry_t _key, KeyEntry_t* _valid_keys, int _semId)
+int AddKey(const KeyEntry_t _key, const KeyRule_t* _rule, KeyShard_t* _shard, int _semId)
 {
     int ret = 0;
+    KeyRule_t rule;
+
+    if (_rule != NULL){
+        rule = *_rule;
+    }
+    else{
+        memset(&rule, 0, sizeof(rule));
+    }
     if (lockSem(_semId) == -1){
         return -1;
     }
+    SeqWriteBegin(&_shard->seq);
     for(int i=0; i < MAX_VALID_KEYS; i++)
     {
-        if(_valid_keys[i].value[0] == '\0')
+        if(_shard->keys[i].code == KEY_EMPTY)
         {
-            strcpy(_valid_keys[i].value, _key.value);
+            _shard->keys[i] = _key;
+            _shard->rules[i] = rule;
+            _shard->version++;
+            NoteExpire(_shard, _key.code, &rule);
             ret = i+1;
             break;
         }
-        if (strcmp(_key.value, _valid_keys[i].value) == 0){
+        if (_key.code == _shard->keys[i].code){
+            _shard->rules[i] = rule;
+            _shard->version++;
+            NoteExpire(_shard, _key.code, &rule);
             break;
         }
     }
+    SeqWriteEnd(&_shard->seq);
     if (unlockSem(_semId) == -1){
         return -1;
     }
@@ -162,76 +257,164 @@ int AddKey(const KeyEntry_t _key, KeyEntry_t* _valid_keys, int _semId)
 }
 
 /**
- * \fn int DeleteKey(const KeyEntry_t _key, KeyEntry_t* _valid_keys, int _semId)
+ * \fn int DeleteKey(const KeyEntry_t _key, KeyShard_t* _shard, int _semId)
  * \brief Elimina una Key a la lista de Keys.
  * \details Elimina una Key a la lista de Keys.
  * \param [in] _key: Clave a borrar.
- * \param [in] _valid_keys: Lista de valid Keys.
+ * \param [in] _shard: Lista de valid Keys.
  * \param [in] _semId: Id del semáforo a utilizar.
  * \return Devuelve -1 si error. 0 sino.
 */
-int DeleteKey(const KeyEntry_t _key, KeyEntry_t* _valid_keys, int _semId)
+int DeleteKey(const KeyEntry_t _key, KeyShard_t* _shard, int _semId)
 {
     if( lockSem(_semId) == -1){
         return -1;
     }
-    int pos = -1;
-    for(int i=0; i < MAX_VALID_KEYS; i++)   //Busco la clave
-    {
-        if(_valid_keys[i].value[0] == '\0'){
-            break;
+    int pos = FindKey(_shard, _key.code);
+    if (pos == -1) { //No existía la clave
+        return unlockSem(_semId);
+    }
+    RemoveAt(_shard, pos);
+
+    if( unlockSem(_semId) == -1){
+        return -1;
+    }
+    return (pos+1);
+}
+
+/**
+ * \fn int AddKeysBulk(const KeyEntry_t* _keys, int _count, int _replace, const KeyRule_t* _rule, KeyShard_t* _shard, int _semId)
+ * \brief Añade un lote de Keys en una sola sección crítica.
+ * \details Las claves deben venir validadas (KEY_SIZE dígitos). Las repetidas (en el lote o ya guardadas) no se duplican,
+ * pero todas las del lote quedan con la regla indicada. Es todo o nada: si no entran todas no se modifica la lista.
+ * \param [in] _keys: Claves a guardar.
+ * \param [in] _count: Cantidad de claves del lote.
+ * \param [in] _replace: Si es distinto de 0 el lote reemplaza a la lista completa.
+ * \param [in] _rule: Validez de las claves del lote. NULL para claves permanentes.
+ * \param [in] _shard: Lista de valid Keys.
+ * \param [in] _semId: Id del semáforo a utilizar.
+ * \return Cantidad de claves nuevas. -1 si error. -2 si no hay lugar.
+*/
+int AddKeysBulk(const KeyEntry_t* _keys, int _count, int _replace, const KeyRule_t* _rule, KeyShard_t* _shard, int _semId)
+{
+    unsigned char present[KEY_SPACE / 8];   // Una marca por clave posible: evita comparar contra toda la lista
+    uint16_t where[KEY_SPACE];              // Posición de cada clave marcada
+    KeyRule_t rule;
+    int used = 0;
+    int added = 0;
+
+    if (_rule != NULL){
+        rule = *_rule;
+    }
+    else{
+        memset(&rule, 0, sizeof(rule));
+    }
+    memset(present, 0, sizeof(present));
+    if (lockSem(_semId) == -1){
+        return -1;
+    }
+    if (!_replace){
+        while (used < MAX_VALID_KEYS && _shard->keys[used].code != KEY_EMPTY){
+            int code = _shard->keys[used].code;
+            present[code / 8] |= (1 << (code % 8));
+            where[code] = (uint16_t)used;
+            used++;
         }
-        if (strcmp(_key.value, _valid_keys[i].value) == 0)
-        {
-            pos = i;
-            break;
+    }
+
+    // Primero cuento: si no entran todas, no toco nada.
+    int fresh = 0;
+    unsigned char batch[KEY_SPACE / 8];
+    memcpy(batch, present, sizeof(batch));
+    for (int i = 0; i < _count; i++){
+        int code = _keys[i].code;
+        if (!(batch[code / 8] & (1 << (code % 8)))){
+            batch[code / 8] |= (1 << (code % 8));
+            fresh++;
         }
     }
-    if (pos == -1) { //No existía la clave
-        return unlockSem(_semId);
+    if (used + fresh > MAX_VALID_KEYS){
+        unlockSem(_semId);
+        return -2;
     }
-        
-    for(int i=pos; i < MAX_VALID_KEYS-1;i++)    //Muevo todo hacia atras
-    {
-        strcpy(_valid_keys[i].value, _valid_keys[i+1].value);
-        if(_valid_keys[i+1].value[0] == '\0')
-        {
-            _valid_keys[i].value[0] = '\0';
-            break;
+
+    SeqWriteBegin(&_shard->seq);
+    memset(batch, 0, sizeof(batch));    // Ahora marca las del lote que ya tienen la regla puesta
+    for (int i = 0; i < _count; i++){
+        int code = _keys[i].code;
+        if (!(present[code / 8] & (1 << (code % 8)))){
+            present[code / 8] |= (1 << (code % 8));
+            where[code] = (uint16_t)(used + added);
+            _shard->keys[used + added] = _keys[i];
+            added++;
         }
+        if (!(batch[code / 8] & (1 << (code % 8)))){
+            batch[code / 8] |= (1 << (code % 8));
+            _shard->rules[where[code]] = rule;
+            NoteExpire(_shard, (uint16_t)code, &rule);
+        }
+    }
+    for (int i = used + added; i < MAX_VALID_KEYS && _shard->keys[i].code != KEY_EMPTY; i++){
+        _shard->keys[i].code = KEY_EMPTY;    // Restos de la lista reemplazada
     }
-    _valid_keys[MAX_VALID_KEYS-1].value[0] = '\0';
+    _shard->version++;
+    SeqWriteEnd(&_shard->seq);
 
+    if (unlockSem(_semId) == -1){
+        return -1;
+    }
+    return added;
+}
+
+/**
+ * \fn int HasKey(const KeyEntry_t _key, const KeyShard_t* _shard, int _semId)
+ * \brief Detecta si una Key está en una lista y se puede usar ahora.
+ * \details Compara de a KEY_BLOCK enteros sin cortar en el medio, así el compilador puede vectorizar la vuelta.
+ * La regla se evalúa solo sobre la clave encontrada.
+ * \param [in] _key: Clave a buscar.
+ * \param [in] _shard: Lista de valid Keys.
+ * \param [in] _semId: Id del semáforo a utilizar.
+ * \return 1 si posee la KEY y es válida en este momento. 0 si no.
+*/
+int HasKey(const KeyEntry_t _key, const KeyShard_t* _shard, int _semId)
+{
+    int val = 0;
+
+    if( lockSem(_semId) == -1){
+        return -1;
+    }
+    int pos = FindKey(_shard, _key.code);
+    if (pos != -1){
+        val = KeyRuleAllows(&_shard->rules[pos], TimeNowNs());
+    }
     if( unlockSem(_semId) == -1){
         return -1;
     }
-    return (pos+1);
+    return val;
 }
 
 /**
- * \fn int HasKey(const KeyEntry_t _key, const KeyEntry_t* _valid_keys, int _semId)
- * \brief Detecta si una Key está en una lista o no.
- * \details Detecta si una Key está en una lista o no.
+ * \fn int UseKey(const KeyEntry_t _key, KeyShard_t* _shard, int _semId)
+ * \brief Como HasKey() pero además consume las claves de un solo uso.
+ * \details La búsqueda y el borrado van en la misma sección crítica: una clave de un solo uso no se acepta dos veces.
  * \param [in] _key: Clave a buscar.
- * \param [in] _valid_keys: Lista de valid Keys.
+ * \param [in] _shard: Lista de valid Keys.
  * \param [in] _semId: Id del semáforo a utilizar.
- * \return 1 si posee la KEY. 0 si no.
+ * \return 1 si la clave se aceptó. 2 si se aceptó y se borró (un solo uso). 0 si no. -1 si error.
 */
-int HasKey(const KeyEntry_t _key, const KeyEntry_t* _valid_keys, int _semId)
+int UseKey(const KeyEntry_t _key, KeyShard_t* _shard, int _semId)
 {
     int val = 0;
 
     if( lockSem(_semId) == -1){
         return -1;
     }
-    for(int i=0; i < MAX_VALID_KEYS; i++)
-    {
-        if(_valid_keys[i].value[0] == '\0'){
-            break;
-        }
-        if (strcmp(_key.value, _valid_keys[i].value) == 0){
-            val = 1;
-            break;
+    int pos = FindKey(_shard, _key.code);
+    if (pos != -1){
+        val = KeyRuleAllows(&_shard->rules[pos], TimeNowNs());
+        if (val && (_shard->rules[pos].flags & RULE_ONE_TIME)){
+            RemoveAt(_shard, pos);
+            val = 2;
         }
     }
     if( unlockSem(_semId) == -1){
@@ -241,15 +424,231 @@ int HasKey(const KeyEntry_t _key, const KeyEntry_t* _valid_keys, int _semId)
 }
 
 /**
- * \fn int AddLog(const ActivityEntry_t _activity, ActivityEntry_t* _log, int _semId)
+ * \fn int ExpireKeys(const uint16_t* _codes, int _count, int64_t _now_ns, KeyShard_t* _shard, int _semId)
+ * \brief Borra, de las claves indicadas, las que ya vencieron.
+ * \details Las que no vencieron (porque se les cambió la regla) se dejan. Compacta la lista una sola vez por llamada.
+ * \param [in] _codes: Claves a revisar.
+ * \param [in] _count: Cantidad de claves.
+ * \param [in] _now_ns: Instante actual.
+ * \param [in] _shard: Lista de valid Keys.
+ * \param [in] _semId: Id del semáforo a utilizar.
+ * \return Cantidad de claves borradas. -1 si error.
+*/
+int ExpireKeys(const uint16_t* _codes, int _count, int64_t _now_ns, KeyShard_t* _shard, int _semId)
+{
+    unsigned char check[KEY_SPACE / 8];
+    int kept = 0;
+    int i;
+
+    if (_count <= 0){
+        return 0;
+    }
+    memset(check, 0, sizeof(check));
+    for (i = 0; i < _count; i++){
+        check[_codes[i] / 8] |= (1 << (_codes[i] % 8));
+    }
+    if (lockSem(_semId) == -1){
+        return -1;
+    }
+    SeqWriteBegin(&_shard->seq);
+    for (i = 0; i < MAX_VALID_KEYS && _shard->keys[i].code != KEY_EMPTY; i++){
+        int code = _shard->keys[i].code;
+        const KeyRule_t* rule = &_shard->rules[i];
+        if ((check[code / 8] & (1 << (code % 8))) && rule->end_ns != 0 && rule->end_ns <= _now_ns){
+            continue;
+        }
+        if (kept != i){
+            _shard->keys[kept] = _shard->keys[i];
+            _shard->rules[kept] = _shard->rules[i];
+        }
+        kept++;
+    }
+    for (int j = kept; j < i; j++){
+        _shard->keys[j].code = KEY_EMPTY;
+    }
+    if (kept != i){
+        _shard->version++;
+    }
+    SeqWriteEnd(&_shard->seq);
+    if (unlockSem(_semId) == -1){
+        return -1;
+    }
+    return i - kept;
+}
+
+/**
+ * \fn int TakeExpirations(KeyShard_t* _shard, int _semId, KeyExpire_t* _out, int* _lost)
+ * \brief Saca los avisos de vencimientos nuevos.
+ * \param [in] _shard: Lista de valid Keys.
+ * \param [in] _semId: Id del semáforo a utilizar.
+ * \param [out] _out: Buffer de KEY_EXPIRE_QUEUE avisos.
+ * \param [out] _lost: 1 si se perdieron avisos y hay que revisar toda la tabla con ListExpirations().
+ * \return Cantidad de avisos. -1 si error.
+*/
+int TakeExpirations(KeyShard_t* _shard, int _semId, KeyExpire_t* _out, int* _lost)
+{
+    int count;
+
+    if (lockSem(_semId) == -1){
+        return -1;
+    }
+    count = (int)_shard->expire_count;
+    memcpy(_out, _shard->expire, sizeof(KeyExpire_t) * count);
+    *_lost = (_shard->expire_lost != 0);
+    _shard->expire_count = 0;
+    _shard->expire_lost = 0;
+    if (unlockSem(_semId) == -1){
+        return -1;
+    }
+    return count;
+}
+
+/**
+ * \fn int ListExpirations(const KeyShard_t* _shard, int _semId, KeyExpire_t* _out)
+ * \brief Lista todas las claves que vencen (al arrancar el lector o si se perdieron avisos).
+ * \param [in] _shard: Lista de valid Keys.
+ * \param [in] _semId: Id del semáforo a utilizar.
+ * \param [out] _out: Buffer de MAX_VALID_KEYS avisos.
+ * \return Cantidad de claves. -1 si error.
+*/
+int ListExpirations(const KeyShard_t* _shard, int _semId, KeyExpire_t* _out)
+{
+    int count = 0;
+
+    if (lockSem(_semId) == -1){
+        return -1;
+    }
+    for (int i = 0; i < MAX_VALID_KEYS && _shard->keys[i].code != KEY_EMPTY; i++){
+        if (_shard->rules[i].end_ns != 0){
+            _out[count].end_ns = _shard->rules[i].end_ns;
+            _out[count].code = _shard->keys[i].code;
+            count++;
+        }
+    }
+    if (unlockSem(_semId) == -1){
+        return -1;
+    }
+    return count;
+}
+
+/**
+ * \fn void SeqWriteBegin(uint32_t* _seq)
+ * \brief Marca el comienzo de un cambio (seq queda impar). Se llama con el semáforo tomado.
+ * \param [in] _seq: Contador de la lista o del log.
+*/
+void SeqWriteBegin(uint32_t* _seq)
+{
+    __atomic_store_n(_seq, *_seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);    // Nadie ve el cambio antes que el seq impar
+}
+
+/**
+ * \fn void SeqWriteEnd(uint32_t* _seq)
+ * \brief Marca el fin de un cambio (seq vuelve a ser par) y lo publica.
+ * \param [in] _seq: Contador de la lista o del log.
+*/
+void SeqWriteEnd(uint32_t* _seq)
+{
+    __atomic_store_n(_seq, *_seq + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * \fn int KeyShardRead(const KeyShard_t* _shard, KeyEntry_t* _keys, KeyRule_t* _rules, uint32_t* _version)
+ * \brief Copia las claves sin tomar el semáforo.
+ * \details Copia entre dos lecturas de seq y reintenta si cambió o si había un cambio a medias: quien lee no
+ * frena a quien escribe ni lo hace entrar al kernel.
+ * \param [in] _shard: Lista de valid Keys.
+ * \param [out] _keys: MAX_VALID_KEYS claves.
+ * \param [out] _rules: MAX_VALID_KEYS reglas. NULL si no hacen falta.
+ * \param [out] _version: Versión de la copia. NULL si no hace falta.
+ * \return Cantidad de claves. -1 si no se consiguió una copia entera en SEQ_RETRIES intentos.
+*/
+int KeyShardRead(const KeyShard_t* _shard, KeyEntry_t* _keys, KeyRule_t* _rules, uint32_t* _version)
+{
+    for (int retry = 0; retry < SEQ_RETRIES; retry++){
+        uint32_t start = __atomic_load_n(&_shard->seq, __ATOMIC_ACQUIRE);
+        if (start & 1){     // Cambio a medias
+            sched_yield();
+            continue;
+        }
+        int count = 0;
+        while (count < MAX_VALID_KEYS && _shard->keys[count].code != KEY_EMPTY){
+            _keys[count] = _shard->keys[count];
+            if (_rules != NULL){
+                _rules[count] = _shard->rules[count];
+            }
+            count++;
+        }
+        if (_version != NULL){
+            *_version = _shard->version;
+        }
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);    // La copia se termina antes de volver a leer seq
+        if (__atomic_load_n(&_shard->seq, __ATOMIC_RELAXED) == start){
+            return count;
+        }
+    }
+    return -1;
+}
+
+/**
+ * \fn void KeyShardInit(KeyShard_t* _shard)
+ * \brief Deja una lista vacía.
+ * \param [out] _shard: Lista a inicializar.
+*/
+void KeyShardInit(KeyShard_t* _shard)
+{
+    memset(_shard, 0, sizeof(KeyShard_t));
+    for (int i = 0; i < MAX_VALID_KEYS; i++){
+        _shard->keys[i].code = KEY_EMPTY;
+    }
+}
+
+/**
+ * \fn int KeyRuleAllows(const KeyRule_t* _rule, int64_t _now_ns)
+ * \brief Evalúa una regla en un instante.
+ * \param [in] _rule: Regla.
+ * \param [in] _now_ns: Instante (ns desde epoch).
+ * \return 1 si la clave se puede usar. 0 si no.
+*/
+int KeyRuleAllows(const KeyRule_t* _rule, int64_t _now_ns)
+{
+    if (_rule->start_ns != 0 && _now_ns < _rule->start_ns){
+        return 0;
+    }
+    if (_rule->end_ns != 0 && _now_ns >= _rule->end_ns){
+        return 0;
+    }
+    if (_rule->weekdays == 0 && _rule->from_min == _rule->to_min){
+        return 1;   // Sin días ni franja: no hace falta la hora local
+    }
+
+    time_t now = (time_t)(_now_ns / 1000000000LL);
+    struct tm local;
+    localtime_r(&now, &local);
+    if (_rule->weekdays != 0 && !(_rule->weekdays & (1 << local.tm_wday))){
+        return 0;
+    }
+    if (_rule->from_min != _rule->to_min){
+        int minute = local.tm_hour * 60 + local.tm_min;
+        if (_rule->from_min < _rule->to_min){
+            return (minute >= _rule->from_min && minute < _rule->to_min);
+        }
+        return (minute >= _rule->from_min || minute < _rule->to_min);   // Cruza la medianoche
+    }
+    return 1;
+}
+
+/**
+ * \fn int AddLog(const ActivityEntry_t _activity, ActivityEntry_t* _log, LogIndex_t* _index, int _semId)
  * \brief Añade una actividad a un log de actividades.
- * \details Añade una actividad a un log de actividades.
+ * \details Añade una actividad a un log de actividades y la suma al índice en la misma sección crítica.
  * \param [in] _activity: actividad a guardar.
  * \param [in] _log: log de actividades.
+ * \param [in] _index: Índice del log. NULL si no tiene.
  * \param [in] _semId: Id del semáforo a utilizar.
- * \return Devuelve -1 si error. 0 sino.
+ * \return Devuelve -1 si error, 0 si el log está lleno (no se guarda) y la posición + 1 sino.
 */
-int AddLog(const ActivityEntry_t _activity, ActivityEntry_t* _log, int _semId)
+int AddLog(const ActivityEntry_t _activity, ActivityEntry_t* _log, LogIndex_t* _index, int _semId)
 {
     int ret = -1;
     if( lockSem(_semId) == -1){
@@ -257,13 +656,17 @@ int AddLog(const ActivityEntry_t _activity, ActivityEntry_t* _log, int _semId)
     }
     for(int i=0; i < MAX_LOG; i++)
     {
-        if(_log[i].code[0] == '\0')
+        if(_log[i].code == KEY_EMPTY)
         {
-            strcpy(_log[i].code, _activity.code);
-            strcpy(_log[i].date, _activity.date);
-            _log[i].status = _activity.status;
-            strcpy(_log[i].time, _activity.time);
+            if (_index != NULL){
+                SeqWriteBegin(&_index->seq);
+            }
+            _log[i] = _activity;
             ret = i;
+            if (_index != NULL){
+                LogIndexAdd(_index, _log, i);
+                SeqWriteEnd(&_index->seq);
+            }
             break;
         }
     }
@@ -285,14 +688,234 @@ int AddLog(const ActivityEntry_t _activity, ActivityEntry_t* _log, int _semId)
 */
 int CreateActivityEntry(ActivityEntry_t* _activity, KeyEntry_t _code, const int _status)
 {
-    time_t t = time(NULL);
-    struct tm tm_info;
-    localtime_r(&t, &tm_info); 
-
-    strcpy(_activity->code, _code.value);
-    strftime(_activity->date, sizeof(_activity->date), "%Y%m%d", &tm_info);
-    _activity->status = _status;
-    strftime(_activity->time, sizeof(_activity->time), "%H%M%S", &tm_info);
+    _activity->time_ns = TimeNowNs();
+    _activity->code = _code.code;
+    _activity->flags = _status ? LOG_STATUS_OK : 0;
+    _activity->reserved = 0;
 
     return 0;
-}
\ No newline at end of file
+}
+
+/**
+ * \fn int LogEntryStatus(const ActivityEntry_t* _entry)
+ * \brief Estado de una entrada del log.
+ * \param [in] _entry: Entrada.
+ * \return 0 rechazada, 1 aceptada, 2 bloqueó la puerta.
+*/
+int LogEntryStatus(const ActivityEntry_t* _entry)
+{
+    return (_entry->flags & LOG_STATUS_OK) ? 1 : (_entry->flags & LOG_LOCKOUT) ? 2 : 0;
+}
+
+/**
+ * \fn void LogIndexBuild(LogIndex_t* _index, const ActivityEntry_t* _log)
+ * \brief Rehace el índice a partir del log completo. Se llama con el semáforo tomado (o sin otros procesos).
+ * \details seq no se toca: lo maneja quien escribe el log.
+ * \param [out] _index: Índice.
+ * \param [in] _log: Log de MAX_LOG entradas.
+*/
+void LogIndexBuild(LogIndex_t* _index, const ActivityEntry_t* _log)
+{
+    uint32_t seq = _index->seq;
+
+    memset(_index, 0xFF, sizeof(*_index));      // Todas las cadenas en LOG_NONE
+    memset(_index->count, 0, sizeof(_index->count));
+    _index->seq = seq;
+    for (int i = 0; i < MAX_LOG && _log[i].code != KEY_EMPTY; i++){
+        LogIndexAdd(_index, _log, i);
+    }
+}
+
+/**
+ * \fn void LogIndexAdd(LogIndex_t* _index, const ActivityEntry_t* _log, int _pos)
+ * \brief Suma al índice la entrada recién escrita en _pos. Se llama con el semáforo tomado.
+ * \param [in] _index: Índice.
+ * \param [in] _log: Log.
+ * \param [in] _pos: Posición de la entrada nueva (siempre más nueva que las anteriores).
+*/
+void LogIndexAdd(LogIndex_t* _index, const ActivityEntry_t* _log, int _pos)
+{
+    uint16_t code = _log[_pos].code;
+    int status = LogEntryStatus(&_log[_pos]);
+
+    if (code >= KEY_SPACE){
+        return;
+    }
+    _index->prev_code[_pos] = _index->by_code[code];
+    _index->by_code[code] = (int16_t)_pos;
+    _index->prev_status[_pos] = _index->by_status[status];
+    _index->by_status[status] = (int16_t)_pos;
+    _index->count[status]++;
+}
+
+/**
+ * \fn void LogQueryInit(LogQuery_t* _query)
+ * \brief Deja una consulta sin filtros.
+ * \param [out] _query: Consulta.
+*/
+void LogQueryInit(LogQuery_t* _query)
+{
+    _query->code = LOG_ANY;
+    _query->status = LOG_ANY;
+    _query->since_ns = 0;
+    _query->next = LOG_NONE;
+    _query->started = 0;
+}
+
+/**
+ * \fn int LogFind(const ActivityEntry_t* _log, const LogIndex_t* _index, int _semId, LogQuery_t* _query, ActivityEntry_t* _out, int _max)
+ * \brief Copia hasta _max entradas que cumplen la consulta, de la más nueva a la más vieja.
+ * \details Sigue la cadena de la clave (o la del estado si no hay clave): el costo es proporcional al resultado,
+ * no al largo del log. Cada llamada es una sección crítica corta; la siguiente sigue desde _query->next.
+ * \param [in] _log: Log.
+ * \param [in] _index: Índice del log.
+ * \param [in] _semId: Id del semáforo a utilizar.
+ * \param [in] _query: Consulta con clave o estado. Se actualiza para la próxima tanda.
+ * \param [out] _out: Entradas encontradas.
+ * \param [in] _max: Tamaño de _out.
+ * \return Cantidad de entradas copiadas (0: terminó). -1 si error.
+*/
+int LogFind(const ActivityEntry_t* _log, const LogIndex_t* _index, int _semId, LogQuery_t* _query, ActivityEntry_t* _out, int _max)
+{
+    int by_code = (_query->code != LOG_ANY);
+    int count = 0;
+
+    if (!by_code && _query->status == LOG_ANY){
+        return -1;      // Sin clave ni estado no hay cadena que seguir
+    }
+    if (lockSem(_semId) == -1){
+        return -1;
+    }
+    if (!_query->started){
+        _query->started = 1;
+        _query->next = by_code ? _index->by_code[_query->code] : _index->by_status[_query->status];
+    }
+    // Las entradas se agregan en orden de llegada: al pasar since_ns ya no hay más nuevas en la cadena.
+    while (_query->next != LOG_NONE && count < _max){
+        const ActivityEntry_t* entry = &_log[_query->next];
+        if (entry->time_ns < _query->since_ns){
+            _query->next = LOG_NONE;
+            break;
+        }
+        if (!by_code || _query->status == LOG_ANY || LogEntryStatus(entry) == _query->status){
+            _out[count++] = *entry;
+        }
+        _query->next = by_code ? _index->prev_code[_query->next] : _index->prev_status[_query->next];
+    }
+    if (unlockSem(_semId) == -1){
+        return -1;
+    }
+    return count;
+}
+
+/**
+ * \fn int LogRead(const ActivityEntry_t* _log, const LogIndex_t* _index, ActivityEntry_t* _out, uint32_t* _count)
+ * \brief Copia el log y los contadores del índice sin tomar el semáforo, igual que KeyShardRead().
+ * \param [in] _log: Log.
+ * \param [in] _index: Índice del log.
+ * \param [out] _out: MAX_LOG entradas, de la más vieja a la más nueva.
+ * \param [out] _count: LOG_STATUSES contadores. NULL si no hacen falta.
+ * \return Cantidad de entradas. -1 si no se consiguió una copia entera en SEQ_RETRIES intentos.
+*/
+int LogRead(const ActivityEntry_t* _log, const LogIndex_t* _index, ActivityEntry_t* _out, uint32_t* _count)
+{
+    for (int retry = 0; retry < SEQ_RETRIES; retry++){
+        uint32_t start = __atomic_load_n(&_index->seq, __ATOMIC_ACQUIRE);
+        if (start & 1){
+            sched_yield();
+            continue;
+        }
+        int entries = 0;
+        while (entries < MAX_LOG && _log[entries].code != KEY_EMPTY){
+            _out[entries] = _log[entries];
+            entries++;
+        }
+        if (_count != NULL){
+            memcpy(_count, _index->count, sizeof(_index->count));
+        }
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&_index->seq, __ATOMIC_RELAXED) == start){
+            return entries;
+        }
+    }
+    return -1;
+}
+
+/***********************************************************************************************************************************
+ *** FUNCIONES PRIVADAS AL MODULO
+ **********************************************************************************************************************************/
+/**
+ * \fn static int FindKey(const KeyShard_t* _shard, uint16_t _code)
+ * \brief Busca una clave. Hay que tener tomado el semáforo.
+ * \details Compara de a KEY_BLOCK sin cortar en el medio del bloque: las posiciones libres valen KEY_EMPTY y nunca coinciden.
+ * \param [in] _shard: Lista de valid Keys.
+ * \param [in] _code: Clave a buscar.
+ * \return Posición de la clave. -1 si no está.
+*/
+static int FindKey(const KeyShard_t* _shard, uint16_t _code)
+{
+    for (int i = 0; i < MAX_VALID_KEYS; i += KEY_BLOCK){
+        const KeyEntry_t* block = _shard->keys + i;
+        int hit = 0;
+        for (int j = 0; j < KEY_BLOCK; j++){
+            hit |= (block[j].code == _code);
+        }
+        if (hit){
+            for (int j = 0; j < KEY_BLOCK; j++){
+                if (block[j].code == _code){
+                    return i + j;
+                }
+            }
+        }
+        if (block[KEY_BLOCK-1].code == KEY_EMPTY){  // La lista termina en este bloque
+            break;
+        }
+    }
+    return -1;
+}
+
+/**
+ * \fn static void RemoveAt(KeyShard_t* _shard, int _pos)
+ * \brief Borra la clave de una posición corriendo las siguientes. Hay que tener tomado el semáforo.
+ * \param [in] _shard: Lista de valid Keys.
+ * \param [in] _pos: Posición a borrar.
+*/
+static void RemoveAt(KeyShard_t* _shard, int _pos)
+{
+    SeqWriteBegin(&_shard->seq);
+    for(int i=_pos; i < MAX_VALID_KEYS-1;i++)    //Muevo todo hacia atras
+    {
+        _shard->keys[i] = _shard->keys[i+1];
+        _shard->rules[i] = _shard->rules[i+1];
+        if(_shard->keys[i+1].code == KEY_EMPTY)
+        {
+            break;
+        }
+    }
+    _shard->keys[MAX_VALID_KEYS-1].code = KEY_EMPTY;
+    _shard->version++;
+    SeqWriteEnd(&_shard->seq);
+}
+
+/**
+ * \fn static void NoteExpire(KeyShard_t* _shard, uint16_t _code, const KeyRule_t* _rule)
+ * \brief Avisa al lector que una clave vence. Hay que tener tomado el semáforo.
+ * \details Si la cola está llena se marca expire_lost y el lector revisa toda la tabla una vez.
+ * \param [in] _shard: Lista de valid Keys.
+ * \param [in] _code: Clave.
+ * \param [in] _rule: Regla de la clave.
+*/
+static void NoteExpire(KeyShard_t* _shard, uint16_t _code, const KeyRule_t* _rule)
+{
+    if (_rule->end_ns == 0){
+        return;
+    }
+    if (_shard->expire_count >= KEY_EXPIRE_QUEUE){
+        _shard->expire_lost = 1;
+        return;
+    }
+    KeyExpire_t* aux = &_shard->expire[_shard->expire_count++];
+    memset(aux, 0, sizeof(KeyExpire_t));
+    aux->end_ns = _rule->end_ns;
+    aux->code = _code;
+}
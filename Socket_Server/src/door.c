@@ -0,0 +1,355 @@
+/*******************************************************************************************************************************//**
+ *
+ * @file		door.c
+ * @brief		Puertas del sitio: un dispositivo de alarma, su lector y su parte de las claves y del log.
+ * @date		19 oct. 2026
+ * @author		Martinez Agustin
+ *
+ **********************************************************************************************************************************/
+
+ /***********************************************************************************************************************************
+ *** INCLUDES
+ **********************************************************************************************************************************/
+#include "../inc/door.h"
+#include "../inc/shm.h"
+#include "../inc/periph.h"  // periph(): door.h no lo incluye porque periph.h usa Door_t
+#include "../inc/children.h"    // ChildrenUnblockSignals()
+
+/***********************************************************************************************************************************
+ *** PROTOTIPOS DE FUNCIONES PRIVADAS AL MODULO
+ **********************************************************************************************************************************/
+static void SetPointers(Doors_t* _doors, ShmLayout_t* _shm);
+
+/***********************************************************************************************************************************
+ *** IMPLEMENTACION DE LOS METODODS DE LA CLASE
+ **********************************************************************************************************************************/
+/**
+ * \fn int DoorsLoad(const Config_t* _config, Doors_t* _doors)
+ * \brief Lee los dispositivos del config.ini (una línea DEVICE por puerta).
+ * \param [in] _config: Configuración leída.
+ * \param [out] _doors: Puertas a completar. Todavía sin memoria compartida ni dispositivos abiertos.
+ * \return Devuelve -1 si error. La cantidad de puertas sino.
+*/
+int DoorsLoad(const Config_t* _config, Doors_t* _doors)
+{
+    char devices[MAX_DOORS][CONFIG_VALUE_LEN];
+    int count = ConfigGetList(_config, "DEVICE", devices, MAX_DOORS);
+
+    memset(_doors, 0, sizeof(Doors_t));
+    _doors->smId = -1;
+    _doors->sem_global = -1;
+    if (count <= 0){
+        return -1;
+    }
+    for (int i = 0; i < count; i++){
+        Door_t* door = &_doors->door[i];
+        if (strlen(devices[i]) >= DOOR_DEVICE_LEN){
+            printf("DEVICE demasiado largo: %s\n", devices[i]);
+            return -1;
+        }
+        door->id = i;
+        strcpy(door->device, devices[i]);
+        door->driver = -1;
+        door->sem_k = -1;
+        door->sem_l = -1;
+        door->sem_write = -1;
+        door->pid = -1;
+    }
+    _doors->count = count;
+    return count;
+}
+
+/**
+ * \fn int DoorsCreate(char* _path, Doors_t* _doors)
+ * \brief Crea la memoria compartida y los semáforos, los inicializa y abre los dispositivos.
+ * \details Si algo falla deshace lo creado.
+ * \param [in] _path: Path al archivo generador de claves IPC (argv[0]).
+ * \param [in] _doors: Puertas leídas con DoorsLoad().
+ * \return Devuelve -1 si error. 0 sino.
+*/
+int DoorsCreate(char* _path, Doors_t* _doors)
+{
+    size_t size = sizeof(ShmLayout_t) + sizeof(DoorShm_t) * (size_t)_doors->count;
+
+    ShmLayout_t* shm = (ShmLayout_t*)createShMem(_path, SM_ID, size, &_doors->smId);
+    if (shm == NULL){
+        perror("Error al pedir memoria compartida");
+        return -1;
+    }
+
+    // Inicializo vacío:
+    memset(&shm->header, 0, sizeof(shm->header));
+    shm->header.magic = SHM_MAGIC;
+    shm->header.version = SHM_VERSION;
+    shm->header.doors = (uint32_t)_doors->count;
+    shm->header.max_log = MAX_LOG;
+    shm->header.size = size;
+    shm->header.cache_line = CACHE_LINE;
+    shm->header.shard_size = sizeof(KeyShard_t);
+    shm->header.door_size = sizeof(DoorShm_t);
+    shm->header.global_offset = offsetof(ShmLayout_t, global_keys);
+    shm->header.doors_offset = offsetof(ShmLayout_t, door);
+    shm->header.region[SHM_STATS] = (ShmRegion_t){ offsetof(ShmLayout_t, stats), sizeof(StatsTable_t) };
+    shm->header.region[SHM_LOCKOUT] = (ShmRegion_t){ offsetof(ShmLayout_t, lockout), sizeof(LockoutTable_t) };
+    shm->header.region[SHM_ACTUATOR] = (ShmRegion_t){ offsetof(ShmLayout_t, actuator), sizeof(ActuatorStats_t) };
+    shm->header.region[SHM_BUFPOOL] = (ShmRegion_t){ offsetof(ShmLayout_t, bufpool), sizeof(BufPoolStats_t) };
+    shm->header.region[SHM_CHILDREN] = (ShmRegion_t){ offsetof(ShmLayout_t, children), sizeof(ChildStats_t) };
+    shm->header.region[SHM_TLS] = (ShmRegion_t){ offsetof(ShmLayout_t, tls), sizeof(TlsStats_t) };
+    SetPointers(_doors, shm);
+    KeyShardInit(&shm->global_keys);
+    // Las horas y los días con stamp 0 se limpian al usarse: no hace falta tocar las páginas de claves por día.
+    memset(&shm->stats, 0, offsetof(StatsTable_t, key_used));
+    memset(&shm->lockout, 0, sizeof(shm->lockout));
+    memset(&shm->actuator, 0, sizeof(shm->actuator));
+    memset(&shm->bufpool, 0, sizeof(shm->bufpool));
+    memset(&shm->children, 0, sizeof(shm->children));
+    memset(&shm->tls, 0, sizeof(shm->tls));
+    for (int i = 0; i < _doors->count; i++){
+        DoorShm_t* door = &shm->door[i];
+        KeyShardInit(&door->keys);
+        memset(door->log, 0, sizeof(door->log));
+        for (int j = 0; j < MAX_LOG; j++){
+            door->log[j].code = KEY_EMPTY;
+        }
+        door->index.seq = 0;        // LogIndexBuild() lo conserva: el segmento puede venir de una corrida anterior
+        LogIndexBuild(&door->index, door->log);
+        memset(&door->lockout, 0, sizeof(door->lockout));
+    }
+
+    // Un semáforo por parte: el global por clave IPC, los de cada puerta privados (van por fork/traspaso).
+    _doors->sem_global = createSem(_path, SEM_ID_K);
+    if (_doors->sem_global == -1){
+        perror("Error al crear el semáforo KEY");
+        DoorsDetach(_doors);
+        DoorsDestroy(_doors);
+        return -1;
+    }
+    for (int i = 0; i < _doors->count; i++){
+        Door_t* door = &_doors->door[i];
+        door->sem_k = createSem(NULL, 0);
+        door->sem_l = createSem(NULL, 0);
+        door->sem_write = createSem(NULL, 0);
+        if (door->sem_k == -1 || door->sem_l == -1 || door->sem_write == -1){
+            perror("Error al crear los semáforos de la puerta");
+            DoorsDetach(_doors);
+            DoorsDestroy(_doors);
+            return -1;
+        }
+        door->driver = open(door->device, O_RDWR);
+        if (door->driver < 0){
+            perror(door->device);
+            DoorsDetach(_doors);
+            DoorsDestroy(_doors);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * \fn int DoorsAttach(Doors_t* _doors)
+ * \brief Se engancha a la memoria compartida ya creada (por IDs) y recalcula los punteros.
+ * \param [in] _doors: Puertas con los IDs cargados.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+int DoorsAttach(Doors_t* _doors)
+{
+    ShmLayout_t* shm = (ShmLayout_t*)shmat(_doors->smId, NULL, 0);
+    if (shm == (void*)-1){
+        return -1;
+    }
+    // Creada por otro binario: solo se usa si tiene exactamente el formato de este.
+    if (shm->header.magic != SHM_MAGIC || shm->header.version != SHM_VERSION || shm->header.doors != (uint32_t)_doors->count
+        || shm->header.max_log != MAX_LOG || shm->header.door_size != sizeof(DoorShm_t)
+        || shm->header.doors_offset != offsetof(ShmLayout_t, door)){
+        shmdt(shm);
+        return -1;
+    }
+    SetPointers(_doors, shm);
+    return 0;
+}
+
+/**
+ * \fn void DoorsDetach(Doors_t* _doors)
+ * \brief Se desengancha de la memoria compartida sin borrarla.
+ * \param [in] _doors: Puertas.
+*/
+void DoorsDetach(Doors_t* _doors)
+{
+    if (_doors->shm != NULL){
+        shmdt(_doors->shm);
+    }
+    SetPointers(_doors, NULL);
+}
+
+/**
+ * \fn void DoorsDestroy(Doors_t* _doors)
+ * \brief Cierra los dispositivos y borra la memoria compartida y los semáforos.
+ * \param [in] _doors: Puertas.
+*/
+void DoorsDestroy(Doors_t* _doors)
+{
+    DoorsCloseDrivers(_doors);
+    for (int i = 0; i < _doors->count; i++){
+        Door_t* door = &_doors->door[i];
+        if (door->sem_k != -1){
+            closeSem(door->sem_k);
+        }
+        if (door->sem_l != -1){
+            closeSem(door->sem_l);
+        }
+        if (door->sem_write != -1){
+            closeSem(door->sem_write);
+        }
+        door->driver = door->sem_k = door->sem_l = door->sem_write = -1;
+    }
+    if (_doors->sem_global != -1){
+        closeSem(_doors->sem_global);
+    }
+    if (_doors->smId != -1){
+        shmctl(_doors->smId, IPC_RMID, NULL);
+    }
+    _doors->sem_global = _doors->smId = -1;
+}
+
+/**
+ * \fn int DoorsStart(Doors_t* _doors)
+ * \brief Lanza un proceso lector (periph) por puerta.
+ * \param [in] _doors: Puertas.
+ * \return Devuelve -1 si error (los que llegaron a arrancar se detienen). 0 sino.
+*/
+int DoorsStart(Doors_t* _doors)
+{
+    for (int i = 0; i < _doors->count; i++){
+        pid_t pid = fork();
+        if (pid < 0){
+            perror("Error de fork");
+            DoorsStop(_doors);
+            return -1;
+        }
+        if (pid == 0){  // Lector de la puerta i: solo necesita su dispositivo
+            ChildrenUnblockSignals();
+            for (int j = 0; j < _doors->count; j++){
+                if (j != i){
+                    close(_doors->door[j].driver);
+                }
+            }
+            periph(_doors, i);
+            exit(0);
+        }
+        _doors->door[i].pid = pid;
+        printf("Puerta %d: %s (lector %d)\n", i, _doors->door[i].device, pid);
+    }
+    return 0;
+}
+
+/**
+ * \fn void DoorsStop(Doors_t* _doors)
+ * \brief Termina los procesos lectores.
+ * \param [in] _doors: Puertas.
+*/
+void DoorsStop(Doors_t* _doors)
+{
+    for (int i = 0; i < _doors->count; i++){
+        if (_doors->door[i].pid > 0){   // El pid queda: WorkerExited lo usa para no contarlo como cliente
+            kill(_doors->door[i].pid, SIGTERM);
+        }
+    }
+}
+
+/**
+ * \fn int DoorsIsWorker(const Doors_t* _doors, pid_t _pid)
+ * \brief Indica si _pid es el lector de alguna puerta.
+ * \param [in] _doors: Puertas.
+ * \param [in] _pid: Proceso a buscar.
+ * \return 1 si es un lector. 0 sino.
+*/
+int DoorsIsWorker(const Doors_t* _doors, pid_t _pid)
+{
+    for (int i = 0; i < _doors->count; i++){
+        if (_doors->door[i].pid == _pid){
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * \fn void DoorsCloseDrivers(const Doors_t* _doors)
+ * \brief Cierra los fds de los dispositivos en este proceso.
+ * \param [in] _doors: Puertas.
+*/
+void DoorsCloseDrivers(const Doors_t* _doors)
+{
+    for (int i = 0; i < _doors->count; i++){
+        if (_doors->door[i].driver >= 0){
+            close(_doors->door[i].driver);
+        }
+    }
+}
+
+/**
+ * \fn KeyShard_t* DoorKeys(const Doors_t* _doors, int _door, int* _semId)
+ * \brief Claves de una puerta o las globales.
+ * \param [in] _doors: Puertas.
+ * \param [in] _door: Id de la puerta o DOOR_GLOBAL.
+ * \param [out] _semId: Semáforo que protege esas claves.
+ * \return Puntero a las claves. NULL si la puerta no existe.
+*/
+KeyShard_t* DoorKeys(const Doors_t* _doors, int _door, int* _semId)
+{
+    if (_door == DOOR_GLOBAL){
+        *_semId = _doors->sem_global;
+        return _doors->global_keys;
+    }
+    if (_door < 0 || _door >= _doors->count){
+        return NULL;
+    }
+    *_semId = _doors->door[_door].sem_k;
+    return _doors->door[_door].keys;
+}
+
+/**
+ * \fn int DoorsNotify(const Doors_t* _doors, int _door, const driver_msg_t _msg)
+ * \brief Envía un mensaje al dispositivo de una puerta, o a todos si _door es DOOR_GLOBAL.
+ * \param [in] _doors: Puertas.
+ * \param [in] _door: Id de la puerta o DOOR_GLOBAL.
+ * \param [in] _msg: Mensaje a escribir.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+int DoorsNotify(const Doors_t* _doors, int _door, const driver_msg_t _msg)
+{
+    int ret = 0;
+    for (int i = 0; i < _doors->count; i++){
+        if (_door != DOOR_GLOBAL && _door != i){
+            continue;
+        }
+        if (writeDriver(_doors->door[i].driver, _msg, _doors->door[i].sem_write) == -1){
+            ret = -1;
+        }
+    }
+    return ret;
+}
+
+/***********************************************************************************************************************************
+ *** FUNCIONES PRIVADAS AL MODULO
+ **********************************************************************************************************************************/
+/**
+ * \fn static void SetPointers(Doors_t* _doors, ShmLayout_t* _shm)
+ * \brief Reparte la memoria compartida entre las puertas.
+ * \details [encabezado][claves globales][estadísticas y bloqueos][puerta 0: claves, log, índice, bloqueo][puerta 1]...
+ * ver ShmLayout_t.
+ * \param [in] _doors: Puertas.
+ * \param [in] _shm: Segmento (NULL para limpiar los punteros).
+*/
+static void SetPointers(Doors_t* _doors, ShmLayout_t* _shm)
+{
+    _doors->shm = _shm;
+    _doors->global_keys = _shm ? &_shm->global_keys : NULL;
+    for (int i = 0; i < _doors->count; i++){
+        _doors->door[i].keys = _shm ? &_shm->door[i].keys : NULL;
+        _doors->door[i].log = _shm ? _shm->door[i].log : NULL;
+        _doors->door[i].log_index = _shm ? &_shm->door[i].index : NULL;
+        _doors->door[i].lockout = _shm ? &_shm->door[i].lockout : NULL;
+    }
+}
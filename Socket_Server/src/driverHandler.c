@@ -40,18 +40,55 @@ int writeDriver(int driver_fd, const driver_msg_t _msg, int _sem)
     }
     return unlockSem(_sem);
 }
+
+/**
+ * \fn int writeDriverBatch(int driver_fd, const driver_msg_t* _msgs, int _count, int _sem)
+ * \brief Escritura de varios mensajes en el driver con una sola llamada.
+ * \details Cada mensaje sigue siendo una escritura de dos caracteres para el driver (un iovec por mensaje), pero se
+ * toma el semáforo una vez y se hace un solo writev().
+ * \param [in] driver_fd: File Descriptor del Driver a escribir.
+ * \param [in] _msgs: Mensajes a enviar, en orden.
+ * \param [in] _count: Cantidad de mensajes (hasta IOV_MAX).
+ * \param [in] _sem: Semaforo para escritura
+ * \return Devuelve -1 si error. 0 sino.
+*/
+int writeDriverBatch(int driver_fd, const driver_msg_t* _msgs, int _count, int _sem)
+{
+    unsigned char buff[_count][2];
+    struct iovec iov[_count];
+
+    for (int i = 0; i < _count; i++){
+        buff[i][0] = _msgs[i].command;
+        buff[i][1] = _msgs[i].dec_ms;
+        iov[i].iov_base = buff[i];
+        iov[i].iov_len = sizeof(buff[i]);
+    }
+    if (lockSem(_sem) == -1)
+        return -1;
+    ssize_t n = writev(driver_fd, iov, _count);
+    if (n != (ssize_t)sizeof(buff)){
+        unlockSem(_sem);
+        return -1;
+    }
+    return unlockSem(_sem);
+}
+
 /**
  * \fn int readDriver( KeyEntry_t* _driver_buff )
  * \brief Lectura del driver.
  * \details Lee el driver de forma segura con las variables pasadas.
  * \param [in] _driver_buff: Buffer donde se guarda la lectura.
- * \return Devuelve -1 si error. 0 sino.
+ * \return Devuelve -1 si error. -2 si lo leído no es una clave de KEY_SIZE dígitos. 0 sino.
 */
 int readDriver( int driver_fd, KeyEntry_t* _driver_buff )
 {
-    size_t n = read(driver_fd, _driver_buff->value, sizeof(_driver_buff->value));
+    char text[KEY_SIZE + 1];    // El driver entrega la clave como texto
+    ssize_t n = read(driver_fd, text, sizeof(text));
     if (n < 0) {
         return -1;
     }
+    if (KeyFromString(text, strnlen(text, n), _driver_buff) < 0){
+        return -2;
+    }
     return 0;
 }
\ No newline at end of file
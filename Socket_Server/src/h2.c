@@ -0,0 +1,1370 @@
+/*******************************************************************************************************************************//**
+ *
+ * @file		h2.c
+ * @brief		HTTP/2 sin TLS (h2c): frames, streams multiplexados sobre una conexión y control de flujo.
+ * @date		19 oct. 2026
+ * @author		Martinez Agustin
+ *
+ **********************************************************************************************************************************/
+
+ /***********************************************************************************************************************************
+ *** INCLUDES
+ **********************************************************************************************************************************/
+#include "../inc/h2.h"
+
+/***********************************************************************************************************************************
+ *** DEFINES PRIVADOS AL MODULO
+ **********************************************************************************************************************************/
+/* Tipos de frame (RFC 9113 6) */
+#define FRAME_DATA          0x0
+#define FRAME_HEADERS       0x1
+#define FRAME_PRIORITY      0x2
+#define FRAME_RST_STREAM    0x3
+#define FRAME_SETTINGS      0x4
+#define FRAME_PUSH_PROMISE  0x5
+#define FRAME_PING          0x6
+#define FRAME_GOAWAY        0x7
+#define FRAME_WINDOW_UPDATE 0x8
+#define FRAME_CONTINUATION  0x9
+
+/* Flags */
+#define FLAG_END_STREAM     0x01
+#define FLAG_ACK            0x01
+#define FLAG_END_HEADERS    0x04
+#define FLAG_PADDED         0x08
+#define FLAG_PRIORITY       0x20
+
+/* Códigos de error (RFC 9113 7) */
+#define ERR_NO_ERROR        0x0
+#define ERR_PROTOCOL        0x1
+#define ERR_INTERNAL        0x2
+#define ERR_FLOW_CONTROL    0x3
+#define ERR_STREAM_CLOSED   0x5
+#define ERR_FRAME_SIZE      0x6
+#define ERR_REFUSED_STREAM  0x7
+#define ERR_COMPRESSION     0x9
+#define ERR_CALM            0xB     /**< ENHANCE_YOUR_CALM */
+
+/* SETTINGS */
+#define SET_HEADER_TABLE_SIZE       0x1
+#define SET_ENABLE_PUSH             0x2
+#define SET_MAX_CONCURRENT_STREAMS  0x3
+#define SET_INITIAL_WINDOW_SIZE     0x4
+#define SET_MAX_FRAME_SIZE          0x5
+#define SET_MAX_HEADER_LIST_SIZE    0x6
+
+#define PSEUDO_SIZE         2048    /**< :path y :authority más largos que se aceptan */
+
+/***********************************************************************************************************************************
+ *** TIPO DE DATOS PRIVADOS AL MODULO
+ **********************************************************************************************************************************/
+/**
+ * \struct Fields_t
+ * \brief Campos de un bloque de encabezados mientras se decodifica.
+ */
+typedef struct {
+    char method[16];                /**< :method */
+    size_t method_len;
+    char path[PSEUDO_SIZE];         /**< :path */
+    size_t path_len;
+    char authority[PSEUDO_SIZE];    /**< :authority */
+    size_t authority_len;
+    int scheme;                     /**< Llegó :scheme */
+    char fields[H2_HEAD_SIZE];      /**< Los demás campos, como líneas HTTP/1.1 */
+    size_t fields_len;
+    int regular;                    /**< Ya llegó un campo que no es pseudo-encabezado */
+    int malformed;                  /**< El pedido no es válido: se resetea el stream */
+    int too_large;                  /**< No entra en H2_HEAD_SIZE */
+} Fields_t;
+
+/***********************************************************************************************************************************
+ *** PROTOTIPOS DE FUNCIONES PRIVADAS AL MODULO
+ **********************************************************************************************************************************/
+static int Loop(H2Session_t* _s);
+static int Frame(H2Session_t* _s, uint8_t _type, uint8_t _flags, uint32_t _id, const uint8_t* _p, size_t _len);
+static int OnData(H2Session_t* _s, uint8_t _flags, uint32_t _id, const uint8_t* _p, size_t _len);
+static int OnHeaders(H2Session_t* _s, uint8_t _flags, uint32_t _id, const uint8_t* _p, size_t _len);
+static int OnBlock(H2Session_t* _s, uint8_t _flags, uint32_t _id, const uint8_t* _p, size_t _len);
+static int EndBlock(H2Session_t* _s, uint32_t _id);
+static int OnSettings(H2Session_t* _s, uint8_t _flags, uint32_t _id, const uint8_t* _p, size_t _len);
+static int ApplySettings(H2Session_t* _s, const uint8_t* _p, size_t _len);
+static int OnWindow(H2Session_t* _s, uint32_t _id, const uint8_t* _p, size_t _len);
+static int OnField(void* _arg, const char* _name, size_t _name_len, const char* _value, size_t _value_len);
+static int IgnoreField(void* _arg, const char* _name, size_t _name_len, const char* _value, size_t _value_len);
+static int Upgrade(H2Session_t* _s);
+static int Dispatch(H2Session_t* _s, H2Stream_t* _st);
+static int Answer(H2Session_t* _s, H2Stream_t* _st, Connection_t* _conn, int _status);
+static int Respond(H2Session_t* _s, H2Stream_t* _st, ConnCapture_t* _capture);
+static long Dechunk(char* _body, size_t _len);
+static int Flush(H2Session_t* _s);
+static int Send(H2Session_t* _s, uint8_t _type, uint8_t _flags, uint32_t _id, const void* _payload, size_t _len);
+static int SendPending(H2Session_t* _s);
+static int SendSettings(H2Session_t* _s);
+static int SendWindow(H2Session_t* _s, uint32_t _id, uint32_t _increment);
+static int SendGoaway(H2Session_t* _s, uint32_t _code);
+static int Reset(H2Session_t* _s, uint32_t _id, uint32_t _code);
+static H2Stream_t* StreamFind(H2Session_t* _s, uint32_t _id);
+static H2Stream_t* StreamNew(H2Session_t* _s, uint32_t _id);
+static void StreamFree(H2Stream_t* _st);
+static int Busy(const H2Session_t* _s);
+static const char* FindHeader(const Connection_t* _conn, const char* _name, size_t* _len);
+static int Base64Url(const char* _in, size_t _len, uint8_t* _out, size_t _size);
+static uint32_t Get32(const uint8_t* _p);
+static void Put32(uint8_t* _p, uint32_t _value);
+
+/***********************************************************************************************************************************
+ *** IMPLEMENTACION DE LOS METODODS DE LA CLASE
+ **********************************************************************************************************************************/
+/**
+ * \fn int H2Detect(const Connection_t* _conn)
+ * \brief Indica si el pedido leído por ConnReadRequest() abre una conexión HTTP/2.
+ * \param [in] _conn: Conexión con el pedido completo.
+ * \return H2_PRIOR si empieza con el prefacio, H2_UPGRADE si pide Upgrade: h2c con HTTP2-Settings. 0 sino.
+*/
+int H2Detect(const Connection_t* _conn)
+{
+    size_t len;
+
+    if (_conn->len >= H2_PREFACE_HEAD && memcmp(_conn->buff, H2_PREFACE, H2_PREFACE_HEAD) == 0){
+        return H2_PRIOR;
+    }
+    const char* upgrade = FindHeader(_conn, "Upgrade", &len);
+    if (upgrade == NULL || FindHeader(_conn, "HTTP2-Settings", NULL) == NULL){
+        return 0;
+    }
+    // "Upgrade: websocket, h2c": uno de los protocolos de la lista
+    while (len > 0){
+        size_t token = 0;
+        while (token < len && upgrade[token] != ','){
+            token++;
+        }
+        size_t start = 0;
+        size_t end = token;
+        while (start < end && upgrade[start] == ' '){
+            start++;
+        }
+        while (end > start && upgrade[end - 1] == ' '){
+            end--;
+        }
+        if (end - start == 3 && strncasecmp(upgrade + start, "h2c", 3) == 0){
+            return H2_UPGRADE;
+        }
+        upgrade += (token < len) ? token + 1 : token;
+        len -= (token < len) ? token + 1 : token;
+    }
+    return 0;
+}
+
+/**
+ * \fn int H2Serve(Connection_t* _conn, int _mode, H2Handler_t _handler, void* _arg)
+ * \brief Atiende la conexión con HTTP/2 hasta que el cliente la cierra, se vence READ_TIMEOUT sin tráfico o se
+ * llega a H2_MAX_REQUESTS pedidos.
+ * \details Cada stream completo se arma como pedido HTTP/1.1 en una conexión aparte y lo atiende _handler con el
+ * socket capturado; la respuesta sale en un HEADERS (con HPACK) y frames DATA. Los DATA de los distintos streams se
+ * envían alternados, de a un frame por stream, respetando las ventanas del cliente. Con H2_UPGRADE primero se
+ * responde 101 y el pedido original pasa a ser el stream 1.
+ * \param [in] _conn: Conexión con el pedido que devolvió H2Detect().
+ * \param [in] _mode: H2_PRIOR o H2_UPGRADE.
+ * \param [in] _handler: Atiende cada pedido.
+ * \param [in] _arg: Argumento de _handler.
+ * \return Devuelve -1 si error de socket. 0 sino.
+*/
+int H2Serve(Connection_t* _conn, int _mode, H2Handler_t _handler, void* _arg)
+{
+    H2Session_t* s = (H2Session_t*)calloc(1, sizeof(H2Session_t));
+    if (s == NULL){
+        return -1;
+    }
+    s->conn = _conn;
+    s->handler = _handler;
+    s->arg = _arg;
+    s->window = H2_WINDOW;
+    s->initial_window = H2_WINDOW;
+    HpackInit(&s->decoder, HPACK_TABLE_SIZE);
+    HpackInit(&s->encoder, HPACK_TABLE_SIZE);
+
+    // Lo que llegó detrás del pedido (o el prefacio entero) ya son frames.
+    size_t from = (_mode == H2_UPGRADE) ? _conn->header_len + _conn->content_length : 0;
+    size_t extra = _conn->len - from;
+    s->in_cap = H2_PREFACE_LEN + H2_FRAME_HEADER + H2_MAX_FRAME;
+    if (extra > s->in_cap){
+        s->in_cap = extra;
+    }
+    s->in = (uint8_t*)malloc(s->in_cap);
+    if (s->in == NULL){
+        free(s);
+        return -1;
+    }
+    memcpy(s->in, _conn->buff + from, extra);
+    s->in_len = extra;
+
+    int ret;
+    if (_mode == H2_UPGRADE){
+        ret = Upgrade(s);
+        if (ret > 0){           // HTTP2-Settings inválido: se sigue con HTTP/1.1
+            free(s->in);
+            free(s);
+            return _handler(_conn, _arg);
+        }
+    }
+    else{
+        ret = SendSettings(s);
+    }
+    if (ret == 0){
+        ret = Loop(s);
+    }
+    printf("HTTP/2: %d pedidos en la conexión\n", s->requests);
+
+    for (int i = 0; i < H2_MAX_STREAMS; i++){
+        StreamFree(&s->streams[i]);
+    }
+    free(s->in);
+    free(s);
+    return ret;
+}
+
+/***********************************************************************************************************************************
+ *** FUNCIONES PRIVADAS AL MODULO
+ **********************************************************************************************************************************/
+/**
+ * \fn static int Loop(H2Session_t* _s)
+ * \brief Procesa los frames recibidos, envía lo pendiente y espera más datos, hasta que la conexión termina.
+ * \details Un error de conexión se avisa con GOAWAY. READ_TIMEOUT sin recibir nada cierra con GOAWAY sin error.
+ * \param [in] _s: Sesión.
+ * \return Devuelve -1 si error de socket. 0 sino.
+*/
+static int Loop(H2Session_t* _s)
+{
+    int err = ERR_NO_ERROR;
+
+    while (1){
+        size_t pos = 0;
+        if (!_s->preface){
+            size_t n = (_s->in_len < H2_PREFACE_LEN) ? _s->in_len : H2_PREFACE_LEN;
+            if (memcmp(_s->in, H2_PREFACE, n) != 0){
+                return 0;       // No es HTTP/2: no hay a quién avisar
+            }
+            if (n == H2_PREFACE_LEN){
+                _s->preface = 1;
+                pos = H2_PREFACE_LEN;
+            }
+        }
+        while (_s->preface && _s->in_len - pos >= H2_FRAME_HEADER){
+            const uint8_t* h = _s->in + pos;
+            size_t len = ((size_t)h[0] << 16) | ((size_t)h[1] << 8) | h[2];
+            if (len > H2_MAX_FRAME){
+                err = ERR_FRAME_SIZE;
+                goto goaway;
+            }
+            if (_s->in_len - pos < H2_FRAME_HEADER + len){
+                break;
+            }
+            int ret = Frame(_s, h[3], h[4], Get32(h + 5) & 0x7FFFFFFF, h + H2_FRAME_HEADER, len);
+            if (ret < 0){
+                return -1;
+            }
+            if (ret > 0){
+                err = ret;
+                goto goaway;
+            }
+            pos += H2_FRAME_HEADER + len;
+        }
+        memmove(_s->in, _s->in + pos, _s->in_len - pos);
+        _s->in_len -= pos;
+
+        if (Flush(_s) < 0){
+            return -1;
+        }
+        if (_s->closing && !Busy(_s)){
+            return 0;
+        }
+
+        struct pollfd pfd = { .fd = _s->conn->fd, .events = POLLIN };
+        int n = poll(&pfd, 1, _s->conn->limits.read_timeout_ms);
+        if (n < 0){
+            if (errno == EINTR){
+                continue;
+            }
+            return -1;
+        }
+        if (n == 0){
+            goto goaway;        // Sin tráfico: se cierra sin error
+        }
+        ssize_t len = recv(_s->conn->fd, _s->in + _s->in_len, _s->in_cap - _s->in_len, 0);
+        if (len < 0){
+            if (errno == EINTR || errno == EAGAIN){
+                continue;
+            }
+            return -1;
+        }
+        if (len == 0){
+            return 0;
+        }
+        _s->in_len += len;
+    }
+
+goaway:
+    if (err != ERR_NO_ERROR){
+        printf("HTTP/2: error de conexión %d\n", err);
+    }
+    if (SendGoaway(_s, err) < 0 || SendPending(_s) < 0){
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * \fn static int Frame(H2Session_t* _s, uint8_t _type, uint8_t _flags, uint32_t _id, const uint8_t* _p, size_t _len)
+ * \brief Procesa un frame completo.
+ * \param [in] _s: Sesión.
+ * \param [in] _type: Tipo.
+ * \param [in] _flags: Flags.
+ * \param [in] _id: Stream.
+ * \param [in] _p: Contenido.
+ * \param [in] _len: Largo del contenido.
+ * \return 0 si se procesó. Un código de error de conexión (> 0), o -1 si falló el socket.
+*/
+static int Frame(H2Session_t* _s, uint8_t _type, uint8_t _flags, uint32_t _id, const uint8_t* _p, size_t _len)
+{
+    // Un bloque de encabezados no se puede cortar con otros frames.
+    if (_s->continuation != 0 && (_type != FRAME_CONTINUATION || _id != _s->continuation)){
+        return ERR_PROTOCOL;
+    }
+    if (!_s->settings && _type != FRAME_SETTINGS){
+        return ERR_PROTOCOL;
+    }
+
+    switch (_type){
+    case FRAME_DATA:
+        return OnData(_s, _flags, _id, _p, _len);
+    case FRAME_HEADERS:
+        return OnHeaders(_s, _flags, _id, _p, _len);
+    case FRAME_CONTINUATION:
+        if (_s->continuation == 0){
+            return ERR_PROTOCOL;
+        }
+        return OnBlock(_s, _flags, _id, _p, _len);
+    case FRAME_PRIORITY:        // Las prioridades no cambian el reparto
+        if (_id == 0){
+            return ERR_PROTOCOL;
+        }
+        return (_len != 5) ? Reset(_s, _id, ERR_FRAME_SIZE) : 0;
+    case FRAME_RST_STREAM:
+        if (_id == 0 || _id > _s->last_id){
+            return ERR_PROTOCOL;
+        }
+        if (_len != 4){
+            return ERR_FRAME_SIZE;
+        }
+        StreamFree(StreamFind(_s, _id));
+        return 0;
+    case FRAME_SETTINGS:
+        return OnSettings(_s, _flags, _id, _p, _len);
+    case FRAME_PUSH_PROMISE:    // Solo los manda el servidor
+        return ERR_PROTOCOL;
+    case FRAME_PING:
+        if (_id != 0){
+            return ERR_PROTOCOL;
+        }
+        if (_len != 8){
+            return ERR_FRAME_SIZE;
+        }
+        return (_flags & FLAG_ACK) ? 0 : Send(_s, FRAME_PING, FLAG_ACK, 0, _p, 8);
+    case FRAME_GOAWAY:
+        if (_id != 0){
+            return ERR_PROTOCOL;
+        }
+        _s->closing = 1;
+        return 0;
+    case FRAME_WINDOW_UPDATE:
+        return OnWindow(_s, _id, _p, _len);
+    default:                    // Tipos desconocidos se ignoran
+        return 0;
+    }
+}
+
+/**
+ * \fn static int OnData(H2Session_t* _s, uint8_t _flags, uint32_t _id, const uint8_t* _p, size_t _len)
+ * \brief DATA: agrega el cuerpo al pedido y devuelve la ventana. Con END_STREAM el pedido se atiende.
+ * \details Todo lo recibido vuelve enseguida a la ventana de la conexión (y a la del stream si sigue abierto): el
+ * tamaño del pedido ya lo limita MAX_REQUEST_SIZE.
+ * \param [in] _s: Sesión.
+ * \param [in] _flags: Flags.
+ * \param [in] _id: Stream.
+ * \param [in] _p: Contenido.
+ * \param [in] _len: Largo del contenido.
+ * \return 0 si se procesó. Un código de error de conexión (> 0), o -1 si falló el socket.
+*/
+static int OnData(H2Session_t* _s, uint8_t _flags, uint32_t _id, const uint8_t* _p, size_t _len)
+{
+    const uint8_t* data = _p;
+    size_t data_len = _len;
+
+    if (_id == 0 || _id > _s->last_id){
+        return ERR_PROTOCOL;
+    }
+    if (_flags & FLAG_PADDED){
+        if (_len < 1 || _p[0] >= _len){
+            return ERR_PROTOCOL;
+        }
+        data = _p + 1;
+        data_len = _len - 1 - _p[0];
+    }
+    if (_len > 0 && SendWindow(_s, 0, _len) < 0){
+        return -1;
+    }
+
+    H2Stream_t* st = StreamFind(_s, _id);
+    if (st == NULL || st->remote_closed){
+        return Reset(_s, _id, ERR_STREAM_CLOSED);
+    }
+    if (st->body_len + data_len > _s->conn->limits.max_request_size){
+        st->too_large = 1;      // Se sigue leyendo hasta END_STREAM para responder 413
+    }
+    else if (data_len > 0){
+        if (st->body_len + data_len > st->body_cap){
+            size_t cap = st->body_len + data_len;
+            char* body = (char*)realloc(st->body, cap);
+            if (body == NULL){
+                return Reset(_s, _id, ERR_INTERNAL);
+            }
+            st->body = body;
+            st->body_cap = cap;
+        }
+        memcpy(st->body + st->body_len, data, data_len);
+        st->body_len += data_len;
+    }
+
+    if (_flags & FLAG_END_STREAM){
+        st->remote_closed = 1;
+        return Dispatch(_s, st);
+    }
+    return (_len > 0) ? SendWindow(_s, _id, _len) : 0;
+}
+
+/**
+ * \fn static int OnHeaders(H2Session_t* _s, uint8_t _flags, uint32_t _id, const uint8_t* _p, size_t _len)
+ * \brief HEADERS: abre un pedido (o trae los trailers de uno abierto) y empieza su bloque de encabezados.
+ * \details Si no hay lugar para otro stream, o ya se mandó GOAWAY, el bloque igual se decodifica (la tabla HPACK es
+ * de toda la conexión) y el stream se rechaza con REFUSED_STREAM: el cliente lo puede reintentar.
+ * \param [in] _s: Sesión.
+ * \param [in] _flags: Flags.
+ * \param [in] _id: Stream.
+ * \param [in] _p: Contenido.
+ * \param [in] _len: Largo del contenido.
+ * \return 0 si se procesó. Un código de error de conexión (> 0), o -1 si falló el socket.
+*/
+static int OnHeaders(H2Session_t* _s, uint8_t _flags, uint32_t _id, const uint8_t* _p, size_t _len)
+{
+    const uint8_t* pos = _p;
+    const uint8_t* end = _p + _len;
+    size_t pad = 0;
+
+    if (_id == 0 || (_id & 1) == 0){
+        return ERR_PROTOCOL;
+    }
+    if (_flags & FLAG_PADDED){
+        if (pos >= end){
+            return ERR_FRAME_SIZE;
+        }
+        pad = *pos++;
+    }
+    if (_flags & FLAG_PRIORITY){
+        if (end - pos < 5){
+            return ERR_FRAME_SIZE;
+        }
+        pos += 5;
+    }
+    if (pad > (size_t)(end - pos)){
+        return ERR_PROTOCOL;
+    }
+    end -= pad;
+
+    if (_id <= _s->last_id){
+        H2Stream_t* st = StreamFind(_s, _id);
+        if (st == NULL || st->remote_closed){
+            return ERR_STREAM_CLOSED;
+        }
+        _s->block_kind = H2_BLOCK_TRAILERS;
+    }
+    else{
+        _s->last_id = _id;
+        _s->block_kind = (_s->closing || StreamNew(_s, _id) == NULL) ? H2_BLOCK_REFUSED : H2_BLOCK_REQUEST;
+    }
+    _s->block_len = 0;
+    _s->block_end = _flags & FLAG_END_STREAM;
+    return OnBlock(_s, _flags, _id, pos, end - pos);
+}
+
+/**
+ * \fn static int OnBlock(H2Session_t* _s, uint8_t _flags, uint32_t _id, const uint8_t* _p, size_t _len)
+ * \brief Agrega un fragmento al bloque de encabezados. Con END_HEADERS el bloque está completo.
+ * \param [in] _s: Sesión.
+ * \param [in] _flags: Flags del HEADERS o CONTINUATION.
+ * \param [in] _id: Stream.
+ * \param [in] _p: Fragmento.
+ * \param [in] _len: Largo del fragmento.
+ * \return 0 si se procesó. Un código de error de conexión (> 0), o -1 si falló el socket.
+*/
+static int OnBlock(H2Session_t* _s, uint8_t _flags, uint32_t _id, const uint8_t* _p, size_t _len)
+{
+    if (_s->block_len + _len > H2_HEADER_BLOCK){
+        return ERR_CALM;
+    }
+    memcpy(_s->block + _s->block_len, _p, _len);
+    _s->block_len += _len;
+    if (!(_flags & FLAG_END_HEADERS)){
+        _s->continuation = _id;
+        return 0;
+    }
+    _s->continuation = 0;
+    return EndBlock(_s, _id);
+}
+
+/**
+ * \fn static int EndBlock(H2Session_t* _s, uint32_t _id)
+ * \brief Decodifica un bloque de encabezados completo y arma el encabezado HTTP/1.1 del pedido.
+ * \param [in] _s: Sesión.
+ * \param [in] _id: Stream.
+ * \return 0 si se procesó. Un código de error de conexión (> 0), o -1 si falló el socket.
+*/
+static int EndBlock(H2Session_t* _s, uint32_t _id)
+{
+    static __thread Fields_t f;
+
+    f.method_len = f.path_len = f.authority_len = f.fields_len = 0;
+    f.scheme = f.regular = f.malformed = f.too_large = 0;
+    HpackField_t field = (_s->block_kind == H2_BLOCK_REQUEST) ? OnField : IgnoreField;
+    if (HpackDecode(&_s->decoder, _s->block, _s->block_len, field, &f) < 0){
+        return ERR_COMPRESSION;
+    }
+    if (_s->block_kind == H2_BLOCK_REFUSED){
+        return Reset(_s, _id, ERR_REFUSED_STREAM);
+    }
+
+    H2Stream_t* st = StreamFind(_s, _id);
+    if (_s->block_kind == H2_BLOCK_TRAILERS){
+        if (!_s->block_end){
+            return Reset(_s, _id, ERR_PROTOCOL);
+        }
+        st->remote_closed = 1;
+        return Dispatch(_s, st);
+    }
+    if (f.malformed || f.method_len == 0 || f.path_len == 0 || !f.scheme){
+        return Reset(_s, _id, ERR_PROTOCOL);
+    }
+
+    int n = snprintf(st->head, sizeof(st->head), "%.*s %.*s HTTP/1.1\r\n", (int)f.method_len, f.method,
+                     (int)f.path_len, f.path);
+    if (f.authority_len > 0 && n >= 0 && (size_t)n < sizeof(st->head)){
+        n += snprintf(st->head + n, sizeof(st->head) - n, "Host: %.*s\r\n", (int)f.authority_len, f.authority);
+    }
+    if (f.too_large || n < 0 || (size_t)n + f.fields_len >= sizeof(st->head)){
+        st->too_large = 1;
+    }
+    else{
+        memcpy(st->head + n, f.fields, f.fields_len);
+        st->head_len = n + f.fields_len;
+    }
+
+    if (++_s->requests >= H2_MAX_REQUESTS && !_s->closing){
+        _s->closing = 1;
+        if (SendGoaway(_s, ERR_NO_ERROR) < 0){
+            return -1;
+        }
+    }
+    if (_s->block_end){
+        st->remote_closed = 1;
+        return Dispatch(_s, st);
+    }
+    return 0;
+}
+
+/**
+ * \fn static int OnSettings(H2Session_t* _s, uint8_t _flags, uint32_t _id, const uint8_t* _p, size_t _len)
+ * \brief SETTINGS: aplica los valores del cliente y confirma con ACK.
+ * \param [in] _s: Sesión.
+ * \param [in] _flags: Flags.
+ * \param [in] _id: Stream (tiene que ser 0).
+ * \param [in] _p: Contenido.
+ * \param [in] _len: Largo del contenido.
+ * \return 0 si se procesó. Un código de error de conexión (> 0), o -1 si falló el socket.
+*/
+static int OnSettings(H2Session_t* _s, uint8_t _flags, uint32_t _id, const uint8_t* _p, size_t _len)
+{
+    if (_id != 0){
+        return ERR_PROTOCOL;
+    }
+    if (_flags & FLAG_ACK){
+        return (_len != 0) ? ERR_FRAME_SIZE : 0;
+    }
+    if (_len % 6 != 0){
+        return ERR_FRAME_SIZE;
+    }
+    int err = ApplySettings(_s, _p, _len);
+    if (err != 0){
+        return err;
+    }
+    _s->settings = 1;
+    return Send(_s, FRAME_SETTINGS, FLAG_ACK, 0, NULL, 0);
+}
+
+/**
+ * \fn static int ApplySettings(H2Session_t* _s, const uint8_t* _p, size_t _len)
+ * \brief Aplica una lista de SETTINGS del cliente (del frame o de HTTP2-Settings).
+ * \param [in] _s: Sesión.
+ * \param [in] _p: Pares de identificador (16 bits) y valor (32 bits).
+ * \param [in] _len: Largo de la lista (múltiplo de 6).
+ * \return 0 si se aplicaron. Un código de error de conexión sino.
+*/
+static int ApplySettings(H2Session_t* _s, const uint8_t* _p, size_t _len)
+{
+    for (size_t i = 0; i + 6 <= _len; i += 6){
+        uint16_t id = ((uint16_t)_p[i] << 8) | _p[i + 1];
+        uint32_t value = Get32(_p + i + 2);
+
+        switch (id){
+        case SET_HEADER_TABLE_SIZE:
+            HpackResize(&_s->encoder, value);
+            break;
+        case SET_ENABLE_PUSH:
+            if (value > 1){
+                return ERR_PROTOCOL;
+            }
+            break;
+        case SET_INITIAL_WINDOW_SIZE:
+            if (value > H2_MAX_WINDOW){
+                return ERR_FLOW_CONTROL;
+            }
+            // Cambia la ventana de los streams abiertos en la diferencia (RFC 9113 6.9.2)
+            for (int j = 0; j < H2_MAX_STREAMS; j++){
+                if (_s->streams[j].id != 0){
+                    _s->streams[j].window += (int64_t)value - _s->initial_window;
+                }
+            }
+            _s->initial_window = value;
+            break;
+        case SET_MAX_FRAME_SIZE:   // Los DATA no pasan de H2_MAX_FRAME, que todos aceptan
+            if (value < H2_MAX_FRAME || value > 0xFFFFFF){
+                return ERR_PROTOCOL;
+            }
+            break;
+        default:                // MAX_CONCURRENT_STREAMS (no hay push), MAX_HEADER_LIST_SIZE y desconocidos
+            break;
+        }
+    }
+    return 0;
+}
+
+/**
+ * \fn static int OnWindow(H2Session_t* _s, uint32_t _id, const uint8_t* _p, size_t _len)
+ * \brief WINDOW_UPDATE: agranda la ventana de envío de la conexión o de un stream.
+ * \param [in] _s: Sesión.
+ * \param [in] _id: Stream. 0: la conexión.
+ * \param [in] _p: Contenido.
+ * \param [in] _len: Largo del contenido.
+ * \return 0 si se procesó. Un código de error de conexión (> 0), o -1 si falló el socket.
+*/
+static int OnWindow(H2Session_t* _s, uint32_t _id, const uint8_t* _p, size_t _len)
+{
+    if (_len != 4){
+        return ERR_FRAME_SIZE;
+    }
+    uint32_t increment = Get32(_p) & 0x7FFFFFFF;
+    if (_id == 0){
+        if (increment == 0){
+            return ERR_PROTOCOL;
+        }
+        _s->window += increment;
+        return (_s->window > H2_MAX_WINDOW) ? ERR_FLOW_CONTROL : 0;
+    }
+    if (_id > _s->last_id){
+        return ERR_PROTOCOL;
+    }
+    H2Stream_t* st = StreamFind(_s, _id);
+    if (st == NULL){            // Stream cerrado: puede llegar tarde
+        return 0;
+    }
+    if (increment == 0){
+        return Reset(_s, _id, ERR_PROTOCOL);
+    }
+    st->window += increment;
+    return (st->window > H2_MAX_WINDOW) ? Reset(_s, _id, ERR_FLOW_CONTROL) : 0;
+}
+
+/**
+ * \fn static int OnField(void* _arg, const char* _name, size_t _name_len, const char* _value, size_t _value_len)
+ * \brief Guarda un campo del pedido: los pseudo-encabezados aparte y los demás como líneas HTTP/1.1.
+ * \details Nunca corta la decodificación (la tabla HPACK tiene que quedar al día): un campo inválido marca el
+ * pedido como mal formado. Los campos propios de HTTP/1.1 (Connection, Transfer-Encoding...) no se admiten, y los
+ * saltos de línea tampoco, porque el pedido se vuelve a armar como texto. Content-Length se recalcula.
+ * \param [in] _arg: Fields_t.
+ * \param [in] _name: Nombre.
+ * \param [in] _name_len: Largo del nombre.
+ * \param [in] _value: Valor.
+ * \param [in] _value_len: Largo del valor.
+ * \return 0.
+*/
+static int OnField(void* _arg, const char* _name, size_t _name_len, const char* _value, size_t _value_len)
+{
+    static const char* const banned[] = { "connection", "keep-alive", "proxy-connection", "transfer-encoding", "upgrade" };
+    Fields_t* f = (Fields_t*)_arg;
+
+    if (_name_len == 0 || memchr(_value, '\r', _value_len) || memchr(_value, '\n', _value_len) ||
+        memchr(_value, '\0', _value_len)){
+        f->malformed = 1;
+        return 0;
+    }
+    if (_name[0] == ':'){
+        char* dst = NULL;
+        size_t* dst_len = NULL;
+        size_t size = 0;
+
+        if (f->regular){
+            f->malformed = 1;
+        }
+        else if (_name_len == 7 && memcmp(_name, ":method", 7) == 0){
+            dst = f->method;
+            dst_len = &f->method_len;
+            size = sizeof(f->method);
+        }
+        else if (_name_len == 5 && memcmp(_name, ":path", 5) == 0){
+            dst = f->path;
+            dst_len = &f->path_len;
+            size = sizeof(f->path);
+        }
+        else if (_name_len == 10 && memcmp(_name, ":authority", 10) == 0){
+            dst = f->authority;
+            dst_len = &f->authority_len;
+            size = sizeof(f->authority);
+        }
+        else if (_name_len == 7 && memcmp(_name, ":scheme", 7) == 0){
+            f->malformed |= f->scheme;
+            f->scheme = 1;
+        }
+        else{
+            f->malformed = 1;
+        }
+        if (dst != NULL){
+            if (*dst_len != 0 || _value_len == 0 || memchr(_value, ' ', _value_len)){
+                f->malformed = 1;
+            }
+            else if (_value_len > size){
+                f->too_large = 1;
+            }
+            else{
+                memcpy(dst, _value, _value_len);
+                *dst_len = _value_len;
+            }
+        }
+        return 0;
+    }
+
+    f->regular = 1;
+    for (size_t i = 0; i < _name_len; i++){
+        if (isupper((unsigned char)_name[i]) || _name[i] == ':' || _name[i] == ' '){
+            f->malformed = 1;
+            return 0;
+        }
+    }
+    for (size_t i = 0; i < sizeof(banned) / sizeof(banned[0]); i++){
+        if (strlen(banned[i]) == _name_len && memcmp(banned[i], _name, _name_len) == 0){
+            f->malformed = 1;
+            return 0;
+        }
+    }
+    if ((_name_len == 2 && memcmp(_name, "te", 2) == 0 && (_value_len != 8 || memcmp(_value, "trailers", 8) != 0))){
+        f->malformed = 1;
+        return 0;
+    }
+    if ((_name_len == 14 && memcmp(_name, "content-length", 14) == 0) ||
+        (_name_len == 4 && memcmp(_name, "host", 4) == 0 && f->authority_len > 0)){
+        return 0;
+    }
+    if (f->fields_len + _name_len + _value_len + 4 > sizeof(f->fields)){
+        f->too_large = 1;
+        return 0;
+    }
+    memcpy(f->fields + f->fields_len, _name, _name_len);
+    f->fields_len += _name_len;
+    memcpy(f->fields + f->fields_len, ": ", 2);
+    f->fields_len += 2;
+    memcpy(f->fields + f->fields_len, _value, _value_len);
+    f->fields_len += _value_len;
+    memcpy(f->fields + f->fields_len, "\r\n", 2);
+    f->fields_len += 2;
+    return 0;
+}
+
+/**
+ * \fn static int IgnoreField(void* _arg, const char* _name, size_t _name_len, const char* _value, size_t _value_len)
+ * \brief Descarta un campo (trailers y streams rechazados).
+ * \return 0.
+*/
+static int IgnoreField(void* _arg, const char* _name, size_t _name_len, const char* _value, size_t _value_len)
+{
+    (void)_arg;
+    (void)_name;
+    (void)_name_len;
+    (void)_value;
+    (void)_value_len;
+    return 0;
+}
+
+/**
+ * \fn static int Upgrade(H2Session_t* _s)
+ * \brief Pasa a HTTP/2 una conexión que lo pidió con Upgrade: h2c. Responde 101, envía SETTINGS y atiende el pedido
+ * original como stream 1.
+ * \param [in] _s: Sesión.
+ * \return 0 si se pasó a HTTP/2. 1 si HTTP2-Settings es inválido (no se envió nada). -1 si falló el socket.
+*/
+static int Upgrade(H2Session_t* _s)
+{
+    static const char switching[] = "HTTP/1.1 101 Switching Protocols\r\nConnection: Upgrade\r\nUpgrade: h2c\r\n\r\n";
+    uint8_t settings[H2_PENDING];
+    size_t len;
+
+    const char* value = FindHeader(_s->conn, "HTTP2-Settings", &len);
+    int n = Base64Url(value, len, settings, sizeof(settings));
+    if (n < 0 || n % 6 != 0 || ApplySettings(_s, settings, n) != 0){
+        return 1;
+    }
+    if (ConnWriteAll(_s->conn, switching, sizeof(switching) - 1) < 0 || SendSettings(_s) < 0){
+        return -1;
+    }
+
+    H2Stream_t* st = StreamNew(_s, 1);
+    st->remote_closed = 1;
+    _s->last_id = 1;
+    _s->requests = 1;
+    return (Answer(_s, st, _s->conn, CONN_OK) < 0) ? -1 : 0;
+}
+
+/**
+ * \fn static int Dispatch(H2Session_t* _s, H2Stream_t* _st)
+ * \brief Arma el pedido HTTP/1.1 de un stream completo en una conexión aparte y lo atiende.
+ * \param [in] _s: Sesión.
+ * \param [in] _st: Stream con END_STREAM recibido.
+ * \return 0 si se procesó. Un código de error de conexión (> 0), o -1 si falló el socket.
+*/
+static int Dispatch(H2Session_t* _s, H2Stream_t* _st)
+{
+    char head[H2_HEAD_SIZE + 48];
+    Connection_t conn;
+
+    if (ConnInit(&conn, _s->conn->fd, &_s->conn->limits) < 0){
+        return Reset(_s, _st->id, ERR_INTERNAL);
+    }
+    int status = CONN_TOO_LARGE;
+    if (!_st->too_large){
+        int n = snprintf(head, sizeof(head), "%.*sContent-Length: %zu\r\n\r\n", (int)_st->head_len, _st->head,
+                         _st->body_len);
+        status = ConnSetRequest(&conn, head, n, _st->body, _st->body_len);
+    }
+    free(_st->body);
+    _st->body = NULL;
+    _st->body_len = _st->body_cap = 0;
+
+    int ret = Answer(_s, _st, &conn, status);
+    ConnFree(&conn);
+    return ret;
+}
+
+/**
+ * \fn static int Answer(H2Session_t* _s, H2Stream_t* _st, Connection_t* _conn, int _status)
+ * \brief Atiende el pedido con el socket capturado y pasa la respuesta al stream.
+ * \param [in] _s: Sesión.
+ * \param [in] _st: Stream.
+ * \param [in] _conn: Conexión con el pedido.
+ * \param [in] _status: CONN_OK para atenderlo. Otro CONN_* responde el error con ConnSendError().
+ * \return 0 si se procesó. Un código de error de conexión (> 0), o -1 si falló el socket.
+*/
+static int Answer(H2Session_t* _s, H2Stream_t* _st, Connection_t* _conn, int _status)
+{
+    ConnCapture_t capture;
+
+    ConnCaptureBegin(&capture, _conn->fd);
+    if (_status == CONN_OK){
+        _s->handler(_conn, _s->arg);
+    }
+    else{
+        ConnSendError(_conn, _status);
+    }
+    ConnCaptureEnd();
+    return Respond(_s, _st, &capture);
+}
+
+/**
+ * \fn static int Respond(H2Session_t* _s, H2Stream_t* _st, ConnCapture_t* _capture)
+ * \brief Convierte la respuesta HTTP/1.1 capturada: el encabezado sale en un HEADERS y el cuerpo queda para Flush().
+ * \details Los nombres pasan a minúsculas, Connection y Transfer-Encoding no existen en HTTP/2 y Content-Length
+ * se recalcula (un cuerpo chunked se junta en el lugar). Content-Type y los demás campos se indexan en la tabla
+ * HPACK: desde la segunda respuesta ocupan un byte. La captura pasa a ser del stream.
+ * \param [in] _s: Sesión.
+ * \param [in] _st: Stream.
+ * \param [in] _capture: Respuesta capturada.
+ * \return 0 si se procesó. Un código de error de conexión (> 0), o -1 si falló el socket.
+*/
+static int Respond(H2Session_t* _s, H2Stream_t* _st, ConnCapture_t* _capture)
+{
+    char* data = _capture->data;
+    size_t len = _capture->len;
+    uint8_t block[1024];
+    char name[64];
+    char value[512];
+    int chunked = 0;
+    int n;
+
+    // Fin del encabezado ("\n\n" o "\r\n\r\n", como ParseHeader())
+    size_t end = 0;
+    for (size_t i = 0; i + 1 < len && end == 0; i++){
+        if (data[i] == '\n' && data[i + 1] == '\n'){
+            end = i + 2;
+        }
+        else if (data[i] == '\n' && data[i + 1] == '\r' && i + 2 < len && data[i + 2] == '\n'){
+            end = i + 3;
+        }
+    }
+    if (end == 0 || len < 12 || strncmp(data, "HTTP/1.", 7) != 0){
+        free(data);
+        return Reset(_s, _st->id, ERR_INTERNAL);
+    }
+
+    snprintf(value, sizeof(value), "%.3s", data + 9);
+    n = HpackEncode(&_s->encoder, block, sizeof(block), ":status", value, HPACK_INDEX);
+    size_t block_len = (n > 0) ? n : 0;
+    const char* line = (const char*)memchr(data, '\n', end) + 1;
+    while (line < data + end){
+        const char* eol = (const char*)memchr(line, '\n', data + end - line);
+        const char* colon = (const char*)memchr(line, ':', eol - line);
+        size_t line_len = eol - line;
+        if (line_len > 0 && line[line_len - 1] == '\r'){
+            line_len--;
+        }
+        if (colon != NULL && (size_t)(colon - line) < sizeof(name)){
+            size_t name_len = colon - line;
+            const char* v = colon + 1;
+            while (v < line + line_len && *v == ' '){
+                v++;
+            }
+            for (size_t i = 0; i < name_len; i++){
+                name[i] = tolower((unsigned char)line[i]);
+            }
+            name[name_len] = '\0';
+            snprintf(value, sizeof(value), "%.*s", (int)(line + line_len - v), v);
+            if (strcmp(name, "transfer-encoding") == 0){
+                chunked = (strstr(value, "chunked") != NULL);
+            }
+            else if (strcmp(name, "connection") != 0 && strcmp(name, "content-length") != 0 &&
+                     strcmp(name, "keep-alive") != 0){
+                n = HpackEncode(&_s->encoder, block + block_len, sizeof(block) - block_len, name, value, HPACK_INDEX);
+                block_len += (n > 0) ? n : 0;
+            }
+        }
+        line = eol + 1;
+    }
+
+    char* body = data + end;
+    long body_len = len - end;
+    if (chunked){
+        body_len = Dechunk(body, body_len);
+        if (body_len < 0){
+            free(data);
+            return Reset(_s, _st->id, ERR_INTERNAL);
+        }
+    }
+    snprintf(value, sizeof(value), "%ld", body_len);
+    n = HpackEncode(&_s->encoder, block + block_len, sizeof(block) - block_len, "content-length", value, HPACK_NO_INDEX);
+    block_len += (n > 0) ? n : 0;
+
+    if (Send(_s, FRAME_HEADERS, FLAG_END_HEADERS | (body_len == 0 ? FLAG_END_STREAM : 0), _st->id, block, block_len) < 0){
+        free(data);
+        return -1;
+    }
+    if (body_len == 0){
+        free(data);
+        StreamFree(_st);
+        return 0;
+    }
+    _st->out = data;
+    _st->out_pos = end;
+    _st->out_end = end + body_len;
+    return 0;
+}
+
+/**
+ * \fn static long Dechunk(char* _body, size_t _len)
+ * \brief Junta en el lugar un cuerpo Transfer-Encoding: chunked.
+ * \param [in,out] _body: Cuerpo.
+ * \param [in] _len: Largo del cuerpo.
+ * \return Largo de los datos. -1 si el cuerpo está cortado o mal formado.
+*/
+static long Dechunk(char* _body, size_t _len)
+{
+    size_t in = 0;
+    size_t out = 0;
+
+    while (in < _len){
+        char* num_end;
+        unsigned long size = strtoul(_body + in, &num_end, 16);
+        char* eol = memchr(_body + in, '\n', _len - in);
+        if (num_end == _body + in || eol == NULL){
+            return -1;
+        }
+        in = eol + 1 - _body;
+        if (size == 0){
+            return out;
+        }
+        if (in + size + 2 > _len){
+            return -1;
+        }
+        memmove(_body + out, _body + in, size);
+        out += size;
+        in += size + 2;
+    }
+    return -1;
+}
+
+/**
+ * \fn static int Flush(H2Session_t* _s)
+ * \brief Envía el cuerpo de las respuestas pendientes, de a un DATA por stream por vuelta, mientras las ventanas lo
+ * permitan. Un stream que terminó se libera.
+ * \details Alternar streams hace que una respuesta larga (/log) no demore a las cortas pedidas en paralelo.
+ * \param [in] _s: Sesión.
+ * \return Devuelve -1 si falló el socket. 0 sino.
+*/
+static int Flush(H2Session_t* _s)
+{
+    int progress = 1;
+
+    while (progress && _s->window > 0){
+        progress = 0;
+        for (int i = 0; i < H2_MAX_STREAMS && _s->window > 0; i++){
+            H2Stream_t* st = &_s->streams[(_s->next + i) % H2_MAX_STREAMS];
+            if (st->id == 0 || st->out == NULL || st->window <= 0){
+                continue;
+            }
+            size_t n = st->out_end - st->out_pos;
+            if (n > H2_MAX_FRAME){
+                n = H2_MAX_FRAME;
+            }
+            if ((int64_t)n > _s->window){
+                n = _s->window;
+            }
+            if ((int64_t)n > st->window){
+                n = st->window;
+            }
+            int last = (st->out_pos + n == st->out_end);
+            if (Send(_s, FRAME_DATA, last ? FLAG_END_STREAM : 0, st->id, st->out + st->out_pos, n) < 0){
+                return -1;
+            }
+            st->out_pos += n;
+            st->window -= n;
+            _s->window -= n;
+            if (last){
+                StreamFree(st);
+            }
+            progress = 1;
+        }
+        _s->next = (_s->next + 1) % H2_MAX_STREAMS;
+    }
+    return SendPending(_s);
+}
+
+/**
+ * \fn static int Send(H2Session_t* _s, uint8_t _type, uint8_t _flags, uint32_t _id, const void* _payload, size_t _len)
+ * \brief Envía un frame. Los chicos se juntan en pending y salen con el siguiente grande o con SendPending().
+ * \param [in] _s: Sesión.
+ * \param [in] _type: Tipo.
+ * \param [in] _flags: Flags.
+ * \param [in] _id: Stream.
+ * \param [in] _payload: Contenido. Puede ser NULL si _len es 0.
+ * \param [in] _len: Largo del contenido.
+ * \return Devuelve -1 si falló el socket. 0 sino.
+*/
+static int Send(H2Session_t* _s, uint8_t _type, uint8_t _flags, uint32_t _id, const void* _payload, size_t _len)
+{
+    uint8_t header[H2_FRAME_HEADER];
+
+    header[0] = _len >> 16;
+    header[1] = _len >> 8;
+    header[2] = _len;
+    header[3] = _type;
+    header[4] = _flags;
+    Put32(header + 5, _id);
+
+    if (_s->pending_len + H2_FRAME_HEADER + _len <= H2_PENDING){
+        memcpy(_s->pending + _s->pending_len, header, H2_FRAME_HEADER);
+        if (_len > 0){
+            memcpy(_s->pending + _s->pending_len + H2_FRAME_HEADER, _payload, _len);
+        }
+        _s->pending_len += H2_FRAME_HEADER + _len;
+        return 0;
+    }
+    // No entra: sale todo junto, lo pendiente primero.
+    struct iovec iov[3] = {
+        { .iov_base = _s->pending, .iov_len = _s->pending_len },
+        { .iov_base = header, .iov_len = H2_FRAME_HEADER },
+        { .iov_base = (void*)_payload, .iov_len = _len },
+    };
+    _s->pending_len = 0;
+    return ConnWriteVec(_s->conn, iov, 3);
+}
+
+/**
+ * \fn static int SendPending(H2Session_t* _s)
+ * \brief Escribe los frames juntados en pending.
+ * \param [in] _s: Sesión.
+ * \return Devuelve -1 si falló el socket. 0 sino.
+*/
+static int SendPending(H2Session_t* _s)
+{
+    if (_s->pending_len == 0){
+        return 0;
+    }
+    size_t len = _s->pending_len;
+    _s->pending_len = 0;
+    return ConnWriteAll(_s->conn, _s->pending, len);
+}
+
+/**
+ * \fn static int SendSettings(H2Session_t* _s)
+ * \brief Envía los SETTINGS del servidor: cuántos streams acepta y el tamaño máximo de los encabezados.
+ * \param [in] _s: Sesión.
+ * \return Devuelve -1 si falló el socket. 0 sino.
+*/
+static int SendSettings(H2Session_t* _s)
+{
+    uint8_t settings[12];
+
+    settings[0] = 0;
+    settings[1] = SET_MAX_CONCURRENT_STREAMS;
+    Put32(settings + 2, H2_MAX_STREAMS);
+    settings[6] = 0;
+    settings[7] = SET_MAX_HEADER_LIST_SIZE;
+    Put32(settings + 8, H2_HEAD_SIZE);
+    return Send(_s, FRAME_SETTINGS, 0, 0, settings, sizeof(settings));
+}
+
+/**
+ * \fn static int SendWindow(H2Session_t* _s, uint32_t _id, uint32_t _increment)
+ * \brief Envía un WINDOW_UPDATE.
+ * \param [in] _s: Sesión.
+ * \param [in] _id: Stream. 0: la conexión.
+ * \param [in] _increment: Bytes que se devuelven a la ventana.
+ * \return Devuelve -1 si falló el socket. 0 sino.
+*/
+static int SendWindow(H2Session_t* _s, uint32_t _id, uint32_t _increment)
+{
+    uint8_t payload[4];
+    Put32(payload, _increment);
+    return Send(_s, FRAME_WINDOW_UPDATE, 0, _id, payload, sizeof(payload));
+}
+
+/**
+ * \fn static int SendGoaway(H2Session_t* _s, uint32_t _code)
+ * \brief Envía GOAWAY con el último stream aceptado.
+ * \param [in] _s: Sesión.
+ * \param [in] _code: Código de error.
+ * \return Devuelve -1 si falló el socket. 0 sino.
+*/
+static int SendGoaway(H2Session_t* _s, uint32_t _code)
+{
+    uint8_t payload[8];
+    Put32(payload, _s->last_id);
+    Put32(payload + 4, _code);
+    return Send(_s, FRAME_GOAWAY, 0, 0, payload, sizeof(payload));
+}
+
+/**
+ * \fn static int Reset(H2Session_t* _s, uint32_t _id, uint32_t _code)
+ * \brief Error de stream: envía RST_STREAM y libera el stream. La conexión sigue.
+ * \param [in] _s: Sesión.
+ * \param [in] _id: Stream.
+ * \param [in] _code: Código de error.
+ * \return Devuelve -1 si falló el socket. 0 sino.
+*/
+static int Reset(H2Session_t* _s, uint32_t _id, uint32_t _code)
+{
+    uint8_t payload[4];
+
+    StreamFree(StreamFind(_s, _id));
+    Put32(payload, _code);
+    return Send(_s, FRAME_RST_STREAM, 0, _id, payload, sizeof(payload));
+}
+
+/**
+ * \fn static H2Stream_t* StreamFind(H2Session_t* _s, uint32_t _id)
+ * \brief Busca un stream abierto.
+ * \param [in] _s: Sesión.
+ * \param [in] _id: Stream.
+ * \return El stream. NULL si no está abierto.
+*/
+static H2Stream_t* StreamFind(H2Session_t* _s, uint32_t _id)
+{
+    for (int i = 0; i < H2_MAX_STREAMS; i++){
+        if (_s->streams[i].id == _id){
+            return &_s->streams[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * \fn static H2Stream_t* StreamNew(H2Session_t* _s, uint32_t _id)
+ * \brief Abre un stream con la ventana inicial del cliente.
+ * \param [in] _s: Sesión.
+ * \param [in] _id: Stream.
+ * \return El stream. NULL si ya hay H2_MAX_STREAMS abiertos.
+*/
+static H2Stream_t* StreamNew(H2Session_t* _s, uint32_t _id)
+{
+    H2Stream_t* st = StreamFind(_s, 0);
+    if (st == NULL){
+        return NULL;
+    }
+    st->id = _id;
+    st->remote_closed = 0;
+    st->too_large = 0;
+    st->head_len = 0;
+    st->body = NULL;
+    st->body_len = st->body_cap = 0;
+    st->out = NULL;
+    st->out_pos = st->out_end = 0;
+    st->window = _s->initial_window;
+    return st;
+}
+
+/**
+ * \fn static void StreamFree(H2Stream_t* _st)
+ * \brief Libera el cuerpo y la respuesta de un stream y deja el lugar libre.
+ * \param [in] _st: Stream. NULL no hace nada.
+*/
+static void StreamFree(H2Stream_t* _st)
+{
+    if (_st == NULL){
+        return;
+    }
+    free(_st->body);
+    free(_st->out);
+    _st->body = NULL;
+    _st->out = NULL;
+    _st->id = 0;
+}
+
+/**
+ * \fn static int Busy(const H2Session_t* _s)
+ * \brief Indica si queda algún stream abierto (recibiendo el pedido o enviando la respuesta).
+ * \param [in] _s: Sesión.
+ * \return Distinto de 0 si hay streams abiertos.
+*/
+static int Busy(const H2Session_t* _s)
+{
+    for (int i = 0; i < H2_MAX_STREAMS; i++){
+        if (_s->streams[i].id != 0){
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * \fn static const char* FindHeader(const Connection_t* _conn, const char* _name, size_t* _len)
+ * \brief Busca un campo en el encabezado de un pedido HTTP/1.1, sin distinguir mayúsculas.
+ * \param [in] _conn: Conexión con el pedido completo.
+ * \param [in] _name: Nombre del campo.
+ * \param [out] _len: Largo del valor, sin espacios ni fin de línea. Puede ser NULL.
+ * \return El valor (no termina en '\0'). NULL si no está.
+*/
+static const char* FindHeader(const Connection_t* _conn, const char* _name, size_t* _len)
+{
+    size_t name_len = strlen(_name);
+    const char* end = _conn->buff + _conn->header_len;
+    const char* line = memchr(_conn->buff, '\n', _conn->header_len);
+
+    while (line != NULL && ++line < end){
+        if ((size_t)(end - line) > name_len && strncasecmp(line, _name, name_len) == 0 && line[name_len] == ':'){
+            const char* value = line + name_len + 1;
+            while (value < end && *value == ' '){
+                value++;
+            }
+            const char* value_end = value;
+            while (value_end < end && *value_end != '\r' && *value_end != '\n'){
+                value_end++;
+            }
+            while (value_end > value && value_end[-1] == ' '){
+                value_end--;
+            }
+            if (_len != NULL){
+                *_len = value_end - value;
+            }
+            return value;
+        }
+        line = memchr(line, '\n', end - line);
+    }
+    return NULL;
+}
+
+/**
+ * \fn static int Base64Url(const char* _in, size_t _len, uint8_t* _out, size_t _size)
+ * \brief Decodifica base64url sin relleno (HTTP2-Settings).
+ * \param [in] _in: Texto.
+ * \param [in] _len: Largo del texto.
+ * \param [out] _out: Destino.
+ * \param [in] _size: Tamaño de _out.
+ * \return Bytes decodificados. -1 si el texto es inválido o no entra.
+*/
+static int Base64Url(const char* _in, size_t _len, uint8_t* _out, size_t _size)
+{
+    uint32_t acc = 0;
+    int bits = 0;
+    size_t len = 0;
+
+    for (size_t i = 0; i < _len; i++){
+        char c = _in[i];
+        int v;
+        if (c >= 'A' && c <= 'Z') v = c - 'A';
+        else if (c >= 'a' && c <= 'z') v = c - 'a' + 26;
+        else if (c >= '0' && c <= '9') v = c - '0' + 52;
+        else if (c == '-') v = 62;
+        else if (c == '_') v = 63;
+        else if (c == '=') break;
+        else return -1;
+
+        acc = (acc << 6) | v;
+        bits += 6;
+        if (bits >= 8){
+            bits -= 8;
+            if (len >= _size){
+                return -1;
+            }
+            _out[len++] = acc >> bits;
+        }
+    }
+    return len;
+}
+
+/**
+ * \fn static uint32_t Get32(const uint8_t* _p)
+ * \brief Lee un entero de 32 bits en orden de red.
+ * \param [in] _p: Datos.
+ * \return Valor.
+*/
+static uint32_t Get32(const uint8_t* _p)
+{
+    return ((uint32_t)_p[0] << 24) | ((uint32_t)_p[1] << 16) | ((uint32_t)_p[2] << 8) | _p[3];
+}
+
+/**
+ * \fn static void Put32(uint8_t* _p, uint32_t _value)
+ * \brief Escribe un entero de 32 bits en orden de red.
+ * \param [out] _p: Destino.
+ * \param [in] _value: Valor.
+*/
+static void Put32(uint8_t* _p, uint32_t _value)
+{
+    _p[0] = _value >> 24;
+    _p[1] = _value >> 16;
+    _p[2] = _value >> 8;
+    _p[3] = _value;
+}
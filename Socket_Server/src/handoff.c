@@ -0,0 +1,221 @@
+/*******************************************************************************************************************************//**
+ *
+ * @file		handoff.c
+ * @brief		Traspaso de sockets de escucha y memoria compartida a un binario nuevo (actualización sin cortes).
+ * @date		19 oct. 2026
+ * @author		Martinez Agustin
+ *
+ **********************************************************************************************************************************/
+
+ /***********************************************************************************************************************************
+ *** INCLUDES
+ **********************************************************************************************************************************/
+#include "../inc/handoff.h"
+
+/***********************************************************************************************************************************
+ *** IMPLEMENTACION DE LOS METODODS DE LA CLASE
+ **********************************************************************************************************************************/
+/**
+ * \fn int HandoffSpawn(char* _argv[], int* _sock)
+ * \brief Ejecuta el binario nuevo con un socket de traspaso.
+ * \details Crea un socketpair y ejecuta _argv[0] con HANDOFF_ENV apuntando a su extremo. Se hace doble fork()
+ * para que el proceso nuevo no sea hijo del viejo: así no entra en la cuenta de hijos del proceso viejo y
+ * sigue vivo cuando el viejo termina. El proceso nuevo cierra el resto de los fds heredados:
+ * los que necesita le llegan por el socket.
+ * \param [in] _argv: Argumentos con los que se ejecutó el servidor.
+ * \param [out] _sock: Extremo del socket del proceso viejo.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+int HandoffSpawn(char* _argv[], int* _sock)
+{
+    int sv[2];
+    int status;
+    char fd_text[16];
+    sigset_t mask, oldmask;
+
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == -1){
+        return -1;
+    }
+
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &mask, &oldmask);    // El intermedio lo junto yo, no el lazo principal
+
+    pid_t pid = fork();
+    if (pid == 0){
+        if (fork() != 0){       // Intermedio
+            _exit(0);
+        }
+        // Proceso nuevo (nieto):
+        sigprocmask(SIG_SETMASK, &oldmask, NULL);
+        long max_fd = sysconf(_SC_OPEN_MAX);
+        for (int fd = 3; fd < max_fd && fd < 4096; fd++){
+            if (fd != sv[1]){
+                close(fd);
+            }
+        }
+        snprintf(fd_text, sizeof(fd_text), "%d", sv[1]);
+        setenv(HANDOFF_ENV, fd_text, 1);
+        execv(_argv[0], _argv);
+        perror("Error en exec del binario nuevo");
+        _exit(1);
+    }
+    if (pid > 0){
+        waitpid(pid, &status, 0);
+    }
+    sigprocmask(SIG_SETMASK, &oldmask, NULL);
+
+    close(sv[1]);
+    if (pid < 0){
+        close(sv[0]);
+        return -1;
+    }
+    *_sock = sv[0];
+    return 0;
+}
+
+/**
+ * \fn int HandoffSend(int _sock, const HandoffState_t* _state)
+ * \brief Envía el estado y los fds al proceso nuevo.
+ * \param [in] _sock: Socket de traspaso.
+ * \param [in] _state: Estado a enviar.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+int HandoffSend(int _sock, const HandoffState_t* _state)
+{
+    int fds[HANDOFF_MAX_FDS];
+    int nfds = 0;
+    char control[CMSG_SPACE(sizeof(fds))];
+
+    for (int i = 0; i < _state->listeners_count; i++){
+        fds[nfds++] = _state->listeners[i].fd;
+    }
+    for (int i = 0; i < _state->doors.count; i++){
+        fds[nfds++] = _state->doors.door[i].driver;
+    }
+    if (_state->repl_listener.fd >= 0){
+        fds[nfds++] = _state->repl_listener.fd;
+    }
+
+    struct iovec iov = { .iov_base = (void*)_state, .iov_len = sizeof(HandoffState_t) };
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    memset(control, 0, sizeof(control));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = CMSG_SPACE(sizeof(int) * nfds);
+
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int) * nfds);
+    memcpy(CMSG_DATA(cmsg), fds, sizeof(int) * nfds);
+
+    if (sendmsg(_sock, &msg, MSG_NOSIGNAL) != sizeof(HandoffState_t)){
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * \fn int HandoffWaitReady(int _sock, int _timeout_ms)
+ * \brief Espera la confirmación del proceso nuevo.
+ * \param [in] _sock: Socket de traspaso.
+ * \param [in] _timeout_ms: Espera máxima.
+ * \return 0 si el proceso nuevo ya atiende clientes. -1 si falló (el viejo debe seguir atendiendo).
+*/
+int HandoffWaitReady(int _sock, int _timeout_ms)
+{
+    struct pollfd pfd = { .fd = _sock, .events = POLLIN };
+    char ack = 0;
+    int n;
+
+    do {
+        n = poll(&pfd, 1, _timeout_ms);
+    } while (n < 0 && errno == EINTR);
+    if (n <= 0){
+        return -1;
+    }
+    if (recv(_sock, &ack, 1, 0) != 1 || ack != 'R'){   // EOF: el binario nuevo no arrancó
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * \fn int HandoffReceive(HandoffState_t* _state, int* _sock)
+ * \brief En el proceso nuevo: recibe el estado si se lo ejecutó por traspaso.
+ * \param [out] _state: Estado recibido, con los fds ya válidos en este proceso.
+ * \param [out] _sock: Socket de traspaso para confirmar con HandoffReady().
+ * \return 1 si hubo traspaso, 0 si es un arranque normal, -1 si error.
+*/
+int HandoffReceive(HandoffState_t* _state, int* _sock)
+{
+    int fds[HANDOFF_MAX_FDS];
+    char control[CMSG_SPACE(sizeof(fds))];
+    const char* env = getenv(HANDOFF_ENV);
+
+    if (env == NULL){
+        return 0;
+    }
+    *_sock = atoi(env);
+    unsetenv(HANDOFF_ENV);  // Un próximo traspaso arma su propio socket
+
+    struct iovec iov = { .iov_base = _state, .iov_len = sizeof(HandoffState_t) };
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    ssize_t len;
+    do {
+        len = recvmsg(*_sock, &msg, MSG_WAITALL);
+    } while (len < 0 && errno == EINTR);
+    if (len != sizeof(HandoffState_t) || _state->magic != HANDOFF_MAGIC || _state->version != HANDOFF_VERSION){
+        close(*_sock);
+        return -1;
+    }
+
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    if (cmsg == NULL || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS){
+        close(*_sock);
+        return -1;
+    }
+    int nfds = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+    if (_state->listeners_count > MAX_LISTENERS || _state->doors.count > MAX_DOORS
+        || nfds != _state->listeners_count + _state->doors.count + (_state->repl_listener.fd >= 0)){
+        close(*_sock);
+        return -1;
+    }
+    memcpy(fds, CMSG_DATA(cmsg), sizeof(int) * nfds);
+
+    // Los números de fd cambian al pasar de proceso:
+    for (int i = 0; i < _state->listeners_count; i++){
+        _state->listeners[i].fd = fds[i];
+    }
+    for (int i = 0; i < _state->doors.count; i++){
+        _state->doors.door[i].driver = fds[_state->listeners_count + i];
+        _state->doors.door[i].pid = -1;     // Los lectores los lanza el proceso nuevo
+    }
+    if (_state->repl_listener.fd >= 0){
+        _state->repl_listener.fd = fds[nfds - 1];
+    }
+    return 1;
+}
+
+/**
+ * \fn int HandoffReady(int _sock)
+ * \brief En el proceso nuevo: avisa al viejo que ya atiende clientes y cierra el socket.
+ * \param [in] _sock: Socket de traspaso.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+int HandoffReady(int _sock)
+{
+    char ack = 'R';
+    int ret = (send(_sock, &ack, 1, MSG_NOSIGNAL) == 1) ? 0 : -1;
+    close(_sock);
+    return ret;
+}
@@ -0,0 +1,561 @@
+/*******************************************************************************************************************************//**
+ *
+ * @file		hpack.c
+ * @brief		HPACK (RFC 7541): compresión de encabezados de HTTP/2 con tabla estática, tabla dinámica y Huffman.
+ * @date		19 oct. 2026
+ * @author		Martinez Agustin
+ *
+ **********************************************************************************************************************************/
+
+ /***********************************************************************************************************************************
+ *** INCLUDES
+ **********************************************************************************************************************************/
+#include "../inc/hpack.h"
+#include <pthread.h>    // pthread_once()
+
+/***********************************************************************************************************************************
+ *** DEFINES PRIVADOS AL MODULO
+ **********************************************************************************************************************************/
+#define HUFFMAN_SYMBOLS 257         /**< 256 bytes y EOS */
+#define HUFFMAN_MAX_LEN 30          /**< Código más largo */
+#define INTEGER_MAX     (1 << 24)   /**< Mayor entero que se acepta (índices, largos y tamaños) */
+
+/***********************************************************************************************************************************
+ *** TIPO DE DATOS PRIVADOS AL MODULO
+ **********************************************************************************************************************************/
+/**
+ * \struct StaticEntry_t
+ * \brief Una entrada de la tabla estática.
+ */
+typedef struct {
+    const char* name;
+    const char* value;
+} StaticEntry_t;
+
+/***********************************************************************************************************************************
+ *** VARIABLES GLOBALES PRIVADAS AL MODULO
+ **********************************************************************************************************************************/
+/** Tabla estática (RFC 7541 apéndice A). El índice 1 es static_table[0] */
+static const StaticEntry_t static_table[HPACK_STATIC] = {
+    {":authority", ""}, {":method", "GET"}, {":method", "POST"}, {":path", "/"}, {":path", "/index.html"},
+    {":scheme", "http"}, {":scheme", "https"}, {":status", "200"}, {":status", "204"}, {":status", "206"},
+    {":status", "304"}, {":status", "400"}, {":status", "404"}, {":status", "500"}, {"accept-charset", ""},
+    {"accept-encoding", "gzip, deflate"}, {"accept-language", ""}, {"accept-ranges", ""}, {"accept", ""},
+    {"access-control-allow-origin", ""}, {"age", ""}, {"allow", ""}, {"authorization", ""}, {"cache-control", ""},
+    {"content-disposition", ""}, {"content-encoding", ""}, {"content-language", ""}, {"content-length", ""},
+    {"content-location", ""}, {"content-range", ""}, {"content-type", ""}, {"cookie", ""}, {"date", ""},
+    {"etag", ""}, {"expect", ""}, {"expires", ""}, {"from", ""}, {"host", ""}, {"if-match", ""},
+    {"if-modified-since", ""}, {"if-none-match", ""}, {"if-range", ""}, {"if-unmodified-since", ""},
+    {"last-modified", ""}, {"link", ""}, {"location", ""}, {"max-forwards", ""}, {"proxy-authenticate", ""},
+    {"proxy-authorization", ""}, {"range", ""}, {"referer", ""}, {"refresh", ""}, {"retry-after", ""},
+    {"server", ""}, {"set-cookie", ""}, {"strict-transport-security", ""}, {"transfer-encoding", ""},
+    {"user-agent", ""}, {"vary", ""}, {"via", ""}, {"www-authenticate", ""},
+};
+
+/**
+ * Largo del código de Huffman de cada símbolo (RFC 7541 apéndice B). El código es canónico: ordenando los símbolos
+ * por largo y valor, cada código es el anterior más uno (corrido a la izquierda al cambiar de largo), así que alcanza
+ * con los largos para decodificar.
+ */
+static const uint8_t huffman_len[HUFFMAN_SYMBOLS] = {
+    13, 23, 28, 28, 28, 28, 28, 28, 28, 24, 30, 28, 28, 30, 28, 28,  /*   0 */
+    28, 28, 28, 28, 28, 28, 30, 28, 28, 28, 28, 28, 28, 28, 28, 28,  /*  16 */
+     6, 10, 10, 12, 13,  6,  8, 11, 10, 10,  8, 11,  8,  6,  6,  6,  /*  32 */
+     5,  5,  5,  6,  6,  6,  6,  6,  6,  6,  7,  8, 15,  6, 12, 10,  /*  48 */
+    13,  6,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  /*  64 */
+     7,  7,  7,  7,  7,  7,  7,  7,  8,  7,  8, 13, 19, 13, 14,  6,  /*  80 */
+    15,  5,  6,  5,  6,  5,  6,  6,  6,  5,  7,  7,  6,  6,  6,  5,  /*  96 */
+     6,  7,  6,  5,  5,  6,  7,  7,  7,  7,  7, 15, 11, 14, 13, 28,  /* 112 */
+    20, 22, 20, 20, 22, 22, 22, 23, 22, 23, 23, 23, 23, 23, 24, 23,  /* 128 */
+    24, 24, 22, 23, 24, 23, 23, 23, 23, 21, 22, 23, 22, 23, 23, 24,  /* 144 */
+    22, 21, 20, 22, 22, 23, 23, 21, 23, 22, 22, 24, 21, 22, 23, 23,  /* 160 */
+    21, 21, 22, 21, 23, 22, 23, 23, 20, 22, 22, 22, 23, 22, 22, 23,  /* 176 */
+    26, 26, 20, 19, 22, 23, 22, 25, 26, 26, 26, 27, 27, 26, 24, 25,  /* 192 */
+    19, 21, 26, 27, 27, 26, 27, 24, 21, 21, 26, 26, 28, 27, 27, 27,  /* 208 */
+    20, 24, 20, 21, 22, 21, 21, 23, 22, 22, 25, 25, 24, 24, 26, 23,  /* 224 */
+    26, 27, 26, 26, 27, 27, 27, 27, 27, 28, 27, 27, 27, 27, 27, 26,  /* 240 */
+    30                                                               /* 256: EOS */
+};
+
+static uint16_t huffman_sorted[HUFFMAN_SYMBOLS];        /**< Símbolos ordenados por largo de código y valor */
+static uint16_t huffman_count[HUFFMAN_MAX_LEN + 1];     /**< Códigos de cada largo */
+static pthread_once_t huffman_once = PTHREAD_ONCE_INIT; /**< Arma las dos tablas de arriba la primera vez */
+
+/***********************************************************************************************************************************
+ *** PROTOTIPOS DE FUNCIONES PRIVADAS AL MODULO
+ **********************************************************************************************************************************/
+static int DecodeInteger(const uint8_t** _pos, const uint8_t* _end, int _prefix, uint32_t* _value);
+static int EncodeInteger(uint8_t* _out, size_t _size, int _prefix, uint8_t _flags, uint32_t _value);
+static int DecodeString(const uint8_t** _pos, const uint8_t* _end, char* _out, size_t* _len);
+static int DecodeHuffman(const uint8_t* _in, size_t _len, char* _out, size_t* _out_len);
+static void HuffmanBuild(void);
+static int Lookup(const HpackTable_t* _table, uint32_t _index, const char** _name, size_t* _name_len, const char** _value, size_t* _value_len);
+static void Insert(HpackTable_t* _table, const char* _name, size_t _name_len, const char* _value, size_t _value_len);
+static void Evict(HpackTable_t* _table, size_t _needed);
+
+/***********************************************************************************************************************************
+ *** IMPLEMENTACION DE LOS METODODS DE LA CLASE
+ **********************************************************************************************************************************/
+/**
+ * \fn void HpackInit(HpackTable_t* _table, size_t _limit)
+ * \brief Deja la tabla vacía con tamaño máximo _limit.
+ * \param [out] _table: Tabla.
+ * \param [in] _limit: Tamaño máximo (a lo sumo HPACK_TABLE_SIZE).
+*/
+void HpackInit(HpackTable_t* _table, size_t _limit)
+{
+    _table->count = 0;
+    _table->size = 0;
+    _table->text_len = 0;
+    _table->limit = (_limit < HPACK_TABLE_SIZE) ? _limit : HPACK_TABLE_SIZE;
+    _table->max_size = _table->limit;
+    _table->resized = 0;
+}
+
+/**
+ * \fn int HpackDecode(HpackTable_t* _table, const uint8_t* _block, size_t _len, HpackField_t _field, void* _arg)
+ * \brief Decodifica un bloque de encabezados completo y llama a _field por cada campo, en orden.
+ * \details Cualquier error deja la tabla inconsistente con la del otro lado: es un error de compresión y la
+ * conexión no se puede seguir usando.
+ * \param [in] _table: Tabla dinámica del decodificador.
+ * \param [in] _block: Bloque (HEADERS más sus CONTINUATION).
+ * \param [in] _len: Largo del bloque.
+ * \param [in] _field: Función para cada campo.
+ * \param [in] _arg: Argumento de _field.
+ * \return Devuelve -1 si el bloque es inválido o _field cortó. 0 sino.
+*/
+int HpackDecode(HpackTable_t* _table, const uint8_t* _block, size_t _len, HpackField_t _field, void* _arg)
+{
+    static __thread char name[HPACK_STRING_MAX];
+    static __thread char value[HPACK_STRING_MAX];
+    const uint8_t* pos = _block;
+    const uint8_t* end = _block + _len;
+    int fields = 0;
+
+    while (pos < end){
+        const char* n;
+        const char* v;
+        size_t n_len, v_len;
+        uint32_t index;
+        uint8_t first = *pos;
+
+        if (first & 0x80){              // Campo indexado
+            if (DecodeInteger(&pos, end, 7, &index) < 0 || Lookup(_table, index, &n, &n_len, &v, &v_len) < 0 ||
+                _field(_arg, n, n_len, v, v_len) < 0){
+                return -1;
+            }
+            fields++;
+            continue;
+        }
+        if ((first & 0xE0) == 0x20){    // Actualización del tamaño de la tabla: solo antes del primer campo
+            if (fields > 0 || DecodeInteger(&pos, end, 5, &index) < 0 || index > _table->limit){
+                return -1;
+            }
+            _table->max_size = index;
+            Evict(_table, 0);
+            continue;
+        }
+
+        // Literal: con indexado incremental (01), sin indexar (0000) o nunca indexado (0001)
+        int indexing = (first & 0xC0) == 0x40;
+        if (DecodeInteger(&pos, end, indexing ? 6 : 4, &index) < 0){
+            return -1;
+        }
+        if (index == 0){
+            n_len = sizeof(name);
+            if (DecodeString(&pos, end, name, &n_len) < 0){
+                return -1;
+            }
+        }
+        else{
+            if (Lookup(_table, index, &n, &n_len, &v, &v_len) < 0){
+                return -1;
+            }
+            memcpy(name, n, n_len);     // Insert() puede desalojar la entrada de donde sale el nombre
+        }
+        v_len = sizeof(value);
+        if (DecodeString(&pos, end, value, &v_len) < 0 || _field(_arg, name, n_len, value, v_len) < 0){
+            return -1;
+        }
+        if (indexing){
+            Insert(_table, name, n_len, value, v_len);
+        }
+        fields++;
+    }
+    return 0;
+}
+
+/**
+ * \fn void HpackResize(HpackTable_t* _table, size_t _limit)
+ * \brief Codificador: el otro lado cambió SETTINGS_HEADER_TABLE_SIZE. Se avisa en el próximo bloque.
+ * \param [in] _table: Tabla dinámica del codificador.
+ * \param [in] _limit: Tamaño máximo nuevo (se usa a lo sumo HPACK_TABLE_SIZE).
+*/
+void HpackResize(HpackTable_t* _table, size_t _limit)
+{
+    size_t size = (_limit < HPACK_TABLE_SIZE) ? _limit : HPACK_TABLE_SIZE;
+    if (size != _table->max_size){
+        _table->limit = size;
+        _table->max_size = size;
+        _table->resized = 1;
+        Evict(_table, 0);
+    }
+}
+
+/**
+ * \fn int HpackEncode(HpackTable_t* _table, uint8_t* _out, size_t _size, const char* _name, const char* _value, int _mode)
+ * \brief Agrega un campo a un bloque de encabezados.
+ * \details Usa un índice si el campo ya está en la tabla estática o en la dinámica. Sino va como literal, con el
+ * nombre indexado si se puede, y con HPACK_INDEX queda en la tabla dinámica para las respuestas siguientes. Los
+ * literales no usan Huffman. El primer campo de un bloque lleva el aviso de HpackResize() si hay uno pendiente.
+ * \param [in] _table: Tabla dinámica del codificador.
+ * \param [out] _out: Destino.
+ * \param [in] _size: Espacio en _out.
+ * \param [in] _name: Nombre en minúsculas.
+ * \param [in] _value: Valor.
+ * \param [in] _mode: HPACK_INDEX o HPACK_NO_INDEX.
+ * \return Bytes escritos. -1 si no entra.
+*/
+int HpackEncode(HpackTable_t* _table, uint8_t* _out, size_t _size, const char* _name, const char* _value, int _mode)
+{
+    size_t name_len = strlen(_name);
+    size_t value_len = strlen(_value);
+    uint32_t name_index = 0;
+    int len = 0;
+    int n;
+
+    if (_table->resized){
+        len = EncodeInteger(_out, _size, 5, 0x20, _table->max_size);
+        if (len < 0){
+            return -1;
+        }
+        _table->resized = 0;
+    }
+
+    // Campo completo o solo el nombre, primero en la tabla estática y después en la dinámica
+    for (int i = 0; i < HPACK_STATIC; i++){
+        if (strcmp(static_table[i].name, _name) == 0){
+            if (strcmp(static_table[i].value, _value) == 0){
+                n = EncodeInteger(_out + len, _size - len, 7, 0x80, i + 1);
+                return (n < 0) ? -1 : len + n;
+            }
+            if (name_index == 0){
+                name_index = i + 1;
+            }
+        }
+    }
+    for (int i = 0; i < _table->count; i++){
+        const HpackEntry_t* e = &_table->entry[i];
+        const char* text = _table->text + e->offset;
+        if (e->name_len == name_len && memcmp(text, _name, name_len) == 0){
+            if (e->value_len == value_len && memcmp(text + name_len, _value, value_len) == 0){
+                n = EncodeInteger(_out + len, _size - len, 7, 0x80, HPACK_STATIC + 1 + i);
+                return (n < 0) ? -1 : len + n;
+            }
+            if (name_index == 0){
+                name_index = HPACK_STATIC + 1 + i;
+            }
+        }
+    }
+
+    int indexing = (_mode == HPACK_INDEX);
+    n = indexing ? EncodeInteger(_out + len, _size - len, 6, 0x40, name_index)
+                 : EncodeInteger(_out + len, _size - len, 4, 0x00, name_index);
+    if (n < 0){
+        return -1;
+    }
+    len += n;
+    if (name_index == 0){
+        n = EncodeInteger(_out + len, _size - len, 7, 0x00, name_len);
+        if (n < 0 || len + n + name_len > _size){
+            return -1;
+        }
+        len += n;
+        memcpy(_out + len, _name, name_len);
+        len += name_len;
+    }
+    n = EncodeInteger(_out + len, _size - len, 7, 0x00, value_len);
+    if (n < 0 || len + n + value_len > _size){
+        return -1;
+    }
+    len += n;
+    memcpy(_out + len, _value, value_len);
+    len += value_len;
+
+    if (indexing){
+        Insert(_table, _name, name_len, _value, value_len);
+    }
+    return len;
+}
+
+/***********************************************************************************************************************************
+ *** FUNCIONES PRIVADAS AL MODULO
+ **********************************************************************************************************************************/
+/**
+ * \fn static int DecodeInteger(const uint8_t** _pos, const uint8_t* _end, int _prefix, uint32_t* _value)
+ * \brief Lee un entero con prefijo de _prefix bits (RFC 7541 5.1) y avanza *_pos.
+ * \param [in,out] _pos: Posición en el bloque.
+ * \param [in] _end: Fin del bloque.
+ * \param [in] _prefix: Bits del prefijo (1 a 8).
+ * \param [out] _value: Valor.
+ * \return Devuelve -1 si el entero está cortado o pasa INTEGER_MAX. 0 sino.
+*/
+static int DecodeInteger(const uint8_t** _pos, const uint8_t* _end, int _prefix, uint32_t* _value)
+{
+    const uint8_t* pos = *_pos;
+    uint32_t mask = (1u << _prefix) - 1;
+    uint32_t value;
+
+    if (pos >= _end){
+        return -1;
+    }
+    value = *pos++ & mask;
+    if (value == mask){
+        int shift = 0;
+        uint8_t b;
+        do{
+            if (pos >= _end || shift > 21){
+                return -1;
+            }
+            b = *pos++;
+            value += (uint32_t)(b & 0x7F) << shift;
+            shift += 7;
+        } while (b & 0x80);
+        if (value > INTEGER_MAX){
+            return -1;
+        }
+    }
+    *_value = value;
+    *_pos = pos;
+    return 0;
+}
+
+/**
+ * \fn static int EncodeInteger(uint8_t* _out, size_t _size, int _prefix, uint8_t _flags, uint32_t _value)
+ * \brief Escribe un entero con prefijo de _prefix bits. Los bits altos del primer byte son _flags.
+ * \param [out] _out: Destino.
+ * \param [in] _size: Espacio en _out.
+ * \param [in] _prefix: Bits del prefijo (1 a 8).
+ * \param [in] _flags: Bits que van arriba del prefijo.
+ * \param [in] _value: Valor.
+ * \return Bytes escritos. -1 si no entra.
+*/
+static int EncodeInteger(uint8_t* _out, size_t _size, int _prefix, uint8_t _flags, uint32_t _value)
+{
+    uint32_t mask = (1u << _prefix) - 1;
+    size_t len = 0;
+
+    if (_size == 0){
+        return -1;
+    }
+    if (_value < mask){
+        _out[len++] = _flags | _value;
+        return len;
+    }
+    _out[len++] = _flags | mask;
+    _value -= mask;
+    while (_value >= 0x80){
+        if (len >= _size){
+            return -1;
+        }
+        _out[len++] = (_value & 0x7F) | 0x80;
+        _value >>= 7;
+    }
+    if (len >= _size){
+        return -1;
+    }
+    _out[len++] = _value;
+    return len;
+}
+
+/**
+ * \fn static int DecodeString(const uint8_t** _pos, const uint8_t* _end, char* _out, size_t* _len)
+ * \brief Lee un string (RFC 7541 5.2), literal o con Huffman, y avanza *_pos.
+ * \param [in,out] _pos: Posición en el bloque.
+ * \param [in] _end: Fin del bloque.
+ * \param [out] _out: Destino.
+ * \param [in,out] _len: Tamaño de _out. Queda el largo del string.
+ * \return Devuelve -1 si el string está cortado, no entra o tiene un código inválido. 0 sino.
+*/
+static int DecodeString(const uint8_t** _pos, const uint8_t* _end, char* _out, size_t* _len)
+{
+    uint32_t len;
+    int huffman;
+
+    if (*_pos >= _end){
+        return -1;
+    }
+    huffman = **_pos & 0x80;
+    if (DecodeInteger(_pos, _end, 7, &len) < 0 || len > (size_t)(_end - *_pos)){
+        return -1;
+    }
+    if (huffman){
+        if (DecodeHuffman(*_pos, len, _out, _len) < 0){
+            return -1;
+        }
+    }
+    else{
+        if (len > *_len){
+            return -1;
+        }
+        memcpy(_out, *_pos, len);
+        *_len = len;
+    }
+    *_pos += len;
+    return 0;
+}
+
+/**
+ * \fn static int DecodeHuffman(const uint8_t* _in, size_t _len, char* _out, size_t* _out_len)
+ * \brief Decodifica un string con el código de Huffman canónico, bit a bit.
+ * \details En cada largo los códigos son consecutivos: si el código leído menos el primero de ese largo es menor
+ * que la cantidad de códigos de ese largo, ese es el símbolo. El relleno final tiene que ser un prefijo de EOS
+ * (todos unos) de menos de 8 bits, y EOS no puede aparecer.
+ * \param [in] _in: Datos.
+ * \param [in] _len: Largo de _in.
+ * \param [out] _out: Destino.
+ * \param [in,out] _out_len: Tamaño de _out. Queda el largo decodificado.
+ * \return Devuelve -1 si el código es inválido o no entra. 0 sino.
+*/
+static int DecodeHuffman(const uint8_t* _in, size_t _len, char* _out, size_t* _out_len)
+{
+    uint32_t code = 0;      // Bits leídos del símbolo en curso
+    uint32_t first = 0;     // Primer código del largo en curso
+    uint32_t index = 0;     // Posición en huffman_sorted del primer código del largo en curso
+    int bits = 0;           // Largo del símbolo en curso
+    size_t len = 0;
+
+    pthread_once(&huffman_once, HuffmanBuild);
+    for (size_t i = 0; i < _len; i++){
+        for (int b = 7; b >= 0; b--){
+            code = (code << 1) | ((_in[i] >> b) & 1);
+            bits++;
+            if (code - first < huffman_count[bits]){
+                uint16_t symbol = huffman_sorted[index + code - first];
+                if (symbol == HUFFMAN_SYMBOLS - 1 || len >= *_out_len){
+                    return -1;
+                }
+                _out[len++] = (char)symbol;
+                code = first = index = 0;
+                bits = 0;
+                continue;
+            }
+            if (bits >= HUFFMAN_MAX_LEN){
+                return -1;
+            }
+            index += huffman_count[bits];
+            first = (first + huffman_count[bits]) << 1;
+        }
+    }
+    if (bits > 7 || code != (1u << bits) - 1){
+        return -1;
+    }
+    *_out_len = len;
+    return 0;
+}
+
+/**
+ * \fn static void HuffmanBuild(void)
+ * \brief Ordena los símbolos por largo de código y cuenta los códigos de cada largo.
+*/
+static void HuffmanBuild(void)
+{
+    int n = 0;
+    for (int bits = 1; bits <= HUFFMAN_MAX_LEN; bits++){
+        for (int symbol = 0; symbol < HUFFMAN_SYMBOLS; symbol++){
+            if (huffman_len[symbol] == bits){
+                huffman_sorted[n++] = symbol;
+                huffman_count[bits]++;
+            }
+        }
+    }
+}
+
+/**
+ * \fn static int Lookup(const HpackTable_t* _table, uint32_t _index, const char** _name, size_t* _name_len, const char** _value, size_t* _value_len)
+ * \brief Busca un índice en la tabla estática (1 a 61) o en la dinámica (62 en adelante, la más nueva primero).
+ * \param [in] _table: Tabla dinámica.
+ * \param [in] _index: Índice.
+ * \param [out] _name: Nombre.
+ * \param [out] _name_len: Largo del nombre.
+ * \param [out] _value: Valor.
+ * \param [out] _value_len: Largo del valor.
+ * \return Devuelve -1 si el índice no existe. 0 sino.
+*/
+static int Lookup(const HpackTable_t* _table, uint32_t _index, const char** _name, size_t* _name_len, const char** _value, size_t* _value_len)
+{
+    if (_index == 0){
+        return -1;
+    }
+    if (_index <= HPACK_STATIC){
+        const StaticEntry_t* s = &static_table[_index - 1];
+        *_name = s->name;
+        *_name_len = strlen(s->name);
+        *_value = s->value;
+        *_value_len = strlen(s->value);
+        return 0;
+    }
+    _index -= HPACK_STATIC + 1;
+    if (_index >= (uint32_t)_table->count){
+        return -1;
+    }
+    const HpackEntry_t* e = &_table->entry[_index];
+    *_name = _table->text + e->offset;
+    *_name_len = e->name_len;
+    *_value = *_name + e->name_len;
+    *_value_len = e->value_len;
+    return 0;
+}
+
+/**
+ * \fn static void Insert(HpackTable_t* _table, const char* _name, size_t _name_len, const char* _value, size_t _value_len)
+ * \brief Agrega una entrada al principio de la tabla dinámica, desalojando las más viejas que hagan falta.
+ * \details Una entrada más grande que la tabla la deja vacía y no se agrega (RFC 7541 4.4).
+ * \param [in] _table: Tabla dinámica.
+ * \param [in] _name: Nombre (no puede apuntar dentro de la tabla).
+ * \param [in] _name_len: Largo del nombre.
+ * \param [in] _value: Valor (no puede apuntar dentro de la tabla).
+ * \param [in] _value_len: Largo del valor.
+*/
+static void Insert(HpackTable_t* _table, const char* _name, size_t _name_len, const char* _value, size_t _value_len)
+{
+    size_t text = _name_len + _value_len;
+    size_t size = text + HPACK_ENTRY_EXTRA;
+
+    if (size > _table->max_size){
+        _table->count = 0;
+        _table->size = 0;
+        _table->text_len = 0;
+        return;
+    }
+    Evict(_table, size);
+
+    memmove(_table->text + text, _table->text, _table->text_len);
+    memmove(&_table->entry[1], &_table->entry[0], _table->count * sizeof(HpackEntry_t));
+    for (int i = 1; i <= _table->count; i++){
+        _table->entry[i].offset += text;
+    }
+    memcpy(_table->text, _name, _name_len);
+    memcpy(_table->text + _name_len, _value, _value_len);
+    _table->entry[0].offset = 0;
+    _table->entry[0].name_len = _name_len;
+    _table->entry[0].value_len = _value_len;
+    _table->count++;
+    _table->size += size;
+    _table->text_len += text;
+}
+
+/**
+ * \fn static void Evict(HpackTable_t* _table, size_t _needed)
+ * \brief Desaloja las entradas más viejas hasta que entren _needed bytes más sin pasar max_size.
+ * \param [in] _table: Tabla dinámica.
+ * \param [in] _needed: Tamaño de la entrada por agregar. 0 solo ajusta al tamaño máximo.
+*/
+static void Evict(HpackTable_t* _table, size_t _needed)
+{
+    while (_table->count > 0 && _table->size + _needed > _table->max_size){
+        const HpackEntry_t* e = &_table->entry[--_table->count];
+        _table->size -= e->name_len + e->value_len + HPACK_ENTRY_EXTRA;
+        _table->text_len -= e->name_len + e->value_len;
+    }
+}
@@ -0,0 +1,245 @@
+/*******************************************************************************************************************************//**
+ *
+ * @file		listener.c
+ * @brief		Sockets de escucha del servidor (IPv4, IPv6 dual-stack y unix domain socket).
+ * @date		19 oct. 2026
+ * @author		Martinez Agustin
+ *
+ **********************************************************************************************************************************/
+
+ /***********************************************************************************************************************************
+ *** INCLUDES
+ **********************************************************************************************************************************/
+#include "../inc/listener.h"
+
+/***********************************************************************************************************************************
+ *** IMPLEMENTACION DE LOS METODODS DE LA CLASE
+ **********************************************************************************************************************************/
+/**
+ * \fn int ParseListener(const char* _spec, int _backlog, Listener_t* _listener)
+ * \brief Interpreta una dirección de escucha.
+ * \details Formatos: "IPv4:puerto", "[IPv6]:puerto", "unix:/path", seguidos de opciones separadas por espacios:
+ * backlog=N, nodelay, defer_accept=SEG, fastopen=N, v6only, mode=OCTAL, tls.
+ * \param [in] _spec: Texto a interpretar.
+ * \param [in] _backlog: Backlog a usar si no se indica.
+ * \param [out] _listener: Listener a completar.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+int ParseListener(const char* _spec, int _backlog, Listener_t* _listener)
+{
+    char spec[256];
+    char* save = NULL;
+
+    memset(_listener, 0, sizeof(Listener_t));
+    _listener->fd = -1;
+    _listener->backlog = _backlog;
+
+    strncpy(spec, _spec, sizeof(spec) - 1);
+    spec[sizeof(spec) - 1] = '\0';
+
+    char* addr = strtok_r(spec, " \t", &save);
+    if (addr == NULL){
+        return -1;
+    }
+
+    if (strncmp(addr, "unix:", 5) == 0){            // unix:/path
+        _listener->family = AF_UNIX;
+        if (strlen(addr + 5) == 0 || strlen(addr + 5) >= LISTEN_ADDR_LEN){
+            return -1;
+        }
+        strcpy(_listener->addr, addr + 5);
+    }
+    else{
+        char* port;
+        if (addr[0] == '['){                        // [IPv6]:puerto
+            char* end = strchr(addr, ']');
+            if (end == NULL || end[1] != ':'){
+                return -1;
+            }
+            *end = '\0';
+            _listener->family = AF_INET6;
+            strncpy(_listener->addr, addr + 1, LISTEN_ADDR_LEN - 1);
+            port = end + 2;
+        }
+        else{                                       // IPv4:puerto
+            port = strrchr(addr, ':');
+            if (port == NULL){
+                return -1;
+            }
+            *port++ = '\0';
+            _listener->family = AF_INET;
+            strncpy(_listener->addr, addr, LISTEN_ADDR_LEN - 1);
+        }
+        _listener->port = atoi(port);
+        if (_listener->port <= 0 || _listener->port > 65535){
+            return -1;
+        }
+    }
+
+    // Opciones:
+    char* opt;
+    while ((opt = strtok_r(NULL, " \t", &save)) != NULL){
+        if (strncmp(opt, "backlog=", 8) == 0){
+            _listener->backlog = atoi(opt + 8);
+        }
+        else if (strcmp(opt, "nodelay") == 0){
+            _listener->nodelay = 1;
+        }
+        else if (strncmp(opt, "defer_accept=", 13) == 0){
+            _listener->defer_accept = atoi(opt + 13);
+        }
+        else if (strncmp(opt, "fastopen=", 9) == 0){
+            _listener->fastopen = atoi(opt + 9);
+        }
+        else if (strcmp(opt, "v6only") == 0){
+            _listener->v6only = 1;
+        }
+        else if (strncmp(opt, "mode=", 5) == 0){
+            _listener->mode = (int)strtol(opt + 5, NULL, 8);
+        }
+        else if (strcmp(opt, "tls") == 0){
+            _listener->tls = 1;
+        }
+        else{
+            printf("Opción de LISTEN desconocida: %s\n", opt);
+            return -1;
+        }
+    }
+    if (_listener->backlog <= 0){
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * \fn int OpenListener(Listener_t* _listener)
+ * \brief Crea el socket, aplica las opciones, hace bind() y listen().
+ * \param [in] _listener: Listener a abrir. Se completa su fd.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+int OpenListener(Listener_t* _listener)
+{
+    struct sockaddr_storage server_data;
+    socklen_t server_data_size;
+    int opt = 1;
+
+    memset(&server_data, 0, sizeof(server_data));
+    if (_listener->family == AF_UNIX){
+        struct sockaddr_un* sun = (struct sockaddr_un*)&server_data;
+        sun->sun_family = AF_UNIX;
+        memcpy(sun->sun_path, _listener->addr, sizeof(sun->sun_path) - 1);  // Ya viene terminado en \0
+        server_data_size = sizeof(struct sockaddr_un);
+        unlink(_listener->addr);    // Socket viejo de una ejecución anterior
+    }
+    else if (_listener->family == AF_INET6){
+        struct sockaddr_in6* sin6 = (struct sockaddr_in6*)&server_data;
+        sin6->sin6_family = AF_INET6;
+        sin6->sin6_port = htons(_listener->port);
+        if (inet_pton(AF_INET6, _listener->addr, &sin6->sin6_addr) != 1){
+            return -1;
+        }
+        server_data_size = sizeof(struct sockaddr_in6);
+    }
+    else{
+        struct sockaddr_in* sin = (struct sockaddr_in*)&server_data;
+        sin->sin_family = AF_INET;
+        sin->sin_port = htons(_listener->port);
+        if (inet_pton(AF_INET, _listener->addr, &sin->sin_addr) != 1){
+            return -1;
+        }
+        server_data_size = sizeof(struct sockaddr_in);
+    }
+
+    int server_Id = socket(_listener->family, SOCK_STREAM, 0);
+    if (server_Id == -1){
+        return -1;
+    }
+
+    if (_listener->family != AF_UNIX){
+        setsockopt(server_Id, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+        if (_listener->family == AF_INET6){
+            int v6only = _listener->v6only;     // 0 -> también acepta IPv4 (::ffff:a.b.c.d)
+            setsockopt(server_Id, IPPROTO_IPV6, IPV6_V6ONLY, &v6only, sizeof(v6only));
+        }
+        if (_listener->nodelay){
+            setsockopt(server_Id, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+        }
+        if (_listener->defer_accept > 0){       // accept() recién cuando llegan datos
+            setsockopt(server_Id, IPPROTO_TCP, TCP_DEFER_ACCEPT, &_listener->defer_accept, sizeof(int));
+        }
+        if (_listener->fastopen > 0){
+            if (setsockopt(server_Id, IPPROTO_TCP, TCP_FASTOPEN, &_listener->fastopen, sizeof(int)) == -1){
+                perror("TCP_FASTOPEN no disponible");
+            }
+        }
+    }
+
+    if (bind(server_Id, (struct sockaddr *)&server_data, server_data_size) == -1){
+        close(server_Id);
+        return -1;
+    }
+    if (_listener->family == AF_UNIX && _listener->mode != 0){
+        chmod(_listener->addr, _listener->mode);
+    }
+    if (listen(server_Id, _listener->backlog) < 0){
+        close(server_Id);
+        return -1;
+    }
+
+    _listener->fd = server_Id;
+    return 0;
+}
+
+/**
+ * \fn void CloseListener(Listener_t* _listener, int _unlink)
+ * \brief Cierra el socket de escucha.
+ * \param [in] _listener: Listener a cerrar.
+ * \param [in] _unlink: Si es distinto de 0 borra el path de los sockets unix.
+*/
+void CloseListener(Listener_t* _listener, int _unlink)
+{
+    if (_listener->fd < 0){
+        return;
+    }
+    close(_listener->fd);
+    _listener->fd = -1;
+    if (_unlink && _listener->family == AF_UNIX){
+        unlink(_listener->addr);
+    }
+}
+
+/**
+ * \fn void SetupAccepted(const Listener_t* _listener, int _client_id)
+ * \brief Aplica al socket aceptado las opciones del listener que lo recibió.
+ * \param [in] _listener: Listener que aceptó la conexión.
+ * \param [in] _client_id: Socket aceptado.
+*/
+void SetupAccepted(const Listener_t* _listener, int _client_id)
+{
+    int opt = 1;
+    if (_listener->family != AF_UNIX && _listener->nodelay){
+        setsockopt(_client_id, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+    }
+}
+
+/**
+ * \fn const char* ListenerName(const Listener_t* _listener, char* _buff, size_t _size)
+ * \brief Texto de la dirección para mostrar por consola.
+ * \param [in] _listener: Listener a describir.
+ * \param [out] _buff: Buffer destino.
+ * \param [in] _size: Tamaño del buffer.
+ * \return _buff.
+*/
+const char* ListenerName(const Listener_t* _listener, char* _buff, size_t _size)
+{
+    if (_listener->family == AF_UNIX){
+        snprintf(_buff, _size, "unix:%s", _listener->addr);
+    }
+    else if (_listener->family == AF_INET6){
+        snprintf(_buff, _size, "[%s]:%d", _listener->addr, _listener->port);
+    }
+    else{
+        snprintf(_buff, _size, "%s:%d", _listener->addr, _listener->port);
+    }
+    return _buff;
+}
@@ -0,0 +1,371 @@
+/*******************************************************************************************************************************//**
+ *
+ * @file		lockout.c
+ * @brief		Bloqueo por intentos fallidos (fuerza bruta) con ventanas deslizantes por puerta y por origen.
+ * @date		19 oct. 2026
+ * @author		Martinez Agustin
+ *
+ **********************************************************************************************************************************/
+
+ /***********************************************************************************************************************************
+ *** INCLUDES
+ **********************************************************************************************************************************/
+#include "../inc/lockout.h"
+
+/***********************************************************************************************************************************
+ *** VARIABLES GLOBALES PRIVADAS AL MODULO
+ **********************************************************************************************************************************/
+static int max_failures = 0;            /**< 0: bloqueo desactivado */
+static int64_t window_ns = 0;           /**< Largo de la ventana */
+static int64_t lock_ns = 0;             /**< Duración del bloqueo */
+static LockoutTable_t* table = NULL;    /**< Orígenes web (memoria compartida). NULL: no se bloquean */
+
+/***********************************************************************************************************************************
+ *** PROTOTIPOS DE FUNCIONES PRIVADAS AL MODULO
+ **********************************************************************************************************************************/
+static void WindowAdvance(SlidingWindow_t* _window, int64_t _now_ns);
+static int PeerAddress(int _fd, uint8_t _addr[16]);
+static LockoutSource_t* FindSource(const uint8_t _addr[16], int _create, int64_t _now_ns);
+static int TableLock(void);
+static int64_t SourceAge(const LockoutSource_t* _src, int64_t _now_ns);
+
+/***********************************************************************************************************************************
+ *** IMPLEMENTACION DE LOS METODODS DE LA CLASE
+ **********************************************************************************************************************************/
+/**
+ * \fn void LockoutInit(LockoutTable_t* _table, int _failures, long _window_ms, long _time_ms)
+ * \brief Fija los límites y la tabla de orígenes. Se llama una vez en el proceso principal, antes de los fork().
+ * \details Inicializa el lock de la tabla solo si el segmento es nuevo: con SIGUSR2 lo pueden tener tomado los
+ * clientes del proceso anterior.
+ * \param [in] _table: Tabla en la memoria compartida (ShmLayout_t). NULL: solo se bloquean las puertas.
+ * \param [in] _failures: Fallas dentro de la ventana que bloquean (LOCKOUT_FAILURES). 0 desactiva el bloqueo.
+ * \param [in] _window_ms: Ventana (LOCKOUT_WINDOW).
+ * \param [in] _time_ms: Duración del bloqueo (LOCKOUT_TIME).
+*/
+void LockoutInit(LockoutTable_t* _table, int _failures, long _window_ms, long _time_ms)
+{
+    max_failures = _failures;
+    window_ns = (int64_t)_window_ms * 1000000LL;
+    lock_ns = (int64_t)_time_ms * 1000000LL;
+    table = (max_failures > 0) ? _table : NULL;
+    if (table != NULL && !table->ready){
+        pthread_mutexattr_t attr;
+        pthread_mutexattr_init(&attr);
+        pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+        pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+        if (pthread_mutex_init(&table->lock, &attr) != 0){
+            perror("Error al inicializar el lock de los orígenes");
+            table = NULL;
+        }
+        else{
+            table->ready = 1;
+        }
+        pthread_mutexattr_destroy(&attr);
+    }
+}
+
+/**
+ * \fn int LockoutActive(Lockout_t* _lockout, int64_t _now_ns)
+ * \brief Indica si está bloqueado. Si lo está cuenta el intento como descartado.
+ * \param [in] _lockout: Estado.
+ * \param [in] _now_ns: Instante actual.
+ * \return 1 si está bloqueado. 0 sino.
+*/
+int LockoutActive(Lockout_t* _lockout, int64_t _now_ns)
+{
+    if (_lockout->locked_until_ns == 0 || _now_ns >= _lockout->locked_until_ns){
+        return 0;
+    }
+    _lockout->suppressed++;
+    return 1;
+}
+
+/**
+ * \fn int LockoutFail(Lockout_t* _lockout, int64_t _now_ns)
+ * \brief Registra una falla.
+ * \param [in] _lockout: Estado.
+ * \param [in] _now_ns: Instante actual.
+ * \return 1 si esta falla empieza un bloqueo. 0 sino.
+*/
+int LockoutFail(Lockout_t* _lockout, int64_t _now_ns)
+{
+    SlidingWindow_t* w = &_lockout->window;
+
+    if (max_failures <= 0){
+        return 0;
+    }
+    WindowAdvance(w, _now_ns);
+    w->current++;
+
+    // Parte de la ventana anterior que sigue dentro de los últimos window_ns:
+    double weight = (double)(window_ns - (_now_ns - w->start_ns)) / (double)window_ns;
+    double estimate = w->current + w->previous * weight;
+    if (estimate < max_failures){
+        return 0;
+    }
+    _lockout->locked_until_ns = _now_ns + lock_ns;
+    _lockout->suppressed = 0;
+    w->current = 0;     // Al terminar el bloqueo se arranca de cero
+    w->previous = 0;
+    return 1;
+}
+
+/**
+ * \fn void LockoutReset(Lockout_t* _lockout)
+ * \brief Olvida las fallas (clave correcta).
+ * \param [in] _lockout: Estado.
+*/
+void LockoutReset(Lockout_t* _lockout)
+{
+    _lockout->window.current = 0;
+    _lockout->window.previous = 0;
+}
+
+/**
+ * \fn int LockoutExpired(Lockout_t* _lockout, int64_t _now_ns)
+ * \brief Termina el bloqueo si ya pasó LOCKOUT_TIME.
+ * \param [in] _lockout: Estado.
+ * \param [in] _now_ns: Instante actual.
+ * \return Intentos descartados si el bloqueo terminó ahora. -1 sino.
+*/
+int LockoutExpired(Lockout_t* _lockout, int64_t _now_ns)
+{
+    if (_lockout->locked_until_ns == 0 || _now_ns < _lockout->locked_until_ns){
+        return -1;
+    }
+    _lockout->locked_until_ns = 0;
+    return (int)_lockout->suppressed;
+}
+
+/**
+ * \fn int LockoutSourceActive(int _fd, int64_t _now_ns)
+ * \brief Indica si el origen de la conexión está bloqueado. Las conexiones por socket unix no se bloquean.
+ * \param [in] _fd: Socket del cliente.
+ * \param [in] _now_ns: Instante actual.
+ * \return Segundos que faltan si está bloqueado. 0 sino.
+*/
+int LockoutSourceActive(int _fd, int64_t _now_ns)
+{
+    uint8_t addr[16];
+    int remaining = 0;
+
+    if (table == NULL || PeerAddress(_fd, addr) < 0){
+        return 0;
+    }
+    if (TableLock() < 0){
+        return 0;
+    }
+    SeqWriteBegin(&table->seq);
+    LockoutSource_t* src = FindSource(addr, 0, _now_ns);
+    if (src != NULL && LockoutActive(&src->state, _now_ns)){
+        remaining = (int)((src->state.locked_until_ns - _now_ns + 999999999LL) / 1000000000LL);
+    }
+    else if (src != NULL){
+        LockoutExpired(&src->state, _now_ns);   // Ya terminó: la celda vuelve a poder reemplazarse
+    }
+    SeqWriteEnd(&table->seq);
+    pthread_mutex_unlock(&table->lock);
+    return remaining;
+}
+
+/**
+ * \fn int LockoutSourceFail(int _fd, int64_t _now_ns)
+ * \brief Registra una falla del origen de la conexión.
+ * \param [in] _fd: Socket del cliente.
+ * \param [in] _now_ns: Instante actual.
+ * \return 1 si esta falla bloquea al origen. 0 sino.
+*/
+int LockoutSourceFail(int _fd, int64_t _now_ns)
+{
+    uint8_t addr[16];
+    int locked = 0;
+
+    if (table == NULL || PeerAddress(_fd, addr) < 0){
+        return 0;
+    }
+    if (TableLock() < 0){
+        return 0;
+    }
+    SeqWriteBegin(&table->seq);
+    LockoutSource_t* src = FindSource(addr, 1, _now_ns);
+    src->last_ns = _now_ns;
+    LockoutExpired(&src->state, _now_ns);
+    locked = LockoutFail(&src->state, _now_ns);
+    SeqWriteEnd(&table->seq);
+    pthread_mutex_unlock(&table->lock);
+    return locked;
+}
+
+/**
+ * \fn void LockoutRead(const Lockout_t* _lockout, Lockout_t* _out)
+ * \brief Copia el bloqueo de una puerta, que escribe solo su lector, desde otro proceso.
+ * \details Cada campo se lee entero; la copia puede mezclar dos intentos seguidos, alcanza para mostrarla.
+ * \param [in] _lockout: Estado (puede estar enganchado en solo lectura).
+ * \param [out] _out: Copia.
+*/
+void LockoutRead(const Lockout_t* _lockout, Lockout_t* _out)
+{
+    _out->window.start_ns = __atomic_load_n(&_lockout->window.start_ns, __ATOMIC_RELAXED);
+    _out->window.current = __atomic_load_n(&_lockout->window.current, __ATOMIC_RELAXED);
+    _out->window.previous = __atomic_load_n(&_lockout->window.previous, __ATOMIC_RELAXED);
+    _out->locked_until_ns = __atomic_load_n(&_lockout->locked_until_ns, __ATOMIC_RELAXED);
+    _out->suppressed = __atomic_load_n(&_lockout->suppressed, __ATOMIC_RELAXED);
+}
+
+/**
+ * \fn int LockoutSourcesRead(const LockoutTable_t* _table, LockoutSource_t* _out)
+ * \brief Copia los orígenes ocupados sin tomar el lock, para leer la tabla de otro proceso.
+ * \details Copia entre dos lecturas de seq y reintenta si cambió o si había un cambio a medias.
+ * \param [in] _table: Tabla (puede estar enganchada en solo lectura).
+ * \param [out] _out: LOCKOUT_SOURCES posiciones.
+ * \return Cantidad de orígenes. -1 si no se consiguió una copia entera en SEQ_RETRIES intentos.
+*/
+int LockoutSourcesRead(const LockoutTable_t* _table, LockoutSource_t* _out)
+{
+    for (int retry = 0; retry < SEQ_RETRIES; retry++){
+        uint32_t start = __atomic_load_n(&_table->seq, __ATOMIC_ACQUIRE);
+        if (start & 1){
+            sched_yield();
+            continue;
+        }
+        int count = 0;
+        for (int i = 0; i < LOCKOUT_SOURCES; i++){
+            if (_table->sources[i].last_ns != 0){
+                _out[count++] = _table->sources[i];
+            }
+        }
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&_table->seq, __ATOMIC_RELAXED) == start){
+            return count;
+        }
+    }
+    return -1;
+}
+
+/***********************************************************************************************************************************
+ *** FUNCIONES PRIVADAS AL MODULO
+ **********************************************************************************************************************************/
+/**
+ * \fn static void WindowAdvance(SlidingWindow_t* _window, int64_t _now_ns)
+ * \brief Pasa a la ventana que contiene a _now_ns.
+ * \param [in] _window: Contador.
+ * \param [in] _now_ns: Instante actual.
+*/
+static void WindowAdvance(SlidingWindow_t* _window, int64_t _now_ns)
+{
+    int64_t elapsed = _now_ns - _window->start_ns;
+
+    if (elapsed < window_ns){
+        return;
+    }
+    // Una ventana después: la actual pasa a ser la anterior. Más de una: las dos quedaron afuera.
+    _window->previous = (elapsed < 2 * window_ns) ? _window->current : 0;
+    _window->current = 0;
+    _window->start_ns = _now_ns - (_now_ns % window_ns);
+}
+
+/**
+ * \fn static int PeerAddress(int _fd, uint8_t _addr[16])
+ * \brief Dirección del otro extremo como IPv6 (las IPv4 como ::ffff:a.b.c.d).
+ * \param [in] _fd: Socket.
+ * \param [out] _addr: Dirección.
+ * \return Devuelve -1 si no es TCP (socket unix). 0 sino.
+*/
+static int PeerAddress(int _fd, uint8_t _addr[16])
+{
+    struct sockaddr_storage peer;
+    socklen_t len = sizeof(peer);
+
+    if (getpeername(_fd, (struct sockaddr*)&peer, &len) < 0){
+        return -1;
+    }
+    if (peer.ss_family == AF_INET6){
+        memcpy(_addr, &((struct sockaddr_in6*)&peer)->sin6_addr, 16);
+        return 0;
+    }
+    if (peer.ss_family == AF_INET){
+        memset(_addr, 0, 10);
+        _addr[10] = 0xFF;
+        _addr[11] = 0xFF;
+        memcpy(_addr + 12, &((struct sockaddr_in*)&peer)->sin_addr, 4);
+        return 0;
+    }
+    return -1;
+}
+
+/**
+ * \fn static LockoutSource_t* FindSource(const uint8_t _addr[16], int _create, int64_t _now_ns)
+ * \brief Busca un origen en LOCKOUT_PROBE celdas a partir de su hash. Hay que tener tomado el lock.
+ * \details Si no está y _create, ocupa una celda libre o reemplaza a la de falla más vieja que no esté bloqueada.
+ * \param [in] _addr: Dirección.
+ * \param [in] _create: Crear si no está.
+ * \param [in] _now_ns: Instante actual.
+ * \return El origen. NULL si no está y no se pidió crear.
+*/
+static LockoutSource_t* FindSource(const uint8_t _addr[16], int _create, int64_t _now_ns)
+{
+    uint32_t h = 2166136261U;
+    LockoutSource_t* victim = NULL;
+
+    for (int i = 0; i < 16; i++){
+        h = (h ^ _addr[i]) * 16777619U;
+    }
+    for (int i = 0; i < LOCKOUT_PROBE; i++){
+        LockoutSource_t* src = &table->sources[(h + i) % LOCKOUT_SOURCES];
+        if (src->last_ns != 0 && memcmp(src->addr, _addr, 16) == 0){
+            return src;
+        }
+        if (victim == NULL || SourceAge(src, _now_ns) < SourceAge(victim, _now_ns)){
+            victim = src;
+        }
+    }
+    if (!_create){
+        return NULL;
+    }
+    memset(victim, 0, sizeof(LockoutSource_t));
+    memcpy(victim->addr, _addr, 16);
+    return victim;
+}
+
+/**
+ * \fn static int TableLock(void)
+ * \brief Toma el lock de la tabla de orígenes.
+ * \details Si el dueño anterior murió con el lock tomado, seq puede haber quedado impar y su celda a medio cambiar:
+ * se cierra el cambio (seq vuelve a ser par) y se marca el mutex como consistente. La celda queda como estaba, con
+ * a lo sumo una falla de más o de menos.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+static int TableLock(void)
+{
+    int err = pthread_mutex_lock(&table->lock);
+
+    if (err == EOWNERDEAD){
+        printf("Un cliente murió con el lock de los orígenes tomado: se recupera\n");
+        if (__atomic_load_n(&table->seq, __ATOMIC_RELAXED) & 1){
+            SeqWriteEnd(&table->seq);
+        }
+        err = pthread_mutex_consistent(&table->lock);
+    }
+    if (err != 0){
+        errno = err;
+        perror("Error al tomar el lock de los orígenes");
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * \fn static int64_t SourceAge(const LockoutSource_t* _src, int64_t _now_ns)
+ * \brief Orden para reemplazar celdas: primero las libres, después las de falla más vieja, al final las bloqueadas.
+ * \details Un bloqueo que ya terminó cuenta como no bloqueado aunque todavía no se haya limpiado.
+ * \param [in] _src: Celda.
+ * \param [in] _now_ns: Instante actual.
+ * \return Menor es mejor candidata.
+*/
+static int64_t SourceAge(const LockoutSource_t* _src, int64_t _now_ns)
+{
+    if (_src->last_ns == 0){
+        return INT64_MIN;
+    }
+    return (_src->state.locked_until_ns > _now_ns) ? INT64_MAX : _src->last_ns;
+}
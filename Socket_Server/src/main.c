@@ -15,8 +15,13 @@
 /***********************************************************************************************************************************
  *** VARIABLES GLOBALES PRIVADAS AL MODULO
  **********************************************************************************************************************************/
-volatile int cant_clients = 0;
-volatile int running = 1;
+int running = 1;                /**< Pedidos que marca DispatchSignals() y atiende el lazo principal */
+int reload_config = 0;
+int upgrade_requested = 0;
+int snapshot_due = 0;
+int promote_requested = 0;
+Doors_t doors;  /**< Global para que WorkerExited distinga lectores de réplicas */
+pid_t repl_pids[MAX_REPLICAS + 1] = { -1, -1, -1, -1, -1 };  /**< Envíos a réplicas y, al final, el seguidor de la primaria */
 
 /***********************************************************************************************************************************
  *** IMPLEMENTACION DE LOS METODODS DE LA CLASE
@@ -25,344 +30,811 @@ volatile int running = 1;
  * \fn int main(int argc, char *argv[])
  * \brief main del Servidor.
  * \details Crea el servidor. Crea la Memoria Compartida. 
- * Realiza el fork para lectura del driver. Se queda esperando clientes nuevos.
+ * Realiza un fork por puerta para lectura de su driver. Se queda esperando clientes nuevos.
  * \param [in] argc: Cantidad de argumentos.
  * \param [in] argv: Puntero a char con los argumentos.
  * \return Devuelve -1 si error. 0 sino.
 */
 int main(int argc, char *argv[])
 {
-    int smId_k = -1;
-    int smId_l = -1;
+    Listener_t listeners[MAX_LISTENERS];
+    int listeners_count = 0;
+    int next_listener = 0;
 
-    int semId_k = -1;
-    int semId_l = -1;
-    int sem_write = -1;
-    
-    int server_Id = -1;
-    int pid_procces_teclado = -1;
+    Listener_t repl_listener;
+    const char* primary;
 
-    int driver = -1;
+    HandoffState_t handoff;
+    int handoff_sock = -1;
+    int inherited = 0;
+    int owns_ipc = 1;
 
     int backlog, max_connections;
-    KeyEntry_t* valid_keys = NULL;
-    ActivityEntry_t* log = NULL;
+    Config_t config;
+    ConnLimits_t limits;
+    static Snapshot_t snapshot;
+    static WorkerPool_t workers;    /**< count 0: un fork() por cliente */
+    static ChildTable_t children;   /**< Clientes atendidos en procesos hijo */
+    sigset_t signals;
 
     printf("%s\n\n\n",argv[0]);
-    if (argc != 2){
-        printf("Error en ejecución de programa.\nTP2 <puerto>\n\n");
+    if (argc > 2){
+        printf("Error en ejecución de programa.\nTP2 [puerto]\n\n");
         exit(1);
     }
 
-    // Lectura de config file:
-    backlog = GetInitValue("config.ini", "BACKLOG");
-    if (backlog <= 0){
-        printf("Valor de BACKLOG por defecto");
-        backlog = DEFAULT_BACKLOG;
+    // Lectura de config file (una sola vez, validado):
+    if (ConfigLoad(CONFIG_FILE, &config) < 0){
+        printf("Error en %s\n", CONFIG_FILE);
+        exit(1);
     }
-    max_connections = GetInitValue("config.ini", "MAX_CONNECTIONS");
-    if ( max_connections <= 0){
-        printf("Valor de MAX_CONNECTIONS por defecto");
-        max_connections = DEFAULT_MAXCONNECTIONS;
+    ApplyConfig(&config, &backlog, &max_connections, &limits);
+    if (ClientInit() < 0){
+        printf("Tabla de rutas inválida\n");
+        exit(1);
     }
-
-    // Creacion de la memoria compartida:
-    valid_keys = (KeyEntry_t*)createShMem(argv[0],SM_ID_K,(sizeof(KeyEntry_t)*MAX_VALID_KEYS),&smId_k);
-    if (valid_keys == (KeyEntry_t *)-1) {
-        perror("Error al pedir memoria compartida KEY");
+    if (SnapshotInit(&snapshot, ConfigGetString(&config, "SNAPSHOT_FILE")) < 0){
+        perror("Error al preparar la copia de claves");
         exit(1);
     }
-    semId_k = createSem(argv[0],SEM_ID_K);
-    if (semId_k == -1){
-        perror("Error al crear el semáforo KEY\n");
-        shmdt(valid_keys);
-        shmctl(smId_k, IPC_RMID, 0);
+    if (JournalOpen(ConfigGetString(&config, "REPLICATION_JOURNAL")) < 0){
+        perror(ConfigGetString(&config, "REPLICATION_JOURNAL"));
         exit(1);
     }
+    primary = ConfigGetString(&config, "REPLICA_OF");
+    repl_listener.fd = -1;
 
-    log = (ActivityEntry_t*)createShMem(argv[0],SM_ID_L,(sizeof(ActivityEntry_t)*MAX_LOG),&smId_l);
-    if (log == (ActivityEntry_t *)-1) {
-        perror("Error al pedir memoria compartida LOG");
-        shmdt(valid_keys);
-        shmctl(smId_k, IPC_RMID, 0);
-        closeSem(semId_k);
+    // ¿Me ejecutó un proceso viejo para reemplazarlo? (SIGUSR2)
+    inherited = HandoffReceive(&handoff, &handoff_sock);
+    if (inherited < 0){
+        printf("Traspaso inválido\n");
         exit(1);
     }
-    semId_l = createSem(argv[0],SEM_ID_L);
-    if (semId_l == -1){
-        perror("Error al crear el semáforo LOG\n");
-        shmdt(valid_keys);
-        shmctl(smId_k, IPC_RMID, 0);
-        shmdt(log);
-        shmctl(smId_l, IPC_RMID, 0);
-        closeSem(semId_k);
-        exit(1);
+    if (inherited){     // Me engancho a lo que ya existe, sin borrar claves ni log
+        memcpy(&doors, &handoff.doors, sizeof(Doors_t));
+        listeners_count = handoff.listeners_count;
+        memcpy(listeners, handoff.listeners, sizeof(listeners));
+        repl_listener = handoff.repl_listener;
+        if (DoorsAttach(&doors) < 0){
+            perror("Error al tomar la memoria compartida heredada");
+            exit(1);
+        }
+        printf("Estado heredado del proceso anterior (%d listeners, %d puertas)\n", listeners_count, doors.count);
     }
-    sem_write = createSem(argv[0],SEM_ID_WR);
-    if (sem_write == -1){
-        perror("Error al crear el semáforo DRIVER\n");
-        shmdt(valid_keys);
-        shmdt(log);
-        shmctl(smId_l, IPC_RMID, 0);
-        shmctl(smId_k, IPC_RMID, 0);
-        closeSem(semId_l);
-        closeSem(semId_k);
-        exit(1);
+    else{
+        // Una puerta por línea DEVICE, con su parte de la memoria compartida y sus semáforos:
+        if (DoorsLoad(&config, &doors) < 0){
+            printf("No hay dispositivos DEVICE válidos\n");
+            exit(1);
+        }
+        if (DoorsCreate(argv[0], &doors) < 0){
+            exit(1);
+        }
+        doors.read_only = (primary != NULL);
+        // Las claves de la última copia, antes de que arranquen los lectores:
+        int64_t start_ns = TimeNowNs();
+        int restored = SnapshotLoad(&snapshot, &doors);
+        if (restored < 0){
+            printf("Copia de claves %s inválida: se arranca sin claves\n", snapshot.path);
+        }
+        else if (restored > 0){
+            printf("Recuperé %d claves de %s en %.2f ms\n", restored, snapshot.path, (TimeNowNs() - start_ns) / 1e6);
+        }
     }
 
+    // Estadísticas y bloqueos: en el mismo segmento, así siguen al día después de un traspaso.
+    if (BufPoolInit(&doors.shm->bufpool) < 0){     // Sin pool se sigue atendiendo con malloc()
+        perror("Error al reservar el pool de buffers");
+    }
+    LockoutInit(&doors.shm->lockout, ConfigGetInt(&config, "LOCKOUT_FAILURES"), ConfigGetInt(&config, "LOCKOUT_WINDOW"),
+                ConfigGetInt(&config, "LOCKOUT_TIME"));
+    ActuatorSetup(&doors.shm->actuator, ConfigGetInt(&config, "ACTUATOR_WINDOW"));
+    StatsSetup(&doors.shm->stats, ConfigGetInt(&config, "STATS_HOURS"), ConfigGetInt(&config, "STATS_DAYS"));
+
+    // Fork de un lector por puerta (una réplica no lee dispositivos hasta que la promueven):
+    if (!doors.read_only && DoorsStart(&doors) < 0){
+        DoorsDestroy(&doors);
+        exit(1);
+    }
 
-    int sem_list[3] = {semId_k, semId_l, sem_write};
-    // Inicializo con 0:
-    for(int i=0; i < MAX_VALID_KEYS; i++ ){
-        valid_keys[i].value[0] = '\0';
+    // Creación de los sockets de escucha:
+    if (!inherited){
+        listeners_count = LoadListeners(&config, (argc == 2) ? atoi(argv[1]) : 0, backlog, listeners);
     }
-    for(int i=0; i < MAX_LOG; i++){
-        log[i].code[0] = '\0';
+    if (listeners_count <= 0){
+        perror("Error creando el server");
+        DoorsStop(&doors);
+        DoorsDestroy(&doors);
+        exit(1);
     }
-    driver = open("/dev/my_alarm", O_RDWR);
-    if (driver < 0){
-        closeSem(semId_k);
-        closeSem(semId_l);
-        closeSem(sem_write);
-        shmctl(smId_k, IPC_RMID, 0);
-        shmctl(smId_l, IPC_RMID, 0);
+    if (!inherited && OpenReplication(&config, backlog, &repl_listener) < 0){
+        CloseListeners(listeners, listeners_count);
+        DoorsStop(&doors);
+        DoorsDestroy(&doors);
         exit(1);
     }
-    // Fork para telcado y server:
-    pid_procces_teclado = fork();
-    if (pid_procces_teclado < 0){
-        perror("Error de fork");
-        shmctl(smId_k, IPC_RMID, NULL);
-        shmctl(smId_l, IPC_RMID, NULL);
-        closeSem(semId_k);
-        closeSem(semId_l);
-        closeSem(sem_write);
+    if (StartTls(&config, listeners, listeners_count) < 0){     // Antes de los hilos y de los hijos, que lo heredan
+        CloseListeners(listeners, listeners_count);
+        StopReplication(0);
+        DoorsStop(&doors);
+        DoorsDestroy(&doors);
         exit(1);
-    } 
-    if (pid_procces_teclado == 0) {  // Hijo va a teclado
-        periph(driver, valid_keys, log, sem_list);
-        return 0;
+    }
+    if (doors.read_only){
+        if (primary == NULL){
+            printf("Réplica sin REPLICA_OF: queda de solo lectura hasta que se la promueva (SIGUSR1)\n");
+        }
+        else{
+            repl_pids[MAX_REPLICAS] = StartFollower(primary, listeners, listeners_count, &repl_listener);
+        }
     }
 
-    // Creación del server:
-    server_Id = MakeServer(atoi(argv[1]), backlog);
-    if (server_Id < 0){
-        perror("Error creando el server");
-        kill(pid_procces_teclado, SIGTERM);
-        shmctl(smId_k, IPC_RMID, NULL);
-        shmctl(smId_l, IPC_RMID, NULL);
-        closeSem(semId_k);
-        closeSem(semId_l);
-        closeSem(sem_write);
+    // Signals: todas llegan por un signalfd que se atiende en el mismo poll() que los listeners. Se bloquean
+    // antes de lanzar los hilos para que ninguno las reciba:
+    setSignals(&signals);
+    if (ChildrenInit(&children, &signals, &doors.shm->children) < 0){
+        perror("Error al crear el signalfd");
+        CloseListeners(listeners, listeners_count);
+        StopReplication(0);
+        DoorsStop(&doors);
+        DoorsDestroy(&doors);
+        exit(1);
+    }
+    ChildrenReap(&children, WorkerExited);     // Lectores o réplica que terminaron antes del signalfd: su SIGCHLD se perdió
+
+    // Pool de hilos (WORKERS > 0), después de los fork() de lectores y réplica:
+    if (StartWorkers(&config, &workers, &doors) < 0){
+        perror("Error al lanzar los hilos");
+        CloseListeners(listeners, listeners_count);
+        StopReplication(0);
+        DoorsStop(&doors);
+        DoorsDestroy(&doors);
         exit(1);
     }
 
-    // Signals:
-    setHandlers();
-    sigset_t mask, oldmask;
-    sigemptyset(&mask);
-    sigaddset(&mask, SIGCHLD);
+    SnapshotTimer(ConfigGetInt(&config, "SNAPSHOT_INTERVAL"));
+
+    if (inherited){     // Ya atiendo: el proceso viejo puede dejar de aceptar
+        HandoffReady(handoff_sock);
+    }
 
     // Espero clientes:
     while (running) {
-        struct sockaddr_in client_data;
-        unsigned int client_data_size = sizeof(client_data);
+        struct sockaddr_storage client_data;
+        socklen_t client_data_size = sizeof(client_data);
+        struct pollfd pfds[MAX_LISTENERS + 2];
+        Listener_t* listener = NULL;
         int pid;
 
-        sigprocmask(SIG_BLOCK, &mask, &oldmask);    //Bloqueo el sigchild
-        while (cant_clients >= max_connections){
-            sigsuspend(&oldmask);   //Similar a pause(). Funcion bloqueante hasta que llegue SIGCHLD.
-            printf("Termino un cliente. Leyendo el siguiente\n");
-        }
-        sigprocmask(SIG_SETMASK, &oldmask, NULL);   //Desbloqueo el sigchild (trabajo normal)
         if(!running){
             break;
         }
+        if (reload_config){     // SIGHUP: los clientes nuevos ya usan los valores nuevos
+            reload_config = 0;
+            ReloadConfig(&config, listeners, listeners_count, &max_connections, &limits);
+            SnapshotTimer(ConfigGetInt(&config, "SNAPSHOT_INTERVAL"));
+            continue;
+        }
+        if (promote_requested){  // SIGUSR1: la réplica pasa a ser primaria
+            promote_requested = 0;
+            if (doors.read_only){
+                StopReplication(1);
+                doors.read_only = 0;
+                if (DoorsStart(&doors) < 0){
+                    perror("Error al lanzar los lectores");
+                }
+                printf("Promovida a primaria: se aceptan cambios\n");
+            }
+            continue;
+        }
+        if (snapshot_due){      // SIGALRM: copia de las claves a disco si cambiaron
+            snapshot_due = 0;
+            if (SnapshotSave(&snapshot, &doors) < 0){
+                perror(snapshot.path);
+            }
+            continue;
+        }
+        if (upgrade_requested){  // SIGUSR2: paso todo a un binario nuevo y me quedo terminando lo pendiente
+            upgrade_requested = 0;
+            memset(&handoff, 0, sizeof(handoff));
+            handoff.magic = HANDOFF_MAGIC;
+            handoff.version = HANDOFF_VERSION;
+            memcpy(&handoff.doors, &doors, sizeof(Doors_t));
+            handoff.listeners_count = listeners_count;
+            memcpy(handoff.listeners, listeners, sizeof(listeners));
+            handoff.repl_listener = repl_listener;
+            SnapshotTimer(0);   // El timer sobrevive al exec: el binario nuevo moriría por SIGALRM antes de tener handler
+            if (Upgrade(argv, &handoff) == 0){
+                for (int i = 0; i < listeners_count; i++){
+                    CloseListener(&listeners[i], 0);    // Los paths unix ahora son del proceso nuevo
+                }
+                listeners_count = 0;
+                if (repl_listener.fd >= 0){
+                    CloseListener(&repl_listener, 0);
+                }
+                owns_ipc = 0;
+                break;
+            }
+            SnapshotTimer(ConfigGetInt(&config, "SNAPSHOT_INTERVAL"));
+            printf("Actualización fallida: sigo atendiendo\n");
+            continue;
+        }
 
-        int client_Id = accept(server_Id, (struct sockaddr *)&client_data, &client_data_size);
-        if (client_Id < 0){
+        // Espero una conexión en cualquiera de las direcciones de escucha (y la de réplicas y las señales, al final).
+        // Con MAX_CONNECTIONS clientes los listeners salen del poll(): las conexiones esperan en el backlog
+        // y el resto (réplicas, SIGCHLD, señales) se sigue atendiendo.
+        int full = (workers.count == 0 && ChildrenActive(&children) >= max_connections);
+        for (int i = 0; i < listeners_count; i++){
+            pfds[i].fd = full ? -1 : listeners[i].fd;
+            pfds[i].events = POLLIN;
+            pfds[i].revents = 0;
+        }
+        pfds[listeners_count].fd = repl_listener.fd;    // poll() ignora fd -1
+        pfds[listeners_count].events = POLLIN;
+        pfds[listeners_count].revents = 0;
+        pfds[listeners_count + 1].fd = children.fd;
+        pfds[listeners_count + 1].events = POLLIN;
+        pfds[listeners_count + 1].revents = 0;
+        if (poll(pfds, listeners_count + 2, -1) < 0){
             if (errno == EINTR){
+                continue;
+            }
+            perror("Error en poll");
+            break;
+        }
+        if (pfds[listeners_count + 1].revents & POLLIN){
+            if (DispatchSignals(&children) > 0 && full){
+                printf("Termino un cliente. Leyendo el siguiente\n");
+            }
+            continue;
+        }
+        if (pfds[listeners_count].revents & POLLIN){
+            ServeReplica(&repl_listener, listeners, listeners_count);
+            continue;
+        }
+        for (int i = 0; i < listeners_count; i++){     // Reparto entre listeners para que ninguno acapare
+            int idx = (next_listener + i) % listeners_count;
+            if (pfds[idx].revents & POLLIN){
+                listener = &listeners[idx];
+                next_listener = (idx + 1) % listeners_count;
                 break;
             }
+        }
+        if (listener == NULL){
+            continue;
+        }
+
+        int client_Id = accept(listener->fd, (struct sockaddr *)&client_data, &client_data_size);
+        if (client_Id < 0){
+            if (errno == EINTR || errno == EAGAIN || errno == ECONNABORTED){
+                continue;
+            }
             perror("Error en aceppt");
-            close(server_Id);
-            kill(pid_procces_teclado, SIGTERM);
-            shmctl(smId_k, IPC_RMID, NULL);
-            shmctl(smId_l, IPC_RMID, NULL);
-            closeSem(semId_k);
-            closeSem(semId_l);
-            closeSem(sem_write);
+            CloseListeners(listeners, listeners_count);
+            DoorsStop(&doors);
+            DoorsDestroy(&doors);
             exit(1);
         }
 
+        SetupAccepted(listener, client_Id);
+        limits.tls = listener->tls;
+
+        if (workers.count > 0){     // Lo atiende un hilo libre; si la cola está llena se corta
+            if (WorkersSubmit(&workers, client_Id, &limits) < 0){
+                printf("Cola de hilos llena: se rechaza la conexión\n");
+                close(client_Id);
+            }
+            continue;
+        }
+
         pid = fork();
         if (pid < 0){
             perror("Error fork");
             close(client_Id);
-            close(server_Id);
-            kill(pid_procces_teclado, SIGTERM);
-            shmctl(smId_k, IPC_RMID, NULL);
-            shmctl(smId_l, IPC_RMID, NULL);
-            closeSem(semId_k);
-            closeSem(semId_l);
-            closeSem(sem_write);
+            CloseListeners(listeners, listeners_count);
+            DoorsStop(&doors);
+            DoorsDestroy(&doors);
             exit(1);
         }
         if (pid == 0){      // Cliente
-            signal(SIGINT, SIG_DFL);
+            ChildrenUnblockSignals();
+            ChildrenClose(&children);
+            for (int i = 0; i < listeners_count; i++){
+                close(listeners[i].fd);     // No borro los sockets unix: siguen siendo del padre
+            }
+            if (repl_listener.fd >= 0){
+                close(repl_listener.fd);
+            }
 
-            if (client(client_Id, driver, valid_keys, log, sem_list) < 0){
+            if (client(client_Id, &doors, &limits) < 0){
                 perror("Error al trabajar al cliente. ##");
             }
             close(client_Id);
-            close(server_Id);
-            close(driver);
+            DoorsCloseDrivers(&doors);
+            DoorsDetach(&doors);
             exit(0);
         }
-        cant_clients++;
+        if (ChildrenAdd(&children, pid) < 0){     // No pasa: MAX_CONNECTIONS no supera MAX_CHILDREN
+            printf("Tabla de hijos llena: el cliente %d no se cuenta\n", pid);
+        }
         close(client_Id);
     }
 
     // Si cliente -> creo hijo, cierro conexión y repito
-    kill(pid_procces_teclado, SIGTERM);
-    printf("Esperando que terminen %d clientes\n", cant_clients);
-
-    sigprocmask(SIG_BLOCK, &mask, &oldmask);    //Bloqueo el sigchild
-    while (cant_clients > 0){
-            sigsuspend(&oldmask);   //Desbloqueo por 1 vez.
-            //printf("Termino un cliente. Leyendo el siguiente\n");
+    WorkersStop(&workers);     // Los hilos terminan lo encolado antes de cerrar los drivers
+    DoorsStop(&doors);
+    StopReplication(0);
+    printf("Esperando que terminen %d clientes\n", ChildrenActive(&children));
+
+    while (ChildrenActive(&children) > 0){
+        struct pollfd pfd = { .fd = children.fd, .events = POLLIN };
+        if (poll(&pfd, 1, -1) > 0){
+            DispatchSignals(&children);
         }
-    sigprocmask(SIG_SETMASK, &oldmask, NULL);   //Desbloqueo el sigchild (trabajo normal)
-
-    /*while (cant_clients > 0){
-        pause();
-    }*/
+    }
+    ChildrenReap(&children, WorkerExited);     // Lectores que terminaron después del último cliente
+    ChildrenClose(&children);
     printf("Todos los clientes terminaron. Me voy\n");
     
-    close(driver);
-    close(server_Id);
-    shmctl(smId_k, IPC_RMID, NULL);
-    shmctl(smId_l, IPC_RMID, NULL);
-    closeSem(semId_k);
-    closeSem(semId_l);
-    closeSem(sem_write);
+    CloseListeners(listeners, listeners_count);
+    if (repl_listener.fd >= 0){
+        CloseListener(&repl_listener, 1);
+    }
+    if (!owns_ipc){     // La memoria compartida y los semáforos siguen en uso por el proceso nuevo
+        DoorsCloseDrivers(&doors);
+        DoorsDetach(&doors);
+        SnapshotFree(&snapshot);
+        return 0;
+    }
+    if (SnapshotSave(&snapshot, &doors) < 0){    // Última copia antes de borrar la memoria compartida
+        perror(snapshot.path);
+    }
+    SnapshotFree(&snapshot);
+    DoorsDetach(&doors);
+    DoorsDestroy(&doors);
+    return 0;
+}
+
+/**
+ * \fn int Upgrade(char* _argv[], const HandoffState_t* _state)
+ * \brief Reemplaza el servidor por el binario actual de _argv[0] sin cortar conexiones.
+ * \details Ejecuta el binario nuevo, le pasa los sockets de escucha, los drivers y los IDs de memoria compartida
+ * y semáforos, y espera a que confirme que ya atiende. Mientras tanto ambos aceptan sobre los mismos sockets,
+ * por lo que no hay ventana en la que se rechacen conexiones.
+ * \param [in] _argv: Argumentos con los que se ejecutó el servidor.
+ * \param [in] _state: Estado a traspasar.
+ * \return Devuelve -1 si error (el proceso actual sigue atendiendo). 0 sino.
+*/
+int Upgrade(char* _argv[], const HandoffState_t* _state)
+{
+    int sock;
+
+    printf("Actualizando a %s\n", _argv[0]);
+    if (HandoffSpawn(_argv, &sock) < 0){
+        perror("Error ejecutando el binario nuevo");
+        return -1;
+    }
+    if (HandoffSend(sock, _state) < 0 || HandoffWaitReady(sock, HANDOFF_TIMEOUT_MS) < 0){
+        close(sock);
+        return -1;
+    }
+    close(sock);
+    printf("Binario nuevo atendiendo. Termino los clientes pendientes\n");
+    return 0;
+}
+
+/**
+ * \fn int LoadListeners(const Config_t* _config, int _port, int _backlog, Listener_t* _listeners)
+ * \brief Crea los sockets de escucha.
+ * \details Abre una dirección por cada línea LISTEN de la configuración. Si no hay ninguna escucha en _port
+ * en modo dual-stack ([::]), o solo IPv4 si el sistema no tiene IPv6.
+ * Si hay líneas LISTEN y también se indicó _port, se avisa que el puerto no se usa.
+ * \param [in] _config: Configuración leída.
+ * \param [in] _port: Puerto por defecto (0 si no se indicó).
+ * \param [in] _backlog: Backlog por defecto.
+ * \param [out] _listeners: Vector de MAX_LISTENERS listeners a completar.
+ * \return Devuelve -1 si error. La cantidad de listeners abiertos sino.
+*/
+int LoadListeners(const Config_t* _config, int _port, int _backlog, Listener_t* _listeners)
+{
+    char specs[MAX_LISTENERS][CONFIG_VALUE_LEN];
+    char name[LISTEN_ADDR_LEN + 16];
+    int count = ConfigGetList(_config, "LISTEN", specs, MAX_LISTENERS);
+
+    if (count <= 0){
+        if (_port <= 0){
+            printf("No hay direcciones LISTEN ni puerto indicado\n");
+            return -1;
+        }
+        snprintf(specs[0], sizeof(specs[0]), "[::]:%d", _port);
+        if (ParseListener(specs[0], _backlog, &_listeners[0]) < 0){
+            return -1;
+        }
+        if (OpenListener(&_listeners[0]) < 0){
+            snprintf(specs[0], sizeof(specs[0]), "0.0.0.0:%d", _port);
+            if (ParseListener(specs[0], _backlog, &_listeners[0]) < 0 || OpenListener(&_listeners[0]) < 0){
+                return -1;
+            }
+        }
+        printf("Servidor creado con éxito en %s\n\n", ListenerName(&_listeners[0], name, sizeof(name)));
+        return 1;
+    }
+    if (_port > 0){     // Las líneas LISTEN mandan: el puerto de la línea de comandos no se usa
+        printf("Se ignora el puerto %d: %s tiene líneas LISTEN\n", _port, CONFIG_FILE);
+    }
+
+    for (int i = 0; i < count; i++){
+        if (ParseListener(specs[i], _backlog, &_listeners[i]) < 0){
+            printf("LISTEN inválido: %s\n", specs[i]);
+            CloseListeners(_listeners, i);
+            return -1;
+        }
+        if (OpenListener(&_listeners[i]) < 0){
+            perror(ListenerName(&_listeners[i], name, sizeof(name)));
+            CloseListeners(_listeners, i);
+            return -1;
+        }
+        printf("Escuchando en %s (backlog %d%s)\n", ListenerName(&_listeners[i], name, sizeof(name)), _listeners[i].backlog,
+               _listeners[i].tls ? ", https" : "");
+    }
+    printf("\n");
+    return count;
+}
+
+/**
+ * \fn void CloseListeners(Listener_t* _listeners, int _count)
+ * \brief Cierra todos los sockets de escucha.
+ * \param [in] _listeners: Vector de listeners.
+ * \param [in] _count: Cantidad de listeners.
+*/
+void CloseListeners(Listener_t* _listeners, int _count)
+{
+    for (int i = 0; i < _count; i++){
+        CloseListener(&_listeners[i], 1);
+    }
+}
+
+/**
+ * \fn void ApplyConfig(const Config_t* _config, int* _backlog, int* _max_connections, ConnLimits_t* _limits)
+ * \brief Copia los valores de la configuración a las variables del servidor.
+ * \param [in] _config: Configuración validada.
+ * \param [out] _backlog: Backlog por defecto.
+ * \param [out] _max_connections: Cantidad máxima de clientes simultáneos.
+ * \param [out] _limits: Límites de cada conexión.
+*/
+void ApplyConfig(const Config_t* _config, int* _backlog, int* _max_connections, ConnLimits_t* _limits)
+{
+    *_backlog = ConfigGetInt(_config, "BACKLOG");
+    *_max_connections = ConfigGetInt(_config, "MAX_CONNECTIONS");
+    _limits->read_timeout_ms = ConfigGetInt(_config, "READ_TIMEOUT");
+    _limits->request_timeout_ms = ConfigGetInt(_config, "REQUEST_TIMEOUT");
+    _limits->write_timeout_ms = ConfigGetInt(_config, "WRITE_TIMEOUT");
+    _limits->max_request_size = ConfigGetInt(_config, "MAX_REQUEST_SIZE");
+    _limits->h2c = ConfigGetInt(_config, "HTTP2");
+}
+
+/**
+ * \fn int ReloadConfig(Config_t* _config, Listener_t* _listeners, int _count, int* _max_connections, ConnLimits_t* _limits)
+ * \brief Recarga el config.ini (SIGHUP).
+ * \details Si el archivo nuevo es inválido se sigue con la configuración anterior. Los valores nuevos
+ * reemplazan a los anteriores todos juntos: los clientes ya atendidos terminan con los viejos y los
+ * siguientes fork() heredan los nuevos. Un BACKLOG nuevo se aplica llamando otra vez a listen().
+ * \param [in] _config: Configuración en uso. Se reemplaza si la nueva es válida.
+ * \param [in] _listeners: Sockets de escucha abiertos.
+ * \param [in] _count: Cantidad de sockets de escucha.
+ * \param [out] _max_connections: Cantidad máxima de clientes simultáneos.
+ * \param [out] _limits: Límites de cada conexión.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+int ReloadConfig(Config_t* _config, Listener_t* _listeners, int _count, int* _max_connections, ConnLimits_t* _limits)
+{
+    static Config_t new_config;
+    char specs[MAX_LISTENERS][CONFIG_VALUE_LEN];
+    int backlog;
+
+    if (ConfigLoad(CONFIG_FILE, &new_config) < 0){
+        printf("Recarga de %s descartada: se mantiene la configuración anterior\n", CONFIG_FILE);
+        return -1;
+    }
+    ConfigWarnNotReloadable(_config, &new_config);
+    ApplyConfig(&new_config, &backlog, _max_connections, _limits);
+
+    // Backlog: solo cambia en los listeners que no lo fijan en su línea LISTEN.
+    int spec_count = ConfigGetList(_config, "LISTEN", specs, MAX_LISTENERS);
+    for (int i = 0; i < _count; i++){
+        Listener_t aux;
+        if (i < spec_count){
+            if (ParseListener(specs[i], backlog, &aux) < 0){
+                continue;
+            }
+        }
+        else{
+            aux.backlog = backlog;
+        }
+        if (aux.backlog != _listeners[i].backlog && listen(_listeners[i].fd, aux.backlog) == 0){
+            _listeners[i].backlog = aux.backlog;
+        }
+    }
+
+    memcpy(_config, &new_config, sizeof(Config_t));
+    printf("Configuración recargada: MAX_CONNECTIONS=%d BACKLOG=%d\n", *_max_connections, backlog);
     return 0;
 }
 
 /**
- * \fn int MakeServer(int _port, int _backlog )
- * \brief Crea el servidor.
- * \details Crea el servidor.
- * \param [in] _port: Puerto del servidor a crear.
- * \param [in] _backlog: Cantidad de clientes que permite en espera.
+ * \fn int OpenReplication(const Config_t* _config, int _backlog, Listener_t* _listener)
+ * \brief Abre la escucha de réplicas (REPLICATION_LISTEN).
+ * \details Necesita un journal (REPLICATION_JOURNAL): es de donde se envían los cambios.
+ * \param [in] _config: Configuración leída.
+ * \param [in] _backlog: Backlog por defecto.
+ * \param [out] _listener: Escucha. fd -1 si no se pidió.
  * \return Devuelve -1 si error. 0 sino.
 */
-int MakeServer(int _port, int _backlog ) 
+int OpenReplication(const Config_t* _config, int _backlog, Listener_t* _listener)
 {
-    int server_Id;
-    struct sockaddr_in server_data;
+    char name[LISTEN_ADDR_LEN + 16];
+    const char* spec = ConfigGetString(_config, "REPLICATION_LISTEN");
 
-    server_Id = socket(AF_INET, SOCK_STREAM, 0); // Creo el socket para comunicación IPv4
-    if (server_Id == -1)
+    _listener->fd = -1;
+    if (spec == NULL){
+        return 0;
+    }
+    if (ConfigGetString(_config, "REPLICATION_JOURNAL") == NULL){
+        printf("REPLICATION_LISTEN necesita REPLICATION_JOURNAL\n");
+        return -1;
+    }
+    if (ParseListener(spec, _backlog, _listener) < 0){
+        printf("REPLICATION_LISTEN inválido: %s\n", spec);
         return -1;
-    int opt=1;
-    setsockopt(server_Id, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    }
+    if (OpenListener(_listener) < 0){
+        perror(ListenerName(_listener, name, sizeof(name)));
+        return -1;
+    }
+    printf("Réplicas en %s\n\n", ListenerName(_listener, name, sizeof(name)));
+    return 0;
+}
+
+/**
+ * \fn int StartWorkers(const Config_t* _config, WorkerPool_t* _workers, Doors_t* _doors)
+ * \brief Lanza el pool de hilos si WORKERS > 0.
+ * \details Los hilos usan la memoria compartida que este proceso ya tiene enganchada. WORKER_CPUS es una lista
+ * de CPUs: el hilo i queda fijo en la CPU i % cantidad.
+ * \param [in] _config: Configuración leída.
+ * \param [out] _workers: Pool. count queda en 0 si se atiende con fork().
+ * \param [in] _doors: Puertas.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+int StartWorkers(const Config_t* _config, WorkerPool_t* _workers, Doors_t* _doors)
+{
+    char specs[MAX_WORKERS][CONFIG_VALUE_LEN];
+    int cpus[MAX_WORKERS];
+    int count = ConfigGetInt(_config, "WORKERS");
+    int cpus_count = ConfigGetList(_config, "WORKER_CPUS", specs, MAX_WORKERS);
+
+    _workers->count = 0;
+    if (count <= 0){
+        return 0;
+    }
+    for (int i = 0; i < cpus_count; i++){
+        char* end;
+        long cpu = strtol(specs[i], &end, 10);
+        if (end == specs[i] || *end != '\0' || cpu < 0 || cpu > MAX_WORKER_CPU){
+            printf("WORKER_CPUS inválido: %s\n", specs[i]);
+            errno = EINVAL;
+            return -1;
+        }
+        cpus[i] = (int)cpu;
+    }
+    if (WorkersStart(_workers, count, (cpus_count > 0) ? cpus : NULL, cpus_count, _doors) < 0){
+        return -1;
+    }
+    printf("Atendiendo con %d hilos%s\n\n", count, (cpus_count > 0) ? " (fijos a WORKER_CPUS)" : "");
+    return 0;
+}
+
+/**
+ * \fn int StartTls(const Config_t* _config, const Listener_t* _listeners, int _count)
+ * \brief Prepara HTTPS si algún listener tiene la opción tls.
+ * \param [in] _config: Configuración leída (TLS_CERT, TLS_KEY, TLS_TICKETS, TLS_SESSION_TIME).
+ * \param [in] _listeners: Vector de listeners.
+ * \param [in] _count: Cantidad de listeners.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+int StartTls(const Config_t* _config, const Listener_t* _listeners, int _count)
+{
+    int https = 0;
 
-    server_data.sin_family = AF_INET;
-    server_data.sin_port = htons(_port);
-    server_data.sin_addr.s_addr = htonl(INADDR_ANY);
-    if (bind(server_Id, (struct sockaddr *)&server_data, sizeof(server_data)) == -1) // Enlazo el server a un puerto
+    for (int i = 0; i < _count; i++){
+        https += _listeners[i].tls;
+    }
+    if (https == 0){
+        return 0;
+    }
+    if (TlsSetup(&doors.shm->tls, ConfigGetString(_config, "TLS_CERT"), ConfigGetString(_config, "TLS_KEY"),
+                 ConfigGetInt(_config, "TLS_TICKETS"), ConfigGetInt(_config, "TLS_SESSION_TIME")) < 0){
+        printf("No se pudo preparar HTTPS\n");
         return -1;
+    }
+    printf("HTTPS en %d listeners (%s)\n\n", https, ConfigGetString(_config, "TLS_CERT"));
+    return 0;
+}
 
-    if (listen(server_Id, _backlog) < 0){ // MAX cant de pedidos en espera
-        close(server_Id);
+/**
+ * \fn pid_t StartFollower(const char* _primary, Listener_t* _listeners, int _count, const Listener_t* _repl)
+ * \brief Lanza el proceso que sigue a la primaria.
+ * \param [in] _primary: Dirección de la primaria (REPLICA_OF).
+ * \param [in] _listeners: Sockets de escucha (el hijo los cierra).
+ * \param [in] _count: Cantidad de sockets de escucha.
+ * \param [in] _repl: Escucha de réplicas (el hijo la cierra).
+ * \return El pid del proceso. -1 si error.
+*/
+pid_t StartFollower(const char* _primary, Listener_t* _listeners, int _count, const Listener_t* _repl)
+{
+    pid_t pid = fork();
+    if (pid < 0){
+        perror("Error fork");
         return -1;
     }
-    printf("Servidor creado con éxito en 127.0.0.1:%d\n\n",_port);
-    return server_Id;
+    if (pid == 0){
+        ChildrenUnblockSignals();
+        SnapshotTimer(0);
+        for (int i = 0; i < _count; i++){
+            close(_listeners[i].fd);
+        }
+        if (_repl->fd >= 0){
+            close(_repl->fd);
+        }
+        DoorsCloseDrivers(&doors);
+        ReplFollow(_primary, &doors);
+        exit(1);
+    }
+    printf("Réplica de %s (solo lectura)\n", _primary);
+    return pid;
 }
 
 /**
- * \fn int GetInitValue(const char* _file_name, const char* _key, char* _value, const size_t _size )
- * \brief Obtiene valores iniciales NUMÉRICOS de un archivo.
- * \details Obtiene valores iniciales NUMÉRICOS de un archivo.
- * \param [in] _file_name: Nombre del archivo .ini.
- * \param [in] _key: Nombre de la variable a buscar.
- * \return Devuelve -1 si error. el valor a leer sino.
+ * \fn void ServeReplica(const Listener_t* _repl, Listener_t* _listeners, int _count)
+ * \brief Acepta una réplica y lanza el proceso que le envía los cambios.
+ * \details No ocupa lugar de cliente. Una instancia de solo lectura no acepta réplicas.
+ * \param [in] _repl: Escucha de réplicas.
+ * \param [in] _listeners: Sockets de escucha (el hijo los cierra).
+ * \param [in] _count: Cantidad de sockets de escucha.
 */
-int GetInitValue(const char* _file_name, const char* _key)
+void ServeReplica(const Listener_t* _repl, Listener_t* _listeners, int _count)
 {
-    char line[256];
-    char key[256];
-    char value[256];
-    int ret = -1;
-    FILE* config_file = fopen(_file_name, "rb");
-    if(!config_file){
-        return -2;
-    }
-
-    // Leo linea y comparo con key. Devuelvo el valor tal y como está escrito.
-    while(fgets(line, sizeof(line), config_file)){
-        if (sscanf(line, "%[^=]=%s", key, value) == 2) {
-            if(strcmp(key, _key) == 0){
-                ret = 1;
-                break;
-            }
+    int slot = -1;
+    int sock = accept(_repl->fd, NULL, NULL);
+    if (sock < 0){
+        return;
+    }
+    for (int i = 0; i < MAX_REPLICAS && slot < 0; i++){
+        if (repl_pids[i] <= 0){
+            slot = i;
         }
     }
-    fclose(config_file);
-    
-    value[255] = '\0';
-    
-    if (ret == 1){
-        ret = atoi(value);
+    if (slot < 0 || doors.read_only){
+        printf("Réplica rechazada: %s\n", doors.read_only ? "esta instancia es de solo lectura" : "demasiadas réplicas");
+        close(sock);
+        return;
+    }
+    SetupAccepted(_repl, sock);
+
+    pid_t pid = fork();
+    if (pid < 0){
+        perror("Error fork");
+        close(sock);
+        return;
+    }
+    if (pid == 0){
+        ChildrenUnblockSignals();
+        for (int i = 0; i < _count; i++){
+            close(_listeners[i].fd);
+        }
+        close(_repl->fd);
+        DoorsCloseDrivers(&doors);
+        ReplServe(sock, &doors);
+        close(sock);
+        exit(0);
     }
-    return ret;
+    repl_pids[slot] = pid;
+    close(sock);
 }
 
 /**
- * \fn void setHandlers( void )
- * \brief Setea los Handlers de señales.
- * \details Configura SIGCHLD con ChildHandler y SIGINT con KillHandler. 
- * Este último no continua con acciones bloqueantes, lo que permite salir.
- * \return void.
+ * \fn void StopReplication(int _follower_only)
+ * \brief Termina los procesos de replicación.
+ * \param [in] _follower_only: 1 para terminar solo el seguidor de la primaria (promoción).
 */
-void setHandlers( void )
+void StopReplication(int _follower_only)
 {
-    struct sigaction sa;
+    for (int i = _follower_only ? MAX_REPLICAS : 0; i <= MAX_REPLICAS; i++){
+        pid_t pid = repl_pids[i];
+        if (pid > 0){
+            kill(pid, SIGTERM);
+            waitpid(pid, NULL, 0);
+            repl_pids[i] = -1;
+        }
+    }
+}
 
-    sa.sa_handler = ChildHandler;
-    sigemptyset(&sa.sa_mask);
-    sa.sa_flags = SA_RESTART;  
-    sigaction(SIGCHLD, &sa, NULL);
-    
-    sa.sa_handler = KillHandler;    //NOTA: Se utilizo SIGACTION para que SIGINT pueda salir del accept (que es bloqueante)
-    sigemptyset(&sa.sa_mask);
-    sa.sa_flags = 0;           
-    sigaction(SIGINT, &sa, NULL);
+/**
+ * \fn void SnapshotTimer(long _interval_ms)
+ * \brief Programa SIGALRM cada _interval_ms para copiar las claves a disco.
+ * \details Los hijos no heredan el timer (fork() lo borra).
+ * \param [in] _interval_ms: Intervalo (SNAPSHOT_INTERVAL). 0 para detenerlo.
+*/
+void SnapshotTimer(long _interval_ms)
+{
+    struct itimerval timer;
+
+    timer.it_interval.tv_sec = _interval_ms / 1000;
+    timer.it_interval.tv_usec = (_interval_ms % 1000) * 1000;
+    timer.it_value = timer.it_interval;
+    setitimer(ITIMER_REAL, &timer, NULL);
+}
 
+/**
+ * \fn void setSignals(sigset_t* _mask)
+ * \brief Arma el conjunto de señales que atiende el lazo principal.
+ * \details SIGINT termina, SIGHUP recarga la configuración, SIGUSR1 promueve la réplica, SIGUSR2 actualiza el
+ * binario y SIGALRM copia las claves. No tienen handler: ChildrenInit() las bloquea junto con SIGCHLD y se leen del
+ * mismo signalfd (ver DispatchSignals()).
+ * \param [out] _mask: Señales.
+*/
+void setSignals(sigset_t* _mask)
+{
+    sigemptyset(_mask);
+    sigaddset(_mask, SIGINT);
+    sigaddset(_mask, SIGHUP);
+    sigaddset(_mask, SIGUSR1);
+    sigaddset(_mask, SIGUSR2);
+    sigaddset(_mask, SIGALRM);
 }
 
 /**
- * \fn void ChildHandler(int _signal )
- * \brief Handler de procesos hijos.
- * \details Handler de procesos hijos.
- * \param [in] _signal: Señal enviada.
+ * \fn int DispatchSignals(ChildTable_t* _children)
+ * \brief Lee las señales pendientes del signalfd y atiende cada una según ssi_signo.
+ * \details SIGCHLD junta los hijos enseguida. Las demás marcan el pedido, que el lazo principal hace antes de volver
+ * al poll(): una señal que llega mientras tanto queda pendiente en el signalfd y despierta al poll() siguiente.
+ * \param [in] _children: Hijos del proceso principal (tienen el signalfd).
+ * \return Cantidad de clientes que terminaron.
 */
-void ChildHandler(int signal)
+int DispatchSignals(ChildTable_t* _children)
 {
-    while(waitpid(-1, NULL, WNOHANG) > 0){
-        cant_clients--;
+    int reap = 0;
+    int signo;
+
+    while ((signo = ChildrenNextSignal(_children)) > 0){
+        switch (signo){
+            case SIGCHLD: reap = 1; break;
+            case SIGINT: running = 0; break;
+            case SIGHUP: reload_config = 1; break;
+            case SIGUSR1: promote_requested = 1; break;
+            case SIGUSR2: upgrade_requested = 1; break;
+            case SIGALRM: snapshot_due = 1; break;
+            default: break;
+        }
     }
+    return reap ? ChildrenReap(_children, WorkerExited) : 0;
 }
 
 /**
- * \fn void KillHandler(int _signal )
- * \brief Handler de finalización de programa.
- * \details Handler de finalización de programa.
- * \param [in] _signal: Señal enviada.
+ * \fn void WorkerExited(pid_t _pid, int _status)
+ * \brief Procesos terminados que no son clientes: lectores de puertas y réplicas.
+ * \details Los llama ChildrenReap() desde el lazo principal. No liberan un lugar de cliente.
+ * \param [in] _pid: Proceso.
+ * \param [in] _status: Estado de waitpid().
 */
-void KillHandler(int signal)
+void WorkerExited(pid_t _pid, int _status)
 {
-    running = 0;
-}
\ No newline at end of file
+    for (int i = 0; i <= MAX_REPLICAS; i++){
+        if (repl_pids[i] == _pid){
+            repl_pids[i] = -1;
+            return;
+        }
+    }
+    if (DoorsIsWorker(&doors, _pid) && running && WIFSIGNALED(_status) && WTERMSIG(_status) != SIGTERM){
+        printf("Lector %d terminó por la señal %d\n", _pid, WTERMSIG(_status));
+    }
+}
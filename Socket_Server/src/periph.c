@@ -12,72 +12,371 @@
  **********************************************************************************************************************************/
 #include "../inc/periph.h"
 
+/***********************************************************************************************************************************
+ *** DEFINES PRIVADOS AL MODULO
+ **********************************************************************************************************************************/
+#define EXPIRE_DOOR     0       /**< Tag de la rueda: claves de la puerta */
+#define EXPIRE_GLOBAL   1       /**< Tag de la rueda: claves globales (solo las atiende la puerta 0) */
+
+/***********************************************************************************************************************************
+ *** TIPOS DE DATOS PRIVADOS AL MODULO
+ **********************************************************************************************************************************/
+/**
+ * \struct Expirer_t
+ * \brief Vencimientos que atiende un lector: su rueda y las claves que vencieron en la vuelta.
+ */
+typedef struct {
+    TimerWheel_t wheel;                 /**< Rueda de timers */
+    KeyShard_t* shard[2];               /**< Claves por tag. NULL si no las atiende */
+    int sem[2];                         /**< Semáforo de cada una */
+    uint16_t* due[2];                   /**< Claves vencidas en la vuelta, por tag */
+    int due_count[2];                   /**< Cantidad en due */
+    KeyExpire_t* scan;                  /**< Buffer para ListExpirations() */
+} Expirer_t;
+
+/***********************************************************************************************************************************
+ *** PROTOTIPOS DE FUNCIONES PRIVADAS AL MODULO
+ **********************************************************************************************************************************/
+static int ExpirerInit(Expirer_t* _exp, const Doors_t* _doors, int _id);
+static void ExpirerTick(Expirer_t* _exp, int _id);
+static void ExpirerSchedule(Expirer_t* _exp, int _tag, const KeyExpire_t* _list, int _count);
+static void ExpirerFire(void* _ctx, uint16_t _code, uint16_t _tag);
+static int ExpirerTimeout(void);
+static void ExpirerJournal(const Expirer_t* _exp, int _door, int _tag, int64_t _now_ns);
+static int UseKeyJournaled(KeyEntry_t _key, KeyShard_t* _shard, int _semId, int _door);
+
 /***********************************************************************************************************************************
  *** IMPLEMENTACION DE LOS METODODS DE LA CLASE
  **********************************************************************************************************************************/
 /**
- * \fn int periph( int driver )
- * \brief Función de manejo del periférico
- * \details Abre la memoria compartida, lee el teclado y analiza la respuesta. 
- * \param [in] driver: File descriptor del driver a utilizar. 
- * Las respuestas activan los leds y se guardan en el log.
+ * \fn int periph(const Doors_t* _doors, int _id)
+ * \brief Función de manejo del periférico de una puerta.
+ * \details Espera con poll() a que el dispositivo tenga una clave, la valida contra las claves de la puerta y las
+ * globales, activa los leds y la guarda en el log de la puerta. Solo toma semáforos de su puerta (y el global para leer).
+ * Además vence las claves temporales de su puerta (la puerta 0 también las globales) con una rueda de timers que
+ * avanza una vez por segundo. Tras LOCKOUT_FAILURES claves incorrectas en LOCKOUT_WINDOW la puerta se bloquea
+ * LOCKOUT_TIME: se registra una sola entrada (LOG_LOCKOUT) y los intentos siguientes se descartan sin validar.
+ * Los comandos a leds y buzzer pasan por una cola que los junta durante ACTUATOR_WINDOW y los escribe de una vez.
+ * \param [in] _doors: Puertas.
+ * \param [in] _id: Puerta a atender.
 */
-int periph( int driver, KeyEntry_t* valid_keys, ActivityEntry_t*log, int sem_list[3])
+int periph(const Doors_t* _doors, int _id)
 {
+    const Door_t* door = &_doors->door[_id];
     KeyEntry_t driver_buff;
     ActivityEntry_t activity;
     driver_msg_t msg;
+    char code[KEY_SIZE + 1];
+    struct pollfd pfd = { .fd = door->driver, .events = POLLIN };
+    Expirer_t expirer;
+    Lockout_t* lockout = door->lockout;     // En la memoria compartida (DoorShm_t): sigue después de un traspaso
+    Actuator_t actuator;
 
-    int sem_k = sem_list[0];
-    int sem_l = sem_list[1];
-    int sem_write = sem_list[2];
-
+    ActuatorInit(&actuator, door, _id);
+    if (ExpirerInit(&expirer, _doors, _id) < 0){
+        perror("Error al crear la rueda de vencimientos");
+        return -1;
+    }
     while(1){
+        //Espero que el teclado tenga una clave, que pase el segundo de la rueda o que venza la ventana de los leds.
+        int timeout = ExpirerTimeout();
+        int flush_in = ActuatorTimeout(&actuator, TimeNowNs());
+        if (flush_in >= 0 && flush_in < timeout){
+            timeout = flush_in;
+        }
+        int ready = poll(&pfd, 1, timeout);
+        if (ready < 0){
+            if (errno == EINTR){
+                continue;
+            }
+            perror(door->device);
+            sleep(1);
+            continue;
+        }
+        if (ActuatorTimeout(&actuator, TimeNowNs()) == 0 && ActuatorFlush(&actuator) < 0){
+            perror("Error al escribir los actuadores");
+        }
+        ExpirerTick(&expirer, _id);
+        int dropped = LockoutExpired(lockout, TimeNowNs());
+        if (dropped >= 0){
+            printf("Puerta %d: fin del bloqueo, %d intentos descartados\n", _id, dropped);
+        }
+        if (ready == 0){
+            continue;
+        }
+        if (pfd.revents & (POLLERR | POLLNVAL)){
+            printf("Puerta %d: error en %s\n", _id, door->device);
+            sleep(1);
+            continue;
+        }
+
         //Pido clave a driver teclado.
-        if(readDriver(driver, &driver_buff) < 0){
-            perror("Error al leer de /dev/my_alarm");
+        int ret = readDriver(door->driver, &driver_buff);
+        if (ret == -2){
+            printf("Puerta %d: clave mal formada desde %s\n", _id, door->device);
+            continue;
+        }
+        if(ret < 0){
+            perror(door->device);
             sleep(1);
             continue;
         }
 
-        //Verifico que sea correcta.
-        if(HasKey(driver_buff, valid_keys, sem_k)){
+        //Bloqueada por intentos fallidos: no valido, no activo nada y no lleno el log.
+        if (LockoutActive(lockout, TimeNowNs())){
+            continue;
+        }
+
+        //Verifico que sea correcta (claves de la puerta o globales).
+        int used = UseKeyJournaled(driver_buff, door->keys, door->sem_k, _id);
+        if (used <= 0){
+            used = UseKeyJournaled(driver_buff, _doors->global_keys, _doors->sem_global, DOOR_GLOBAL);
+        }
+        if(used > 0){
             CreateActivityEntry(&activity, driver_buff, 1);
+            LockoutReset(lockout);
             //Si es correcta -> prendo led, prendo buzzer f2, guardo en log.
             msg.command = GREEN_LED;
             msg.dec_ms = 100;       //1s
-            if (writeDriver(driver, msg, sem_write) < 0){
+            if (ActuatorPush(&actuator, msg, activity.time_ns) < 0){
                 perror("Error al escribir Led Verde");
             }
             msg.command = BUZZER;
             msg.dec_ms = 10;        //100ms
-            if (writeDriver(driver, msg, sem_write) < 0){
+            if (ActuatorPush(&actuator, msg, activity.time_ns) < 0){
                 perror("Error al escribir Buzzer");
             }
         }
         else{
             CreateActivityEntry(&activity, driver_buff, 0);
+            if (LockoutFail(lockout, activity.time_ns)){   // Esta entrada resume el bloqueo que empieza
+                activity.flags |= LOG_LOCKOUT;
+            }
             //Si es incorrecta -> prendo led, prendo buzzer f1, guardo en log.
             msg.command = RED_LED;
             msg.dec_ms = 200;       //2s
-            if (writeDriver(driver, msg, sem_write) < 0){
+            if (ActuatorPush(&actuator, msg, activity.time_ns) < 0){
                 perror("Error al escribir Led Rojo");
             }
             msg.command = BUZZER;
             msg.dec_ms = 200;
-            if (writeDriver(driver, msg, sem_write) < 0){
+            if (ActuatorPush(&actuator, msg, activity.time_ns) < 0){
                 perror("Error al escribir Buzzer");
             }
         }
-        int aux = AddLog(activity, log, sem_l);
+        const TimeCache_t* when = TimeFormat(activity.time_ns);
+        printf("%s %s puerta %d clave %s %s\n", when->date, when->hour, _id, KeyToString(driver_buff, code),
+               (activity.flags & LOG_STATUS_OK) ? "aceptada" : (activity.flags & LOG_LOCKOUT) ? "rechazada: puerta bloqueada" : "rechazada");
+        int aux = AddLog(activity, door->log, door->log_index, door->sem_l);
         if (aux < 0){
             perror("Error al guardar el log");
         }
+        else if (aux == 0 && (activity.flags & LOG_LOCKOUT)){   // El log no rota: que el bloqueo no se pierda en silencio
+            printf("Log lleno: no se guardó el bloqueo de la puerta %d (%s %s)\n", _id, when->date, when->hour);
+        }
+        StatsAdd(_id, &activity);   // Aunque el log esté lleno
+        if (JournalLog(_id, &activity) < 0){
+            perror("Error al escribir el journal");
+        }
     }
-    
-    shmdt(valid_keys);
-    shmdt(log);
 
     return 0;
 
 }
+
+/***********************************************************************************************************************************
+ *** FUNCIONES PRIVADAS AL MODULO
+ **********************************************************************************************************************************/
+/**
+ * \fn static int ExpirerInit(Expirer_t* _exp, const Doors_t* _doors, int _id)
+ * \brief Crea la rueda y programa las claves que ya vencen (arranque o traspaso desde otro binario).
+ * \details Es la única vez que se recorre la tabla; después solo se leen los avisos nuevos de cada KeyShard_t.
+ * \param [out] _exp: Vencimientos del lector.
+ * \param [in] _doors: Puertas.
+ * \param [in] _id: Puerta que atiende el lector.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+static int ExpirerInit(Expirer_t* _exp, const Doors_t* _doors, int _id)
+{
+    memset(_exp, 0, sizeof(Expirer_t));
+    _exp->shard[EXPIRE_DOOR] = _doors->door[_id].keys;
+    _exp->sem[EXPIRE_DOOR] = _doors->door[_id].sem_k;
+    if (_id == 0){
+        _exp->shard[EXPIRE_GLOBAL] = _doors->global_keys;
+        _exp->sem[EXPIRE_GLOBAL] = _doors->sem_global;
+    }
+
+    // Lugar para que cada clave se reprograme una vez antes de vencer (cambio de regla) sin perder timers.
+    int capacity = 2 * MAX_VALID_KEYS * (_id == 0 ? 2 : 1);
+    if (WheelInit(&_exp->wheel, capacity, TimeNowNs() / 1000000000LL) < 0){
+        return -1;
+    }
+    _exp->scan = (KeyExpire_t*)malloc(sizeof(KeyExpire_t) * MAX_VALID_KEYS);
+    _exp->due[EXPIRE_DOOR] = (uint16_t*)malloc(sizeof(uint16_t) * capacity);
+    _exp->due[EXPIRE_GLOBAL] = (uint16_t*)malloc(sizeof(uint16_t) * capacity);
+    if (!_exp->scan || !_exp->due[EXPIRE_DOOR] || !_exp->due[EXPIRE_GLOBAL]){
+        free(_exp->scan);
+        free(_exp->due[EXPIRE_DOOR]);
+        free(_exp->due[EXPIRE_GLOBAL]);
+        WheelFree(&_exp->wheel);
+        return -1;
+    }
+    for (int tag = EXPIRE_DOOR; tag <= EXPIRE_GLOBAL; tag++){
+        if (_exp->shard[tag] == NULL){
+            continue;
+        }
+        // Los avisos pendientes quedan cubiertos por el recorrido completo.
+        int lost;
+        TakeExpirations(_exp->shard[tag], _exp->sem[tag], _exp->scan, &lost);
+        int count = ListExpirations(_exp->shard[tag], _exp->sem[tag], _exp->scan);
+        ExpirerSchedule(_exp, tag, _exp->scan, count);
+    }
+    return 0;
+}
+
+/**
+ * \fn static void ExpirerTick(Expirer_t* _exp, int _id)
+ * \brief Programa los vencimientos nuevos, avanza la rueda y borra las claves vencidas.
+ * \param [in] _exp: Vencimientos del lector.
+ * \param [in] _id: Puerta que atiende el lector (para los mensajes).
+*/
+static void ExpirerTick(Expirer_t* _exp, int _id)
+{
+    KeyExpire_t fresh[KEY_EXPIRE_QUEUE];
+    int64_t now_ns = TimeNowNs();
+
+    for (int tag = EXPIRE_DOOR; tag <= EXPIRE_GLOBAL; tag++){
+        if (_exp->shard[tag] == NULL){
+            continue;
+        }
+        int lost = 0;
+        int count = TakeExpirations(_exp->shard[tag], _exp->sem[tag], fresh, &lost);
+        ExpirerSchedule(_exp, tag, fresh, count);
+        if (lost){  // Se llenó la cola: una revisión completa (las repetidas se descartan al vencer)
+            count = ListExpirations(_exp->shard[tag], _exp->sem[tag], _exp->scan);
+            ExpirerSchedule(_exp, tag, _exp->scan, count);
+        }
+        _exp->due_count[tag] = 0;
+    }
+
+    if (WheelAdvance(&_exp->wheel, now_ns / 1000000000LL, ExpirerFire, _exp) == 0){
+        return;
+    }
+    for (int tag = EXPIRE_DOOR; tag <= EXPIRE_GLOBAL; tag++){
+        if (_exp->due_count[tag] == 0){
+            continue;
+        }
+        // Borrado y journal con el semáforo tomado: el journal queda en el orden de los cambios.
+        if (lockSem(_exp->sem[tag]) == -1){
+            continue;
+        }
+        int removed = ExpireKeys(_exp->due[tag], _exp->due_count[tag], now_ns, _exp->shard[tag], SEM_HELD);
+        if (removed > 0){
+            ExpirerJournal(_exp, tag == EXPIRE_GLOBAL ? DOOR_GLOBAL : _id, tag, now_ns);
+        }
+        unlockSem(_exp->sem[tag]);
+        if (removed > 0){
+            printf("Puerta %d: %d clave(s) %s vencida(s)\n", _id, removed, tag == EXPIRE_GLOBAL ? "global(es)" : "de la puerta");
+        }
+    }
+}
+
+/**
+ * \fn static void ExpirerSchedule(Expirer_t* _exp, int _tag, const KeyExpire_t* _list, int _count)
+ * \brief Agrega vencimientos a la rueda.
+ * \param [in] _exp: Vencimientos del lector.
+ * \param [in] _tag: EXPIRE_DOOR o EXPIRE_GLOBAL.
+ * \param [in] _list: Vencimientos.
+ * \param [in] _count: Cantidad (puede ser -1 si hubo error).
+*/
+static void ExpirerSchedule(Expirer_t* _exp, int _tag, const KeyExpire_t* _list, int _count)
+{
+    for (int i = 0; i < _count; i++){
+        int64_t expire = (_list[i].end_ns + 999999999LL) / 1000000000LL;   // El segundo en que ya venció
+        if (WheelAdd(&_exp->wheel, expire, _list[i].code, (uint16_t)_tag) < 0){
+            // Sin lugar: la clave igual se rechaza al vencer (HasKey/UseKey miran la regla), solo queda en la tabla.
+            printf("Rueda de vencimientos llena: la clave %04u se borrará al reprogramarla\n", _list[i].code);
+            return;
+        }
+    }
+}
+
+/**
+ * \fn static void ExpirerFire(void* _ctx, uint16_t _code, uint16_t _tag)
+ * \brief Anota una clave vencida para borrarla junto con las demás de la vuelta.
+ * \param [in] _ctx: Expirer_t.
+ * \param [in] _code: Clave.
+ * \param [in] _tag: EXPIRE_DOOR o EXPIRE_GLOBAL.
+*/
+static void ExpirerFire(void* _ctx, uint16_t _code, uint16_t _tag)
+{
+    Expirer_t* exp = (Expirer_t*)_ctx;
+    exp->due[_tag][exp->due_count[_tag]++] = _code;
+}
+
+/**
+ * \fn static int ExpirerTimeout(void)
+ * \brief Milisegundos hasta el próximo segundo, para que la rueda avance en hora.
+ * \return Timeout para poll().
+*/
+static int ExpirerTimeout(void)
+{
+    int64_t now_ns = TimeNowNs();
+    return (int)(1000 - (now_ns / 1000000LL) % 1000) + 1;
+}
+
+/**
+ * \fn static void ExpirerJournal(const Expirer_t* _exp, int _door, int _tag, int64_t _now_ns)
+ * \brief Registra en el journal las claves revisadas en la vuelta, para que la réplica las venza igual.
+ * \details La réplica aplica ExpireKeys() con el mismo instante: las que no vencieron tampoco se borran allá.
+ * Se llama con el semáforo de la lista tomado.
+ * \param [in] _exp: Vencimientos del lector.
+ * \param [in] _door: Puerta o DOOR_GLOBAL.
+ * \param [in] _tag: EXPIRE_DOOR o EXPIRE_GLOBAL.
+ * \param [in] _now_ns: Instante usado en ExpireKeys().
+*/
+static void ExpirerJournal(const Expirer_t* _exp, int _door, int _tag, int64_t _now_ns)
+{
+    ReplRecord_t records[REPL_BATCH_MAX];
+    int count = 0;
+
+    memset(records, 0, sizeof(records));
+    for (int i = 0; i < _exp->due_count[_tag]; i++){
+        records[count].time_ns = _now_ns;
+        records[count].type = REPL_KEY_EXPIRE;
+        records[count].door = (int8_t)_door;
+        records[count].code = _exp->due[_tag][i];
+        if (++count == REPL_BATCH_MAX || i + 1 == _exp->due_count[_tag]){
+            if (JournalAppend(records, count) < 0){
+                perror("Error al escribir el journal");
+                return;
+            }
+            count = 0;
+        }
+    }
+}
+
+/**
+ * \fn static int UseKeyJournaled(KeyEntry_t _key, KeyShard_t* _shard, int _semId, int _door)
+ * \brief UseKey() y, si consumió una clave de un solo uso, su borrado en el journal, con el semáforo tomado.
+ * \details Así un POST /agregar de la misma clave no puede quedar antes que este borrado en el journal.
+ * \param [in] _key: Clave.
+ * \param [in] _shard: Lista.
+ * \param [in] _semId: Semáforo de la lista.
+ * \param [in] _door: Puerta o DOOR_GLOBAL.
+ * \return Lo mismo que UseKey().
+*/
+static int UseKeyJournaled(KeyEntry_t _key, KeyShard_t* _shard, int _semId, int _door)
+{
+    if (lockSem(_semId) == -1){
+        return -1;
+    }
+    int used = UseKey(_key, _shard, SEM_HELD);
+    if (used == 2 && JournalKey(REPL_KEY_DEL, _door, _key, NULL, TimeNowNs()) < 0){    // En la réplica también se borra
+        perror("Error al escribir el journal");
+    }
+    if (unlockSem(_semId) == -1){
+        return -1;
+    }
+    return used;
+}
@@ -0,0 +1,842 @@
+/*******************************************************************************************************************************//**
+ *
+ * @file		repl.c
+ * @brief		Replicación de claves y log hacia otra instancia (primaria / réplica).
+ * @date		19 oct. 2026
+ * @author		Martinez Agustin
+ *
+ **********************************************************************************************************************************/
+
+ /***********************************************************************************************************************************
+ *** INCLUDES
+ **********************************************************************************************************************************/
+#include "../inc/repl.h"
+
+/***********************************************************************************************************************************
+ *** VARIABLES GLOBALES PRIVADAS AL MODULO
+ **********************************************************************************************************************************/
+static char journal_path[CONFIG_VALUE_LEN];    /**< Journal de este proceso. Vacío si no se registran cambios */
+
+/***********************************************************************************************************************************
+ *** PROTOTIPOS DE FUNCIONES PRIVADAS AL MODULO
+ **********************************************************************************************************************************/
+static int JournalLock(int _mode, JournalHeader_t* _header, uint64_t* _records);
+static void JournalUnlock(int _fd);
+static int JournalRange(uint64_t* _epoch, uint64_t* _base, uint64_t* _last);
+static int JournalRead(uint64_t _epoch, uint64_t _seq, ReplRecord_t* _out, int _max);
+static int FullSync(int _sock, const Doors_t* _doors, uint64_t* _epoch, uint64_t* _pos, SnapshotKey_t* _keys);
+static int ApplyFull(int _sock, Doors_t* _doors, SnapshotKey_t* _keys, uint64_t* _epoch, uint64_t* _last);
+static void ApplyRecord(const ReplRecord_t* _record, Doors_t* _doors);
+static int SendMsg(int _sock, uint32_t _type, uint32_t _count, uint64_t _seq, uint64_t _epoch, const void* _data, size_t _len);
+static int SendAll(int _sock, const void* _data, size_t _len, int _flags);
+static int RecvAll(int _sock, void* _data, size_t _len, int _timeout_ms);
+static int ReplConnect(const Listener_t* _target);
+static int64_t NowMs(void);
+
+/***********************************************************************************************************************************
+ *** IMPLEMENTACION DE LOS METODODS DE LA CLASE
+ **********************************************************************************************************************************/
+/**
+ * \fn int JournalOpen(const char* _path)
+ * \brief Indica el journal de este proceso (lo heredan los hijos) y lo crea si no existe.
+ * \param [in] _path: Archivo (REPLICATION_JOURNAL). NULL o vacío para no registrar cambios.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+int JournalOpen(const char* _path)
+{
+    JournalHeader_t header;
+    uint64_t records;
+
+    journal_path[0] = '\0';
+    if (_path == NULL || _path[0] == '\0'){
+        return 0;
+    }
+    strncpy(journal_path, _path, sizeof(journal_path) - 1);
+    int fd = JournalLock(LOCK_EX, &header, &records);
+    if (fd < 0){
+        journal_path[0] = '\0';
+        return -1;
+    }
+    JournalUnlock(fd);
+    return 0;
+}
+
+/**
+ * \fn int JournalAppend(const ReplRecord_t* _records, int _count)
+ * \brief Agrega cambios al journal.
+ * \details Cada proceso abre el archivo y toma flock() exclusivo mientras escribe, así clientes y lectores pueden
+ * registrar a la vez. Si el journal supera JOURNAL_MAX_RECORDS se rota antes de escribir.
+ * \param [in] _records: Cambios.
+ * \param [in] _count: Cantidad.
+ * \return Devuelve -1 si error. 0 sino (también si no hay journal).
+*/
+int JournalAppend(const ReplRecord_t* _records, int _count)
+{
+    JournalHeader_t header;
+    uint64_t records;
+
+    if (journal_path[0] == '\0' || _count <= 0){
+        return 0;
+    }
+    int fd = JournalLock(LOCK_EX, &header, &records);
+    if (fd < 0){
+        return -1;
+    }
+    if (records + (uint64_t)_count > JOURNAL_MAX_RECORDS){
+        // Rotación: las réplicas que estaban más atrás que esto reciben una copia completa.
+        header.base += records;
+        if (ftruncate(fd, 0) < 0 || write(fd, &header, sizeof(header)) != (ssize_t)sizeof(header)){
+            JournalUnlock(fd);
+            return -1;
+        }
+    }
+    size_t len = sizeof(ReplRecord_t) * (size_t)_count;
+    ssize_t written = write(fd, _records, len);     // O_APPEND sobre un archivo regular: todo o error
+    if (written != (ssize_t)len){
+        // Un registro a medias se descarta en el próximo JournalLock().
+        JournalUnlock(fd);
+        return -1;
+    }
+    JournalUnlock(fd);
+    return 0;
+}
+
+/**
+ * \fn int JournalKey(ReplType_t _type, int _door, KeyEntry_t _key, const KeyRule_t* _rule, int64_t _time_ns)
+ * \brief Registra un cambio de una clave.
+ * \details Se llama con el semáforo de la lista tomado, en la misma sección crítica que el cambio: así el journal
+ * queda en el mismo orden que los cambios aunque escriban varios procesos.
+ * \param [in] _type: REPL_KEY_ADD, REPL_KEY_DEL, REPL_KEY_CLEAR o REPL_KEY_EXPIRE.
+ * \param [in] _door: Puerta o DOOR_GLOBAL.
+ * \param [in] _key: Clave.
+ * \param [in] _rule: Regla (REPL_KEY_ADD). NULL si no aplica.
+ * \param [in] _time_ns: Instante del cambio.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+int JournalKey(ReplType_t _type, int _door, KeyEntry_t _key, const KeyRule_t* _rule, int64_t _time_ns)
+{
+    ReplRecord_t record;
+
+    if (journal_path[0] == '\0'){
+        return 0;
+    }
+    memset(&record, 0, sizeof(record));
+    record.time_ns = _time_ns;
+    record.type = (uint8_t)_type;
+    record.door = (int8_t)_door;
+    record.code = _key.code;
+    if (_rule != NULL){
+        record.rule = *_rule;
+    }
+    return JournalAppend(&record, 1);
+}
+
+/**
+ * \fn int JournalBulk(const KeyEntry_t* _keys, int _count, int _replace, const KeyRule_t* _rule, int _door)
+ * \brief Registra un lote de claves (POST /claves/bulk) con una sola escritura.
+ * \details Como JournalKey(), con el semáforo de la lista tomado.
+ * \param [in] _keys: Claves del lote.
+ * \param [in] _count: Cantidad.
+ * \param [in] _replace: El lote reemplazó a todas las claves.
+ * \param [in] _rule: Regla de todas las claves del lote.
+ * \param [in] _door: Puerta o DOOR_GLOBAL.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+int JournalBulk(const KeyEntry_t* _keys, int _count, int _replace, const KeyRule_t* _rule, int _door)
+{
+    int64_t now_ns = TimeNowNs();
+    int used = 0;
+
+    if (journal_path[0] == '\0'){
+        return 0;
+    }
+    ReplRecord_t* records = (ReplRecord_t*)calloc((size_t)_count + 1, sizeof(ReplRecord_t));
+    if (!records){
+        return -1;
+    }
+    if (_replace){
+        records[used].time_ns = now_ns;
+        records[used].type = REPL_KEY_CLEAR;
+        records[used].door = (int8_t)_door;
+        records[used].code = KEY_EMPTY;
+        used++;
+    }
+    for (int i = 0; i < _count; i++, used++){
+        records[used].time_ns = now_ns;
+        records[used].type = REPL_KEY_ADD;
+        records[used].door = (int8_t)_door;
+        records[used].code = _keys[i].code;
+        records[used].rule = *_rule;
+    }
+    int ret = JournalAppend(records, used);
+    free(records);
+    return ret;
+}
+
+/**
+ * \fn int JournalLog(int _door, const ActivityEntry_t* _activity)
+ * \brief Registra una entrada nueva del log.
+ * \param [in] _door: Puerta.
+ * \param [in] _activity: Entrada.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+int JournalLog(int _door, const ActivityEntry_t* _activity)
+{
+    ReplRecord_t record;
+
+    if (journal_path[0] == '\0'){
+        return 0;
+    }
+    memset(&record, 0, sizeof(record));
+    record.time_ns = _activity->time_ns;
+    record.type = REPL_LOG;
+    record.door = (int8_t)_door;
+    record.code = _activity->code;
+    record.flags = _activity->flags;
+    return JournalAppend(&record, 1);
+}
+
+/**
+ * \fn int ReplServe(int _sock, const Doors_t* _doors)
+ * \brief Atiende una réplica (proceso hijo) hasta que se desconecta.
+ * \details Si la réplica viene del mismo journal y sus registros siguen en disco, se le envía solo lo que le falta.
+ * Si no, una copia completa de claves y logs. Después se le envían los registros nuevos en lotes de hasta
+ * REPL_BATCH_MAX, revisando el journal cada REPL_BATCH_MS.
+ * \param [in] _sock: Conexión aceptada.
+ * \param [in] _doors: Puertas.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+int ReplServe(int _sock, const Doors_t* _doors)
+{
+    ReplHello_t hello;
+    uint64_t epoch, base, last, pos;
+    int ret = -1;
+
+    if (RecvAll(_sock, &hello, sizeof(hello), REPL_TIMEOUT_MS) < 0 || hello.magic != REPL_MAGIC || hello.version != REPL_VERSION){
+        printf("Replicación: saludo inválido\n");
+        return -1;
+    }
+    if (journal_path[0] == '\0' || JournalRange(&epoch, &base, &last) < 0){
+        return -1;
+    }
+    ReplRecord_t* batch = (ReplRecord_t*)malloc(sizeof(ReplRecord_t) * REPL_BATCH_MAX);
+    SnapshotKey_t* keys = (SnapshotKey_t*)malloc(sizeof(SnapshotKey_t) * MAX_VALID_KEYS);
+    if (!batch || !keys){
+        free(batch);
+        free(keys);
+        return -1;
+    }
+
+    if (hello.epoch == epoch && hello.last_seq >= base && hello.last_seq <= last){
+        pos = hello.last_seq;
+        printf("Replicación: réplica al día hasta %llu, se envían %llu registro(s) del journal\n",
+               (unsigned long long)pos, (unsigned long long)(last - pos));
+    }
+    else if (FullSync(_sock, _doors, &epoch, &pos, keys) < 0){
+        goto end;
+    }
+
+    int64_t last_send = NowMs();
+    while (1){
+        int count = JournalRead(epoch, pos + 1, batch, REPL_BATCH_MAX);
+        if (count == -2){   // Se rotó (o se recreó) el journal por delante de la réplica
+            if (FullSync(_sock, _doors, &epoch, &pos, keys) < 0){
+                goto end;
+            }
+            last_send = NowMs();
+            continue;
+        }
+        if (count < 0){
+            goto end;
+        }
+        if (count > 0){
+            if (SendMsg(_sock, REPL_MSG_BATCH, (uint32_t)count, pos + 1, epoch, batch, sizeof(ReplRecord_t) * count) < 0){
+                goto end;
+            }
+            pos += (uint64_t)count;
+            last_send = NowMs();
+            if (count == REPL_BATCH_MAX){   // Quedan más: sin esperar
+                continue;
+            }
+        }
+        else if (NowMs() - last_send >= REPL_HEARTBEAT_MS){
+            if (SendMsg(_sock, REPL_MSG_BATCH, 0, pos, epoch, NULL, 0) < 0){
+                goto end;
+            }
+            last_send = NowMs();
+        }
+
+        // La réplica no envía nada después del saludo: si el socket se vuelve legible es que cerró.
+        struct pollfd pfd = { _sock, POLLIN, 0 };
+        int ready = poll(&pfd, 1, REPL_BATCH_MS);
+        if (ready < 0 && errno != EINTR){
+            goto end;
+        }
+        if (ready > 0){
+            char aux;
+            if (recv(_sock, &aux, 1, MSG_DONTWAIT) <= 0){
+                ret = 0;
+                goto end;
+            }
+        }
+    }
+
+end:
+    free(batch);
+    free(keys);
+    return ret;
+}
+
+/**
+ * \fn int ReplFollow(const char* _primary, Doors_t* _doors)
+ * \brief Sigue a la primaria (proceso hijo de la réplica). No vuelve.
+ * \details Se conecta, aplica la copia completa o los registros que faltan y después cada lote. Si la conexión se cae
+ * o no llega nada en REPL_TIMEOUT_MS reconecta indicando el último registro aplicado.
+ * \param [in] _primary: Dirección de la primaria (REPLICA_OF): "IP:puerto", "[IPv6]:puerto" o "unix:/path".
+ * \param [in] _doors: Puertas.
+ * \return Devuelve -1 si la dirección es inválida.
+*/
+int ReplFollow(const char* _primary, Doors_t* _doors)
+{
+    Listener_t target;
+    ReplHello_t hello;
+    ReplMsg_t msg;
+    uint64_t epoch = 0, last = 0;
+    int warned = 0;
+
+    if (ParseListener(_primary, 1, &target) < 0){
+        printf("REPLICA_OF inválido: %s\n", _primary);
+        return -1;
+    }
+    ReplRecord_t* batch = (ReplRecord_t*)malloc(sizeof(ReplRecord_t) * REPL_BATCH_MAX);
+    SnapshotKey_t* keys = (SnapshotKey_t*)malloc(sizeof(SnapshotKey_t) * MAX_VALID_KEYS);
+    if (!batch || !keys){
+        free(batch);
+        free(keys);
+        return -1;
+    }
+
+    while (1){
+        int sock = ReplConnect(&target);
+        if (sock < 0){
+            if (!warned){
+                printf("Replicación: no se pudo conectar a %s, reintentando\n", _primary);
+                warned = 1;
+            }
+            usleep(REPL_RETRY_MS * 1000);
+            continue;
+        }
+        warned = 0;
+
+        memset(&hello, 0, sizeof(hello));
+        hello.magic = REPL_MAGIC;
+        hello.version = REPL_VERSION;
+        hello.epoch = epoch;
+        hello.last_seq = last;
+        if (SendAll(sock, &hello, sizeof(hello), 0) == 0){
+            printf("Replicación: conectado a %s desde %llu\n", _primary, (unsigned long long)last);
+        }
+
+        while (RecvAll(sock, &msg, sizeof(msg), REPL_TIMEOUT_MS) == 0){
+            if (msg.type == REPL_MSG_FULL_BEGIN){
+                if (ApplyFull(sock, _doors, keys, &epoch, &last) < 0){
+                    epoch = 0;  // Copia a medias: la próxima vez otra completa
+                    break;
+                }
+                printf("Replicación: copia completa aplicada hasta %llu\n", (unsigned long long)last);
+                continue;
+            }
+            if (msg.type != REPL_MSG_BATCH || msg.count > REPL_BATCH_MAX){
+                printf("Replicación: mensaje inesperado %u\n", msg.type);
+                break;
+            }
+            if (msg.count == 0){    // Latido
+                continue;
+            }
+            if (msg.epoch != epoch || msg.seq != last + 1){
+                printf("Replicación: salto de secuencia (%llu, esperaba %llu)\n", (unsigned long long)msg.seq, (unsigned long long)(last + 1));
+                epoch = 0;
+                break;
+            }
+            if (RecvAll(sock, batch, sizeof(ReplRecord_t) * msg.count, REPL_TIMEOUT_MS) < 0){
+                break;
+            }
+            for (uint32_t i = 0; i < msg.count; i++){
+                ApplyRecord(&batch[i], _doors);
+            }
+            last += msg.count;
+        }
+        close(sock);
+        printf("Replicación: se perdió la conexión con %s\n", _primary);
+        usleep(REPL_RETRY_MS * 1000);
+    }
+    return 0;
+}
+
+/***********************************************************************************************************************************
+ *** FUNCIONES PRIVADAS AL MODULO
+ **********************************************************************************************************************************/
+/**
+ * \fn static int JournalLock(int _mode, JournalHeader_t* _header, uint64_t* _records)
+ * \brief Abre el journal con flock() tomado y lee el encabezado.
+ * \details Si el archivo está vacío (o no es un journal) se crea uno nuevo; si termina en un registro a medias
+ * (se cortó una escritura) se recorta. Las dos cosas necesitan el lock exclusivo.
+ * \param [in] _mode: LOCK_SH o LOCK_EX.
+ * \param [out] _header: Encabezado.
+ * \param [out] _records: Registros completos en el archivo.
+ * \return El fd, para JournalUnlock(). -1 si error.
+*/
+static int JournalLock(int _mode, JournalHeader_t* _header, uint64_t* _records)
+{
+    struct stat info;
+
+    int fd = open(journal_path, O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0600);
+    if (fd < 0){
+        return -1;
+    }
+    if (flock(fd, _mode) < 0 || fstat(fd, &info) < 0){
+        close(fd);
+        return -1;
+    }
+    int valid = ((size_t)info.st_size >= sizeof(JournalHeader_t)
+                 && pread(fd, _header, sizeof(JournalHeader_t), 0) == (ssize_t)sizeof(JournalHeader_t)
+                 && _header->magic == REPL_MAGIC && _header->version == REPL_VERSION);
+    size_t extra = valid ? ((size_t)info.st_size - sizeof(JournalHeader_t)) % sizeof(ReplRecord_t) : 0;
+
+    if (!valid || extra != 0){
+        if (_mode != LOCK_EX){
+            close(fd);
+            return JournalLock(LOCK_EX, _header, _records);
+        }
+        if (!valid){
+            memset(_header, 0, sizeof(JournalHeader_t));
+            _header->magic = REPL_MAGIC;
+            _header->version = REPL_VERSION;
+            _header->epoch = ((uint64_t)TimeNowNs() << 16) ^ (uint64_t)getpid();
+            if (ftruncate(fd, 0) < 0 || write(fd, _header, sizeof(JournalHeader_t)) != (ssize_t)sizeof(JournalHeader_t)){
+                close(fd);
+                return -1;
+            }
+            info.st_size = sizeof(JournalHeader_t);
+        }
+        else{
+            info.st_size -= (off_t)extra;
+            if (ftruncate(fd, info.st_size) < 0){
+                close(fd);
+                return -1;
+            }
+        }
+    }
+    *_records = ((uint64_t)info.st_size - sizeof(JournalHeader_t)) / sizeof(ReplRecord_t);
+    return fd;
+}
+
+/**
+ * \fn static void JournalUnlock(int _fd)
+ * \brief Suelta el lock y cierra el journal.
+ * \param [in] _fd: fd de JournalLock().
+*/
+static void JournalUnlock(int _fd)
+{
+    flock(_fd, LOCK_UN);
+    close(_fd);
+}
+
+/**
+ * \fn static int JournalRange(uint64_t* _epoch, uint64_t* _base, uint64_t* _last)
+ * \brief Secuencias disponibles en el journal: de _base+1 a _last.
+ * \param [out] _epoch: Identificador del journal.
+ * \param [out] _base: Secuencia anterior al primer registro.
+ * \param [out] _last: Última secuencia escrita.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+static int JournalRange(uint64_t* _epoch, uint64_t* _base, uint64_t* _last)
+{
+    JournalHeader_t header;
+    uint64_t records;
+
+    int fd = JournalLock(LOCK_SH, &header, &records);
+    if (fd < 0){
+        return -1;
+    }
+    JournalUnlock(fd);
+    *_epoch = header.epoch;
+    *_base = header.base;
+    *_last = header.base + records;
+    return 0;
+}
+
+/**
+ * \fn static int JournalRead(uint64_t _epoch, uint64_t _seq, ReplRecord_t* _out, int _max)
+ * \brief Lee registros del journal desde la secuencia _seq.
+ * \param [in] _epoch: Journal esperado.
+ * \param [in] _seq: Primera secuencia a leer.
+ * \param [out] _out: Registros.
+ * \param [in] _max: Máximo a leer.
+ * \return Cantidad leída (0 si no hay nuevos). -2 si el journal cambió o ya no tiene _seq. -1 si error.
+*/
+static int JournalRead(uint64_t _epoch, uint64_t _seq, ReplRecord_t* _out, int _max)
+{
+    JournalHeader_t header;
+    uint64_t records;
+    int count = 0;
+
+    int fd = JournalLock(LOCK_SH, &header, &records);
+    if (fd < 0){
+        return -1;
+    }
+    if (header.epoch != _epoch || _seq <= header.base){
+        JournalUnlock(fd);
+        return -2;
+    }
+    uint64_t index = _seq - header.base - 1;
+    if (index < records){
+        count = (records - index < (uint64_t)_max) ? (int)(records - index) : _max;
+        off_t offset = (off_t)(sizeof(JournalHeader_t) + sizeof(ReplRecord_t) * index);
+        if (pread(fd, _out, sizeof(ReplRecord_t) * count, offset) != (ssize_t)(sizeof(ReplRecord_t) * count)){
+            count = -1;
+        }
+    }
+    JournalUnlock(fd);
+    return count;
+}
+
+/**
+ * \fn static int FullSync(int _sock, const Doors_t* _doors, uint64_t* _epoch, uint64_t* _pos, SnapshotKey_t* _keys)
+ * \brief Envía a la réplica una copia completa de las claves y los logs.
+ * \details La posición del journal se toma antes de copiar: lo que cambie durante la copia se vuelve a enviar
+ * después y aplicarlo dos veces no cambia el resultado. Cada conjunto se copia con su semáforo tomado y se envía
+ * sin él.
+ * \param [in] _sock: Conexión con la réplica.
+ * \param [in] _doors: Puertas.
+ * \param [out] _epoch: Journal de la copia.
+ * \param [out] _pos: Última secuencia incluida en la copia.
+ * \param [in] _keys: Buffer de MAX_VALID_KEYS.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+static int FullSync(int _sock, const Doors_t* _doors, uint64_t* _epoch, uint64_t* _pos, SnapshotKey_t* _keys)
+{
+    ActivityEntry_t log[MAX_LOG];
+    uint64_t base;
+
+    if (JournalRange(_epoch, &base, _pos) < 0){
+        return -1;
+    }
+    if (SendMsg(_sock, REPL_MSG_FULL_BEGIN, (uint32_t)_doors->count, *_pos, *_epoch, NULL, 0) < 0){
+        return -1;
+    }
+    for (int i = 0; i <= _doors->count; i++){
+        int sem;
+        KeyShard_t* shard = DoorKeys(_doors, i == 0 ? DOOR_GLOBAL : i - 1, &sem);
+        if (lockSem(sem) == -1){
+            return -1;
+        }
+        uint32_t count = 0;
+        while (count < MAX_VALID_KEYS && shard->keys[count].code != KEY_EMPTY){
+            _keys[count].rule = shard->rules[count];
+            _keys[count].code = shard->keys[count].code;
+            memset(_keys[count].reserved, 0, sizeof(_keys[count].reserved));
+            count++;
+        }
+        unlockSem(sem);
+        if (SendMsg(_sock, REPL_MSG_SHARD, count, (uint64_t)i, *_epoch, _keys, sizeof(SnapshotKey_t) * count) < 0){
+            return -1;
+        }
+    }
+    for (int i = 0; i < _doors->count; i++){
+        if (lockSem(_doors->door[i].sem_l) == -1){
+            return -1;
+        }
+        memcpy(log, _doors->door[i].log, sizeof(log));
+        unlockSem(_doors->door[i].sem_l);
+        if (SendMsg(_sock, REPL_MSG_LOG, MAX_LOG, (uint64_t)i, *_epoch, log, sizeof(log)) < 0){
+            return -1;
+        }
+    }
+    if (SendMsg(_sock, REPL_MSG_FULL_END, 0, *_pos, *_epoch, NULL, 0) < 0){
+        return -1;
+    }
+    printf("Replicación: copia completa enviada hasta %llu\n", (unsigned long long)*_pos);
+    return 0;
+}
+
+/**
+ * \fn static int ApplyFull(int _sock, Doors_t* _doors, SnapshotKey_t* _keys, uint64_t* _epoch, uint64_t* _last)
+ * \brief Recibe una copia completa (ya se leyó REPL_MSG_FULL_BEGIN) y reemplaza claves y logs.
+ * \details Las puertas se identifican por posición: la réplica tiene que tener las mismas líneas DEVICE.
+ * \param [in] _sock: Conexión con la primaria.
+ * \param [in] _doors: Puertas.
+ * \param [in] _keys: Buffer de MAX_VALID_KEYS.
+ * \param [out] _epoch: Journal de la primaria.
+ * \param [out] _last: Última secuencia incluida en la copia.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+static int ApplyFull(int _sock, Doors_t* _doors, SnapshotKey_t* _keys, uint64_t* _epoch, uint64_t* _last)
+{
+    ActivityEntry_t log[MAX_LOG];
+    ReplMsg_t msg;
+
+    while (RecvAll(_sock, &msg, sizeof(msg), REPL_TIMEOUT_MS) == 0){
+        if (msg.type == REPL_MSG_FULL_END){
+            *_epoch = msg.epoch;
+            *_last = msg.seq;
+            return 0;
+        }
+        if (msg.type == REPL_MSG_SHARD && msg.count <= MAX_VALID_KEYS){
+            if (RecvAll(_sock, _keys, sizeof(SnapshotKey_t) * msg.count, REPL_TIMEOUT_MS) < 0){
+                return -1;
+            }
+            int sem;
+            int door = (int)msg.seq - 1;
+            KeyShard_t* shard = (door < _doors->count) ? DoorKeys(_doors, door < 0 ? DOOR_GLOBAL : door, &sem) : NULL;
+            if (shard == NULL){
+                continue;
+            }
+            if (AddKeysBulk(NULL, 0, 1, NULL, shard, sem) < 0){
+                return -1;
+            }
+            for (uint32_t k = 0; k < msg.count; k++){
+                KeyEntry_t key = { _keys[k].code };
+                AddKey(key, &_keys[k].rule, shard, sem);
+            }
+        }
+        else if (msg.type == REPL_MSG_LOG && msg.count == MAX_LOG){
+            if (RecvAll(_sock, log, sizeof(log), REPL_TIMEOUT_MS) < 0){
+                return -1;
+            }
+            if (msg.seq < (uint64_t)_doors->count){
+                Door_t* door = &_doors->door[msg.seq];
+                if (lockSem(door->sem_l) == -1){
+                    return -1;
+                }
+                SeqWriteBegin(&door->log_index->seq);
+                memcpy(door->log, log, sizeof(log));
+                LogIndexBuild(door->log_index, door->log);
+                SeqWriteEnd(&door->log_index->seq);
+                unlockSem(door->sem_l);
+            }
+        }
+        else{
+            return -1;
+        }
+    }
+    return -1;
+}
+
+/**
+ * \fn static void ApplyRecord(const ReplRecord_t* _record, Doors_t* _doors)
+ * \brief Aplica un cambio recibido de la primaria.
+ * \details Aplicarlo dos veces no cambia nada: una entrada de log igual (instante y clave) no se repite.
+ * \param [in] _record: Cambio.
+ * \param [in] _doors: Puertas.
+*/
+static void ApplyRecord(const ReplRecord_t* _record, Doors_t* _doors)
+{
+    KeyEntry_t key = { _record->code };
+    int sem;
+
+    if (_record->door >= _doors->count){
+        return;
+    }
+    if (_record->type == REPL_LOG){
+        if (_record->door < 0){
+            return;
+        }
+        Door_t* door = &_doors->door[(int)_record->door];
+        if (lockSem(door->sem_l) == -1){
+            return;
+        }
+        int free_pos = -1;
+        for (int i = 0; i < MAX_LOG; i++){
+            if (door->log[i].code == _record->code && door->log[i].time_ns == _record->time_ns){
+                free_pos = -2;
+                break;
+            }
+            if (door->log[i].code == KEY_EMPTY && free_pos == -1){
+                free_pos = i;
+            }
+        }
+        if (free_pos >= 0){
+            SeqWriteBegin(&door->log_index->seq);
+            door->log[free_pos].time_ns = _record->time_ns;
+            door->log[free_pos].code = _record->code;
+            door->log[free_pos].flags = _record->flags;
+            door->log[free_pos].reserved = 0;
+            LogIndexAdd(door->log_index, door->log, free_pos);
+            SeqWriteEnd(&door->log_index->seq);
+        }
+        unlockSem(door->sem_l);
+        if (free_pos != -2){
+            ActivityEntry_t entry = { _record->time_ns, _record->code, _record->flags, 0 };
+            StatsAdd(_record->door, &entry);
+        }
+        return;
+    }
+
+    KeyShard_t* shard = DoorKeys(_doors, _record->door < 0 ? DOOR_GLOBAL : _record->door, &sem);
+    if (shard == NULL){
+        return;
+    }
+    switch (_record->type){
+        case REPL_KEY_ADD:
+            AddKey(key, &_record->rule, shard, sem);
+            break;
+        case REPL_KEY_DEL:
+            DeleteKey(key, shard, sem);
+            break;
+        case REPL_KEY_CLEAR:
+            AddKeysBulk(NULL, 0, 1, NULL, shard, sem);
+            break;
+        case REPL_KEY_EXPIRE:
+            ExpireKeys(&_record->code, 1, _record->time_ns, shard, sem);
+            break;
+        default:
+            break;
+    }
+}
+
+/**
+ * \fn static int SendMsg(int _sock, uint32_t _type, uint32_t _count, uint64_t _seq, uint64_t _epoch, const void* _data, size_t _len)
+ * \brief Envía un mensaje a la réplica: encabezado y datos.
+ * \param [in] _sock: Conexión.
+ * \param [in] _type: ReplMsgType_t.
+ * \param [in] _count: Elementos en _data.
+ * \param [in] _seq: Según el tipo.
+ * \param [in] _epoch: Journal.
+ * \param [in] _data: Datos. NULL si no hay.
+ * \param [in] _len: Largo de _data.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+static int SendMsg(int _sock, uint32_t _type, uint32_t _count, uint64_t _seq, uint64_t _epoch, const void* _data, size_t _len)
+{
+    ReplMsg_t msg = { _type, _count, _seq, _epoch };
+
+    if (SendAll(_sock, &msg, sizeof(msg), _len > 0 ? MSG_MORE : 0) < 0){
+        return -1;
+    }
+    return (_len > 0) ? SendAll(_sock, _data, _len, 0) : 0;
+}
+
+/**
+ * \fn static int SendAll(int _sock, const void* _data, size_t _len, int _flags)
+ * \brief send() hasta enviar todo.
+ * \param [in] _sock: Conexión.
+ * \param [in] _data: Datos.
+ * \param [in] _len: Largo.
+ * \param [in] _flags: Flags extra de send() (MSG_MORE).
+ * \return Devuelve -1 si error. 0 sino.
+*/
+static int SendAll(int _sock, const void* _data, size_t _len, int _flags)
+{
+    const char* aux = (const char*)_data;
+    while (_len > 0){
+        ssize_t sent = send(_sock, aux, _len, MSG_NOSIGNAL | _flags);
+        if (sent < 0){
+            if (errno == EINTR){
+                continue;
+            }
+            return -1;
+        }
+        aux += sent;
+        _len -= (size_t)sent;
+    }
+    return 0;
+}
+
+/**
+ * \fn static int RecvAll(int _sock, void* _data, size_t _len, int _timeout_ms)
+ * \brief recv() hasta completar _len bytes.
+ * \param [in] _sock: Conexión.
+ * \param [out] _data: Buffer.
+ * \param [in] _len: Bytes a leer.
+ * \param [in] _timeout_ms: Máxima espera sin recibir nada.
+ * \return Devuelve -1 si error, cierre o timeout. 0 sino.
+*/
+static int RecvAll(int _sock, void* _data, size_t _len, int _timeout_ms)
+{
+    char* aux = (char*)_data;
+    while (_len > 0){
+        struct pollfd pfd = { _sock, POLLIN, 0 };
+        int ready = poll(&pfd, 1, _timeout_ms);
+        if (ready < 0 && errno == EINTR){
+            continue;
+        }
+        if (ready <= 0){
+            return -1;
+        }
+        ssize_t got = recv(_sock, aux, _len, 0);
+        if (got < 0 && errno == EINTR){
+            continue;
+        }
+        if (got <= 0){
+            return -1;
+        }
+        aux += got;
+        _len -= (size_t)got;
+    }
+    return 0;
+}
+
+/**
+ * \fn static int ReplConnect(const Listener_t* _target)
+ * \brief Se conecta a la primaria.
+ * \param [in] _target: Dirección, leída con ParseListener().
+ * \return El socket. -1 si error.
+*/
+static int ReplConnect(const Listener_t* _target)
+{
+    struct sockaddr_storage addr;
+    socklen_t len;
+    int one = 1;
+
+    memset(&addr, 0, sizeof(addr));
+    if (_target->family == AF_UNIX){
+        struct sockaddr_un* un = (struct sockaddr_un*)&addr;
+        un->sun_family = AF_UNIX;
+        memcpy(un->sun_path, _target->addr, sizeof(un->sun_path) - 1);     // Ya viene terminado en \0
+        len = sizeof(struct sockaddr_un);
+    }
+    else if (_target->family == AF_INET6){
+        struct sockaddr_in6* in6 = (struct sockaddr_in6*)&addr;
+        in6->sin6_family = AF_INET6;
+        in6->sin6_port = htons((uint16_t)_target->port);
+        if (inet_pton(AF_INET6, _target->addr, &in6->sin6_addr) != 1){
+            return -1;
+        }
+        len = sizeof(struct sockaddr_in6);
+    }
+    else{
+        struct sockaddr_in* in = (struct sockaddr_in*)&addr;
+        in->sin_family = AF_INET;
+        in->sin_port = htons((uint16_t)_target->port);
+        if (inet_pton(AF_INET, _target->addr, &in->sin_addr) != 1){
+            return -1;
+        }
+        len = sizeof(struct sockaddr_in);
+    }
+
+    int sock = socket(_target->family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (sock < 0){
+        return -1;
+    }
+    if (connect(sock, (struct sockaddr*)&addr, len) < 0){
+        close(sock);
+        return -1;
+    }
+    if (_target->family != AF_UNIX){
+        setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+    return sock;
+}
+
+/**
+ * \fn static int64_t NowMs(void)
+ * \brief Reloj monotónico en ms.
+ * \return ms desde un instante fijo.
+*/
+static int64_t NowMs(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
@@ -0,0 +1,238 @@
+/*******************************************************************************************************************************//**
+ *
+ * @file		router.c
+ * @brief		Tabla de rutas HTTP (método + path -> función) con hash perfecto.
+ * @date		19 oct. 2026
+ * @author		Martinez Agustin
+ *
+ **********************************************************************************************************************************/
+
+ /***********************************************************************************************************************************
+ *** INCLUDES
+ **********************************************************************************************************************************/
+#include "../inc/router.h"
+
+/***********************************************************************************************************************************
+ *** VARIABLES GLOBALES PRIVADAS AL MODULO
+ **********************************************************************************************************************************/
+static const char* const method_names[HTTP_METHODS] = { "GET", "POST" };
+
+/***********************************************************************************************************************************
+ *** PROTOTIPOS DE FUNCIONES PRIVADAS AL MODULO
+ **********************************************************************************************************************************/
+static uint32_t Hash(const char* _path, size_t _len, uint32_t _seed);
+static int SendRouteError(Connection_t* _conn, const char* _status, const char* _allow, const char* _body);
+
+/***********************************************************************************************************************************
+ *** IMPLEMENTACION DE LOS METODODS DE LA CLASE
+ **********************************************************************************************************************************/
+/**
+ * \fn int RouterBuild(Router_t* _router, const Route_t* _routes, int _count)
+ * \brief Busca una semilla con la que ningún par de rutas cae en la misma celda y arma la tabla.
+ * \details Se llama una vez en el proceso principal: hijos e hilos usan la tabla ya armada.
+ * \param [out] _router: Tabla.
+ * \param [in] _routes: Rutas (deben seguir existiendo).
+ * \param [in] _count: Cantidad de rutas (hasta ROUTER_SLOTS / 2).
+ * \return Devuelve -1 si hay paths repetidos o no se encontró semilla. 0 sino.
+*/
+int RouterBuild(Router_t* _router, const Route_t* _routes, int _count)
+{
+    if (_count <= 0 || _count > ROUTER_SLOTS / 2){
+        return -1;
+    }
+    for (int i = 0; i < _count; i++){   // Dos rutas con el mismo path chocan con cualquier semilla
+        for (int j = i + 1; j < _count; j++){
+            if (strcmp(_routes[i].path, _routes[j].path) == 0){
+                printf("Ruta repetida: %s\n", _routes[i].path);
+                return -1;
+            }
+        }
+    }
+
+    _router->routes = _routes;
+    _router->count = _count;
+    for (uint32_t seed = 1; seed <= ROUTER_MAX_SEEDS; seed++){
+        int collision = 0;
+        memset(_router->slot, -1, sizeof(_router->slot));
+        for (int i = 0; i < _count && !collision; i++){
+            uint32_t s = Hash(_routes[i].path, strlen(_routes[i].path), seed) & (ROUTER_SLOTS - 1);
+            if (_router->slot[s] >= 0){
+                collision = 1;
+            }
+            _router->slot[s] = (int8_t)i;
+        }
+        if (!collision){
+            _router->seed = seed;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/**
+ * \fn int RouterDispatch(const Router_t* _router, Request_t* _req)
+ * \brief Separa método, path y query de la línea de pedido y llama a la función de la ruta.
+ * \details Responde 400 si la línea de pedido es inválida, 404 si el path no existe y 405 (con Allow) si existe
+ * pero no para ese método.
+ * \param [in] _router: Tabla.
+ * \param [in] _req: Pedido con client_id, conn, doors, door, keys y sem_k cargados. Completa el resto.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+int RouterDispatch(const Router_t* _router, Request_t* _req)
+{
+    const char* line = _req->conn->buff;
+    const char* target = strchr(line, ' ');
+    const char* line_end = strchr(line, '\n');
+
+    // "<MÉTODO> <path>[?query] HTTP/1.x"
+    if (RouterParseMethod(line, &_req->method) < 0 || target == NULL || line_end == NULL || target > line_end
+        || target[1] != '/'){
+        return ConnSendError(_req->conn, CONN_BAD);
+    }
+    target++;
+    size_t target_len = strcspn(target, " \r\n");
+    if (target[target_len] != ' ' || strncmp(target + target_len, " HTTP/1.", 8) != 0){
+        return ConnSendError(_req->conn, CONN_BAD);
+    }
+    _req->path = target;
+    _req->path_len = strcspn(target, "? \r\n");
+    _req->query = NULL;
+    _req->query_len = 0;
+    if (_req->path_len < target_len){
+        _req->query = target + _req->path_len + 1;
+        _req->query_len = target_len - _req->path_len - 1;
+    }
+
+    int8_t idx = _router->slot[Hash(_req->path, _req->path_len, _router->seed) & (ROUTER_SLOTS - 1)];
+    const Route_t* route = (idx >= 0) ? &_router->routes[idx] : NULL;
+    if (route == NULL || strlen(route->path) != _req->path_len || memcmp(route->path, _req->path, _req->path_len) != 0){
+        printf("Ruta inexistente: %.*s\n", (int)_req->path_len, _req->path);
+        return SendRouteError(_req->conn, "404 Not Found", NULL, "{\"error\":\"ruta inexistente\"}");
+    }
+    if (_req->method == HTTP_METHODS || route->handler[_req->method] == NULL){
+        char allow[32] = "";
+        size_t pos = 0;
+        for (int m = 0; m < HTTP_METHODS; m++){
+            if (route->handler[m] != NULL){
+                pos += snprintf(allow + pos, sizeof(allow) - pos, "%s%s", (pos > 0) ? ", " : "", method_names[m]);
+            }
+        }
+        return SendRouteError(_req->conn, "405 Method Not Allowed", allow, "{\"error\":\"metodo no permitido\"}");
+    }
+    return route->handler[_req->method](_req);
+}
+
+/**
+ * \fn int RouterParseMethod(const char* _line, HttpMethod_t* _method)
+ * \brief Método de una línea de pedido, sin rutearla.
+ * \param [in] _line: Línea de pedido.
+ * \param [out] _method: Método. HTTP_METHODS si es desconocido.
+ * \return Devuelve -1 si la línea no tiene método. 0 sino.
+*/
+int RouterParseMethod(const char* _line, HttpMethod_t* _method)
+{
+    size_t len = strcspn(_line, " \r\n");
+
+    if (len == 0 || _line[len] != ' '){
+        return -1;
+    }
+    *_method = HTTP_METHODS;
+    for (int m = 0; m < HTTP_METHODS; m++){
+        if (strlen(method_names[m]) == len && memcmp(method_names[m], _line, len) == 0){
+            *_method = (HttpMethod_t)m;
+        }
+    }
+    return 0;
+}
+
+/**
+ * \fn int RouteParam(const Request_t* _req, const char* _name, char* _value, size_t _size)
+ * \brief Valor de un parámetro de la query ("?clave=1234&estado=0"). No decodifica %XX.
+ * \param [in] _req: Pedido ruteado.
+ * \param [in] _name: Nombre del parámetro.
+ * \param [out] _value: Valor, terminado en '\0'.
+ * \param [in] _size: Tamaño de _value.
+ * \return Largo del valor. -1 si no está o no entra en _value.
+*/
+int RouteParam(const Request_t* _req, const char* _name, char* _value, size_t _size)
+{
+    size_t name_len = strlen(_name);
+    const char* pos = _req->query;
+    const char* end = _req->query + _req->query_len;
+
+    while (pos != NULL && pos < end){
+        const char* amp = memchr(pos, '&', end - pos);
+        const char* item_end = (amp != NULL) ? amp : end;
+        if ((size_t)(item_end - pos) > name_len && pos[name_len] == '=' && memcmp(pos, _name, name_len) == 0){
+            size_t len = item_end - pos - name_len - 1;
+            if (len >= _size){
+                return -1;
+            }
+            memcpy(_value, pos + name_len + 1, len);
+            _value[len] = '\0';
+            return (int)len;
+        }
+        pos = (amp != NULL) ? amp + 1 : NULL;
+    }
+    return -1;
+}
+
+/**
+ * \fn int RouteError(const Request_t* _req, const char* _status, const char* _body)
+ * \brief Responde un error desde una ruta, igual que los 404/405 del router.
+ * \param [in] _req: Pedido ruteado.
+ * \param [in] _status: Estado ("400 Bad Request").
+ * \param [in] _body: Cuerpo JSON.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+int RouteError(const Request_t* _req, const char* _status, const char* _body)
+{
+    return SendRouteError(_req->conn, _status, NULL, _body);
+}
+
+/***********************************************************************************************************************************
+ *** FUNCIONES PRIVADAS AL MODULO
+ **********************************************************************************************************************************/
+/**
+ * \fn static uint32_t Hash(const char* _path, size_t _len, uint32_t _seed)
+ * \brief FNV-1a de un path, partiendo de una semilla.
+ * \param [in] _path: Path.
+ * \param [in] _len: Largo.
+ * \param [in] _seed: Semilla.
+ * \return El hash.
+*/
+static uint32_t Hash(const char* _path, size_t _len, uint32_t _seed)
+{
+    uint32_t h = 2166136261U ^ (_seed * 16777619U);
+
+    for (size_t i = 0; i < _len; i++){
+        h ^= (uint8_t)_path[i];
+        h *= 16777619U;
+    }
+    return h ^ (h >> 15);
+}
+
+/**
+ * \fn static int SendRouteError(Connection_t* _conn, const char* _status, const char* _allow, const char* _body)
+ * \brief Responde un error de ruteo con un cuerpo JSON.
+ * \param [in] _conn: Conexión.
+ * \param [in] _status: Estado ("404 Not Found").
+ * \param [in] _allow: Métodos admitidos (405). NULL si no aplica.
+ * \param [in] _body: Cuerpo JSON.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+static int SendRouteError(Connection_t* _conn, const char* _status, const char* _allow, const char* _body)
+{
+    char buff_com[256];
+
+    int len = snprintf(buff_com, sizeof(buff_com),
+            "HTTP/1.1 %s\r\n"
+            "%s%s%s"
+            "Content-Type: application/json; charset=utf-8\r\n"
+            "Content-Length: %zu\r\n"
+            "Connection: close\r\n\r\n"
+            "%s",
+            _status, (_allow != NULL) ? "Allow: " : "", (_allow != NULL) ? _allow : "", (_allow != NULL) ? "\r\n" : "",
+            strlen(_body), _body);
+    return ConnWriteAll(_conn, buff_com, len);
+}
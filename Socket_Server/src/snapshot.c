@@ -0,0 +1,285 @@
+/*******************************************************************************************************************************//**
+ *
+ * @file		snapshot.c
+ * @brief		Copia de las claves a disco y recuperación al arrancar.
+ * @date		19 oct. 2026
+ * @author		Martinez Agustin
+ *
+ **********************************************************************************************************************************/
+
+ /***********************************************************************************************************************************
+ *** INCLUDES
+ **********************************************************************************************************************************/
+#include "../inc/snapshot.h"
+
+/***********************************************************************************************************************************
+ *** PROTOTIPOS DE FUNCIONES PRIVADAS AL MODULO
+ **********************************************************************************************************************************/
+static KeyShard_t* ShardAt(const Doors_t* _doors, int _index, int* _semId, const char** _device);
+static uint32_t Checksum(uint32_t _hash, const void* _data, size_t _len);
+
+/***********************************************************************************************************************************
+ *** IMPLEMENTACION DE LOS METODODS DE LA CLASE
+ **********************************************************************************************************************************/
+/**
+ * \fn int SnapshotInit(Snapshot_t* _snap, const char* _path)
+ * \brief Prepara las copias.
+ * \param [out] _snap: Estado a inicializar.
+ * \param [in] _path: Archivo (SNAPSHOT_FILE). NULL o vacío para deshabilitar.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+int SnapshotInit(Snapshot_t* _snap, const char* _path)
+{
+    memset(_snap, 0, sizeof(Snapshot_t));
+    if (_path == NULL || _path[0] == '\0'){
+        return 0;
+    }
+    _snap->keys = (SnapshotKey_t*)malloc(sizeof(SnapshotKey_t) * MAX_VALID_KEYS * SNAPSHOT_SHARDS);
+    if (!_snap->keys){
+        return -1;
+    }
+    strncpy(_snap->path, _path, sizeof(_snap->path) - 1);
+    return 0;
+}
+
+/**
+ * \fn void SnapshotFree(Snapshot_t* _snap)
+ * \brief Libera el buffer de copia.
+ * \param [in] _snap: Estado.
+*/
+void SnapshotFree(Snapshot_t* _snap)
+{
+    free(_snap->keys);
+    _snap->keys = NULL;
+    _snap->path[0] = '\0';
+}
+
+/**
+ * \fn int SnapshotLoad(Snapshot_t* _snap, Doors_t* _doors)
+ * \brief Carga la última copia en la memoria compartida recién creada.
+ * \details Se llama antes de lanzar los lectores, así que no toma semáforos. El archivo se lee con mmap() y se valida
+ * completo (tamaños y checksum) antes de copiar nada. Las claves ya vencidas y las de dispositivos que ya no están se descartan.
+ * \param [in] _snap: Estado.
+ * \param [in] _doors: Puertas con la memoria compartida vacía.
+ * \return Cantidad de claves recuperadas. 0 si no hay copia. -1 si el archivo es inválido.
+*/
+int SnapshotLoad(Snapshot_t* _snap, Doors_t* _doors)
+{
+    struct stat info;
+    int restored = 0;
+
+    if (_snap->path[0] == '\0'){
+        return 0;
+    }
+    int fd = open(_snap->path, O_RDONLY);
+    if (fd < 0){
+        return (errno == ENOENT) ? 0 : -1;
+    }
+    if (fstat(fd, &info) < 0 || (size_t)info.st_size < sizeof(SnapshotHeader_t)){
+        close(fd);
+        return -1;
+    }
+    size_t size = (size_t)info.st_size;
+    const unsigned char* file = (const unsigned char*)mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (file == MAP_FAILED){
+        return -1;
+    }
+
+    // Valido todo antes de tocar la memoria compartida.
+    const SnapshotHeader_t* header = (const SnapshotHeader_t*)file;
+    const SnapshotShard_t* table = (const SnapshotShard_t*)(file + sizeof(SnapshotHeader_t));
+    const SnapshotKey_t* keys = (const SnapshotKey_t*)(table + header->shards);
+    size_t total = 0;
+    int valid = (header->magic == SNAPSHOT_MAGIC && header->version == SNAPSHOT_VERSION && header->shards <= SNAPSHOT_SHARDS
+                 && size >= sizeof(SnapshotHeader_t) + sizeof(SnapshotShard_t) * header->shards);
+    for (uint32_t s = 0; valid && s < header->shards; s++){
+        valid = (table[s].count <= MAX_VALID_KEYS);
+        total += table[s].count;
+    }
+    if (valid){
+        valid = (size == sizeof(SnapshotHeader_t) + sizeof(SnapshotShard_t) * header->shards + sizeof(SnapshotKey_t) * total)
+                && Checksum(2166136261u, table, size - sizeof(SnapshotHeader_t)) == header->checksum;
+    }
+    if (!valid){
+        munmap((void*)file, size);
+        return -1;
+    }
+
+    int64_t now_ns = TimeNowNs();
+    for (uint32_t s = 0; s < header->shards; s++){
+        const SnapshotKey_t* list = keys;
+        keys += table[s].count;
+        KeyShard_t* shard = NULL;
+        for (int i = 0; i <= _doors->count && shard == NULL; i++){
+            int sem;
+            const char* device;
+            KeyShard_t* aux = ShardAt(_doors, i, &sem, &device);
+            if (strncmp(device, table[s].device, DOOR_DEVICE_LEN) == 0){
+                shard = aux;
+            }
+        }
+        if (shard == NULL){
+            printf("Copia de claves: %.*s ya no está configurado, se descartan %u claves\n", DOOR_DEVICE_LEN, table[s].device, table[s].count);
+            continue;
+        }
+        int used = 0;
+        while (used < MAX_VALID_KEYS && shard->keys[used].code != KEY_EMPTY){
+            used++;
+        }
+        SeqWriteBegin(&shard->seq);
+        for (uint32_t k = 0; k < table[s].count && used < MAX_VALID_KEYS; k++){
+            if (list[k].code >= KEY_SPACE || (list[k].rule.end_ns != 0 && list[k].rule.end_ns <= now_ns)){
+                continue;
+            }
+            shard->keys[used].code = list[k].code;
+            shard->rules[used] = list[k].rule;
+            used++;
+            restored++;
+        }
+        shard->version++;
+        SeqWriteEnd(&shard->seq);
+    }
+    munmap((void*)file, size);
+
+    for (int i = 0; i <= _doors->count; i++){  // Lo cargado ya está en disco
+        int sem;
+        const char* device;
+        _snap->version[i] = ShardAt(_doors, i, &sem, &device)->version;
+    }
+    _snap->written = 1;
+    return restored;
+}
+
+/**
+ * \fn int SnapshotSave(Snapshot_t* _snap, const Doors_t* _doors)
+ * \brief Escribe una copia de todas las claves si alguna cambió desde la anterior.
+ * \details Se escribe a un archivo temporal y se renombra: una copia a medio escribir nunca reemplaza a la anterior.
+ * \param [in] _snap: Estado.
+ * \param [in] _doors: Puertas.
+ * \return 1 si se escribió. 0 si no hubo cambios o está deshabilitado. -1 si error.
+*/
+int SnapshotSave(Snapshot_t* _snap, const Doors_t* _doors)
+{
+    char tmp_path[CONFIG_VALUE_LEN + 8];
+    uint32_t version[SNAPSHOT_SHARDS];
+    SnapshotHeader_t header;
+    size_t total = 0;
+    int shards = _doors->count + 1;
+    int changed = !_snap->written;
+
+    if (_snap->path[0] == '\0'){
+        return 0;
+    }
+    // Mirar la versión sin semáforo alcanza para decidir: un cambio que se cruce entra en la próxima copia.
+    for (int i = 0; i < shards && !changed; i++){
+        int sem;
+        const char* device;
+        changed = (ShardAt(_doors, i, &sem, &device)->version != _snap->version[i]);
+    }
+    if (!changed){
+        return 0;
+    }
+
+    // Copia en memoria: el semáforo de cada conjunto se toma solo lo que dura el memcpy.
+    for (int i = 0; i < shards; i++){
+        int sem;
+        const char* device;
+        KeyShard_t* shard = ShardAt(_doors, i, &sem, &device);
+        SnapshotShard_t* entry = &_snap->table[i];
+        SnapshotKey_t* list = _snap->keys + total;
+
+        memset(entry, 0, sizeof(SnapshotShard_t));
+        strncpy(entry->device, device, DOOR_DEVICE_LEN);
+        if (lockSem(sem) == -1){
+            return -1;
+        }
+        uint32_t count = 0;
+        while (count < MAX_VALID_KEYS && shard->keys[count].code != KEY_EMPTY){
+            list[count].rule = shard->rules[count];
+            list[count].code = shard->keys[count].code;
+            memset(list[count].reserved, 0, sizeof(list[count].reserved));
+            count++;
+        }
+        version[i] = shard->version;
+        unlockSem(sem);
+        entry->count = count;
+        total += count;
+    }
+
+    // Escritura sin semáforos tomados.
+    memset(&header, 0, sizeof(header));
+    header.magic = SNAPSHOT_MAGIC;
+    header.version = SNAPSHOT_VERSION;
+    header.created_ns = TimeNowNs();
+    header.shards = (uint32_t)shards;
+    header.checksum = Checksum(2166136261u, _snap->table, sizeof(SnapshotShard_t) * shards);
+    header.checksum = Checksum(header.checksum, _snap->keys, sizeof(SnapshotKey_t) * total);
+
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", _snap->path);
+    int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0){
+        return -1;
+    }
+    struct iovec parts[3] = {
+        { &header, sizeof(header) },
+        { _snap->table, sizeof(SnapshotShard_t) * shards },
+        { _snap->keys, sizeof(SnapshotKey_t) * total },
+    };
+    size_t size = parts[0].iov_len + parts[1].iov_len + parts[2].iov_len;
+    ssize_t sent = writev(fd, parts, 3);
+    if (sent != (ssize_t)size || fsync(fd) < 0){    // Un archivo regular escribe todo o falla
+        close(fd);
+        unlink(tmp_path);
+        return -1;
+    }
+    close(fd);
+    if (rename(tmp_path, _snap->path) < 0){
+        unlink(tmp_path);
+        return -1;
+    }
+
+    memcpy(_snap->version, version, sizeof(uint32_t) * shards);
+    _snap->written = 1;
+    return 1;
+}
+
+/***********************************************************************************************************************************
+ *** FUNCIONES PRIVADAS AL MODULO
+ **********************************************************************************************************************************/
+/**
+ * \fn static KeyShard_t* ShardAt(const Doors_t* _doors, int _index, int* _semId, const char** _device)
+ * \brief Conjunto de claves por posición en el archivo: 0 las globales, i+1 la puerta i.
+ * \param [in] _doors: Puertas.
+ * \param [in] _index: Posición.
+ * \param [out] _semId: Semáforo del conjunto.
+ * \param [out] _device: Dispositivo de la puerta ("" para las globales).
+ * \return El conjunto de claves.
+*/
+static KeyShard_t* ShardAt(const Doors_t* _doors, int _index, int* _semId, const char** _device)
+{
+    if (_index == 0){
+        *_device = "";
+        return DoorKeys(_doors, DOOR_GLOBAL, _semId);
+    }
+    *_device = _doors->door[_index - 1].device;
+    return DoorKeys(_doors, _index - 1, _semId);
+}
+
+/**
+ * \fn static uint32_t Checksum(uint32_t _hash, const void* _data, size_t _len)
+ * \brief FNV-1a de 32 bits, encadenable.
+ * \param [in] _hash: Valor anterior (2166136261 para empezar).
+ * \param [in] _data: Datos.
+ * \param [in] _len: Largo.
+ * \return El hash.
+*/
+static uint32_t Checksum(uint32_t _hash, const void* _data, size_t _len)
+{
+    const unsigned char* aux = (const unsigned char*)_data;
+    for (size_t i = 0; i < _len; i++){
+        _hash ^= aux[i];
+        _hash *= 16777619u;
+    }
+    return _hash;
+}
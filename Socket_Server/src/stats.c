@@ -0,0 +1,362 @@
+/*******************************************************************************************************************************//**
+ *
+ * @file		stats.c
+ * @brief		Estadísticas de accesos por hora, por día y por clave, llevadas al agregar cada entrada del log.
+ * @date		19 oct. 2026
+ * @author		Martinez Agustin
+ *
+ **********************************************************************************************************************************/
+
+ /***********************************************************************************************************************************
+ *** INCLUDES
+ **********************************************************************************************************************************/
+#include "../inc/stats.h"
+
+/***********************************************************************************************************************************
+ *** DEFINES PRIVADOS AL MODULO
+ **********************************************************************************************************************************/
+#define HOUR_S      3600        /**< Segundos de una hora */
+#define DAY_S       86400       /**< Segundos de un día */
+
+/***********************************************************************************************************************************
+ *** VARIABLES GLOBALES PRIVADAS AL MODULO
+ **********************************************************************************************************************************/
+static StatsTable_t* stats = NULL;      /**< En la memoria compartida. NULL: sin estadísticas */
+static int default_hours = 24;          /**< STATS_HOURS */
+static int default_days = 7;            /**< STATS_DAYS */
+
+/***********************************************************************************************************************************
+ *** PROTOTIPOS DE FUNCIONES PRIVADAS AL MODULO
+ **********************************************************************************************************************************/
+static int64_t LocalUnit(int64_t _ns, int _unit_s);
+static int64_t UnitStart(int64_t _unit, int _unit_s);
+static void Lock(void);
+static void Unlock(void);
+static void SumDoors(const StatsCount_t* _doors, int _door, StatsCount_t* _out);
+static void CopyHours(const StatsTable_t* _table, int _door, int _hours, StatsBucket_t* _out);
+static void CopyDays(const StatsTable_t* _table, int _door, int _days, StatsBucket_t* _out);
+
+/***********************************************************************************************************************************
+ *** IMPLEMENTACION DE LOS METODODS DE LA CLASE
+ **********************************************************************************************************************************/
+/**
+ * \fn void StatsSetup(StatsTable_t* _table, int _hours, int _days)
+ * \brief Fija las ventanas por defecto y la tabla. Se llama una vez antes de lanzar los lectores.
+ * \param [in] _table: Tabla en la memoria compartida (ShmLayout_t). NULL: sin estadísticas (/stats responde 503).
+ * \param [in] _hours: Horas que devuelve /stats si no se piden otras (STATS_HOURS).
+ * \param [in] _days: Días que devuelve /stats si no se piden otros (STATS_DAYS).
+*/
+void StatsSetup(StatsTable_t* _table, int _hours, int _days)
+{
+    default_hours = _hours;
+    default_days = _days;
+    stats = _table;
+}
+
+/**
+ * \fn void StatsAdd(int _door, const ActivityEntry_t* _entry)
+ * \brief Cuenta una entrada del log en su hora, su día y su clave.
+ * \details Una entrada más vieja que lo que recuerdan los anillos no se cuenta.
+ * \param [in] _door: Puerta.
+ * \param [in] _entry: Entrada.
+*/
+void StatsAdd(int _door, const ActivityEntry_t* _entry)
+{
+    if (stats == NULL || _door < 0 || _door >= MAX_DOORS){
+        return;
+    }
+    int64_t hour = LocalUnit(_entry->time_ns, HOUR_S);
+    int64_t day = LocalUnit(_entry->time_ns, DAY_S);
+    int hs = (int)(hour % STATS_HOURS_MAX);
+    int ds = (int)(day % STATS_DAYS_MAX);
+    int accepted = (_entry->flags & LOG_STATUS_OK) != 0;
+
+    Lock();
+    SeqWriteBegin(&stats->seq);
+    if (stats->hour_stamp[hs] < hour){      // Hora nueva: se reusa la posición de hace STATS_HOURS_MAX horas
+        memset(stats->hour[hs], 0, sizeof(stats->hour[hs]));
+        stats->hour_stamp[hs] = hour;
+    }
+    if (stats->hour_stamp[hs] == hour){
+        if (accepted){
+            stats->hour[hs][_door].accepted++;
+        }
+        else{
+            stats->hour[hs][_door].denied++;
+        }
+    }
+    if (stats->day_stamp[ds] < day){
+        memset(stats->day[ds], 0, sizeof(stats->day[ds]));
+        memset(stats->key_used[ds], 0, sizeof(stats->key_used[ds]));
+        memset(stats->key[ds], 0, sizeof(stats->key[ds]));
+        stats->day_stamp[ds] = day;
+    }
+    if (stats->day_stamp[ds] == day){
+        if (accepted){
+            stats->day[ds][_door].accepted++;
+        }
+        else{
+            stats->day[ds][_door].denied++;
+        }
+        if (_entry->code < KEY_SPACE){
+            uint16_t* count = &stats->key[ds][_entry->code][accepted ? 0 : 1];
+            if (*count < UINT16_MAX){
+                (*count)++;
+            }
+            stats->key_used[ds][_entry->code / 64] |= 1ULL << (_entry->code % 64);
+        }
+    }
+    SeqWriteEnd(&stats->seq);
+    Unlock();
+}
+
+/**
+ * \fn int StatsWindow(int* _hours, int* _days)
+ * \brief Completa las ventanas no indicadas con las de config.ini y valida las indicadas.
+ * \param [in] _hours: Horas (0: STATS_HOURS). Queda el valor a usar.
+ * \param [in] _days: Días (0: STATS_DAYS). Queda el valor a usar.
+ * \return Devuelve -1 si alguna está fuera de rango. -2 si no hay estadísticas. 0 sino.
+*/
+int StatsWindow(int* _hours, int* _days)
+{
+    if (*_hours == 0){
+        *_hours = default_hours;
+    }
+    if (*_days == 0){
+        *_days = default_days;
+    }
+    if (*_hours < 1 || *_hours > STATS_HOURS_MAX || *_days < 1 || *_days > STATS_DAYS_MAX){
+        return -1;
+    }
+    if (stats == NULL){
+        return -2;
+    }
+    return 0;
+}
+
+/**
+ * \fn int StatsHours(int _door, int _hours, StatsBucket_t* _out)
+ * \brief Intentos de las últimas _hours horas, de la más vieja a la actual (las horas sin intentos van en 0).
+ * \param [in] _door: Puerta o DOOR_GLOBAL (suma de todas).
+ * \param [in] _hours: Ventana (validada con StatsWindow()).
+ * \param [out] _out: _hours posiciones.
+ * \return Cantidad de horas.
+*/
+int StatsHours(int _door, int _hours, StatsBucket_t* _out)
+{
+    Lock();
+    CopyHours(stats, _door, _hours, _out);
+    Unlock();
+    return _hours;
+}
+
+/**
+ * \fn int StatsDays(int _door, int _days, StatsBucket_t* _out)
+ * \brief Intentos de los últimos _days días, del más viejo a hoy.
+ * \param [in] _door: Puerta o DOOR_GLOBAL (suma de todas).
+ * \param [in] _days: Ventana (validada con StatsWindow()).
+ * \param [out] _out: _days posiciones.
+ * \return Cantidad de días.
+*/
+int StatsDays(int _door, int _days, StatsBucket_t* _out)
+{
+    Lock();
+    CopyDays(stats, _door, _days, _out);
+    Unlock();
+    return _days;
+}
+
+/**
+ * \fn int StatsRead(const StatsTable_t* _table, int _door, int _hours, int _days, StatsBucket_t* _hours_out, StatsBucket_t* _days_out)
+ * \brief Lo mismo que StatsHours() y StatsDays() pero sin tomar el lock, para leer la tabla de otro proceso.
+ * \details Copia entre dos lecturas de seq y reintenta si cambió o si había un cambio a medias.
+ * \param [in] _table: Tabla (puede estar enganchada en solo lectura).
+ * \param [in] _door: Puerta o DOOR_GLOBAL (suma de todas).
+ * \param [in] _hours: Horas (1..STATS_HOURS_MAX).
+ * \param [in] _days: Días (1..STATS_DAYS_MAX).
+ * \param [out] _hours_out: _hours posiciones, de la más vieja a la actual.
+ * \param [out] _days_out: _days posiciones, del más viejo a hoy.
+ * \return Devuelve -1 si no se consiguió una copia entera en SEQ_RETRIES intentos. 0 sino.
+*/
+int StatsRead(const StatsTable_t* _table, int _door, int _hours, int _days, StatsBucket_t* _hours_out, StatsBucket_t* _days_out)
+{
+    for (int retry = 0; retry < SEQ_RETRIES; retry++){
+        uint32_t start = __atomic_load_n(&_table->seq, __ATOMIC_ACQUIRE);
+        if (start & 1){
+            sched_yield();
+            continue;
+        }
+        CopyHours(_table, _door, _hours, _hours_out);
+        CopyDays(_table, _door, _days, _days_out);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&_table->seq, __ATOMIC_RELAXED) == start){
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/**
+ * \fn int StatsKeys(StatsCursor_t* _cursor, StatsKey_t* _out, int _max)
+ * \brief Intentos por clave en los últimos _cursor->days días, de a tandas y solo las claves usadas.
+ * \param [in] _cursor: Recorrido (word en 0 para empezar). Se actualiza para la próxima tanda.
+ * \param [out] _out: Claves.
+ * \param [in] _max: Tamaño de _out (al menos 64).
+ * \return Cantidad de claves copiadas. 0 si terminó.
+*/
+int StatsKeys(StatsCursor_t* _cursor, StatsKey_t* _out, int _max)
+{
+    int64_t today = LocalUnit(TimeNowNs(), DAY_S);
+    int slots[STATS_DAYS_MAX];
+    int nslots = 0;
+    int count = 0;
+
+    Lock();
+    for (int i = 0; i < _cursor->days; i++){
+        int64_t day = today - i;
+        int ds = (int)(day % STATS_DAYS_MAX);
+        if (stats->day_stamp[ds] == day){
+            slots[nslots++] = ds;
+        }
+    }
+    // De a una palabra del mapa: solo se suman las claves que tuvieron algún intento en la ventana.
+    while (_cursor->word < STATS_KEY_WORDS && count + 64 <= _max){
+        uint64_t used = 0;
+        for (int s = 0; s < nslots; s++){
+            used |= stats->key_used[slots[s]][_cursor->word];
+        }
+        while (used != 0){
+            int code = _cursor->word * 64 + __builtin_ctzll(used);
+            used &= used - 1;
+            _out[count].code = (uint16_t)code;
+            _out[count].count.accepted = 0;
+            _out[count].count.denied = 0;
+            for (int s = 0; s < nslots; s++){
+                _out[count].count.accepted += stats->key[slots[s]][code][0];
+                _out[count].count.denied += stats->key[slots[s]][code][1];
+            }
+            count++;
+        }
+        _cursor->word++;
+    }
+    Unlock();
+    return count;
+}
+
+/***********************************************************************************************************************************
+ *** FUNCIONES PRIVADAS AL MODULO
+ **********************************************************************************************************************************/
+/**
+ * \fn static int64_t LocalUnit(int64_t _ns, int _unit_s)
+ * \brief Número de hora o de día, en hora local, de un instante.
+ * \param [in] _ns: Instante en ns desde epoch.
+ * \param [in] _unit_s: HOUR_S o DAY_S.
+ * \return Horas o días desde epoch, contados en hora local.
+*/
+static int64_t LocalUnit(int64_t _ns, int _unit_s)
+{
+    time_t seconds = (time_t)(_ns / 1000000000LL);
+    struct tm local;
+
+    localtime_r(&seconds, &local);
+    return ((int64_t)seconds + local.tm_gmtoff) / _unit_s;
+}
+
+/**
+ * \fn static int64_t UnitStart(int64_t _unit, int _unit_s)
+ * \brief Instante en que empieza una hora o un día de LocalUnit().
+ * \param [in] _unit: Hora o día.
+ * \param [in] _unit_s: HOUR_S o DAY_S.
+ * \return Instante en ns desde epoch.
+*/
+static int64_t UnitStart(int64_t _unit, int _unit_s)
+{
+    time_t seconds = (time_t)(_unit * _unit_s);
+    struct tm local;
+
+    localtime_r(&seconds, &local);
+    return ((int64_t)seconds - local.tm_gmtoff) * 1000000000LL;
+}
+
+/**
+ * \fn static void Lock(void)
+ * \brief Toma el spinlock de la página.
+*/
+static void Lock(void)
+{
+    while (__atomic_test_and_set(&stats->lock, __ATOMIC_ACQUIRE)){
+        sched_yield();
+    }
+}
+
+/**
+ * \fn static void Unlock(void)
+ * \brief Suelta el spinlock de la página.
+*/
+static void Unlock(void)
+{
+    __atomic_clear(&stats->lock, __ATOMIC_RELEASE);
+}
+
+/**
+ * \fn static void SumDoors(const StatsCount_t* _doors, int _door, StatsCount_t* _out)
+ * \brief Suma los intentos de una puerta, o de todas.
+ * \param [in] _doors: MAX_DOORS contadores.
+ * \param [in] _door: Puerta o DOOR_GLOBAL.
+ * \param [out] _out: Suma.
+*/
+static void SumDoors(const StatsCount_t* _doors, int _door, StatsCount_t* _out)
+{
+    for (int d = 0; d < MAX_DOORS; d++){
+        if (_door == DOOR_GLOBAL || _door == d){
+            _out->accepted += _doors[d].accepted;
+            _out->denied += _doors[d].denied;
+        }
+    }
+}
+
+/**
+ * \fn static void CopyHours(const StatsTable_t* _table, int _door, int _hours, StatsBucket_t* _out)
+ * \brief Copia las últimas _hours horas del anillo (las que no están van en 0).
+ * \param [in] _table: Tabla.
+ * \param [in] _door: Puerta o DOOR_GLOBAL.
+ * \param [in] _hours: Ventana.
+ * \param [out] _out: _hours posiciones.
+*/
+static void CopyHours(const StatsTable_t* _table, int _door, int _hours, StatsBucket_t* _out)
+{
+    int64_t now = LocalUnit(TimeNowNs(), HOUR_S);
+
+    for (int i = 0; i < _hours; i++){
+        int64_t hour = now - _hours + 1 + i;
+        int hs = (int)(hour % STATS_HOURS_MAX);
+        _out[i].start_ns = UnitStart(hour, HOUR_S);
+        memset(&_out[i].count, 0, sizeof(_out[i].count));
+        if (_table->hour_stamp[hs] == hour){
+            SumDoors(_table->hour[hs], _door, &_out[i].count);
+        }
+    }
+}
+
+/**
+ * \fn static void CopyDays(const StatsTable_t* _table, int _door, int _days, StatsBucket_t* _out)
+ * \brief Copia los últimos _days días del anillo (los que no están van en 0).
+ * \param [in] _table: Tabla.
+ * \param [in] _door: Puerta o DOOR_GLOBAL.
+ * \param [in] _days: Ventana.
+ * \param [out] _out: _days posiciones.
+*/
+static void CopyDays(const StatsTable_t* _table, int _door, int _days, StatsBucket_t* _out)
+{
+    int64_t today = LocalUnit(TimeNowNs(), DAY_S);
+
+    for (int i = 0; i < _days; i++){
+        int64_t day = today - _days + 1 + i;
+        int ds = (int)(day % STATS_DAYS_MAX);
+        _out[i].start_ns = UnitStart(day, DAY_S);
+        memset(&_out[i].count, 0, sizeof(_out[i].count));
+        if (_table->day_stamp[ds] == day){
+            SumDoors(_table->day[ds], _door, &_out[i].count);
+        }
+    }
+}
@@ -0,0 +1,68 @@
+/*******************************************************************************************************************************//**
+ *
+ * @file		timefmt.c
+ * @brief		Reloj y formateo de fecha/hora con caché, compartido por el log y las respuestas JSON.
+ * @date		19 oct. 2026
+ * @author		Martinez Agustin
+ *
+ **********************************************************************************************************************************/
+
+ /***********************************************************************************************************************************
+ *** INCLUDES
+ **********************************************************************************************************************************/
+#include "../inc/timefmt.h"
+
+/***********************************************************************************************************************************
+ *** VARIABLES GLOBALES PRIVADAS AL MODULO
+ **********************************************************************************************************************************/
+/**
+ * \var cache
+ * \brief Caché de fecha y hora del hilo. Los hijos de fork() la heredan ya cargada.
+ */
+static __thread TimeCache_t cache = { -1, -1, "", "" };
+
+/***********************************************************************************************************************************
+ *** IMPLEMENTACION DE LOS METODODS DE LA CLASE
+ **********************************************************************************************************************************/
+/**
+ * \fn int64_t TimeNowNs(void)
+ * \brief Instante actual en ns desde epoch.
+ * \details clock_gettime(CLOCK_REALTIME) se resuelve en el vDSO, sin syscall.
+ * \return Nanosegundos desde epoch.
+*/
+int64_t TimeNowNs(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return (int64_t)now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+/**
+ * \fn const TimeCache_t* TimeFormat(int64_t _time_ns)
+ * \brief Formatea un instante en hora local con la caché del hilo.
+ * \param [in] _time_ns: Instante en ns desde epoch.
+ * \return Caché con date y hour correspondientes a _time_ns. Vale hasta el próximo TimeFormat() del mismo hilo.
+*/
+const TimeCache_t* TimeFormat(int64_t _time_ns)
+{
+    time_t t = (time_t)(_time_ns / 1000000000LL);
+
+    if (t == cache.second){     // Mismo segundo: ya está formateado
+        return &cache;
+    }
+    // Los cambios de hora (DST) caen en minutos enteros: dentro de un minuto la fecha y HH:MM no cambian.
+    if (cache.second < 0 || t < cache.minute_start || t >= cache.minute_start + 60){
+        struct tm tm_info;
+        localtime_r(&t, &tm_info);
+        strftime(cache.date, sizeof(cache.date), "%Y/%m/%d", &tm_info);
+        strftime(cache.hour, sizeof(cache.hour), "%H:%M:%S", &tm_info);
+        cache.minute_start = t - tm_info.tm_sec;
+        cache.second = t;
+        return &cache;
+    }
+    int sec = (int)(t - cache.minute_start);
+    cache.hour[6] = '0' + sec / 10;
+    cache.hour[7] = '0' + sec % 10;
+    cache.second = t;
+    return &cache;
+}
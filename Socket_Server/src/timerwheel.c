@@ -0,0 +1,194 @@
+/*******************************************************************************************************************************//**
+ *
+ * @file		timerwheel.c
+ * @brief		Rueda de timers jerárquica para vencimientos de claves (resolución de 1 segundo).
+ * @date		19 oct. 2026
+ * @author		Martinez Agustin
+ *
+ **********************************************************************************************************************************/
+
+ /***********************************************************************************************************************************
+ *** INCLUDES
+ **********************************************************************************************************************************/
+#include "../inc/timerwheel.h"
+
+/***********************************************************************************************************************************
+ *** PROTOTIPOS DE FUNCIONES PRIVADAS AL MODULO
+ **********************************************************************************************************************************/
+static void Place(TimerWheel_t* _wheel, int _timer);
+static void Cascade(TimerWheel_t* _wheel, int _level, int _slot);
+
+/***********************************************************************************************************************************
+ *** IMPLEMENTACION DE LOS METODODS DE LA CLASE
+ **********************************************************************************************************************************/
+/**
+ * \fn int WheelInit(TimerWheel_t* _wheel, int _capacity, int64_t _now)
+ * \brief Inicializa una rueda vacía.
+ * \param [out] _wheel: Rueda.
+ * \param [in] _capacity: Cantidad máxima de timers simultáneos.
+ * \param [in] _now: Segundo epoch actual.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+int WheelInit(TimerWheel_t* _wheel, int _capacity, int64_t _now)
+{
+    _wheel->pool = (WheelTimer_t*)malloc(sizeof(WheelTimer_t) * _capacity);
+    if (!_wheel->pool){
+        return -1;
+    }
+    _wheel->now = _now;
+    _wheel->capacity = _capacity;
+    _wheel->count = 0;
+    for (int l = 0; l < WHEEL_LEVELS; l++){
+        for (int s = 0; s < WHEEL_SLOTS; s++){
+            _wheel->slots[l][s] = -1;
+        }
+    }
+    for (int i = 0; i < _capacity; i++){
+        _wheel->pool[i].next = (i + 1 < _capacity) ? i + 1 : -1;
+    }
+    _wheel->free_head = (_capacity > 0) ? 0 : -1;
+    return 0;
+}
+
+/**
+ * \fn void WheelFree(TimerWheel_t* _wheel)
+ * \brief Libera la rueda.
+ * \param [in] _wheel: Rueda.
+*/
+void WheelFree(TimerWheel_t* _wheel)
+{
+    free(_wheel->pool);
+    _wheel->pool = NULL;
+    _wheel->capacity = 0;
+    _wheel->count = 0;
+    _wheel->free_head = -1;
+}
+
+/**
+ * \fn int WheelAdd(TimerWheel_t* _wheel, int64_t _expire, uint16_t _code, uint16_t _tag)
+ * \brief Programa un vencimiento.
+ * \details Un vencimiento ya pasado se dispara en el próximo WheelAdvance().
+ * \param [in] _wheel: Rueda.
+ * \param [in] _expire: Segundo epoch en que vence.
+ * \param [in] _code: Clave.
+ * \param [in] _tag: Dato libre.
+ * \return Devuelve -1 si no hay lugar. 0 sino.
+*/
+int WheelAdd(TimerWheel_t* _wheel, int64_t _expire, uint16_t _code, uint16_t _tag)
+{
+    int timer = _wheel->free_head;
+    if (timer < 0){
+        return -1;
+    }
+    _wheel->free_head = _wheel->pool[timer].next;
+
+    if (_expire <= _wheel->now){
+        _expire = _wheel->now + 1;
+    }
+    _wheel->pool[timer].expire = _expire;
+    _wheel->pool[timer].code = _code;
+    _wheel->pool[timer].tag = _tag;
+    Place(_wheel, timer);
+    _wheel->count++;
+    return 0;
+}
+
+/**
+ * \fn int WheelAdvance(TimerWheel_t* _wheel, int64_t _now, WheelFire_t _fire, void* _ctx)
+ * \brief Avanza hasta _now disparando los timers vencidos.
+ * \param [in] _wheel: Rueda.
+ * \param [in] _now: Segundo epoch actual.
+ * \param [in] _fire: Función a llamar por cada timer vencido.
+ * \param [in] _ctx: Dato para _fire.
+ * \return Cantidad de timers disparados.
+*/
+int WheelAdvance(TimerWheel_t* _wheel, int64_t _now, WheelFire_t _fire, void* _ctx)
+{
+    int fired = 0;
+
+    if (_wheel->count == 0){    // Nada programado: salto directo
+        if (_now > _wheel->now){
+            _wheel->now = _now;
+        }
+        return 0;
+    }
+    while (_wheel->now < _now){
+        int64_t t = ++_wheel->now;
+
+        // Cuando un nivel da la vuelta, la posición que toca del nivel siguiente baja a los inferiores.
+        for (int l = 1; l < WHEEL_LEVELS; l++){
+            if (((t >> (WHEEL_BITS * (l - 1))) & WHEEL_MASK) != 0){
+                break;
+            }
+            Cascade(_wheel, l, (int)((t >> (WHEEL_BITS * l)) & WHEEL_MASK));
+        }
+
+        int* slot = &_wheel->slots[0][t & WHEEL_MASK];
+        int timer = *slot;
+        *slot = -1;
+        while (timer >= 0){
+            WheelTimer_t* aux = &_wheel->pool[timer];
+            int next = aux->next;
+            if (aux->expire > t){   // Más lejos que el horizonte de la rueda: se reubica
+                Place(_wheel, timer);
+            }
+            else{
+                _fire(_ctx, aux->code, aux->tag);
+                aux->next = _wheel->free_head;
+                _wheel->free_head = timer;
+                _wheel->count--;
+                fired++;
+            }
+            timer = next;
+        }
+        if (_wheel->count == 0){
+            _wheel->now = _now;
+        }
+    }
+    return fired;
+}
+
+/***********************************************************************************************************************************
+ *** FUNCIONES PRIVADAS AL MODULO
+ **********************************************************************************************************************************/
+/**
+ * \fn static void Place(TimerWheel_t* _wheel, int _timer)
+ * \brief Pone un timer en el nivel que corresponde a cuánto falta.
+ * \param [in] _wheel: Rueda.
+ * \param [in] _timer: Índice del timer en el pool.
+*/
+static void Place(TimerWheel_t* _wheel, int _timer)
+{
+    WheelTimer_t* aux = &_wheel->pool[_timer];
+    int64_t delta = aux->expire - _wheel->now;
+    int level = 0;
+
+    while (level < WHEEL_LEVELS - 1 && delta >= ((int64_t)1 << (WHEEL_BITS * (level + 1)))){
+        level++;
+    }
+    int64_t expire = aux->expire;
+    if (delta >= ((int64_t)1 << (WHEEL_BITS * WHEEL_LEVELS))){  // Fuera del horizonte: al final del último nivel
+        expire = _wheel->now + ((int64_t)1 << (WHEEL_BITS * WHEEL_LEVELS)) - 1;
+    }
+    int slot = (int)((expire >> (WHEEL_BITS * level)) & WHEEL_MASK);
+    aux->next = _wheel->slots[level][slot];
+    _wheel->slots[level][slot] = _timer;
+}
+
+/**
+ * \fn static void Cascade(TimerWheel_t* _wheel, int _level, int _slot)
+ * \brief Reubica los timers de una posición en los niveles inferiores.
+ * \param [in] _wheel: Rueda.
+ * \param [in] _level: Nivel.
+ * \param [in] _slot: Posición.
+*/
+static void Cascade(TimerWheel_t* _wheel, int _level, int _slot)
+{
+    int timer = _wheel->slots[_level][_slot];
+    _wheel->slots[_level][_slot] = -1;
+    while (timer >= 0){
+        int next = _wheel->pool[timer].next;
+        Place(_wheel, timer);
+        timer = next;
+    }
+}
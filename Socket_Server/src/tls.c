@@ -0,0 +1,357 @@
+/*******************************************************************************************************************************//**
+ *
+ * @file		tls.c
+ * @brief		HTTPS: handshake con OpenSSL en espacio de usuario y cifrado de los registros en el kernel (kTLS).
+ * @date		19 oct. 2026
+ * @author		Martinez Agustin
+ *
+ **********************************************************************************************************************************/
+
+ /***********************************************************************************************************************************
+ *** INCLUDES
+ **********************************************************************************************************************************/
+#include "../inc/tls.h"
+
+/***********************************************************************************************************************************
+ *** VARIABLES GLOBALES PRIVADAS AL MODULO
+ **********************************************************************************************************************************/
+static SSL_CTX* ctx = NULL;             /**< Contexto de TlsSetup(). NULL: sin HTTPS */
+static TlsStats_t* stats = NULL;        /**< Página compartida. NULL: sin estadísticas */
+
+static __thread SSL* current = NULL;    /**< Conexión TLS que atiende el hilo (o el hijo). NULL si no hay */
+static __thread int current_fd = -1;    /**< Socket de current */
+static __thread int kernel_tx = 0;      /**< El kernel cifra lo que se escribe en current_fd */
+static __thread int kernel_rx = 0;      /**< El kernel descifra lo que se lee de current_fd */
+
+/***********************************************************************************************************************************
+ *** PROTOTIPOS DE FUNCIONES PRIVADAS AL MODULO
+ **********************************************************************************************************************************/
+static ssize_t TlsResult(SSL* _tls, int _ok, size_t _len);
+static int KernelHasTls(void);
+static int Handshake(SSL* _tls, int _fd, int _timeout_ms, const struct timespec* _deadline);
+
+/***********************************************************************************************************************************
+ *** IMPLEMENTACION DE LOS METODODS DE LA CLASE
+ **********************************************************************************************************************************/
+/**
+ * \fn int TlsSetup(TlsStats_t* _stats, const char* _cert, const char* _key, int _tickets, int _session_ms)
+ * \brief Crea el contexto TLS con el certificado. Se llama una vez antes de aceptar clientes.
+ * \details Las claves de los tickets se generan acá: los hijos y los hilos las heredan y reanudan las sesiones de
+ * los demás. La caché de sesiones del servidor solo sirve entre hilos (WORKERS), porque cada hijo tiene la suya.
+ * \param [in] _stats: Estadísticas en la memoria compartida (ShmLayout_t). NULL: sin estadísticas.
+ * \param [in] _cert: Certificado PEM (TLS_CERT). Puede incluir la cadena.
+ * \param [in] _key: Clave privada PEM (TLS_KEY).
+ * \param [in] _tickets: Tickets por handshake (TLS_TICKETS). 0: tickets con estado, que solo reanudan entre hilos.
+ * \param [in] _session_ms: Duración de una sesión reanudable (TLS_SESSION_TIME).
+ * \return Devuelve -1 si error. 0 sino.
+*/
+int TlsSetup(TlsStats_t* _stats, const char* _cert, const char* _key, int _tickets, int _session_ms)
+{
+    if (_cert == NULL || _key == NULL){
+        printf("HTTPS sin TLS_CERT o TLS_KEY\n");
+        return -1;
+    }
+    ctx = SSL_CTX_new(TLS_server_method());
+    if (ctx == NULL){
+        return -1;
+    }
+    // kTLS solo arma registros AES-GCM y ChaCha20-Poly1305 (TLS 1.3 no ofrece otros) y no admite renegociar.
+    SSL_CTX_set_min_proto_version(ctx, TLS1_2_VERSION);
+    SSL_CTX_set_options(ctx, SSL_OP_ENABLE_KTLS | SSL_OP_NO_RENEGOTIATION | SSL_OP_IGNORE_UNEXPECTED_EOF);
+    if (SSL_CTX_set_cipher_list(ctx, "ECDHE+AESGCM:ECDHE+CHACHA20") != 1 ||
+        SSL_CTX_use_certificate_chain_file(ctx, _cert) != 1 ||
+        SSL_CTX_use_PrivateKey_file(ctx, _key, SSL_FILETYPE_PEM) != 1 ||
+        SSL_CTX_check_private_key(ctx) != 1){
+        printf("Certificado o clave inválidos (%s, %s): %s\n", _cert, _key, ERR_reason_error_string(ERR_get_error()));
+        SSL_CTX_free(ctx);
+        ctx = NULL;
+        return -1;
+    }
+
+    // Reanudación: un pedido nuevo del mismo navegador no repite el intercambio de claves ni la firma.
+    SSL_CTX_set_session_id_context(ctx, (const unsigned char*)TLS_SID_CTX, strlen(TLS_SID_CTX));
+    SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_SERVER);
+    SSL_CTX_set_timeout(ctx, _session_ms / 1000);
+    if (_tickets == 0){
+        SSL_CTX_set_options(ctx, SSL_OP_NO_TICKET);
+        SSL_CTX_set_num_tickets(ctx, 1);
+    }
+    else{
+        SSL_CTX_set_num_tickets(ctx, _tickets);
+    }
+
+    signal(SIGPIPE, SIG_IGN);   // OpenSSL escribe sin MSG_NOSIGNAL: un cliente que cierra no mata al hijo
+    if (!KernelHasTls()){
+        printf("El kernel no tiene el módulo tls cargado (modprobe tls): el cifrado se hace con OpenSSL\n");
+    }
+    stats = _stats;
+    return 0;
+}
+
+/**
+ * \fn SSL* TlsAccept(int _fd, int _timeout_ms, const struct timespec* _deadline)
+ * \brief Hace el handshake con el cliente y pasa el cifrado de los registros al kernel si se puede.
+ * \details Con kTLS en el envío el resto del servidor sigue escribiendo en el socket con send()/sendmsg(): el
+ * kernel arma los registros. Sin kTLS TlsSend() y TlsRecv() pasan por OpenSSL. La conexión queda como la del hilo
+ * (o del hijo) hasta TlsClose().
+ * El handshake se hace con el socket no bloqueante y poll(): termina antes de _deadline (el del pedido, REQUEST_TIMEOUT)
+ * aunque el cliente mande de a un byte, y corta si pasan _timeout_ms sin que avance.
+ * \param [in] _fd: Socket aceptado.
+ * \param [in] _timeout_ms: Timeout de cada lectura (READ_TIMEOUT).
+ * \param [in] _deadline: Instante límite del pedido (CLOCK_MONOTONIC), que incluye el handshake.
+ * \return La conexión TLS. NULL si no hay contexto o falló el handshake.
+*/
+SSL* TlsAccept(int _fd, int _timeout_ms, const struct timespec* _deadline)
+{
+    struct timeval tv;
+
+    if (ctx == NULL){
+        return NULL;
+    }
+    // Después del handshake el socket vuelve a ser bloqueante: SO_RCVTIMEO corta los registros a medias.
+    tv.tv_sec = _timeout_ms / 1000;
+    tv.tv_usec = (_timeout_ms % 1000) * 1000;
+    setsockopt(_fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    SSL* tls = SSL_new(ctx);
+    if (tls == NULL || SSL_set_fd(tls, _fd) != 1 || Handshake(tls, _fd, _timeout_ms, _deadline) < 0){
+        unsigned long err = ERR_get_error();
+        printf("Handshake TLS fallido: %s\n", err ? ERR_reason_error_string(err) :
+               (errno == ETIMEDOUT) ? "timeout" : "conexión cortada");
+        ERR_clear_error();
+        SSL_free(tls);
+        if (stats != NULL){
+            __atomic_fetch_add(&stats->failed, 1, __ATOMIC_RELAXED);
+        }
+        return NULL;
+    }
+
+    current = tls;
+    current_fd = _fd;
+    kernel_tx = BIO_get_ktls_send(SSL_get_wbio(tls));
+    kernel_rx = BIO_get_ktls_recv(SSL_get_rbio(tls));
+    if (stats != NULL){
+        __atomic_fetch_add(SSL_session_reused(tls) ? &stats->resumed : &stats->full, 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&stats->ktls_tx, (uint64_t)kernel_tx, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&stats->ktls_rx, (uint64_t)kernel_rx, __ATOMIC_RELAXED);
+    }
+    return tls;
+}
+
+/**
+ * \fn ssize_t TlsSend(int _fd, const void* _buff, size_t _len, int _flags)
+ * \brief send() que cifra con OpenSSL si _fd es la conexión TLS del hilo y el kernel no cifra.
+ * \param [in] _fd: Socket.
+ * \param [in] _buff: Datos.
+ * \param [in] _len: Cantidad de bytes.
+ * \param [in] _flags: Flags de send() (se ignoran al cifrar con OpenSSL).
+ * \return Bytes enviados. -1 si error (EAGAIN si se venció SO_SNDTIMEO).
+*/
+ssize_t TlsSend(int _fd, const void* _buff, size_t _len, int _flags)
+{
+    size_t written = 0;
+
+    if (!TlsUserspace(_fd)){
+        return send(_fd, _buff, _len, _flags);
+    }
+    errno = 0;
+    int ok = SSL_write_ex(current, _buff, _len, &written);
+    return TlsResult(current, ok, written);
+}
+
+/**
+ * \fn ssize_t TlsRecv(int _fd, void* _buff, size_t _len)
+ * \brief recv() que descifra con OpenSSL si _fd es la conexión TLS del hilo y el kernel no descifra.
+ * \param [in] _fd: Socket.
+ * \param [out] _buff: Destino.
+ * \param [in] _len: Tamaño de _buff.
+ * \return Bytes recibidos. 0 si el cliente cerró. -1 si error (EAGAIN si todavía no hay un registro completo).
+*/
+ssize_t TlsRecv(int _fd, void* _buff, size_t _len)
+{
+    size_t read = 0;
+
+    if (current == NULL || _fd != current_fd || kernel_rx){
+        return recv(_fd, _buff, _len, 0);
+    }
+    errno = 0;
+    int ok = SSL_read_ex(current, _buff, _len, &read);
+    return TlsResult(current, ok, read);
+}
+
+/**
+ * \fn int TlsPending(int _fd)
+ * \brief Indica si OpenSSL ya tiene datos descifrados de _fd (poll() no los ve).
+ * \param [in] _fd: Socket.
+ * \return Distinto de 0 si hay datos para TlsRecv().
+*/
+int TlsPending(int _fd)
+{
+    return current != NULL && _fd == current_fd && !kernel_rx && SSL_pending(current) > 0;
+}
+
+/**
+ * \fn int TlsUserspace(int _fd)
+ * \brief Indica si lo que se escribe en _fd tiene que pasar por TlsSend() (TLS sin kTLS en el envío).
+ * \param [in] _fd: Socket.
+ * \return Distinto de 0 si no se puede escribir directo en el socket.
+*/
+int TlsUserspace(int _fd)
+{
+    return current != NULL && _fd == current_fd && !kernel_tx;
+}
+
+/**
+ * \fn void TlsClose(SSL* _tls)
+ * \brief Envía close_notify y libera la conexión. No cierra el socket.
+ * \param [in] _tls: Conexión de TlsAccept(). NULL no hace nada.
+*/
+void TlsClose(SSL* _tls)
+{
+    if (_tls == NULL){
+        return;
+    }
+    SSL_shutdown(_tls);     // No espero el close_notify del cliente: el socket se cierra enseguida
+    ERR_clear_error();
+    SSL_free(_tls);
+    if (_tls == current){
+        current = NULL;
+        current_fd = -1;
+        kernel_tx = 0;
+        kernel_rx = 0;
+    }
+}
+
+/**
+ * \fn int TlsMetrics(char* _out, size_t _size)
+ * \brief Escribe las estadísticas de TLS en formato de texto de Prometheus.
+ * \param [out] _out: Buffer.
+ * \param [in] _size: Tamaño de _out.
+ * \return Bytes escritos. 0 si no hay HTTPS, -1 si no entra.
+*/
+int TlsMetrics(char* _out, size_t _size)
+{
+    if (stats == NULL || _size == 0){
+        return 0;
+    }
+    int len = snprintf(_out, _size,
+            "# TYPE alarm_tls_handshakes_total counter\n"
+            "alarm_tls_handshakes_total{tipo=\"completo\"} %llu\n"
+            "alarm_tls_handshakes_total{tipo=\"reanudado\"} %llu\n"
+            "alarm_tls_handshakes_total{tipo=\"fallido\"} %llu\n"
+            "# TYPE alarm_tls_ktls_connections_total counter\n"
+            "alarm_tls_ktls_connections_total{sentido=\"envio\"} %llu\n"
+            "alarm_tls_ktls_connections_total{sentido=\"recepcion\"} %llu\n",
+            (unsigned long long)__atomic_load_n(&stats->full, __ATOMIC_RELAXED),
+            (unsigned long long)__atomic_load_n(&stats->resumed, __ATOMIC_RELAXED),
+            (unsigned long long)__atomic_load_n(&stats->failed, __ATOMIC_RELAXED),
+            (unsigned long long)__atomic_load_n(&stats->ktls_tx, __ATOMIC_RELAXED),
+            (unsigned long long)__atomic_load_n(&stats->ktls_rx, __ATOMIC_RELAXED));
+    return (len < (int)_size) ? len : -1;
+}
+
+/***********************************************************************************************************************************
+ *** FUNCIONES PRIVADAS AL MODULO
+ **********************************************************************************************************************************/
+/**
+ * \fn static ssize_t TlsResult(SSL* _tls, int _ok, size_t _len)
+ * \brief Traduce el resultado de SSL_read_ex()/SSL_write_ex() al de recv()/send().
+ * \param [in] _tls: Conexión.
+ * \param [in] _ok: Lo que devolvió SSL_read_ex() o SSL_write_ex().
+ * \param [in] _len: Bytes leídos o escritos.
+ * \return _len si _ok. 0 si el cliente cerró. -1 con errno sino.
+*/
+static ssize_t TlsResult(SSL* _tls, int _ok, size_t _len)
+{
+    if (_ok == 1){
+        return (ssize_t)_len;
+    }
+    int err = SSL_get_error(_tls, 0);
+    ERR_clear_error();
+    switch (err){
+    case SSL_ERROR_ZERO_RETURN:     // close_notify
+        return 0;
+    case SSL_ERROR_WANT_READ:
+    case SSL_ERROR_WANT_WRITE:      // Timeout del socket o registro incompleto
+        errno = EAGAIN;
+        return -1;
+    case SSL_ERROR_SYSCALL:         // errno ya indica el error. 0: el cliente cerró sin close_notify
+        return (errno == 0) ? 0 : -1;
+    default:
+        errno = EPROTO;
+        return -1;
+    }
+}
+
+/**
+ * \fn static int KernelHasTls(void)
+ * \brief Indica si el ULP "tls" de TCP está cargado (sin él OpenSSL no puede pasar el cifrado al kernel).
+ * \return Distinto de 0 si está.
+*/
+static int KernelHasTls(void)
+{
+    char ulps[128] = "";
+
+    FILE* file = fopen(TLS_ULP_FILE, "r");
+    if (file == NULL){
+        return 0;
+    }
+    if (fgets(ulps, sizeof(ulps), file) == NULL){
+        ulps[0] = '\0';
+    }
+    fclose(file);
+    return strstr(ulps, "tls") != NULL;
+}
+
+/**
+ * \fn static int Handshake(SSL* _tls, int _fd, int _timeout_ms, const struct timespec* _deadline)
+ * \brief SSL_accept() con el socket no bloqueante, esperando con poll() lo que pida OpenSSL.
+ * \details Cada espera dura lo que falte para _deadline, y como mucho _timeout_ms. Al terminar el socket vuelve a
+ * ser bloqueante.
+ * \param [in] _tls: Conexión.
+ * \param [in] _fd: Socket.
+ * \param [in] _timeout_ms: Máximo sin que el handshake avance.
+ * \param [in] _deadline: Instante límite (CLOCK_MONOTONIC).
+ * \return Devuelve -1 si error (errno ETIMEDOUT si se venció el plazo). 0 sino.
+*/
+static int Handshake(SSL* _tls, int _fd, int _timeout_ms, const struct timespec* _deadline)
+{
+    int flags = fcntl(_fd, F_GETFL);
+    int ret = -1;
+
+    if (flags < 0 || fcntl(_fd, F_SETFL, flags | O_NONBLOCK) < 0){
+        return -1;
+    }
+    while (1){
+        errno = 0;
+        int ok = SSL_accept(_tls);
+        if (ok == 1){
+            ret = 0;
+            break;
+        }
+        int err = SSL_get_error(_tls, ok);
+        if (err != SSL_ERROR_WANT_READ && err != SSL_ERROR_WANT_WRITE){
+            break;
+        }
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        long remaining = (_deadline->tv_sec - now.tv_sec) * 1000L + (_deadline->tv_nsec - now.tv_nsec) / 1000000L;
+        if (remaining <= 0){
+            errno = ETIMEDOUT;
+            break;
+        }
+        struct pollfd pfd = { .fd = _fd, .events = (err == SSL_ERROR_WANT_READ) ? POLLIN : POLLOUT };
+        int n = poll(&pfd, 1, (remaining < _timeout_ms) ? (int)remaining : _timeout_ms);
+        if (n == 0){
+            errno = ETIMEDOUT;
+            break;
+        }
+        if (n < 0 && errno != EINTR){
+            break;
+        }
+    }
+    int saved = errno;
+    fcntl(_fd, F_SETFL, flags);
+    errno = saved;
+    return ret;
+}
@@ -0,0 +1,271 @@
+/*******************************************************************************************************************************//**
+ *
+ * @file		workers.c
+ * @brief		Pool de hilos que atiende clientes (alternativa al fork() por cliente).
+ * @date		19 oct. 2026
+ * @author		Martinez Agustin
+ *
+ **********************************************************************************************************************************/
+
+ /***********************************************************************************************************************************
+ *** INCLUDES
+ **********************************************************************************************************************************/
+#include "../inc/workers.h"
+#include "../inc/client.h"
+
+/***********************************************************************************************************************************
+ *** VARIABLES GLOBALES PRIVADAS AL MODULO
+ **********************************************************************************************************************************/
+static WorkerPool_t* active = NULL;     /**< Pool de este proceso, para /metrics. NULL si se atiende con fork() */
+
+/***********************************************************************************************************************************
+ *** PROTOTIPOS DE FUNCIONES PRIVADAS AL MODULO
+ **********************************************************************************************************************************/
+static void QueueInit(WorkQueue_t* _queue);
+static int QueuePush(WorkQueue_t* _queue, const WorkItem_t* _item);
+static void QueuePop(WorkQueue_t* _queue, WorkItem_t* _item);
+static void* WorkerMain(void* _arg);
+
+/***********************************************************************************************************************************
+ *** IMPLEMENTACION DE LOS METODODS DE LA CLASE
+ **********************************************************************************************************************************/
+/**
+ * \fn int WorkersStart(WorkerPool_t* _pool, int _count, const int* _cpus, int _cpus_count, Doors_t* _doors)
+ * \brief Lanza los hilos.
+ * \details Los hilos bloquean todas las señales: las sigue atendiendo el hilo principal. Si se indican CPUs, el
+ * hilo i queda fijo en _cpus[i % _cpus_count].
+ * \param [out] _pool: Pool.
+ * \param [in] _count: Cantidad de hilos (1 a MAX_WORKERS).
+ * \param [in] _cpus: CPUs (WORKER_CPUS). NULL para no fijar.
+ * \param [in] _cpus_count: Cantidad de CPUs.
+ * \param [in] _doors: Puertas.
+ * \return Devuelve -1 si error. 0 sino.
+*/
+int WorkersStart(WorkerPool_t* _pool, int _count, const int* _cpus, int _cpus_count, Doors_t* _doors)
+{
+    sigset_t all, old;
+
+    if (_count <= 0 || _count > MAX_WORKERS){
+        errno = EINVAL;
+        return -1;
+    }
+    memset(_pool, 0, sizeof(WorkerPool_t));
+    _pool->doors = _doors;
+    QueueInit(&_pool->queue);
+
+    // Los hilos nacen con la máscara del que los crea: los creo con todo bloqueado y la restauro después.
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, &old);
+    for (int i = 0; i < _count; i++){
+        int err = pthread_create(&_pool->threads[i], NULL, WorkerMain, _pool);
+        if (err != 0){
+            pthread_sigmask(SIG_SETMASK, &old, NULL);
+            WorkersStop(_pool);
+            errno = err;
+            return -1;
+        }
+        _pool->count++;
+        if (_cpus != NULL && _cpus_count > 0){
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(_cpus[i % _cpus_count], &set);
+            err = pthread_setaffinity_np(_pool->threads[i], sizeof(set), &set);
+            if (err != 0){  // CPU inexistente o no permitida: el hilo sigue, sin fijar
+                printf("No se pudo fijar el hilo %d a la CPU %d: %s\n", i, _cpus[i % _cpus_count], strerror(err));
+            }
+        }
+    }
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    active = _pool;
+    return 0;
+}
+
+/**
+ * \fn int WorkersSubmit(WorkerPool_t* _pool, int _fd, const ConnLimits_t* _limits)
+ * \brief Encola una conexión aceptada. El hilo que la atiende la cierra.
+ * \param [in] _pool: Pool.
+ * \param [in] _fd: Socket del cliente.
+ * \param [in] _limits: Límites de la conexión.
+ * \return Devuelve -1 si la cola está llena (el socket sigue siendo del que llama). 0 sino.
+*/
+int WorkersSubmit(WorkerPool_t* _pool, int _fd, const ConnLimits_t* _limits)
+{
+    WorkItem_t item;
+
+    item.fd = _fd;
+    item.limits = *_limits;
+    if (QueuePush(&_pool->queue, &item) < 0){
+        __atomic_fetch_add(&_pool->rejected, 1, __ATOMIC_RELAXED);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * \fn void WorkersStop(WorkerPool_t* _pool)
+ * \brief Espera a que se atiendan las conexiones encoladas y termina los hilos.
+ * \param [in] _pool: Pool.
+*/
+void WorkersStop(WorkerPool_t* _pool)
+{
+    WorkItem_t stop;
+
+    memset(&stop, 0, sizeof(stop));
+    stop.fd = -1;
+    // Un aviso por hilo detrás de lo encolado. Si la cola está llena espero a que se libere lugar.
+    for (int i = 0; i < _pool->count; i++){
+        while (QueuePush(&_pool->queue, &stop) < 0){
+            sched_yield();
+        }
+    }
+    for (int i = 0; i < _pool->count; i++){
+        pthread_join(_pool->threads[i], NULL);
+    }
+    sem_destroy(&_pool->queue.items);
+    _pool->count = 0;
+    if (active == _pool){
+        active = NULL;
+    }
+}
+
+/**
+ * \fn int WorkersMetrics(char* _out, size_t _size)
+ * \brief Escribe las estadísticas del pool de este proceso en formato de texto de Prometheus.
+ * \param [out] _out: Buffer.
+ * \param [in] _size: Tamaño de _out.
+ * \return Bytes escritos. 0 si se atiende con fork(), -1 si no entra.
+*/
+int WorkersMetrics(char* _out, size_t _size)
+{
+    int pending = 0;
+    int len;
+
+    if (active == NULL || _size == 0){
+        return 0;
+    }
+    sem_getvalue(&active->queue.items, &pending);
+    len = snprintf(_out, _size,
+                   "# TYPE alarm_workers gauge\nalarm_workers %d\n"
+                   "# TYPE alarm_workers_queue_depth gauge\nalarm_workers_queue_depth %d\n"
+                   "# TYPE alarm_workers_served_total counter\nalarm_workers_served_total %llu\n"
+                   "# TYPE alarm_workers_rejected_total counter\nalarm_workers_rejected_total %llu\n",
+                   active->count, (pending > 0) ? pending : 0,
+                   (unsigned long long)__atomic_load_n(&active->served, __ATOMIC_RELAXED),
+                   (unsigned long long)__atomic_load_n(&active->rejected, __ATOMIC_RELAXED));
+    return (len < (int)_size) ? len : -1;
+}
+
+/***********************************************************************************************************************************
+ *** FUNCIONES PRIVADAS AL MODULO
+ **********************************************************************************************************************************/
+/**
+ * \fn static void QueueInit(WorkQueue_t* _queue)
+ * \brief Deja la cola vacía: la celda i espera al que encole en la posición i.
+ * \param [out] _queue: Cola.
+*/
+static void QueueInit(WorkQueue_t* _queue)
+{
+    for (size_t i = 0; i < WORKER_QUEUE_LEN; i++){
+        _queue->cells[i].seq = i;
+    }
+    _queue->tail = 0;
+    _queue->head = 0;
+    sem_init(&_queue->items, 0, 0);
+}
+
+/**
+ * \fn static int QueuePush(WorkQueue_t* _queue, const WorkItem_t* _item)
+ * \brief Encola un elemento sin tomar locks.
+ * \param [in] _queue: Cola.
+ * \param [in] _item: Elemento.
+ * \return Devuelve -1 si la cola está llena. 0 sino.
+*/
+static int QueuePush(WorkQueue_t* _queue, const WorkItem_t* _item)
+{
+    size_t pos = __atomic_load_n(&_queue->tail, __ATOMIC_RELAXED);
+    WorkCell_t* cell;
+
+    for (;;){
+        cell = &_queue->cells[pos & (WORKER_QUEUE_LEN - 1)];
+        size_t seq = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+        if (diff == 0){     // Turno de encolar: reservo la posición
+            if (__atomic_compare_exchange_n(&_queue->tail, &pos, pos + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)){
+                break;
+            }
+        }
+        else if (diff < 0){ // La celda todavía tiene un elemento de la vuelta anterior
+            return -1;
+        }
+        else{               // Otro productor ganó la posición
+            pos = __atomic_load_n(&_queue->tail, __ATOMIC_RELAXED);
+        }
+    }
+    cell->item = *_item;
+    __atomic_store_n(&cell->seq, pos + 1, __ATOMIC_RELEASE);
+    sem_post(&_queue->items);
+    return 0;
+}
+
+/**
+ * \fn static void QueuePop(WorkQueue_t* _queue, WorkItem_t* _item)
+ * \brief Desencola un elemento. Duerme mientras la cola esté vacía.
+ * \param [in] _queue: Cola.
+ * \param [out] _item: Elemento.
+*/
+static void QueuePop(WorkQueue_t* _queue, WorkItem_t* _item)
+{
+    size_t pos;
+    WorkCell_t* cell;
+
+    // Cada sem_post() corresponde a una celda publicada: al pasar el sem_wait() hay un elemento para mí.
+    while (sem_wait(&_queue->items) < 0 && errno == EINTR){
+    }
+    pos = __atomic_load_n(&_queue->head, __ATOMIC_RELAXED);
+    for (;;){
+        cell = &_queue->cells[pos & (WORKER_QUEUE_LEN - 1)];
+        size_t seq = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+        intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+        if (diff == 0){
+            if (__atomic_compare_exchange_n(&_queue->head, &pos, pos + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)){
+                break;
+            }
+        }
+        else{
+            pos = __atomic_load_n(&_queue->head, __ATOMIC_RELAXED);
+        }
+    }
+    *_item = cell->item;
+    __atomic_store_n(&cell->seq, pos + WORKER_QUEUE_LEN, __ATOMIC_RELEASE);
+}
+
+/**
+ * \fn static void* WorkerMain(void* _arg)
+ * \brief Cuerpo de cada hilo: atiende conexiones hasta recibir fd -1.
+ * \details Usa la memoria compartida que el proceso ya tiene enganchada (no hay shmat()/shmdt() por cliente) y
+ * un pool de buffers propio.
+ * \param [in] _arg: WorkerPool_t.
+ * \return NULL.
+*/
+static void* WorkerMain(void* _arg)
+{
+    WorkerPool_t* pool = (WorkerPool_t*)_arg;
+    WorkItem_t item;
+
+    if (BufPoolThreadInit() < 0){   // Sin pool propio el hilo atiende con malloc()
+        printf("Hilo sin pool de buffers: se usa malloc()\n");
+    }
+    for (;;){
+        QueuePop(&pool->queue, &item);
+        if (item.fd < 0){
+            break;
+        }
+        if (client(item.fd, pool->doors, &item.limits) < 0){
+            perror("Error al trabajar al cliente. ##");
+        }
+        close(item.fd);
+        __atomic_fetch_add(&pool->served, 1, __ATOMIC_RELAXED);
+    }
+    BufPoolThreadFree();
+    return NULL;
+}
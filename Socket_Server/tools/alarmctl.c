@@ -0,0 +1,737 @@
+/*******************************************************************************************************************************//**
+ *
+ * @file		alarmctl.c
+ * @brief		Herramienta de diagnóstico: muestra claves, log, intentos y estado de bloqueo leyendo la memoria
+ * 				compartida del servidor en modo solo lectura, sin pasar por HTTP.
+ * @date		19 oct. 2026
+ * @author		Martinez Agustin
+ *
+ * Uso: make tools && ./bin/alarmctl [-p servidor] [-j] [-d puerta] [-n entradas] [claves|log|stats|bloqueo|todo]
+ * -p es el binario con que se arrancó el servidor (genera las claves IPC, bin/WebServer por defecto).
+ * No toma semáforos ni locks ni escribe en la memoria compartida: copia con KeyShardRead(), LogRead(), StatsRead()
+ * y LockoutSourcesRead(), que reintentan si justo hay un cambio a medias. El servidor no se entera de que alguien
+ * está leyendo.
+ *
+ **********************************************************************************************************************************/
+
+ /***********************************************************************************************************************************
+ *** INCLUDES
+ **********************************************************************************************************************************/
+#include <sys/ipc.h>            // ftok()
+#include <sys/shm.h>            // shmget(), shmat(), SHM_RDONLY
+#include <sys/sem.h>            // semget(), semctl()
+#include <arpa/inet.h>          // inet_ntop()
+#include <stdio.h>              // printf()
+#include <stdlib.h>             // strtol()
+#include <string.h>             // strcmp()
+#include <time.h>               // localtime_r(), strftime()
+#include <unistd.h>             // getopt()
+
+#include "../inc/shm.h"
+
+/***********************************************************************************************************************************
+ *** DEFINES PRIVADOS AL MODULO
+ **********************************************************************************************************************************/
+#define CTL_SERVER      "bin/WebServer" /**< Binario del servidor si no se indica otro */
+
+#define SHOW_KEYS       0x01            /**< Mostrar las claves */
+#define SHOW_LOG        0x02            /**< Mostrar el log */
+#define SHOW_STATS      0x04            /**< Mostrar /stats y las entradas del log por estado */
+#define SHOW_LOCKS      0x08            /**< Mostrar el estado de bloqueo */
+#define SHOW_ALL        0x0F            /**< Todo */
+
+#define CTL_HOURS       24              /**< Horas de /stats que se muestran (STATS_HOURS por defecto) */
+#define CTL_DAYS        7               /**< Días de /stats que se muestran (STATS_DAYS por defecto) */
+
+/***********************************************************************************************************************************
+ *** TIPO DE DATOS PRIVADOS AL MODULO
+ **********************************************************************************************************************************/
+/**
+ * \struct Ctl_t
+ * \brief Lo pedido por línea de comandos y la memoria compartida enganchada.
+ */
+typedef struct {
+    const ShmLayout_t* shm;             /**< Segmento (solo lectura) */
+    int sem_global;                     /**< Semáforo de las claves globales. -1 si no se encontró */
+    int json;                           /**< Salida en JSON */
+    int door;                           /**< Solo esta puerta. DOOR_GLOBAL: todas */
+    int tail;                           /**< Últimas entradas del log por puerta */
+    int show;                           /**< SHOW_* */
+} Ctl_t;
+
+/***********************************************************************************************************************************
+ *** PROTOTIPOS DE FUNCIONES PRIVADAS AL MODULO
+ **********************************************************************************************************************************/
+static const ShmLayout_t* Attach(const char* _path);
+static int ShowKeys(const Ctl_t* _ctl);
+static int ShowShard(const Ctl_t* _ctl, const KeyShard_t* _shard, int _door, int _comma);
+static int ShowLog(const Ctl_t* _ctl);
+static int ShowStats(const Ctl_t* _ctl);
+static int ShowLogCounts(const Ctl_t* _ctl);
+static int ShowLocks(const Ctl_t* _ctl);
+static int ShowSources(const Ctl_t* _ctl);
+static int RegionsValid(const ShmHeader_t* _header);
+static const char* LockoutWhen(int64_t _until_ns, int64_t _now_ns, char* _out, size_t _size);
+static void RuleText(const KeyRule_t* _rule, int _json, char* _out, size_t _size);
+static void LocalTime(int64_t _time_ns, const char* _format, char* _out, size_t _size);
+static int Selected(const Ctl_t* _ctl, int _door);
+
+/***********************************************************************************************************************************
+ *** VARIABLES GLOBALES PRIVADAS AL MODULO
+ **********************************************************************************************************************************/
+static KeyEntry_t keys[MAX_VALID_KEYS];             /**< Copia de una lista de claves */
+static KeyRule_t rules[MAX_VALID_KEYS];             /**< Copia de sus reglas */
+static LockoutSource_t sources[LOCKOUT_SOURCES];    /**< Copia de los orígenes web */
+static const char* const statuses[LOG_STATUSES] = { "rechazada", "aceptada", "bloqueó la puerta" };
+
+/***********************************************************************************************************************************
+ *** FUNCIONES
+ **********************************************************************************************************************************/
+int main(int argc, char* argv[])
+{
+    const char* path = CTL_SERVER;
+    Ctl_t ctl = { NULL, -1, 0, DOOR_GLOBAL, MAX_LOG, 0 };
+    int opt;
+
+    while ((opt = getopt(argc, argv, "p:jd:n:")) != -1){
+        switch (opt){
+            case 'p': path = optarg; break;
+            case 'j': ctl.json = 1; break;
+            case 'd': ctl.door = (int)strtol(optarg, NULL, 10); break;
+            case 'n': ctl.tail = (int)strtol(optarg, NULL, 10); break;
+            default:
+                printf("Uso: %s [-p servidor] [-j] [-d puerta] [-n entradas] [claves|log|stats|bloqueo|todo]\n", argv[0]);
+                return 1;
+        }
+    }
+    for (int i = optind; i < argc; i++){
+        static const char* const names[] = { "claves", "log", "stats", "bloqueo", "todo" };
+        static const int flags[] = { SHOW_KEYS, SHOW_LOG, SHOW_STATS, SHOW_LOCKS, SHOW_ALL };
+        int found = 0;
+        for (int n = 0; n < 5; n++){
+            if (strcmp(argv[i], names[n]) == 0){
+                ctl.show |= flags[n];
+                found = 1;
+            }
+        }
+        if (!found){
+            printf("Sección desconocida: %s (claves, log, stats, bloqueo o todo)\n", argv[i]);
+            return 1;
+        }
+    }
+    if (ctl.show == 0){
+        ctl.show = SHOW_ALL;
+    }
+    if (ctl.tail < 0 || ctl.tail > MAX_LOG){
+        ctl.tail = MAX_LOG;
+    }
+
+    ctl.shm = Attach(path);
+    if (ctl.shm == NULL){
+        return 1;
+    }
+    if (ctl.door != DOOR_GLOBAL && (ctl.door < 0 || ctl.door >= (int)ctl.shm->header.doors)){
+        printf("La puerta %d no existe (hay %u)\n", ctl.door, ctl.shm->header.doors);
+        return 1;
+    }
+    key_t key = ftok(path, SEM_ID_K);
+    ctl.sem_global = (key == -1) ? -1 : semget(key, 0, 0);  // Sin IPC_CREAT: si no está, no se crea
+
+    int ret = 0;
+    if (ctl.json){
+        printf("{\"puertas\":%u", ctl.shm->header.doors);
+    }
+    else{
+        printf("Memoria compartida: %u puertas, %u entradas de log por puerta, %llu bytes (formato %u)\n",
+               ctl.shm->header.doors, ctl.shm->header.max_log, (unsigned long long)ctl.shm->header.size,
+               ctl.shm->header.version);
+    }
+    if ((ctl.show & SHOW_KEYS) && ShowKeys(&ctl) < 0){
+        ret = 1;
+    }
+    if ((ctl.show & SHOW_LOG) && ShowLog(&ctl) < 0){
+        ret = 1;
+    }
+    if ((ctl.show & SHOW_STATS) && ShowStats(&ctl) < 0){
+        ret = 1;
+    }
+    if ((ctl.show & SHOW_LOCKS) && ShowLocks(&ctl) < 0){
+        ret = 1;
+    }
+    if (ctl.json){
+        printf("}\n");
+    }
+    shmdt(ctl.shm);
+    return ret;
+}
+
+/***********************************************************************************************************************************
+ *** FUNCIONES PRIVADAS AL MODULO
+ **********************************************************************************************************************************/
+/**
+ * \fn static const ShmLayout_t* Attach(const char* _path)
+ * \brief Se engancha en solo lectura a la memoria compartida del servidor y valida su formato.
+ * \details Se busca con la misma clave IPC que el servidor (ftok() de su binario). Solo se usa si el encabezado
+ * coincide con las estructuras con que se compiló esta herramienta.
+ * \param [in] _path: Binario con que se arrancó el servidor.
+ * \return Segmento. NULL si no hay servidor corriendo o el formato es otro.
+*/
+static const ShmLayout_t* Attach(const char* _path)
+{
+    struct shmid_ds info;
+
+    key_t key = ftok(_path, SM_ID);
+    if (key == -1){
+        perror(_path);
+        return NULL;
+    }
+    int id = shmget(key, 0, 0);
+    if (id == -1){
+        printf("No hay memoria compartida de %s: ¿está corriendo el servidor?\n", _path);
+        return NULL;
+    }
+    const ShmLayout_t* shm = (const ShmLayout_t*)shmat(id, NULL, SHM_RDONLY);
+    if (shm == (void*)-1){
+        perror("Error al enganchar la memoria compartida");
+        return NULL;
+    }
+    if (shmctl(id, IPC_STAT, &info) == -1 || info.shm_segsz < sizeof(ShmHeader_t) || shm->header.magic != SHM_MAGIC){
+        printf("La memoria compartida de %s no es de este servidor\n", _path);
+        shmdt(shm);
+        return NULL;
+    }
+    const ShmHeader_t* header = &shm->header;
+    if (header->version != SHM_VERSION || header->max_log != MAX_LOG || header->shard_size != sizeof(KeyShard_t)
+        || header->door_size != sizeof(DoorShm_t) || header->doors > MAX_DOORS
+        || header->global_offset != offsetof(ShmLayout_t, global_keys) || header->doors_offset != offsetof(ShmLayout_t, door)
+        || header->size > info.shm_segsz || !RegionsValid(header)){
+        printf("La memoria compartida tiene otro formato (versión %u, esta herramienta lee la %u): recompilar con el servidor\n",
+               header->version, SHM_VERSION);
+        shmdt(shm);
+        return NULL;
+    }
+    return shm;
+}
+
+/**
+ * \fn static int ShowKeys(const Ctl_t* _ctl)
+ * \brief Muestra las claves globales (si no se eligió una puerta) y las de cada puerta.
+ * \param [in] _ctl: Pedido.
+ * \return Devuelve -1 si alguna lista no se pudo copiar. 0 sino.
+*/
+static int ShowKeys(const Ctl_t* _ctl)
+{
+    int ret = 0;
+    int comma = 0;
+
+    if (_ctl->json){
+        printf(",\"claves\":[");
+    }
+    if (_ctl->door == DOOR_GLOBAL){
+        ret |= ShowShard(_ctl, &_ctl->shm->global_keys, DOOR_GLOBAL, comma++);
+    }
+    for (int d = 0; d < (int)_ctl->shm->header.doors; d++){
+        if (Selected(_ctl, d)){
+            ret |= ShowShard(_ctl, &_ctl->shm->door[d].keys, d, comma++);
+        }
+    }
+    if (_ctl->json){
+        printf("]");
+    }
+    return ret;
+}
+
+/**
+ * \fn static int ShowShard(const Ctl_t* _ctl, const KeyShard_t* _shard, int _door, int _comma)
+ * \brief Muestra una lista de claves con sus reglas.
+ * \param [in] _ctl: Pedido.
+ * \param [in] _shard: Lista.
+ * \param [in] _door: Puerta o DOOR_GLOBAL.
+ * \param [in] _comma: 1 si va una coma antes (JSON).
+ * \return Devuelve -1 si no se pudo copiar. 0 sino.
+*/
+static int ShowShard(const Ctl_t* _ctl, const KeyShard_t* _shard, int _door, int _comma)
+{
+    char code[KEY_SIZE + 1];
+    char rule[160];
+    uint32_t version;
+
+    int count = KeyShardRead(_shard, keys, rules, &version);
+    if (count < 0){
+        if (_ctl->json){
+            printf("%s{\"puerta\":%d,\"error\":\"en cambio\"}", _comma ? "," : "", _door);
+        }
+        else{
+            printf("\nClaves de la puerta %d: siempre en cambio, no se pudo copiar\n", _door);
+        }
+        return -1;
+    }
+    if (_ctl->json){
+        if (_door == DOOR_GLOBAL){
+            printf("%s{\"puerta\":\"global\",\"version\":%u,\"claves\":[", _comma ? "," : "", version);
+        }
+        else{
+            printf("%s{\"puerta\":%d,\"version\":%u,\"claves\":[", _comma ? "," : "", _door, version);
+        }
+        for (int i = 0; i < count; i++){
+            RuleText(&rules[i], 1, rule, sizeof(rule));
+            printf("%s{\"clave\":\"%s\"%s}", i ? "," : "", KeyToString(keys[i], code), rule);
+        }
+        printf("]}");
+        return 0;
+    }
+    if (_door == DOOR_GLOBAL){
+        printf("\nClaves globales: %d (versión %u)\n", count, version);
+    }
+    else{
+        printf("\nClaves de la puerta %d: %d (versión %u)\n", _door, count, version);
+    }
+    for (int i = 0; i < count; i++){
+        RuleText(&rules[i], 0, rule, sizeof(rule));
+        printf("  %s%s\n", KeyToString(keys[i], code), rule);
+    }
+    return 0;
+}
+
+/**
+ * \fn static int ShowLog(const Ctl_t* _ctl)
+ * \brief Muestra las últimas _ctl->tail entradas del log de cada puerta, de la más vieja a la más nueva.
+ * \param [in] _ctl: Pedido.
+ * \return Devuelve -1 si algún log no se pudo copiar. 0 sino.
+*/
+static int ShowLog(const Ctl_t* _ctl)
+{
+    ActivityEntry_t log[MAX_LOG];
+    char code[KEY_SIZE + 1];
+    int ret = 0;
+    int comma = 0;
+
+    if (_ctl->json){
+        printf(",\"log\":[");
+    }
+    for (int d = 0; d < (int)_ctl->shm->header.doors; d++){
+        if (!Selected(_ctl, d)){
+            continue;
+        }
+        int entries = LogRead(_ctl->shm->door[d].log, &_ctl->shm->door[d].index, log, NULL);
+        if (entries < 0){
+            if (!_ctl->json){
+                printf("\nLog de la puerta %d: siempre en cambio, no se pudo copiar\n", d);
+            }
+            ret = -1;
+            continue;
+        }
+        int first = (entries > _ctl->tail) ? entries - _ctl->tail : 0;
+        if (!_ctl->json){
+            printf("\nLog de la puerta %d: %d de %d entradas\n", d, entries - first, entries);
+        }
+        for (int i = first; i < entries; i++){
+            const TimeCache_t* when = TimeFormat(log[i].time_ns);
+            KeyEntry_t key = { .code = log[i].code };
+            int status = LogEntryStatus(&log[i]);
+            if (_ctl->json){
+                printf("%s{\"puerta\":%d,\"fecha\":\"%s\",\"hora\":\"%s\",\"clave\":\"%s\",\"estado\":\"%d\"}",
+                       comma++ ? "," : "", d, when->date, when->hour, KeyToString(key, code), status);
+            }
+            else{
+                printf("  %s %s  %s  %s\n", when->date, when->hour, KeyToString(key, code), statuses[status]);
+            }
+        }
+    }
+    if (_ctl->json){
+        printf("]");
+    }
+    return ret;
+}
+
+/**
+ * \fn static int ShowStats(const Ctl_t* _ctl)
+ * \brief Muestra lo mismo que GET /stats (o /doors/<id>/stats con -d): intentos por hora y por día.
+ * \details Los anillos están en la memoria compartida (StatsTable_t) y se copian con StatsRead(), sin el lock.
+ * Después van las entradas del log por puerta y estado (contadores del índice).
+ * \param [in] _ctl: Pedido.
+ * \return Devuelve -1 si los anillos o algún log no se pudieron copiar. 0 sino.
+*/
+static int ShowStats(const Ctl_t* _ctl)
+{
+    StatsBucket_t hours[CTL_HOURS];
+    StatsBucket_t days[CTL_DAYS];
+    int ret = 0;
+    int shown = 0;
+
+    if (StatsRead(&_ctl->shm->stats, _ctl->door, CTL_HOURS, CTL_DAYS, hours, days) < 0){
+        printf(_ctl->json ? ",\"stats\":{\"error\":\"en cambio\"" : "\n/stats: siempre en cambio, no se pudo copiar\n");
+        ret = -1;
+    }
+    else if (_ctl->json){
+        printf(",\"stats\":{\"horas\":[");
+        for (int i = 0; i < CTL_HOURS; i++){
+            const TimeCache_t* when = TimeFormat(hours[i].start_ns);
+            printf("%s{\"fecha\":\"%s\",\"hora\":\"%.5s\",\"aceptadas\":%u,\"rechazadas\":%u}", i ? "," : "",
+                   when->date, when->hour, hours[i].count.accepted, hours[i].count.denied);
+        }
+        printf("],\"dias\":[");
+        for (int i = 0; i < CTL_DAYS; i++){
+            const TimeCache_t* when = TimeFormat(days[i].start_ns);
+            printf("%s{\"fecha\":\"%s\",\"aceptadas\":%u,\"rechazadas\":%u}", i ? "," : "", when->date,
+                   days[i].count.accepted, days[i].count.denied);
+        }
+        printf("]");
+    }
+    else{
+        if (_ctl->door == DOOR_GLOBAL){
+            printf("\n/stats de todas las puertas (aceptadas / rechazadas)\n");
+        }
+        else{
+            printf("\n/stats de la puerta %d (aceptadas / rechazadas)\n", _ctl->door);
+        }
+        printf("  últimas %d horas:\n", CTL_HOURS);
+        for (int i = 0; i < CTL_HOURS; i++){
+            if (hours[i].count.accepted != 0 || hours[i].count.denied != 0){
+                const TimeCache_t* when = TimeFormat(hours[i].start_ns);
+                printf("    %s %.5s  %u / %u\n", when->date, when->hour, hours[i].count.accepted, hours[i].count.denied);
+                shown++;
+            }
+        }
+        if (shown == 0){
+            printf("    sin intentos\n");
+        }
+        printf("  últimos %d días:\n", CTL_DAYS);
+        for (int i = 0; i < CTL_DAYS; i++){
+            printf("    %s        %u / %u\n", TimeFormat(days[i].start_ns)->date, days[i].count.accepted,
+                   days[i].count.denied);
+        }
+    }
+    if (ShowLogCounts(_ctl) < 0){
+        ret = -1;
+    }
+    if (_ctl->json){
+        printf("}");
+    }
+    return ret;
+}
+
+/**
+ * \fn static int ShowLogCounts(const Ctl_t* _ctl)
+ * \brief Muestra las entradas del log por puerta y estado (contadores del índice) y la cantidad de claves.
+ * \param [in] _ctl: Pedido.
+ * \return Devuelve -1 si algún log no se pudo copiar. 0 sino.
+*/
+static int ShowLogCounts(const Ctl_t* _ctl)
+{
+    ActivityEntry_t log[MAX_LOG];
+    uint32_t count[LOG_STATUSES];
+    uint32_t total[LOG_STATUSES] = { 0 };
+    int ret = 0;
+    int comma = 0;
+
+    printf(_ctl->json ? ",\"log\":[" : "\nEntradas del log por puerta (rechazadas / aceptadas / bloquearon la puerta)\n");
+    for (int d = 0; d < (int)_ctl->shm->header.doors; d++){
+        if (!Selected(_ctl, d)){
+            continue;
+        }
+        int entries = LogRead(_ctl->shm->door[d].log, &_ctl->shm->door[d].index, log, count);
+        int nkeys = KeyShardRead(&_ctl->shm->door[d].keys, keys, NULL, NULL);
+        if (entries < 0 || nkeys < 0){
+            ret = -1;
+            continue;
+        }
+        for (int s = 0; s < LOG_STATUSES; s++){
+            total[s] += count[s];
+        }
+        if (_ctl->json){
+            printf("%s{\"puerta\":%d,\"rechazados\":%u,\"aceptados\":%u,\"bloqueos\":%u,\"log\":%d,\"claves\":%d}",
+                   comma++ ? "," : "", d, count[0], count[1], count[2], entries, nkeys);
+        }
+        else{
+            printf("  puerta %d: %u / %u / %u  (log %d/%d, %d claves propias)\n", d, count[0], count[1], count[2],
+                   entries, MAX_LOG, nkeys);
+        }
+    }
+    int nglobal = KeyShardRead(&_ctl->shm->global_keys, keys, NULL, NULL);
+    if (_ctl->json){
+        printf("],\"total\":{\"rechazados\":%u,\"aceptados\":%u,\"bloqueos\":%u,\"claves_globales\":%d}",
+               total[0], total[1], total[2], nglobal);
+    }
+    else{
+        printf("  total:   %u / %u / %u  (%d claves globales)\n", total[0], total[1], total[2], nglobal);
+    }
+    return (nglobal < 0) ? -1 : ret;
+}
+
+/**
+ * \fn static int ShowLocks(const Ctl_t* _ctl)
+ * \brief Muestra el estado del semáforo de las claves globales, los cambios en curso, el bloqueo de cada puerta y
+ * los orígenes web.
+ * \details El semáforo se consulta con semctl() sin operar sobre él. Los semáforos de cada puerta son privados
+ * (IPC_PRIVATE) y no se pueden buscar desde afuera: en su lugar se muestra si hay un cambio a medias (seq impar).
+ * El bloqueo de cada puerta es su Lockout_t en la memoria compartida; el último bloqueo por intentos sale de la
+ * cadena de estado 2 del índice.
+ * \param [in] _ctl: Pedido.
+ * \return Devuelve -1 si algún log no se pudo copiar. 0 sino.
+*/
+static int ShowLocks(const Ctl_t* _ctl)
+{
+    ActivityEntry_t log[MAX_LOG];
+    Lockout_t lockout;
+    char when[32];
+    char until[32];
+    int64_t now = TimeNowNs();
+    int ret = 0;
+    int comma = 0;
+
+    int value = -1, waiting = -1, pid = -1;
+    if (_ctl->sem_global != -1){
+        value = semctl(_ctl->sem_global, 0, GETVAL);
+        waiting = semctl(_ctl->sem_global, 0, GETNCNT);
+        pid = semctl(_ctl->sem_global, 0, GETPID);
+    }
+    int global_busy = __atomic_load_n(&_ctl->shm->global_keys.seq, __ATOMIC_ACQUIRE) & 1;
+    if (_ctl->json){
+        printf(",\"bloqueo\":{\"semaforo\":");
+        if (value < 0){
+            printf("null");
+        }
+        else{
+            printf("{\"libre\":%s,\"esperando\":%d,\"pid\":%d}", value > 0 ? "true" : "false", waiting, pid);
+        }
+        printf(",\"cambiando_globales\":%s,\"puertas\":[", global_busy ? "true" : "false");
+    }
+    else{
+        printf("\nBloqueo\n");
+        if (value < 0){
+            printf("  semáforo de las claves globales: no encontrado\n");
+        }
+        else{
+            printf("  semáforo de las claves globales: %s, %d esperando, último pid %d\n", value > 0 ? "libre" : "tomado",
+                   waiting, pid);
+        }
+        printf("  claves globales: %s\n", global_busy ? "cambio en curso" : "sin cambios en curso");
+    }
+
+    for (int d = 0; d < (int)_ctl->shm->header.doors; d++){
+        const DoorShm_t* door = &_ctl->shm->door[d];
+        if (!Selected(_ctl, d)){
+            continue;
+        }
+        int keys_busy = __atomic_load_n(&door->keys.seq, __ATOMIC_ACQUIRE) & 1;
+        int log_busy = __atomic_load_n(&door->index.seq, __ATOMIC_ACQUIRE) & 1;
+        uint32_t pending = __atomic_load_n(&door->keys.expire_count, __ATOMIC_RELAXED);
+        int entries = LogRead(door->log, &door->index, log, NULL);
+        int64_t last_ns = 0;
+        for (int i = 0; i < entries; i++){
+            if (LogEntryStatus(&log[i]) == 2){
+                last_ns = log[i].time_ns;
+            }
+        }
+        if (entries < 0){
+            ret = -1;
+        }
+        LocalTime(last_ns, "%Y-%m-%dT%H:%M:%S", when, sizeof(when));
+        LockoutRead(&door->lockout, &lockout);
+        const char* locked = LockoutWhen(lockout.locked_until_ns, now, until, sizeof(until));
+        if (_ctl->json){
+            printf("%s{\"puerta\":%d,\"cambiando_claves\":%s,\"cambiando_log\":%s,\"vencimientos_pendientes\":%u,"
+                   "\"ultimo_bloqueo\":", comma++ ? "," : "", d, keys_busy ? "true" : "false", log_busy ? "true" : "false",
+                   pending);
+            printf(last_ns ? "\"%s\"" : "null", when);
+            printf(",\"bloqueada_hasta\":");
+            printf(locked ? "\"%s\"" : "null", until);
+            printf(",\"descartados\":%u,\"fallas\":%u,\"fallas_anteriores\":%u}", lockout.suppressed,
+                   lockout.window.current, lockout.window.previous);
+        }
+        else{
+            printf("  puerta %d: claves %s, log %s, %u vencimientos sin programar, último bloqueo por intentos: %s\n", d,
+                   keys_busy ? "cambiando" : "quietas", log_busy ? "cambiando" : "quieto", pending,
+                   last_ns ? when : "ninguno en el log");
+            if (locked){
+                printf("           bloqueada hasta %s, %u intentos descartados\n", until, lockout.suppressed);
+            }
+            else{
+                printf("           sin bloqueo, %u fallas en la ventana actual y %u en la anterior\n",
+                       lockout.window.current, lockout.window.previous);
+            }
+        }
+    }
+    if (_ctl->json){
+        printf("]");
+    }
+    if (ShowSources(_ctl) < 0){
+        ret = -1;
+    }
+    if (_ctl->json){
+        printf("}");
+    }
+    return ret;
+}
+
+/**
+ * \fn static int ShowSources(const Ctl_t* _ctl)
+ * \brief Muestra los orígenes web con fallas recientes (LockoutTable_t), copiados con LockoutSourcesRead().
+ * \param [in] _ctl: Pedido.
+ * \return Devuelve -1 si la tabla no se pudo copiar. 0 sino.
+*/
+static int ShowSources(const Ctl_t* _ctl)
+{
+    char addr[INET6_ADDRSTRLEN];
+    char last[32];
+    char until[32];
+    int64_t now = TimeNowNs();
+
+    int count = LockoutSourcesRead(&_ctl->shm->lockout, sources);
+    if (count < 0){
+        printf(_ctl->json ? ",\"origenes\":null" : "  orígenes web: siempre en cambio, no se pudo copiar\n");
+        return -1;
+    }
+    printf(_ctl->json ? ",\"origenes\":[" : "  orígenes web con fallas: %d\n", count);
+    for (int i = 0; i < count; i++){
+        const LockoutSource_t* src = &sources[i];
+        static const uint8_t mapped[12] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xFF, 0xFF };
+        if (memcmp(src->addr, mapped, sizeof(mapped)) == 0){     // IPv4 mapeada: se muestra como IPv4
+            inet_ntop(AF_INET, src->addr + 12, addr, sizeof(addr));
+        }
+        else{
+            inet_ntop(AF_INET6, src->addr, addr, sizeof(addr));
+        }
+        LocalTime(src->last_ns, "%Y-%m-%dT%H:%M:%S", last, sizeof(last));
+        const char* locked = LockoutWhen(src->state.locked_until_ns, now, until, sizeof(until));
+        if (_ctl->json){
+            printf("%s{\"ip\":\"%s\",\"ultima_falla\":\"%s\",\"fallas\":%u,\"fallas_anteriores\":%u,\"bloqueado_hasta\":",
+                   i ? "," : "", addr, last, src->state.window.current, src->state.window.previous);
+            printf(locked ? "\"%s\"" : "null", until);
+            printf(",\"descartados\":%u}", src->state.suppressed);
+        }
+        else if (locked){
+            printf("    %s: bloqueado hasta %s, %u pedidos rechazados (última falla %s)\n", addr, until,
+                   src->state.suppressed, last);
+        }
+        else{
+            printf("    %s: %u fallas en la ventana actual y %u en la anterior (última %s)\n", addr,
+                   src->state.window.current, src->state.window.previous, last);
+        }
+    }
+    if (_ctl->json){
+        printf("]");
+    }
+    return 0;
+}
+
+/**
+ * \fn static int RegionsValid(const ShmHeader_t* _header)
+ * \brief Compara la tabla de regiones del encabezado con las estructuras con que se compiló esta herramienta.
+ * \param [in] _header: Encabezado.
+ * \return 1 si todas coinciden y están alineadas a CACHE_LINE. 0 sino.
+*/
+static int RegionsValid(const ShmHeader_t* _header)
+{
+    static const ShmRegion_t expected[SHM_REGIONS] = {
+        [SHM_STATS] = { offsetof(ShmLayout_t, stats), sizeof(StatsTable_t) },
+        [SHM_LOCKOUT] = { offsetof(ShmLayout_t, lockout), sizeof(LockoutTable_t) },
+        [SHM_ACTUATOR] = { offsetof(ShmLayout_t, actuator), sizeof(ActuatorStats_t) },
+        [SHM_BUFPOOL] = { offsetof(ShmLayout_t, bufpool), sizeof(BufPoolStats_t) },
+        [SHM_CHILDREN] = { offsetof(ShmLayout_t, children), sizeof(ChildStats_t) },
+        [SHM_TLS] = { offsetof(ShmLayout_t, tls), sizeof(TlsStats_t) },
+    };
+
+    for (int r = 0; r < SHM_REGIONS; r++){
+        if (_header->region[r].offset != expected[r].offset || _header->region[r].size != expected[r].size
+            || _header->region[r].offset % CACHE_LINE != 0 || _header->region[r].offset + _header->region[r].size > _header->size){
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * \fn static const char* LockoutWhen(int64_t _until_ns, int64_t _now_ns, char* _out, size_t _size)
+ * \brief Formatea el fin de un bloqueo si todavía no pasó.
+ * \details locked_until_ns sigue puesto hasta el próximo intento después del fin: se compara con la hora actual.
+ * \param [in] _until_ns: Fin del bloqueo. 0 si no hay.
+ * \param [in] _now_ns: Instante actual.
+ * \param [out] _out: Texto.
+ * \param [in] _size: Tamaño de _out.
+ * \return _out si sigue bloqueado. NULL sino.
+*/
+static const char* LockoutWhen(int64_t _until_ns, int64_t _now_ns, char* _out, size_t _size)
+{
+    _out[0] = '\0';
+    if (_until_ns == 0 || _until_ns <= _now_ns){
+        return NULL;
+    }
+    LocalTime(_until_ns, "%Y-%m-%dT%H:%M:%S", _out, _size);
+    return _out;
+}
+
+/**
+ * \fn static void RuleText(const KeyRule_t* _rule, int _json, char* _out, size_t _size)
+ * \brief Describe la regla de una clave con los mismos nombres que GET /claves/reglas.
+ * \param [in] _rule: Regla.
+ * \param [in] _json: 1 para campos JSON (",\"desde\":..."), 0 para texto.
+ * \param [out] _out: Texto. Vacío si la clave es permanente.
+ * \param [in] _size: Tamaño de _out.
+*/
+static void RuleText(const KeyRule_t* _rule, int _json, char* _out, size_t _size)
+{
+    static const char* const days[7] = { "dom", "lun", "mar", "mie", "jue", "vie", "sab" };
+    const char* format = _json ? ",\"%s\":\"%s\"" : "  %s %s";
+    int64_t limits[2] = { _rule->start_ns, _rule->end_ns };
+    const char* names[2] = { "desde", "hasta" };
+    char text[32];
+    size_t pos = 0;
+
+    _out[0] = '\0';
+    for (int l = 0; l < 2 && pos < _size; l++){
+        if (limits[l] != 0){
+            LocalTime(limits[l], "%Y-%m-%dT%H:%M", text, sizeof(text));
+            pos += snprintf(_out + pos, _size - pos, format, names[l], text);
+        }
+    }
+    if (_rule->weekdays != 0 && pos < _size){
+        size_t len = 0;
+        for (int d = 0; d < 7; d++){
+            if (_rule->weekdays & (1 << d)){
+                len += snprintf(text + len, sizeof(text) - len, "%s%s", len ? "," : "", days[d]);
+            }
+        }
+        pos += snprintf(_out + pos, _size - pos, format, "dias", text);
+    }
+    if (_rule->from_min != _rule->to_min && pos < _size){
+        snprintf(text, sizeof(text), "%02d:%02d-%02d:%02d", _rule->from_min / 60, _rule->from_min % 60,
+                 _rule->to_min / 60, _rule->to_min % 60);
+        pos += snprintf(_out + pos, _size - pos, format, "horario", text);
+    }
+    if ((_rule->flags & RULE_ONE_TIME) && pos < _size){
+        snprintf(_out + pos, _size - pos, _json ? ",\"unico\":true" : "  un solo uso");
+    }
+}
+
+/**
+ * \fn static void LocalTime(int64_t _time_ns, const char* _format, char* _out, size_t _size)
+ * \brief Formatea un instante en hora local con strftime().
+ * \param [in] _time_ns: Instante en ns desde epoch.
+ * \param [in] _format: Formato de strftime().
+ * \param [out] _out: Texto.
+ * \param [in] _size: Tamaño de _out.
+*/
+static void LocalTime(int64_t _time_ns, const char* _format, char* _out, size_t _size)
+{
+    time_t when = (time_t)(_time_ns / 1000000000LL);
+    struct tm local;
+
+    localtime_r(&when, &local);
+    if (strftime(_out, _size, _format, &local) == 0){
+        _out[0] = '\0';
+    }
+}
+
+/**
+ * \fn static int Selected(const Ctl_t* _ctl, int _door)
+ * \brief Indica si hay que mostrar una puerta.
+ * \param [in] _ctl: Pedido.
+ * \param [in] _door: Puerta.
+ * \return 1 si se muestra. 0 sino.
+*/
+static int Selected(const Ctl_t* _ctl, int _door)
+{
+    return (_ctl->door == DOOR_GLOBAL || _ctl->door == _door);
+}
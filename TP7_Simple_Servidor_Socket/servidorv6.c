@@ -41,7 +41,7 @@ int mantener_on = TRUE;
 
 int crear_server(int *socket_fd);
 
-void hijo (int n_socket_fd, struct sockaddr_in dir_cliente);
+void hijo (int n_socket_fd, struct sockaddr_in6 dir_cliente);
 void atiendo_chld (int signal);
 void atiendo_usr1 (int signal);
 
@@ -50,8 +50,8 @@ int main (void)
     int pid;
     int error;
     int socket_fd, n_socket_fd;
-    struct sockaddr_in dir_cliente;
-    socklen_t tamanio = sizeof(struct sockaddr);    
+    struct sockaddr_in6 dir_cliente;
+    socklen_t tamanio = sizeof(struct sockaddr_in6);    
 
     error = crear_server(&socket_fd);       //Creo e inicializo el server
 
@@ -102,12 +102,14 @@ int main (void)
     return 0;
 }
 
-void hijo (int n_socket_fd, struct sockaddr_in dir_cliente)
+void hijo (int n_socket_fd, struct sockaddr_in6 dir_cliente)
 {
     int error;
     char mensaje[LARGO];
+    char ip[INET6_ADDRSTRLEN];
 
-    printf("El cliente %s se conectó por el puerto %d.\n", inet_ntoa(dir_cliente.sin_addr), dir_cliente.sin_port);
+    inet_ntop(AF_INET6, &dir_cliente.sin6_addr, ip, sizeof(ip));    //Los clientes IPv4 aparecen como ::ffff:a.b.c.d
+    printf("El cliente %s se conectó por el puerto %d.\n", ip, ntohs(dir_cliente.sin6_port));
 
     error = recv (n_socket_fd, mensaje, LARGO, 0);
     if (error == -1)
@@ -160,10 +162,11 @@ void atiendo_usr1 (int signal)
 int crear_server(int *socket_fd)
 {
     int error = SIN_ERROR;
-    struct sockaddr_in dir_server;
-    int optval;
+    struct sockaddr_in6 dir_server;
+    int optval = 1;
+    int v6only = 0;
 
-    (*socket_fd) = socket(AF_INET, SOCK_STREAM, 0);     //Creo el socket
+    (*socket_fd) = socket(AF_INET6, SOCK_STREAM, 0);    //Creo el socket IPv6
     if ((*socket_fd) == -1)
     {
         perror("Error de socket");
@@ -179,15 +182,25 @@ int crear_server(int *socket_fd)
             error = ERROR;
         }
     }
+
+    if(error != ERROR)      //Dual-stack: también atiende clientes IPv4
+    {
+        error = setsockopt((*socket_fd), IPPROTO_IPV6, IPV6_V6ONLY, &v6only, sizeof(int));
+        if (error == -1)
+        {
+            perror("Error de setsockopt IPV6_V6ONLY");
+            error = ERROR;
+        }
+    }
     
     if(error != ERROR)      //Enlazo el server a una IP
     {
-        dir_server.sin_family = AF_INET;
-        dir_server.sin_port = htons(PUERTO);
-        dir_server.sin_addr.s_addr = htonl(INADDR_ANY);
-        memset(&(dir_server.sin_zero), 0, 8);
+        memset(&dir_server, 0, sizeof(dir_server));
+        dir_server.sin6_family = AF_INET6;
+        dir_server.sin6_port = htons(PUERTO);
+        dir_server.sin6_addr = in6addr_any;
 
-        error = bind ((*socket_fd), (struct sockaddr *) &dir_server, sizeof(struct sockaddr));
+        error = bind ((*socket_fd), (struct sockaddr *) &dir_server, sizeof(dir_server));
         if (error == -1)
         {
             perror("Error de bind");